@@ -0,0 +1,40 @@
+%a = cfo_correct_fd(a, f_cfo, df, N_fft, N_taps = 32)
+%
+% Applies frequency domain CFO matrix (see cfo_fd_mtx) to the subcarriers
+% of RE grid a. The matrix is Toeplitz and its elements decay as 1/d with
+% the distance d from the diagonal, so it is truncated to a band of
+% 2*N_taps+1 diagonals and applied as a convolution along subcarriers of
+% all symbols and antennas at once. Subcarriers outside of the grid do
+% not contribute, as in cfo_fd_mtx(N_fft, f_cfo, df)(k,k).
+%
+% Arguments:
+%  a         - RE grid of size [N_sc,N_sym,N_ant]
+%  f_cfo     - CFO in Hz
+%  df        - subcarrier spacing
+%  N_fft     - FFT size
+%  N_taps    - number of ICI kernel taps on each side of the main tap
+%
+% Returns:
+%  a         - RE grid with applied CFO matrix
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function a = cfo_correct_fd(a, f_cfo, df, N_fft, N_taps)
+  if nargin < 5
+    N_taps = 32;
+  end
+
+  assert(isscalar(f_cfo), 'f_cfo must be scalar');
+
+  if f_cfo == 0
+    return;
+  end
+
+  N_taps = min(N_taps, size(a,1) - 1);
+  d = (-N_taps : N_taps)' + f_cfo / df;
+  c = sin(pi*d) ./ (N_fft*sin(pi*d/N_fft)) .* exp(1i*pi*d*(1-1/N_fft));
+
+  % out(m) = sum_d c(d) * a(m-d)
+  dims = size(a);
+  a = reshape(conv2(reshape(a, dims(1), []), c, 'same'), dims);
+end
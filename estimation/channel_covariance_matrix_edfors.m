@@ -1,4 +1,4 @@
-%R_hh = channel_covariance_matrix_edfors(N_fft, L, t_rms)
+%R_hh = channel_covariance_matrix_edfors(N_fft, L, t_rms, k_idx)
 %
 % Calculates approximation of the multipath channel covariance 
 % matrix according to [1] Equation (11).
@@ -11,17 +11,22 @@
 %  N_fft     - FFT size
 %  L         - number of multipath components
 %  t_rms     - RMS delay spread of the channel (in samples)
+%  k_idx     - optional vector of subcarrier indices. If given, only
+%              the submatrix R_hh(k_idx,k_idx) is calculated
 %
 % Returns:
 %  R_hh      - covariance matrix
 
 % Copyright 2018 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function R_hh = channel_covariance_matrix_edfors(N_fft, L, t_rms)
-  R_hh = zeros(N_fft);
+function R_hh = channel_covariance_matrix_edfors(N_fft, L, t_rms, k_idx)
+  if nargin < 4
+    k_idx = 1 : N_fft;
+  end
 
-  m = repmat((0:N_fft-1)', [1 N_fft]);
-  n = repmat((0:N_fft-1) , [N_fft 1]);
+  % the matrix is Toeplitz, elements depend on m-n only
+  m = repmat(reshape(k_idx, [], 1), [1 length(k_idx)]);
+  n = repmat(reshape(k_idx, 1, []), [length(k_idx) 1]);
 
   R_hh = (1 - exp(-L * (1/t_rms + 2i*pi*(m-n)/N_fft) )) ./ (t_rms * (1 - exp(-L/t_rms)) .* (1/t_rms + 2i*pi*(m-n)/N_fft) );
-end
\ No newline at end of file
+end
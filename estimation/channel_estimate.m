@@ -1,5 +1,5 @@
 %[H_est, v] = channel_estimate_LS(x_p, y_p, f_interp, t_interp, avg, method='LS')
-%[H_est, v] = channel_estimate_LS(x_p, y_p, f_interp, t_interp, avg, method='MMSE', N_fft)
+%[H_est, v] = channel_estimate_LS(x_p, y_p, f_interp, t_interp, avg, method='MMSE', N_fft, rank=0)
 %
 % Estimates the wireless channel matrix H using Least-Squares or 
 % Minimum Mean Squared Error method. Performs interpolation of 
@@ -16,6 +16,7 @@
 %              estimate of frequency-time grid [A_freq,A_time]
 %  method    - channel estimator: 'LS' or 'MMSE'
 %  N_fft     - OFDM FFT size
+%  rank      - rank of the MMSE filter, 0 for full rank
 %
 % Returns:
 %  H_est     - estimated channel time-frequency grid
@@ -24,7 +25,7 @@
 
 % Copyright 2018 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function [H_est, P_noise, P_signal] = channel_estimate(x_p, y_p, k_idx, l_idx, grid_size, avg, method, N_fft)
+function [H_est, P_noise, P_signal] = channel_estimate(x_p, y_p, k_idx, l_idx, grid_size, avg, method, N_fft, rank)
   assert(all(size(x_p) == size(y_p)), 'x_p and y_p must have the same sizes');
   assert(length(k_idx) == size(x_p,1), 'length of k_idx must be the same as the fist dimension of pilot matrix');
   assert(length(l_idx) == size(x_p,2), 'length of l_idx must be the same as the second dimension of pilot matrix');
@@ -32,8 +33,12 @@ function [H_est, P_noise, P_signal] = channel_estimate(x_p, y_p, k_idx, l_idx, g
   if nargin < 7
     method = 'LS';
   end
-
-  persistent R_hh N_fft_R_hh
+  if nargin < 8
+    N_fft = 0;
+  end
+  if nargin < 9
+    rank = 0;
+  end
 
   k_idx = reshape(k_idx, [], 1);
   l_idx = reshape(l_idx, [], 1);
@@ -51,19 +56,12 @@ function [H_est, P_noise, P_signal] = channel_estimate(x_p, y_p, k_idx, l_idx, g
   P_noise = var(H_est_raw_avg(:) - H_est_raw(:));
   P_signal = var(H_est_raw_avg(:));
 
-  if strcmpi(method, 'MMSE')
-    if isempty(R_hh) || N_fft_R_hh ~= N_fft
-      N_fft_R_hh = N_fft;
-      % use magic numbers for L and t_rms
-      R_hh = channel_covariance_matrix_edfors(N_fft, 10, 32);
-    end
+  % use magic number for t_rms
+  [F_k, F_l, U, w] = channel_estimation_filters(k_idx, l_idx, grid_size, method, N_fft, 32, rank, P_noise / P_signal);
 
-    R_hh_dec = R_hh(k_idx, k_idx);
-    H_est_dec = zeros(size(H_est_raw));
-    S = R_hh_dec * inv(R_hh_dec + P_noise / P_signal * eye(size(R_hh_dec,1)));
-    for n = 1 : length(l_idx)
-      H_est_dec(:,n) = S * H_est_raw(:,n);
-    end
+  if strcmpi(method, 'MMSE')
+    % Wiener filter in the eigenspace of pilot covariance
+    H_est_dec = w .* (U' * H_est_raw);
   elseif strcmpi(method, 'LS') 
     H_est_dec = H_est_raw_avg;
   else
@@ -71,18 +69,5 @@ function [H_est, P_noise, P_signal] = channel_estimate(x_p, y_p, k_idx, l_idx, g
   end
 
   % interpolate
-  if length(l_idx) < 2
-    % 1D interpolation in frequency domain
-    H_est_s = interp1(k_idx, H_est_dec, 1:grid_size(1), 'spline');
-    H_est_s = reshape(H_est_s, [], 1);
-    H_est = repmat(H_est_s, [1 grid_size(2)]);
-  else
-    % 2D interploation
-    X = repmat(reshape(l_idx, 1, []), [length(k_idx) 1]);
-    Y = repmat(reshape(k_idx, [], 1), [1 length(l_idx)]);
-    Xp = repmat(1:grid_size(2), [grid_size(1) 1]);
-    Yp = repmat((1:grid_size(1))', [1 grid_size(2)]);
-
-    H_est = interp2(X, Y, H_est_dec, Xp, Yp, 'spline');
-  end
-end
\ No newline at end of file
+  H_est = F_k * H_est_dec * F_l.';
+end
@@ -0,0 +1,128 @@
+%[F_k, F_l, U, w] = channel_estimation_filters(k_idx, l_idx, grid_size, method, N_fft, t_rms, rank, nsr)
+%
+% Returns channel estimation filters of a pilot pattern. Filters are
+% cached between calls, so that channel estimation of subsequent slots
+% with the same allocation reduces to a few matrix products:
+%
+%   LS:   H_est = F_k * H_p * F_l.'
+%   MMSE: H_est = F_k * (w .* (U' * H_p)) * F_l.'
+%
+% where H_p is the [N_pilot_freq,N_pilot_time] matrix of raw channel
+% estimates at pilot positions. For MMSE, U holds eigenvectors of the
+% pilot covariance matrix from [1] and w the Wiener filter gains of its
+% eigenmodes, so that no matrix inversion is needed when the noise to
+% signal ratio changes. The ratio is quantized to 1 dB steps. F_k and F_l
+% are cubic spline interpolation weights in frequency and time domain
+% (F_k includes the eigenvectors U for MMSE).
+%
+% [1] O. Edfors et. al., "OFDM Channel Estimation by Singular 
+%     Value Decomposition," IEEE Trans. Commun., vol. 46, 
+%     no. 7, July 1998.
+%
+% Arguments:
+%  k_idx     - vector of frequency indices of pilot symbols
+%  l_idx     - vector of time indices of pilot symbols
+%  grid_size - size of frequency-time grid [N_freq,N_time]
+%  method    - channel estimator: 'LS' or 'MMSE'
+%  N_fft     - OFDM FFT size (MMSE only)
+%  t_rms     - RMS delay spread of the channel model in samples (MMSE only)
+%  rank      - number of the strongest eigenmodes kept in the Wiener
+%              filter (MMSE only), 0 for full rank
+%  nsr       - noise to signal ratio of raw estimates (MMSE only)
+%
+% Returns:
+%  F_k       - frequency interpolation matrix of size [N_freq,N_pilot_freq]
+%              for LS or [N_freq,rank] for MMSE
+%  F_l       - time interpolation matrix of size [N_time,N_pilot_time]
+%  U         - eigenvectors of pilot covariance [N_pilot_freq,rank]
+%  w         - Wiener filter gains of eigenmodes [rank,1]
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function [F_k, F_l, U, w] = channel_estimation_filters(k_idx, l_idx, grid_size, method, N_fft, t_rms, rank, nsr)
+  if nargin < 5
+    N_fft = 0;
+    t_rms = 0;
+  end
+  if nargin < 7
+    rank = 0;
+  end
+  if nargin < 8
+    nsr = 0;
+  end
+
+  persistent cache cache_next
+  cache_size = 16;
+
+  k_idx = reshape(k_idx, [], 1);
+  l_idx = reshape(l_idx, [], 1);
+  is_mmse = strcmpi(method, 'MMSE');
+  if ~is_mmse
+    N_fft = 0;
+    t_rms = 0;
+    rank = 0;
+  end
+
+  for n = 1 : length(cache)
+    e = cache(n);
+    if e.is_mmse == is_mmse && e.N_fft == N_fft && e.t_rms == t_rms && e.rank == rank && ...
+       isequal(e.grid_size, grid_size(:)') && isequal(e.k_idx, k_idx) && isequal(e.l_idx, l_idx)
+      F_k = e.F_k;
+      F_l = e.F_l;
+      U = e.U;
+      w = wiener_gains(e.lambda, nsr);
+      return;
+    end
+  end
+
+  % spline interpolation is linear, weights are interpolated unit vectors
+  F_k = interp_weights(k_idx, grid_size(1));
+  F_l = interp_weights(l_idx, grid_size(2));
+
+  if is_mmse
+    % use magic number for L
+    R_hh = channel_covariance_matrix_edfors(N_fft, 10, t_rms, k_idx);
+    [U, lambda] = eig((R_hh + R_hh') / 2, 'vector');
+    [lambda, order] = sort(real(lambda), 'descend');
+    lambda = max(lambda, 0);
+    if rank > 0 && rank < length(lambda)
+      order = order(1:rank);
+      lambda = lambda(1:rank);
+    end
+    U = U(:,order);
+    F_k = F_k * U;
+  else
+    U = [];
+    lambda = [];
+  end
+
+  e = struct('is_mmse', is_mmse, 'N_fft', N_fft, 't_rms', t_rms, 'rank', rank, 'grid_size', grid_size(:)', ...
+             'k_idx', k_idx, 'l_idx', l_idx, 'F_k', F_k, 'F_l', F_l, 'U', U, 'lambda', lambda);
+
+  % replace the oldest entry when the cache is full
+  if isempty(cache)
+    cache = e;
+    cache_next = 1;
+  elseif length(cache) < cache_size
+    cache(end+1) = e;
+  else
+    cache(cache_next) = e;
+    cache_next = mod(cache_next, cache_size) + 1;
+  end
+
+  w = wiener_gains(lambda, nsr);
+end
+
+function w = wiener_gains(lambda, nsr)
+  % SNR bins of 1 dB within [-20, 60] dB
+  nsr_db = max(min(round(10*log10(nsr)), 20), -60);
+  w = lambda ./ (lambda + 10^(nsr_db/10));
+end
+
+function F = interp_weights(idx, N)
+  if length(idx) < 2
+    F = ones(N, 1);
+  else
+    F = interp1(idx, eye(length(idx)), (1:N)', 'spline');
+  end
+end
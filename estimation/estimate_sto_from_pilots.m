@@ -40,18 +40,23 @@ function sto = estimate_sto_from_pilots(x_p, y_p, k_idx, l_idx, frame_cfg, metho
       end
     end
   elseif strcmpi(method, 'dft')
+    N_search = floor(frame_cfg.N_fft / pilot_spacing);
     for n_layer = 1 : size(x_p,3)
+      % for uniformly spaced pilots, the searched PDP bins equal the
+      % N_search-point IDFT of pilots (up to a phase ramp and scaling)
+      uniform = all(diff(k_idx(:,n_layer)) == pilot_spacing) && length(k_idx) <= N_search;
       for n_rx_ant = 1 : size(y_p,4)
         H_est = conj(x_p(:,:,n_layer) ) .* y_p(:,:,n_layer,n_rx_ant);
-        to_meas = zeros(length(l_idx),1);
-        for n_sym = 1 : length(l_idx)
-          fd = zeros(frame_cfg.N_fft,1);
-          fd(N_guard+k_idx(:,n_layer)) = H_est(:,1);
+        if uniform
+          PDP = abs(ifft(H_est, N_search));
+        else
+          fd = zeros(frame_cfg.N_fft, length(l_idx));
+          fd(N_guard+k_idx(:,n_layer),:) = H_est;
           PDP = abs(ifft(fd));
-          [~,idx] = max(PDP(floor(1:frame_cfg.N_fft / pilot_spacing)));
-          to_meas(n_sym) = idx-1;
+          PDP = PDP(1:N_search,:);
         end
-        sto(n_layer,n_rx_ant) = mean(to_meas);
+        [~,idx] = max(PDP, [], 1);
+        sto(n_layer,n_rx_ant) = mean(idx-1);
       end
     end
   else
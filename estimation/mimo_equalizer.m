@@ -0,0 +1,92 @@
+%[x, N0_eq] = mimo_equalizer(y, H, N0, method)
+%
+% Linear equalizer of MIMO transmission with N_layer layers received
+% with N_rx antennas. Solves the normal equations of every RE of the grid
+% (closed form for 2 layers, Cholesky factorization otherwise). MMSE
+% estimates are scaled to be unbiased, so that x and N0_eq can be passed
+% directly to the soft demapper.
+%
+% Arguments:
+%  y         - received RE grid of size [N_re,N_sym,N_rx]
+%  H         - channel estimate of size [N_re,N_sym,N_layer,N_rx]
+%              (y and H may be single precision, x and N0_eq are then
+%              single as well)
+%  N0        - noise variance, or N_rx x N_rx noise and interference
+%              covariance matrix for 'MMSE-IRC'
+%  method    - equalizer algorithm
+%              'ZF' - Zero-Forcing equalizer
+%              'MMSE' - Minimum Mean Squared Error equalizer
+%              'MMSE-IRC' - MMSE with Interference Rejection Combining,
+%                           the signal is whitened with N0 covariance
+%
+% Returns:
+%  x         - equalized symbols of size [N_re,N_sym,N_layer]
+%  N0_eq     - post-equalization noise variance of every RE and layer
+%              (inverse of SINR for unit power symbols), size as x
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function [x, N0_eq] = mimo_equalizer(y, H, N0, method)
+  N_rx = size(y,3);
+  N_layer = size(H,3);
+
+  if strcmpi(method, 'MMSE-IRC')
+    if isscalar(N0)
+      N0 = N0 * eye(N_rx);
+    end
+    method = 'MMSE';
+  elseif ~isscalar(N0)
+    error('Noise covariance matrix is supported by MMSE-IRC equalizer only');
+  end
+
+  if ~any(strcmpi(method, {'ZF', 'MMSE'}))
+    error('Equalizer algorithm not supported: %s', method);
+  end
+  method = upper(method);
+
+  try
+    [x, N0_eq] = mimo_equalizer_mex(y, H, double(N0), method);
+    return;
+  catch
+    persistent flag
+    if isempty(flag)
+      disp('mimo_equalizer: compile mex file to reduce execution time');
+      flag = 0;
+    end
+  end
+
+  % whitening of noise and interference
+  if isscalar(N0)
+    W = eye(N_rx);
+    sigma2 = N0;
+  else
+    W = inv(chol(N0, 'lower'));
+    sigma2 = 1;
+  end
+
+  if strcmp(method, 'MMSE')
+    reg = sigma2 * eye(N_layer);
+  else
+    reg = zeros(N_layer);
+  end
+
+  x = zeros(size(y,1), size(y,2), N_layer, class(y));
+  N0_eq = zeros(size(y,1), size(y,2), N_layer, class(y));
+
+  for n_sym = 1 : size(y,2)
+    for n_re = 1 : size(y,1)
+      Hd = W * reshape(H(n_re,n_sym,:,:), [N_layer,N_rx]).';
+      A_inv = inv(Hd' * Hd + reg);
+      s = A_inv * (Hd' * (W * reshape(y(n_re,n_sym,:), [], 1)));
+      d = real(diag(A_inv));
+      if strcmp(method, 'MMSE')
+        beta = max(1 - sigma2 * d, 1e-12);
+        x(n_re,n_sym,:) = s ./ beta;
+        N0_eq(n_re,n_sym,:) = sigma2 * d ./ beta;
+      else
+        x(n_re,n_sym,:) = s;
+        N0_eq(n_re,n_sym,:) = sigma2 * d;
+      end
+    end
+  end
+end
@@ -1,4 +1,4 @@
-%[iq_fade] = apply_fading_td(iq, f_d, f_s, mpprofile, channel='sos')
+%[iq_fade,h] = apply_fading_td(iq, f_d, f_s, mpprofile, channel='zheng', mimo=[1,1], block_len=0)
 %
 % Applies specified channel profile to time domain IQ data using specified 
 % channel profile and fading coefficients generators.
@@ -18,6 +18,10 @@
 %              channel coefficients may be passed instead.
 %  mimo      - vector with MIMO configuration with elements:
 %              1 - TX ant num, 2 - RX ant num, 3 - TX ant corr, 4 - RX ant corr
+%  block_len - if non-zero, the channel is assumed constant within blocks of
+%              block_len samples and the convolution is performed by FFT
+%              (overlap-save), suitable for long delay spreads and low Doppler.
+%              Zero selects exact time-varying convolution. Used by mex only.
 %
 % Returns:
 %  iq_fade   - faded time domain IQ data
@@ -26,7 +30,8 @@
 
 % Copyright 2017 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function [iq_fade,h] = apply_fading_td(iq, f_d, f_s, mpprofile, channel, mimo)
+function [iq_fade,h] = apply_fading_td(iq, f_d, f_s, mpprofile, channel, mimo, block_len)
+  if nargin < 7; block_len = 0; end
   if nargin < 6; mimo = [1,1]; end
   if nargin < 5; channel = 'zheng'; end
 
@@ -57,11 +62,8 @@ function [iq_fade,h] = apply_fading_td(iq, f_d, f_s, mpprofile, channel, mimo)
   h = zeros([N, L, MIMO_channels]);
 
   if strcmp(channel, 'zheng')
-    for m = 1 : MIMO_channels
-      for l = 1 : L
-        h(:,l,m) = fading_channel_zheng(f_d, f_s, 1:N);
-      end
-    end
+    % all taps of all MIMO links in a single call
+    h = reshape(fading_channel_zheng(f_d, f_s, 1:N, 8, L * MIMO_channels), [N, L, MIMO_channels]);
   elseif strcmp(channel, 'jtc')
     for m = 1 : MIMO_channels
       for l = 1 : L
@@ -80,19 +82,37 @@ function [iq_fade,h] = apply_fading_td(iq, f_d, f_s, mpprofile, channel, mimo)
     h = channel;
   end
 
-  if (MIMO_channels > 1)
+  if MIMO_channels > 1
     R = kronecker_correlation_matrix(ant_TX, ant_RX, [cor_TX, cor_RX]);
-    C = chol(R);
+    A = chol(R)';
+  else
+    A = [];
+  end
+
+  try
+    iq_fade = tapped_delay_line_mex(iq, tds, tgl, h, A, block_len);
+    if nargout > 1 && MIMO_channels > 1
+      h = reshape((A * reshape(h, [N*L, MIMO_channels]).').', [N, L, MIMO_channels]);
+    end
+    return;
+  catch
+    persistent flag
+    if isempty(flag)
+      disp('apply_fading_td: compile mex file to reduce execution time');
+      flag = 0;
+    end
+  end
 
+  if MIMO_channels > 1
     h_c = zeros(size(h));
     for l = 1 : L
-      h_c(:,l,:) = (C' * reshape(h(:,l,:), [N,MIMO_channels]).').';
+      h_c(:,l,:) = (A * reshape(h(:,l,:), [N,MIMO_channels]).').';
     end
 
     iq_fade_ch = zeros(size(iq,1), MIMO_channels);
     for m_rx = 1 : ant_RX
       for m_tx = 1 : ant_TX
-        ch_id = ((m_rx-1)*ant_RX)+m_tx;
+        ch_id = ((m_rx-1)*ant_TX)+m_tx;
         iq_fade_ch(:,ch_id) = tapped_delay_line(iq(:,m_tx), tds, tgl, h_c(:,:,ch_id));
       end
     end
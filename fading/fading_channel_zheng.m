@@ -1,4 +1,4 @@
-%[c] = fading_channel_zheng(f_d, f_s, n, N_sin=8)
+%[c] = fading_channel_zheng(f_d, f_s, n, N_sin=8, num_links=1)
 %
 % Calculates coefficients of fading channel based on Sum-of-Sinusoid
 % method. Implementation according to Zheng and Xiao model [1].
@@ -12,19 +12,22 @@
 %  f_s   - baseband sampling frequency [Hz]
 %  ns    - vector of sample indices to generate
 %  N_sin - number of sinusoids
+%  num_links - number of independent fading processes to generate
 %
 % Returns:
-%  c     - vector of complex random variates
+%  c     - matrix of complex random variates of size [length(ns), num_links]
 
 % Copyright 2017-2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function [c] = fading_channel_zheng(f_d, f_s, ns, N_sin)
+function [c] = fading_channel_zheng(f_d, f_s, ns, N_sin, num_links)
   if nargin < 4; N_sin = 8; end
+  if nargin < 5; num_links = 1; end
 
   assert(f_d < f_s, 'f_d must be lower than f_s');
 
   try
-    c = fading_channel_zheng_mex(f_d, f_s, ns, N_sin);
+    % random parameters of all links are derived from a single seed
+    c = fading_channel_zheng_mex(f_d, f_s, ns, N_sin, num_links, floor(rand * 2^32));
     return;
   catch
     persistent flag
@@ -43,11 +46,19 @@ function [c] = fading_channel_zheng(f_d, f_s, ns, N_sin)
   pc = 2 * pi * (rand(1,N_sin) - 0.5);
 
   n_sin = 1:1:N_sin;
-  c = zeros(length(ns),1);
+  c = zeros(length(ns),num_links);
   s = sqrt(2 / N_sin);
 
-  for i = 1:length(t)
-    ph = 2 * pi * t(i) * f_d * exp(1i * (pi * (2*n_sin - 1) + th) / (4 * N_sin));
-    c(i) = s * (sum(cos(real(ph) + pr)) + 1i * sum(cos(imag(ph) + pc)));
+  for k = 1:num_links
+    if k > 1
+      th = 2 * pi * (rand - 0.5);
+      pr = 2 * pi * (rand(1,N_sin) - 0.5);
+      pc = 2 * pi * (rand(1,N_sin) - 0.5);
+    end
+
+    for i = 1:length(t)
+      ph = 2 * pi * t(i) * f_d * exp(1i * (pi * (2*n_sin - 1) + th) / (4 * N_sin));
+      c(i,k) = s * (sum(cos(real(ph) + pr)) + 1i * sum(cos(imag(ph) + pc)));
+    end
   end
 end
\ No newline at end of file
@@ -0,0 +1,69 @@
+/* Codeblock desegmentation core of 5G NR LDPC coded transport blocks
+ * (3GPP 38.212 sec. 5.2.2), shared by
+ * nr_38_212_code_block_desegmentation_ldpc_mex.c and native code.
+ *
+ * Kp-L information bits of each codeblock (row of the C x K column-major
+ * hard decision matrix c, double or uint8) are concatenated into b of length B, codeblock
+ * CRCs (cb_crc, NULL for a single codeblock) and the transport block CRC
+ * attached to the last bits of b (tb_crc) are checked in a single pass.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef CB_DESEGMENTATION_H
+#define CB_DESEGMENTATION_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "nr_crc.h"
+
+/* code_block_desegmentation<suffix>(c, ...) for hard decisions c of type T,
+ * returns non-zero if transport block CRC is correct, codeblock CRC results
+ * are written to cb_crc_ok (transport block result for a single codeblock) */
+#define CB_DESEGMENTATION_DEFINE(suffix, T) \
+static int code_block_desegmentation##suffix(const T* c, size_t C, size_t Kp, size_t B, const nr_crc_t* cb_crc, const nr_crc_t* tb_crc, \
+                                             double* b, double* cb_crc_ok) { \
+  double crc_bits[NR_CRC_LEN_MAX]; \
+  size_t L, Kd, tb_data, r, n, s; \
+  uint32_t cb_reg, tb_reg; \
+  int tb_ok; \
+\
+  L = (cb_crc != NULL) ? (size_t) cb_crc->len : 0; \
+  Kd = Kp - L; \
+  tb_data = B - (size_t) tb_crc->len; \
+  tb_reg = nr_crc_init_reg(tb_crc); \
+  s = 0; \
+\
+  for (r = 0; r < C; r++) { \
+    /* rows of c are strided by C in column-major storage */ \
+    for (n = 0; n < Kd; n++) \
+      b[s+n] = (double) c[r + n*C]; \
+\
+    if (s < tb_data) \
+      tb_reg = nr_crc_update_bits(tb_crc, tb_reg, b + s, (tb_data - s < Kd) ? tb_data - s : Kd, 1); \
+\
+    if (cb_crc != NULL) { \
+      for (n = 0; n < L; n++) \
+        crc_bits[n] = (double) c[r + (Kd+n)*C]; \
+      cb_reg = nr_crc_update_bits(cb_crc, nr_crc_init_reg(cb_crc), b + s, Kd, 1); \
+      cb_crc_ok[r] = (double) nr_crc_check_bits(cb_crc, nr_crc_final(cb_crc, cb_reg), crc_bits, 1); \
+    } \
+\
+    s += Kd; \
+  } \
+\
+  tb_ok = nr_crc_check_bits(tb_crc, nr_crc_final(tb_crc, tb_reg), b + tb_data, 1); \
+\
+  /* a single codeblock is protected only by the transport block CRC */ \
+  if (cb_crc == NULL) \
+    for (r = 0; r < C; r++) \
+      cb_crc_ok[r] = (double) tb_ok; \
+\
+  return tb_ok; \
+}
+
+CB_DESEGMENTATION_DEFINE(, double)
+/* uint8 hard decisions of the fixed-point LDPC decoder */
+CB_DESEGMENTATION_DEFINE(_u8, uint8_t)
+
+#endif
@@ -0,0 +1,73 @@
+/* 38.212 circular buffer bit selection and bit interleaving cores shared by
+ * nr_38_212_circbuff_interleave_mex.c, nr_38_212_circbuff_deinterleave_mex.c
+ * and native code.
+ *
+ * Bit interleaving is folded into the circular buffer walk: the j-th selected
+ * bit e(j) goes to f[(j % (E/Q_m))*Q_m + j/(E/Q_m)], so no intermediate
+ * sequence is stored. Fixed-point LLRs (see llr_quant.h) are combined with
+ * saturation.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef CIRCBUFF_H
+#define CIRCBUFF_H
+
+#include <stddef.h>
+#include "llr_quant.h"
+
+/* Selects E = bits_f_len bits starting at k_0, skipping filler bits (-1),
+ * and interleaves them into f. */
+static void circbuff_interleave(const double* bits_d, size_t bits_d_len, double* bits_f, size_t bits_f_len, int Q_m, int k_0) {
+  size_t j, k_ptr, EdQm;
+
+  EdQm = bits_f_len / Q_m;
+  k_ptr = k_0 % bits_d_len;
+
+  for (j = 0; j < EdQm * Q_m; ) {
+    if (bits_d[k_ptr] != -1.0) {
+      bits_f[(j % EdQm) * Q_m + j / EdQm] = bits_d[k_ptr];
+      j++;
+    }
+    k_ptr = (k_ptr + 1 == bits_d_len) ? 0 : k_ptr + 1;
+  }
+}
+
+/* All E LLRs are combined into the circular buffer d, filler bit positions
+ * [Fbst, Fbst+Fbsz) are skipped. */
+static void circbuff_deinterleave(const double* bits_f, size_t bits_f_len, double* bits_d, size_t bits_d_len, int Q_m, int k_0, int Fbst, int Fbsz) {
+  size_t j, k_ptr, EdQm;
+
+  EdQm = bits_f_len / Q_m;
+  k_ptr = k_0 % bits_d_len;
+
+  for (j = 0; j < bits_f_len; ) {
+    if (k_ptr < (size_t)Fbst || k_ptr >= (size_t)(Fbst + Fbsz)) {
+      bits_d[k_ptr] += bits_f[(j % EdQm) * Q_m + j / EdQm];
+      j++;
+    }
+    k_ptr = (k_ptr + 1 == bits_d_len) ? 0 : k_ptr + 1;
+  }
+}
+
+/* circbuff_deinterleave_<suffix> combines fixed-point LLRs of type T */
+#define CIRCBUFF_DEINTERLEAVE_DEFINE(suffix, T) \
+static void circbuff_deinterleave_##suffix(const T* bits_f, size_t bits_f_len, T* bits_d, size_t bits_d_len, int Q_m, int k_0, int Fbst, int Fbsz) { \
+  size_t j, k_ptr, EdQm; \
+\
+  EdQm = bits_f_len / Q_m; \
+  k_ptr = k_0 % bits_d_len; \
+\
+  for (j = 0; j < bits_f_len; ) { \
+    if (k_ptr < (size_t)Fbst || k_ptr >= (size_t)(Fbst + Fbsz)) { \
+      bits_d[k_ptr] = llr_sadd_##suffix(bits_d[k_ptr], bits_f[(j % EdQm) * Q_m + j / EdQm]); \
+      j++; \
+    } \
+    k_ptr = (k_ptr + 1 == bits_d_len) ? 0 : k_ptr + 1; \
+  } \
+}
+
+CIRCBUFF_DEINTERLEAVE_DEFINE(i16, int16_t)
+CIRCBUFF_DEINTERLEAVE_DEFINE(i8, int8_t)
+
+#endif
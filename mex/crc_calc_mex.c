@@ -1,4 +1,4 @@
-/* p = crc_calc_mex(b, crc_poly) 
+/* p = crc_calc_mex(b, crc_poly)
  *
  * Matlab MEX acceleration for nr_38_212_crc_calc function.
  *
@@ -6,26 +6,42 @@
  */
 
 #include "mex.h"
+#include "nr_crc.h"
 
-#define CRC_LFSR_LEN_MAX 25
-
-void crc_calc(double* din, size_t din_len, double* poly, size_t poly_len, double* dout) {
-  int i, n;
-  int lfsr[CRC_LFSR_LEN_MAX] = {0};
-
-  for (i = 0; i < din_len+poly_len-1; i++) {
-    /* shift */
-    for (n = 0; n < poly_len-1; n++)
-      lfsr[n] = lfsr[n+1];
-    lfsr[poly_len-1] = (i < din_len) ? (int)din[i] : 0;
-    /* add polynomial */
-    if (lfsr[0] != 0)
-      for (n = 0; n < poly_len; n++)
-        lfsr[n] = (lfsr[n] + (int)poly[n]) & 1;
+#define CRC_CACHE_SIZE 8
+
+/* tables of recently used polynomials, kept while the mex file is loaded */
+static nr_crc_t crc_cache[CRC_CACHE_SIZE];
+static double crc_cache_key[CRC_CACHE_SIZE][NR_CRC_LEN_MAX + 1];
+static size_t crc_cache_len[CRC_CACHE_SIZE];
+static int crc_cache_next = 0;
+
+static const nr_crc_t* crc_get(double* poly, size_t poly_len) {
+  int n;
+  size_t k;
+
+  for (n = 0; n < CRC_CACHE_SIZE; n++) {
+    if (crc_cache_len[n] != poly_len)
+      continue;
+    for (k = 0; k < poly_len; k++)
+      if (crc_cache_key[n][k] != poly[k])
+        break;
+    if (k == poly_len)
+      return &crc_cache[n];
   }
 
-  for (i = 0; i < poly_len-1; i++)
-    dout[i] = (double) lfsr[i+1];
+  n = crc_cache_next;
+  crc_cache_next = (crc_cache_next + 1) % CRC_CACHE_SIZE;
+
+  crc_cache_len[n] = 0;
+  if (!nr_crc_init(&crc_cache[n], poly, poly_len))
+    return NULL;
+
+  for (k = 0; k < poly_len; k++)
+    crc_cache_key[n][k] = poly[k];
+  crc_cache_len[n] = poly_len;
+
+  return &crc_cache[n];
 }
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
@@ -34,6 +50,8 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
   double* poly;
   size_t poly_len;
   double* dout;
+  const nr_crc_t* crc;
+  uint32_t reg;
 
   /* check for proper number of arguments */
   if(nrhs != 2) {
@@ -45,13 +63,14 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
   }
 
   /* get the input arguments */
-  din_len = mxGetN(prhs[0]);
+  din_len = mxGetM(prhs[0]) * mxGetN(prhs[0]);
   din = mxGetPr(prhs[0]);
-  poly_len = mxGetN(prhs[1]);
+  poly_len = mxGetM(prhs[1]) * mxGetN(prhs[1]);
   poly = mxGetPr(prhs[1]);
 
-  if (poly_len > CRC_LFSR_LEN_MAX) {
-    mexErrMsgIdAndTxt("crc_calc:poly_len","Polynomial length is too high. Recompile mex function with sufficient CRC_LFSR_LEN_MAX.");
+  crc = crc_get(poly, poly_len);
+  if (crc == NULL) {
+    mexErrMsgIdAndTxt("crc_calc:poly_len","Invalid polynomial (up to 32 parity bits supported).");
   }
 
   /* create the output matrix */
@@ -59,5 +78,6 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
   dout = mxGetPr(plhs[0]);
 
   /* call the computational routine */
-  crc_calc(din, din_len, poly, poly_len, dout);
+  reg = nr_crc_update_bits(crc, nr_crc_init_reg(crc), din, din_len, 1);
+  nr_crc_to_bits(crc, nr_crc_final(crc, reg), dout, 1);
 }
@@ -0,0 +1,83 @@
+/* Exhaustive soft and hard demappers over a modulation alphabet, shared by
+ * modulation_demapper_soft_mex.c and native code.
+ *
+ * A (A_re, A_im) is the alphabet and S0, S1 are zero-based Q_m x 2^(Q_m-1)
+ * tables of indices of points with bit q equal to 0 and 1, respectively
+ * (see modulation_alphabet.m). Bit q counts from the least significant bit
+ * of the point index, so LLRs of a symbol are written in reverse order.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef DEMAPPER_ALPHABET_H
+#define DEMAPPER_ALPHABET_H
+
+#include <stddef.h>
+#include <math.h>
+
+#define POW2(X) ((X)*(X))
+
+static void demapprt_true_llr(double* iq_re, double* iq_im, size_t iq_size, int ord, double* N0, double* A_re, double* A_im, double* S0, double* S1, double* llr) {
+  int i, q, a, s_idx;
+  double P0, P1, P0_metric, P1_metric;
+  int alphabet_size = (1<<ord);
+
+  for (i = 0; i < iq_size; i++) {
+    for (q = 0; q < ord; q++) {
+      P0 = 0.0;
+      P1 = 0.0;
+      for (a = 0; a < alphabet_size / 2; a++) {
+        s_idx = q + a*ord;
+        P0_metric = POW2(iq_re[i] - A_re[(int)S0[s_idx]]) + POW2(iq_im[i] - A_im[(int)S0[s_idx]]);
+        P1_metric = POW2(iq_re[i] - A_re[(int)S1[s_idx]]) + POW2(iq_im[i] - A_im[(int)S1[s_idx]]);
+        P0 += exp(-1.0 * P0_metric / N0[i]);
+        P1 += exp(-1.0 * P1_metric / N0[i]);
+      }
+      llr[(i+1)*ord-q-1] = log(P0) - log(P1);
+    }
+  }
+}
+
+static void demapprt_approx_llr(double* iq_re, double* iq_im, size_t iq_size, int ord, double* N0, double* A_re, double* A_im, double* S0, double* S1, double* llr) {
+  int i, q, a, s_idx;
+  double d0, d1, v;
+  int alphabet_size = (1<<ord);
+
+  for (i = 0; i < iq_size; i++) {
+    for (q = 0; q < ord; q++) {
+      d0 = 9999999.0;
+      d1 = 9999999.0;
+      for (a = 0; a < alphabet_size / 2; a++) {
+        s_idx = q + a*ord;
+        v = POW2(iq_re[i] - A_re[(int)S0[s_idx]]) + POW2(iq_im[i] - A_im[(int)S0[s_idx]]);
+        d0 = d0 < v ? d0 : v;
+        v = POW2(iq_re[i] - A_re[(int)S1[s_idx]]) + POW2(iq_im[i] - A_im[(int)S1[s_idx]]);
+        d1 = d1 < v ? d1 : v;
+      }
+      llr[(i+1)*ord-q-1] = -1.0 * (d0 - d1) / N0[i];
+    }
+  }
+}
+
+static void demapprt_hard(double* iq_re, double* iq_im, size_t iq_size, int ord, double* N0, double* A_re, double* A_im, double* S0, double* S1, double* llr) {
+  int i, q, a, s_idx;
+  double d0, d1, v;
+  int alphabet_size = (1<<ord);
+
+  for (i = 0; i < iq_size; i++) {
+    for (q = 0; q < ord; q++) {
+      d0 = 9999999.0;
+      d1 = 9999999.0;
+      for (a = 0; a < alphabet_size / 2; a++) {
+        s_idx = q + a*ord;
+        v = POW2(iq_re[i] - A_re[(int)S0[s_idx]]) + POW2(iq_im[i] - A_im[(int)S0[s_idx]]);
+        d0 = d0 < v ? d0 : v;
+        v = POW2(iq_re[i] - A_re[(int)S1[s_idx]]) + POW2(iq_im[i] - A_im[(int)S1[s_idx]]);
+        d1 = d1 < v ? d1 : v;
+      }
+      llr[(i+1)*ord-q-1] = (d0 > d1) ? (-1.0 / N0[i]) : (1.0 / N0[i]);
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,133 @@
+/* Closed-form max-log demapper of 38.211 Gray-mapped QAM.
+ *
+ * Yields the same LLRs as an exhaustive max-log search over the alphabet,
+ * but exploits separability of the constellations into I and Q PAM. Each
+ * PAM bit is reduced to a sign bit of a folded coordinate, for which the
+ * nearest points of both classes are found in closed form, so the cost per
+ * symbol is O(Q_m) instead of O(Q_m * 2^Q_m).
+ *
+ * LLRs are positive for bit 0 and scaled by 1/N0, i.e. (d1 - d0) / N0.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef DEMAPPER_PAM_H
+#define DEMAPPER_PAM_H
+
+#include <stddef.h>
+#include <math.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+
+/* Max-log metric d1-d0 of the sign bit of PAM with levels +-1, +-3 .. +-M,
+ * where nearest points with positive (p) and negative (n) sign are taken. */
+static double pam_sign_llr(double x, double M) {
+  double r, p, n;
+  r = 2.0 * floor(0.5 * x) + 1.0;
+  r = (r < -M) ? -M : ((r > M) ? M : r);
+  p = (r > 1.0) ? r : 1.0;
+  n = (r < -1.0) ? r : -1.0;
+  return (p - n) * (2.0 * x - p - n);
+}
+
+/* 38.211 QAM point of bits b(0..Q_m-1) has I = s*(1-2b(0))*(2^(k-1) - (1-2b(2))*(2^(k-2) - ...)),
+ * Q likewise with odd bits, where k = Q_m/2. Bit b(2m) is the sign of the
+ * point in PAM folded m times with t_m = 2^(k-m) - |t_(m-1)|, and folding
+ * preserves distances to both bit classes. */
+static void demapprt_pam_symbol(double re, double im, int ord, double N0, double* llr) {
+  int k = ord / 2, m;
+  double s, g, tI, tQ, half;
+
+  if (ord == 1) {
+    llr[0] = 2.0 * sqrt(2.0) * (re + im) / N0;
+    return;
+  }
+
+  s = sqrt(1.5 / (double)((1 << (2*k)) - 1));
+  g = s * s / N0;
+  tI = re / s;
+  tQ = im / s;
+
+  for (m = 0; m < k; m++) {
+    half = (double)(1 << (k - m - 1));
+    llr[2*m]   = g * pam_sign_llr(tI, 2.0 * half - 1.0);
+    llr[2*m+1] = g * pam_sign_llr(tQ, 2.0 * half - 1.0);
+    tI = half - fabs(tI);
+    tQ = half - fabs(tQ);
+  }
+}
+
+#if defined(__AVX__)
+static __m256d pam_sign_llr_avx(__m256d x, __m256d M) {
+  const __m256d one = _mm256_set1_pd(1.0);
+  const __m256d two = _mm256_set1_pd(2.0);
+  __m256d r, p, n;
+  r = _mm256_add_pd(_mm256_mul_pd(two, _mm256_floor_pd(_mm256_mul_pd(_mm256_set1_pd(0.5), x))), one);
+  r = _mm256_min_pd(_mm256_max_pd(r, _mm256_sub_pd(_mm256_setzero_pd(), M)), M);
+  p = _mm256_max_pd(r, one);
+  n = _mm256_min_pd(r, _mm256_sub_pd(_mm256_setzero_pd(), one));
+  return _mm256_mul_pd(_mm256_sub_pd(p, n), _mm256_sub_pd(_mm256_sub_pd(_mm256_mul_pd(two, x), p), n));
+}
+#endif
+
+/* demaps iq_size symbols into iq_size*ord LLRs, N0 is a single value
+ * (N0_size = 1) or one per symbol, iq_im may be NULL for real input */
+static void demapprt_approx_llr_pam(double* iq_re, double* iq_im, size_t iq_size, int ord, double* N0, size_t N0_size, double* llr) {
+  size_t i = 0;
+
+#if defined(__AVX__)
+  if (ord > 1 && iq_im != NULL && N0_size == iq_size) {
+    int k = ord / 2, m, l;
+    const __m256d abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    double s = sqrt(1.5 / (double)((1 << (2*k)) - 1));
+    __m256d vs = _mm256_set1_pd(s);
+    __m256d tI, tQ, g, half, M;
+    double bI[4], bQ[4];
+
+    for (; i + 4 <= iq_size; i += 4) {
+      g = _mm256_div_pd(_mm256_set1_pd(s * s), _mm256_loadu_pd(N0 + i));
+      tI = _mm256_div_pd(_mm256_loadu_pd(iq_re + i), vs);
+      tQ = _mm256_div_pd(_mm256_loadu_pd(iq_im + i), vs);
+
+      for (m = 0; m < k; m++) {
+        half = _mm256_set1_pd((double)(1 << (k - m - 1)));
+        M = _mm256_set1_pd((double)((1 << (k - m)) - 1));
+        _mm256_storeu_pd(bI, _mm256_mul_pd(g, pam_sign_llr_avx(tI, M)));
+        _mm256_storeu_pd(bQ, _mm256_mul_pd(g, pam_sign_llr_avx(tQ, M)));
+        for (l = 0; l < 4; l++) {
+          llr[(i+l)*ord + 2*m]   = bI[l];
+          llr[(i+l)*ord + 2*m+1] = bQ[l];
+        }
+        tI = _mm256_sub_pd(half, _mm256_and_pd(tI, abs_mask));
+        tQ = _mm256_sub_pd(half, _mm256_and_pd(tQ, abs_mask));
+      }
+    }
+  }
+#endif
+
+  for (; i < iq_size; i++)
+    demapprt_pam_symbol(iq_re[i], (iq_im != NULL) ? iq_im[i] : 0.0, ord, N0[(N0_size == iq_size) ? i : 0], llr + i*ord);
+}
+
+#define DEMAPPER_PAM_BLOCK 64
+
+/* single precision input, symbols are converted in blocks and demapped in
+ * double precision by demapprt_approx_llr_pam */
+static void demapprt_approx_llr_pam_f32(const float* iq_re, const float* iq_im, size_t iq_size, int ord, const float* N0, size_t N0_size, double* llr) {
+  double re[DEMAPPER_PAM_BLOCK], im[DEMAPPER_PAM_BLOCK], n0[DEMAPPER_PAM_BLOCK];
+  size_t i, n, blk;
+
+  for (i = 0; i < iq_size; i += blk) {
+    blk = (iq_size - i < DEMAPPER_PAM_BLOCK) ? iq_size - i : DEMAPPER_PAM_BLOCK;
+    for (n = 0; n < blk; n++) {
+      re[n] = iq_re[i + n];
+      im[n] = (iq_im != NULL) ? iq_im[i + n] : 0.0;
+      n0[n] = N0[(N0_size == iq_size) ? i + n : 0];
+    }
+    demapprt_approx_llr_pam(re, (iq_im != NULL) ? im : NULL, blk, ord, n0, (N0_size == iq_size) ? blk : 1, llr + i*ord);
+  }
+}
+
+#endif
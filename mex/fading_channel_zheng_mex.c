@@ -1,90 +1,91 @@
-/* c = fading_channel_zheng_mex(f_d, f_s, ns, N_sin)
+/* c = fading_channel_zheng_mex(f_d, f_s, ns, N_sin, num_links=1, seed)
  *
  * Matlab MEX acceleration for fading_channel_zheng function.
  *
- * Copyright 2017 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ * Generates num_links independent fading processes (e.g. all taps of all
+ * MIMO links of a slot) in one call, column k of c holds link k. Random
+ * parameters of link k are derived from (seed, k) only, see fading_zheng.h.
+ *
+ * Copyright 2017-2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
  */
 
-#define _USE_MATH_DEFINES
-#include <math.h>
-#include <time.h>
 #include "mex.h"
+#include "fading_zheng.h"
 
-#define N_SIN_MAX 32
-#define RAND() ((double)(rand()))/((double)(RAND_MAX))
-
-void fading_channel_zheng(double f_doppler, double f_sampling, double* n_s, size_t n_s_len, int N_sin, double* out_re, double* out_im) {
-  int i, j;
-  double th;
-  double pr[N_SIN_MAX];
-  double pi[N_SIN_MAX];
-  double argr[N_SIN_MAX];
-  double argi[N_SIN_MAX];  
-  double s, two_pi_fd, t;
+void fading_channel_zheng(double f_doppler, double f_sampling, double* n_s, size_t n_s_len, int N_sin, size_t num_links, uint64_t seed, double* out_re, double* out_im) {
+  fading_zheng_t prm;
+  double* t = NULL;
+  double step = 0.0;
+  size_t i, k;
+  int uniform = 1;
 
-  s = sqrt(2.0 / (double)N_sin);
-  two_pi_fd = 2 * M_PI * f_doppler;
+  /* sample indices are usually consecutive, which allows phasor rotation */
+  if (n_s_len > 1) {
+    step = n_s[1] - n_s[0];
+    for (i = 2; i < n_s_len && uniform; i++)
+      uniform = (n_s[i] - n_s[i-1] == step);
+  }
 
-  th = 2 * M_PI * (RAND() - 0.5);
-  for (i = 0; i < N_sin; i++) {
-    pr[i] = 2 * M_PI * (RAND() - 0.5);
-    pi[i] = 2 * M_PI * (RAND() - 0.5);
-    argr[i] = two_pi_fd * cos((M_PI * (2.0*(i+1) - 1) + th) / (double)(4 * N_sin));
-    argi[i] = two_pi_fd * sin((M_PI * (2.0*(i+1) - 1) + th) / (double)(4 * N_sin));
+  if (!uniform) {
+    t = (double*) mxMalloc(n_s_len * sizeof(double));
+    for (i = 0; i < n_s_len; i++)
+      t[i] = n_s[i] / f_sampling;
   }
- 
-  for (i = 0; i < n_s_len; i++) {
-    t = n_s[i] / f_sampling;
-    out_re[i] = 0.0;
-    out_im[i] = 0.0;
-    for (j = 0; j < N_sin; j++) {
-      out_re[i] += cos(t * argr[j] + pr[j]);
-      out_im[i] += cos(t * argi[j] + pi[j]);
-    }
-    out_re[i] *= s;
-    out_im[i] *= s;
+
+  for (k = 0; k < num_links; k++) {
+    fading_zheng_init(&prm, f_doppler, N_sin, seed, k);
+    if (uniform)
+      fading_zheng_uniform_grid(&prm, (n_s_len > 0) ? n_s[0] / f_sampling : 0.0, step / f_sampling, n_s_len, out_re + k*n_s_len, out_im + k*n_s_len);
+    else
+      fading_zheng_times(&prm, t, n_s_len, out_re + k*n_s_len, out_im + k*n_s_len);
   }
+
+  if (t != NULL)
+    mxFree(t);
 }
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+  static uint64_t call_cnt = 0;
   double f_doppler;
   double f_sampling;
   double *n_s;                 /* Nx1 vector of time indices*/
-  int N_sin;                /* number of sinusoids */
-  double *out_re;              /* Nx1 output matrix real part*/
-  double *out_im;              /* Nx1 output matrix imaginary part */
+  int N_sin;                   /* number of sinusoids */
+  size_t num_links;            /* number of independent processes */
+  uint64_t seed;
+  double *out_re;              /* N x num_links output matrix real part*/
+  double *out_im;              /* N x num_links output matrix imaginary part */
   size_t n_s_len;
 
   /* check for proper number of arguments */
-  if(nrhs == 3) {
-    N_sin = 8;
-  } else if(nrhs != 4) {
-    mexErrMsgIdAndTxt("fading_channel_zheng:nrhs","Four inputs required.");
-  } else {
-    N_sin = mxGetScalar(prhs[3]);
+  if(nrhs < 3 || nrhs > 6) {
+    mexErrMsgIdAndTxt("fading_channel_zheng:nrhs","Three to six inputs required.");
   }
 
   if(nlhs!=1) {
     mexErrMsgIdAndTxt("fading_channel_zheng:nlhs","One output required.");
   }
 
-  if (N_sin > N_SIN_MAX) {
-    mexErrMsgIdAndTxt("fading_channel_zheng:N_sin","N_sin is too high. Recompile mex function with sufficient N_SIN_MAX.");
+  N_sin = (nrhs > 3) ? (int) mxGetScalar(prhs[3]) : 8;
+  num_links = (nrhs > 4) ? (size_t) mxGetScalar(prhs[4]) : 1;
+  seed = (nrhs > 5) ? (uint64_t) mxGetScalar(prhs[5]) : fading_zheng_mix(call_cnt++);
+
+  if (N_sin < 1 || N_sin > FADING_ZHENG_N_SIN_MAX) {
+    mexErrMsgIdAndTxt("fading_channel_zheng:N_sin","N_sin is too high. Recompile mex function with sufficient FADING_ZHENG_N_SIN_MAX.");
   }
 
   /* get the input arguments */
   f_doppler  = mxGetScalar(prhs[0]);
   f_sampling = mxGetScalar(prhs[1]);
   n_s = mxGetPr(prhs[2]);
-  n_s_len = mxGetN(prhs[2]);
+  n_s_len = mxGetM(prhs[2]) * mxGetN(prhs[2]);
 
   /* create the output matrix */
-  plhs[0] = mxCreateDoubleMatrix((mwSize)n_s_len, 1, mxCOMPLEX);
+  plhs[0] = mxCreateDoubleMatrix((mwSize)n_s_len, (mwSize)num_links, mxCOMPLEX);
 
   /* get a pointer to the real data in the output matrix */
   out_re = mxGetPr(plhs[0]);
   out_im = mxGetPi(plhs[0]);
 
   /* call the computational routine */
-  fading_channel_zheng(f_doppler, f_sampling, n_s, n_s_len, N_sin, out_re, out_im);
+  fading_channel_zheng(f_doppler, f_sampling, n_s, n_s_len, N_sin, num_links, seed, out_re, out_im);
 }
@@ -0,0 +1,133 @@
+/* Reentrant Zheng and Xiao sum-of-sinusoids Rayleigh fading generator.
+ *
+ * Random phases and angles of arrival of each link are drawn from a
+ * counter-based generator (splitmix64 finalizer applied to seed, link and
+ * draw index), so no global RNG state is used, links can be generated in
+ * any order or in parallel, and a given seed always yields the same channel.
+ *
+ * On a uniform time grid every sinusoid is a rotating phasor, so samples are
+ * produced by complex multiplication instead of cos() calls. Phasors are
+ * recomputed exactly every FADING_ZHENG_RESYNC samples to bound the
+ * accumulated rounding error.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef FADING_ZHENG_H
+#define FADING_ZHENG_H
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define FADING_ZHENG_N_SIN_MAX 32
+#define FADING_ZHENG_RESYNC 512
+
+typedef struct {
+  int N_sin;
+  double s;
+  double w_re[FADING_ZHENG_N_SIN_MAX]; /* angular frequencies [rad/s] */
+  double w_im[FADING_ZHENG_N_SIN_MAX];
+  double p_re[FADING_ZHENG_N_SIN_MAX]; /* initial phases [rad] */
+  double p_im[FADING_ZHENG_N_SIN_MAX];
+} fading_zheng_t;
+
+static uint64_t fading_zheng_mix(uint64_t x) {
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+/* k-th uniform variate in [0,1) of the given link */
+static double fading_zheng_uniform(uint64_t seed, uint64_t link, uint64_t k) {
+  uint64_t x = fading_zheng_mix(fading_zheng_mix(seed ^ (link << 32)) + k);
+  return (double)(x >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static void fading_zheng_init(fading_zheng_t* prm, double f_doppler, int N_sin, uint64_t seed, uint64_t link) {
+  int i;
+  double th, a, two_pi_fd = 2 * M_PI * f_doppler;
+
+  prm->N_sin = N_sin;
+  prm->s = sqrt(2.0 / (double)N_sin);
+
+  th = 2 * M_PI * (fading_zheng_uniform(seed, link, 0) - 0.5);
+  for (i = 0; i < N_sin; i++) {
+    prm->p_re[i] = 2 * M_PI * (fading_zheng_uniform(seed, link, 2*i+1) - 0.5);
+    prm->p_im[i] = 2 * M_PI * (fading_zheng_uniform(seed, link, 2*i+2) - 0.5);
+    a = (M_PI * (2.0*(i+1) - 1) + th) / (double)(4 * N_sin);
+    prm->w_re[i] = two_pi_fd * cos(a);
+    prm->w_im[i] = two_pi_fd * sin(a);
+  }
+}
+
+/* channel coefficients at times t0 + n*dt, n = 0..len-1 */
+static void fading_zheng_uniform_grid(const fading_zheng_t* prm, double t0, double dt, size_t len, double* out_re, double* out_im) {
+  double zr_c[FADING_ZHENG_N_SIN_MAX], zr_s[FADING_ZHENG_N_SIN_MAX];
+  double zi_c[FADING_ZHENG_N_SIN_MAX], zi_s[FADING_ZHENG_N_SIN_MAX];
+  double rr_c[FADING_ZHENG_N_SIN_MAX], rr_s[FADING_ZHENG_N_SIN_MAX];
+  double ri_c[FADING_ZHENG_N_SIN_MAX], ri_s[FADING_ZHENG_N_SIN_MAX];
+  double acc_re, acc_im, c, s, t;
+  size_t n;
+  int j, N_sin = prm->N_sin;
+
+  for (j = 0; j < N_sin; j++) {
+    rr_c[j] = cos(prm->w_re[j] * dt);
+    rr_s[j] = sin(prm->w_re[j] * dt);
+    ri_c[j] = cos(prm->w_im[j] * dt);
+    ri_s[j] = sin(prm->w_im[j] * dt);
+  }
+
+  for (n = 0; n < len; n++) {
+    if (n % FADING_ZHENG_RESYNC == 0) {
+      t = t0 + (double)n * dt;
+      for (j = 0; j < N_sin; j++) {
+        zr_c[j] = cos(prm->w_re[j] * t + prm->p_re[j]);
+        zr_s[j] = sin(prm->w_re[j] * t + prm->p_re[j]);
+        zi_c[j] = cos(prm->w_im[j] * t + prm->p_im[j]);
+        zi_s[j] = sin(prm->w_im[j] * t + prm->p_im[j]);
+      }
+    }
+
+    acc_re = 0.0;
+    acc_im = 0.0;
+    for (j = 0; j < N_sin; j++) {
+      acc_re += zr_c[j];
+      acc_im += zi_c[j];
+
+      c = zr_c[j] * rr_c[j] - zr_s[j] * rr_s[j];
+      s = zr_c[j] * rr_s[j] + zr_s[j] * rr_c[j];
+      zr_c[j] = c;
+      zr_s[j] = s;
+
+      c = zi_c[j] * ri_c[j] - zi_s[j] * ri_s[j];
+      s = zi_c[j] * ri_s[j] + zi_s[j] * ri_c[j];
+      zi_c[j] = c;
+      zi_s[j] = s;
+    }
+    out_re[n] = prm->s * acc_re;
+    out_im[n] = prm->s * acc_im;
+  }
+}
+
+/* channel coefficients at arbitrary times t[n] */
+static void fading_zheng_times(const fading_zheng_t* prm, const double* t, size_t len, double* out_re, double* out_im) {
+  double acc_re, acc_im;
+  size_t n;
+  int j;
+
+  for (n = 0; n < len; n++) {
+    acc_re = 0.0;
+    acc_im = 0.0;
+    for (j = 0; j < prm->N_sin; j++) {
+      acc_re += cos(t[n] * prm->w_re[j] + prm->p_re[j]);
+      acc_im += cos(t[n] * prm->w_im[j] + prm->p_im[j]);
+    }
+    out_re[n] = prm->s * acc_re;
+    out_im[n] = prm->s * acc_im;
+  }
+}
+
+#endif
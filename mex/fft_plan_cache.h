@@ -0,0 +1,92 @@
+/* Cache of radix-2 FFT plans (see fft_radix2.h) kept between mex calls.
+ *
+ * Plans are stored in persistent memory and released at mex exit. When the
+ * cache is full, the least recently used plan is replaced. A mex function
+ * calls fft_plan_cache_begin on entry: plans returned after that are pinned
+ * until the next call, so that a pointer obtained earlier in the same call
+ * never refers to a replaced plan.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef FFT_PLAN_CACHE_H
+#define FFT_PLAN_CACHE_H
+
+#include "mex.h"
+#include "fft_radix2.h"
+
+#define FFT_PLAN_CACHE_SIZE 4
+
+typedef struct {
+  fft_radix2_t plan;
+  double* buf;
+  unsigned long last_use;
+  unsigned long call;
+} fft_plan_cache_t;
+
+static fft_plan_cache_t plan_cache[FFT_PLAN_CACHE_SIZE];
+static unsigned long plan_cache_clock = 0;
+static unsigned long plan_cache_call = 1;
+static int plan_cache_registered = 0;
+
+static void fft_plan_cache_free(void) {
+  int k;
+  for (k = 0; k < FFT_PLAN_CACHE_SIZE; k++) {
+    if (plan_cache[k].buf != NULL)
+      mxFree(plan_cache[k].buf);
+    plan_cache[k].buf = NULL;
+  }
+}
+
+/* releases the plans pinned by the previous mex call */
+static void fft_plan_cache_begin(void) {
+  plan_cache_call++;
+}
+
+/* returns plan of a power of two size n, valid until the end of the mex
+ * call */
+static const fft_radix2_t* fft_plan_get(size_t n) {
+  int k, victim = -1;
+
+  plan_cache_clock++;
+
+  for (k = 0; k < FFT_PLAN_CACHE_SIZE; k++) {
+    if (plan_cache[k].buf != NULL && plan_cache[k].plan.n == n) {
+      plan_cache[k].last_use = plan_cache_clock;
+      plan_cache[k].call = plan_cache_call;
+      return &plan_cache[k].plan;
+    }
+  }
+
+  if (!plan_cache_registered) {
+    mexAtExit(fft_plan_cache_free);
+    plan_cache_registered = 1;
+  }
+
+  /* take a free entry or replace the least recently used one not pinned
+   * by the current call */
+  for (k = 0; k < FFT_PLAN_CACHE_SIZE; k++) {
+    if (plan_cache[k].buf == NULL) {
+      victim = k;
+      break;
+    }
+    if (plan_cache[k].call != plan_cache_call &&
+        (victim < 0 || plan_cache[k].last_use < plan_cache[victim].last_use))
+      victim = k;
+  }
+  if (victim < 0)
+    mexErrMsgIdAndTxt("fft_plan_cache:full","More than %d FFT sizes used in a single call.", FFT_PLAN_CACHE_SIZE);
+  k = victim;
+
+  plan_cache[k].last_use = plan_cache_clock;
+  plan_cache[k].call = plan_cache_call;
+  if (plan_cache[k].buf != NULL)
+    mxFree(plan_cache[k].buf);
+  plan_cache[k].buf = (double*) mxMalloc(n * sizeof(double));
+  mexMakeMemoryPersistent(plan_cache[k].buf);
+  fft_radix2_init(&plan_cache[k].plan, n, plan_cache[k].buf);
+
+  return &plan_cache[k].plan;
+}
+
+#endif
@@ -0,0 +1,83 @@
+/* Iterative radix-2 complex FFT on split real/imaginary arrays.
+ *
+ * The plan holds n/2 twiddle factors in a caller-provided buffer of n
+ * doubles, so the header does not allocate memory and may be used from
+ * mex kernels and worker threads alike. Transforms are unnormalized, the
+ * inverse transform must be scaled by 1/n by the caller.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef FFT_RADIX2_H
+#define FFT_RADIX2_H
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stddef.h>
+
+typedef struct {
+  size_t n;
+  double* tw_re; /* cos(2*pi*k/n), k = 0..n/2-1 */
+  double* tw_im; /* -sin(2*pi*k/n) */
+} fft_radix2_t;
+
+/* smallest power of two not lower than n */
+static size_t fft_radix2_len(size_t n) {
+  size_t m = 1;
+  while (m < n)
+    m <<= 1;
+  return m;
+}
+
+/* n must be a power of two, buf must hold n doubles */
+static void fft_radix2_init(fft_radix2_t* plan, size_t n, double* buf) {
+  size_t k;
+
+  plan->n = n;
+  plan->tw_re = buf;
+  plan->tw_im = buf + n/2;
+  for (k = 0; k < n/2; k++) {
+    plan->tw_re[k] = cos(2 * M_PI * (double)k / (double)n);
+    plan->tw_im[k] = -sin(2 * M_PI * (double)k / (double)n);
+  }
+}
+
+/* in-place transform, inverse != 0 selects the (unscaled) inverse DFT */
+static void fft_radix2(const fft_radix2_t* plan, double* re, double* im, int inverse) {
+  size_t n = plan->n, i, j, k, len, half, step;
+  double t_re, t_im, w_re, w_im, sgn = inverse ? -1.0 : 1.0;
+
+  /* bit reversal permutation */
+  for (i = 1, j = 0; i < n; i++) {
+    k = n >> 1;
+    while (j & k) {
+      j ^= k;
+      k >>= 1;
+    }
+    j |= k;
+    if (i < j) {
+      t_re = re[i]; re[i] = re[j]; re[j] = t_re;
+      t_im = im[i]; im[i] = im[j]; im[j] = t_im;
+    }
+  }
+
+  /* butterflies */
+  for (len = 2; len <= n; len <<= 1) {
+    half = len >> 1;
+    step = n / len;
+    for (i = 0; i < n; i += len) {
+      for (k = 0; k < half; k++) {
+        w_re = plan->tw_re[k * step];
+        w_im = sgn * plan->tw_im[k * step];
+        t_re = re[i+k+half] * w_re - im[i+k+half] * w_im;
+        t_im = re[i+k+half] * w_im + im[i+k+half] * w_re;
+        re[i+k+half] = re[i+k] - t_re;
+        im[i+k+half] = im[i+k] - t_im;
+        re[i+k] += t_re;
+        im[i+k] += t_im;
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,81 @@
+/* Word-parallel generator of the 38.211 sec. 5.2.1 pseudo-random sequence.
+ *
+ * Both m-sequences are generated 32 bits per step. A 62-bit window of the
+ * sequence is advanced using the squared generator polynomials, i.e.
+ * x1(n+62) = x1(n+6) + x1(n) and x2(n+62) = x2(n+6) + x2(n+4) + x2(n+2) + x2(n),
+ * for which all 32 new bits depend on the window only. The N_c = 1600
+ * warm-up is replaced by a precomputed jump: the x1 window at N_c is a
+ * constant, and the x2 window at N_c is a GF(2) linear function of c_init
+ * stored as one 62-bit column per c_init bit. Both are compile-time
+ * constants, the window of x1(0) = 1 and of x2 = bit k of c_init extended
+ * by the original recurrences and advanced by N_c/32 steps, so the
+ * generator is safe to use from any thread without initialization.
+ *
+ * Bit n of the sequence is returned at bit n%32 of word n/32.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef GOLD31_H
+#define GOLD31_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define GOLD31_N_C 1600
+
+typedef struct {
+  uint64_t w1;
+  uint64_t w2;
+} gold31_t;
+
+static const uint64_t gold31_x1_jump = 0x2AC0A9A45E485840ULL;
+static const uint64_t gold31_x2_jump[31] = {
+  0x2D7FF07070889900ULL, 0x378010909199AB01ULL, 0x027FD15153BBCF03ULL, 0x298052D2D7FF0707ULL,
+  0x1300A5A5AFFE0E0EULL, 0x26014B4B5FFC1C1CULL, 0x0C029696BFF83838ULL, 0x18052D2D7FF07070ULL,
+  0x300A5A5AFFE0E0E1ULL, 0x2014B4B5FFC1C1C2ULL, 0x0029696BFF838384ULL, 0x0052D2D7FF070708ULL,
+  0x00A5A5AFFE0E0E11ULL, 0x014B4B5FFC1C1C22ULL, 0x029696BFF8383844ULL, 0x052D2D7FF0707088ULL,
+  0x0A5A5AFFE0E0E111ULL, 0x14B4B5FFC1C1C222ULL, 0x29696BFF83838444ULL, 0x12D2D7FF07070889ULL,
+  0x25A5AFFE0E0E1113ULL, 0x0B4B5FFC1C1C2226ULL, 0x1696BFF83838444CULL, 0x2D2D7FF070708899ULL,
+  0x1A5AFFE0E0E11132ULL, 0x34B5FFC1C1C22264ULL, 0x296BFF83838444C8ULL, 0x12D7FF0707088990ULL,
+  0x25AFFE0E0E111320ULL, 0x0B5FFC1C1C222640ULL, 0x16BFF83838444C80ULL
+};
+
+static uint64_t gold31_x1_step(uint64_t w) {
+  uint64_t n = (w ^ (w >> 6)) & 0xFFFFFFFF;
+  return (w >> 32) | (n << 30);
+}
+
+static uint64_t gold31_x2_step(uint64_t w) {
+  uint64_t n = (w ^ (w >> 2) ^ (w >> 4) ^ (w >> 6)) & 0xFFFFFFFF;
+  return (w >> 32) | (n << 30);
+}
+
+static void gold31_start(gold31_t* g, uint32_t c_init) {
+  int k;
+
+  g->w1 = gold31_x1_jump;
+  g->w2 = 0;
+  for (k = 0; k < 31; k++)
+    if (c_init & (1u << k))
+      g->w2 ^= gold31_x2_jump[k];
+}
+
+/* returns the next 32 bits of the sequence */
+static uint32_t gold31_next(gold31_t* g) {
+  uint32_t c = (uint32_t)((g->w1 ^ g->w2) & 0xFFFFFFFF);
+  g->w1 = gold31_x1_step(g->w1);
+  g->w2 = gold31_x2_step(g->w2);
+  return c;
+}
+
+static void gold31_packed(uint32_t c_init, size_t words, uint32_t* seq) {
+  gold31_t g;
+  size_t n;
+
+  gold31_start(&g, c_init);
+  for (n = 0; n < words; n++)
+    seq[n] = gold31_next(&g);
+}
+
+#endif
@@ -1,77 +1,149 @@
-/* c = gold31seq_mex(c_init, len)
+/* c = gold31seq_mex(c_init, len, format='binary')
  *
  * Matlab MEX acceleration for gold31seq function.
  *
+ * The sequence is generated 32 bits per step with a precomputed jump over
+ * the N_c = 1600 warm-up (see gold31.h).
+ *
+ * Recently generated sequences are kept in a small LRU cache of packed words,
+ * so that repeated c_init values (e.g. DMRS of the same slot and symbol) are
+ * only copied out.
+ *
+ * Formats: 'binary' (0/1 doubles), 'bipolar' (1-2c doubles) and 'packed'
+ * (uint32 words, bit n of the sequence at bit n%32 of word n/32).
+ *
  * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
  */
 
-
 #include "mex.h"
 #include <string.h>
-
-void init_x2(unsigned long c_init, char* x2) {
-  int i;
-  for (i = 0; i < 30; i++) {
-    x2[i] = ( ((1 << i) & c_init) != 0 );
+#include <stdint.h>
+#include "gold31.h"
+
+#define GOLD_CACHE_SIZE 16
+#define GOLD_CACHE_MAX_WORDS 2048
+
+typedef struct {
+  uint32_t c_init;
+  size_t words;
+  uint32_t* seq;
+  unsigned long last_use;
+} gold_cache_t;
+
+static gold_cache_t cache[GOLD_CACHE_SIZE];
+static unsigned long cache_clock = 0;
+
+static void free_cache(void) {
+  int k;
+  for (k = 0; k < GOLD_CACHE_SIZE; k++) {
+    if (cache[k].seq != NULL)
+      mxFree(cache[k].seq);
+    cache[k].seq = NULL;
+    cache[k].words = 0;
   }
 }
 
-void gold31seq(unsigned long c_init, size_t len, double* seq_out) {
-  const size_t N_c = 1600;
-  size_t n;
-  char* x1;
-  char* x2;
-  size_t x_size = N_c + len + 31;
-  
-  x1 = mxMalloc(x_size);
-  memset(x1, 0, x_size);
-  x1[0] = 1;
-
-  x2 = mxMalloc(x_size);
-  memset(x2, 0, x_size);
-  init_x2(c_init, x2);
-
-  for (n = 0; n < len+N_c; n++) {
-    x1[31+n] = (x1[n+3] + x1[n]) & 1;
-    x2[n+31] = (x2[n+3] + x2[n+2] + x2[n+1] + x2[n]) & 1;
+/* returns packed sequence of at least the given number of words, either from
+ * the cache or generated into the least recently used cache entry */
+static const uint32_t* gold31seq_cached(uint32_t c_init, size_t words) {
+  int k, lru = 0;
+
+  for (k = 0; k < GOLD_CACHE_SIZE; k++) {
+    if (cache[k].seq != NULL && cache[k].c_init == c_init && cache[k].words >= words) {
+      cache[k].last_use = ++cache_clock;
+      return cache[k].seq;
+    }
+    if (cache[k].last_use < cache[lru].last_use)
+      lru = k;
   }
 
-  for (n = 0; n < len; n++) {
-    seq_out[n] = (double) ((x1[n+N_c] + x2[n+N_c]) & 1);
+  if (cache[lru].seq == NULL || cache[lru].words < words) {
+    if (cache[lru].seq != NULL)
+      mxFree(cache[lru].seq);
+    cache[lru].seq = (uint32_t*) mxMalloc(words * sizeof(uint32_t));
+    mexMakeMemoryPersistent(cache[lru].seq);
   }
 
-  mxFree(x1);
-  mxFree(x2);
+  gold31_packed(c_init, words, cache[lru].seq);
+  cache[lru].c_init = c_init;
+  cache[lru].words = words;
+  cache[lru].last_use = ++cache_clock;
+
+  return cache[lru].seq;
 }
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
-  unsigned long c_init;
-  size_t  len;
+  uint32_t c_init;
+  size_t len, words, n;
+  const uint32_t* seq;
+  uint32_t* seq_tmp = NULL;
   double* seq_out;
+  char* format = NULL;
+  int fmt = 0;
 
   /* check for proper number and format of arguments */
-  if(nrhs != 2)
-    mexErrMsgIdAndTxt("gold31seq:nrhs","Two inputs required.");
+  if(nrhs < 2 || nrhs > 3)
+    mexErrMsgIdAndTxt("gold31seq:nrhs","Two or three inputs required.");
 
   if(nlhs != 1)
     mexErrMsgIdAndTxt("gold31seq:nlhs","One output required.");
 
-  if( !mxIsDouble(prhs[0]) || mxIsComplex(prhs[0]) || !(mxGetM(prhs[0])==1 && mxGetM(prhs[0])==1) )
+  if( !mxIsDouble(prhs[0]) || mxIsComplex(prhs[0]) || !(mxGetM(prhs[0])==1 && mxGetN(prhs[0])==1) )
     mexErrMsgIdAndTxt( "MATLAB:gold31seq:inputNotRealScalarDouble",
       "Input c_init must be a noncomplex scalar.");
 
-  if( !mxIsDouble(prhs[1]) || mxIsComplex(prhs[1]) || !(mxGetM(prhs[1])==1 && mxGetM(prhs[1])==1) )
+  if( !mxIsDouble(prhs[1]) || mxIsComplex(prhs[1]) || !(mxGetM(prhs[1])==1 && mxGetN(prhs[1])==1) )
     mexErrMsgIdAndTxt( "MATLAB:gold31seq:inputNotRealScalarDouble",
       "Input len must be a noncomplex scalar.");
 
+  if (nrhs > 2) {
+    format = mxArrayToString(prhs[2]);
+    if (format != NULL && strcmp(format, "binary") == 0)
+      fmt = 0;
+    else if (format != NULL && strcmp(format, "bipolar") == 0)
+      fmt = 1;
+    else if (format != NULL && strcmp(format, "packed") == 0)
+      fmt = 2;
+    else
+      fmt = -1;
+    mxFree(format);
+    if (fmt < 0)
+      mexErrMsgIdAndTxt("gold31seq:format","Invalid format (binary, bipolar or packed supported).");
+  }
+
   /* get the input arguments */
-  c_init = (unsigned long) mxGetScalar(prhs[0]);
+  c_init = (uint32_t) mxGetScalar(prhs[0]) & 0x7FFFFFFF;
   len = (size_t) mxGetScalar(prhs[1]);
+  words = (len + 31) / 32;
 
-  /* create the output matrix */
-  plhs[0] = mxCreateDoubleMatrix(1, (mwSize)len, mxREAL);
-  seq_out = mxGetPr(plhs[0]);
+  mexAtExit(free_cache);
 
   /* call the computational routine */
-  gold31seq(c_init, len, seq_out);
-}
\ No newline at end of file
+  if (words <= GOLD_CACHE_MAX_WORDS) {
+    seq = gold31seq_cached(c_init, words);
+  } else {
+    seq_tmp = (uint32_t*) mxMalloc(words * sizeof(uint32_t));
+    gold31_packed(c_init, words, seq_tmp);
+    seq = seq_tmp;
+  }
+
+  /* create the output matrix */
+  if (fmt == 2) {
+    plhs[0] = mxCreateNumericMatrix(1, (mwSize)words, mxUINT32_CLASS, mxREAL);
+    memcpy(mxGetData(plhs[0]), seq, words * sizeof(uint32_t));
+    if (len % 32)
+      ((uint32_t*)mxGetData(plhs[0]))[words-1] &= (1u << (len % 32)) - 1;
+  } else {
+    plhs[0] = mxCreateDoubleMatrix(1, (mwSize)len, mxREAL);
+    seq_out = mxGetPr(plhs[0]);
+    if (fmt == 1)
+      for (n = 0; n < len; n++)
+        seq_out[n] = ((seq[n >> 5] >> (n & 31)) & 1) ? -1.0 : 1.0;
+    else
+      for (n = 0; n < len; n++)
+        seq_out[n] = (double) ((seq[n >> 5] >> (n & 31)) & 1);
+  }
+
+  if (seq_tmp != NULL)
+    mxFree(seq_tmp);
+}
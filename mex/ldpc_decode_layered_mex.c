@@ -0,0 +1,280 @@
+/* [sh, cw_valid, iter, stop, weight] = ldpc_decode_layered_mex(LLRin, base_graph, Z_c, max_iter, method, param, num_threads, crc_poly, crc_bits, patience)
+ *
+ * Matlab MEX acceleration for ldpc_decode_layered function.
+ *
+ * Each row of LLRin is decoded as a separate codeword. Rows may either hold
+ * the full codeword, or omit the 2*Z_c punctured systematic bits, which are
+ * then decoded as erasures. Codewords are distributed over a pool of
+ * num_threads workers (0 selects the number of online CPUs). The pool and
+ * the decoder workspaces of every worker, kept per graph for the last
+ * LAYERED_WS_GRAPHS graphs, persist between calls and are released when
+ * the MEX file is cleared. The graph of
+ * base_graph lifted by Z_c is taken from the process-wide store of
+ * ldpc_graph_store.h.
+ *
+ * int16 or int8 LLRin (see llr_quant.h) is decoded by the fixed-point
+ * decoder in ldpc_layered_i16.h and sh is returned as uint8, the OMS offset
+ * param is then in units of the quantized LLRs.
+ *
+ * The optional crc_poly (generator polynomial as in nr_38_212_crc_calc,
+ * empty to disable), crc_bits and patience configure early termination
+ * (see ldpc_term.h), stop returns the LDPC_TERM_* reason and weight the
+ * final syndrome weight of every codeword.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#include "mex.h"
+#include "ldpc_layered.h"
+#include "ldpc_layered_i16.h"
+#include "ldpc_graph_store.h"
+#include "mex_file_path.h"
+#include "ldpc_term.h"
+#include "thread_pool.h"
+
+#define N_PUNCT_COLS 2
+#define LAYERED_WS_GRAPHS 8
+
+typedef struct {
+  const base_graph_t* bg;
+  int Z;
+  /* per-worker workspaces, allocated on first use by the worker */
+  ldpc_layered_ws_t** ws;
+  ldpc_layered_i16_ws_t** ws16;
+  /* set by the worker that fails to allocate its workspace */
+  int failed[THREAD_POOL_MAX];
+  const double* LLRin;
+  /* fixed-point input, NULL for double LLRin */
+  const void* LLRq;
+  int in_int8;
+  size_t C;
+  int n_punct;
+  int max_iters;
+  int method;
+  double param;
+  const ldpc_term_t* term;
+  double* sh;
+  unsigned char* sh_u8;
+  double* cw_valid;
+  double* iter;
+  double* stop;
+  double* weight;
+} ldpc_batch_t;
+
+/* workspaces of the workers for graph (bg_num, Z) */
+typedef struct {
+  int bg_num;
+  int Z;
+  unsigned long last_use;
+  ldpc_layered_ws_t* ws[THREAD_POOL_MAX];
+  ldpc_layered_i16_ws_t* ws16[THREAD_POOL_MAX];
+} layered_ws_t;
+
+static thread_pool_persistent_t* layered_pool = NULL;
+static layered_ws_t layered_ws[LAYERED_WS_GRAPHS];
+static unsigned long layered_ws_clock = 0;
+
+static void layered_ws_clear(layered_ws_t* e) {
+  int n;
+
+  for (n = 0; n < THREAD_POOL_MAX; n++) {
+    ldpc_layered_ws_free(e->ws[n]);
+    ldpc_layered_i16_ws_free(e->ws16[n]);
+    e->ws[n] = NULL;
+    e->ws16[n] = NULL;
+  }
+  e->bg_num = 0;
+  e->Z = 0;
+}
+
+/* returns workspaces of graph (bg_num, Z), replacing those of the least
+ * recently used graph if there are none */
+static layered_ws_t* layered_ws_get(int bg_num, int Z) {
+  int k, victim = 0;
+
+  layered_ws_clock++;
+  for (k = 0; k < LAYERED_WS_GRAPHS; k++) {
+    if (layered_ws[k].bg_num == bg_num && layered_ws[k].Z == Z) {
+      layered_ws[k].last_use = layered_ws_clock;
+      return &layered_ws[k];
+    }
+    if (layered_ws[k].last_use < layered_ws[victim].last_use)
+      victim = k;
+  }
+
+  layered_ws_clear(&layered_ws[victim]);
+  layered_ws[victim].bg_num = bg_num;
+  layered_ws[victim].Z = Z;
+  layered_ws[victim].last_use = layered_ws_clock;
+  return &layered_ws[victim];
+}
+
+static void layered_release(void) {
+  int k;
+
+  thread_pool_destroy(layered_pool);
+  layered_pool = NULL;
+  for (k = 0; k < LAYERED_WS_GRAPHS; k++)
+    layered_ws_clear(&layered_ws[k]);
+  ldpc_graph_release();
+}
+
+void ldpc_decode_task(void* ctx, int r, int worker) {
+  ldpc_batch_t* b = (ldpc_batch_t*) ctx;
+  ldpc_term_stats_t stats;
+
+  if (b->LLRq != NULL) {
+    if (b->ws16[worker] == NULL)
+      b->ws16[worker] = ldpc_layered_i16_ws_alloc(b->bg, b->Z);
+
+    if (b->ws16[worker] == NULL) {
+      b->failed[worker] = 1;
+      return;
+    }
+
+    ldpc_layered_decode_i16(b->bg, b->ws16[worker], b->in_int8 ? (const void*)((const int8_t*) b->LLRq + r) : (const void*)((const int16_t*) b->LLRq + r),
+      b->in_int8, b->C, b->n_punct, b->max_iters, b->method, b->param, b->term, b->sh_u8 + r, b->C, b->cw_valid + r, b->iter + r, &stats);
+  } else {
+    if (b->ws[worker] == NULL)
+      b->ws[worker] = ldpc_layered_ws_alloc(b->bg, b->Z);
+
+    if (b->ws[worker] == NULL) {
+      b->failed[worker] = 1;
+      return;
+    }
+
+    ldpc_layered_decode(b->bg, b->ws[worker], b->LLRin + r, b->C, b->n_punct, b->max_iters, b->method, b->param, b->term,
+      b->sh + r, b->C, b->cw_valid + r, b->iter + r, &stats);
+  }
+
+  if (b->stop != NULL)
+    b->stop[r] = (double) stats.reason;
+  if (b->weight != NULL)
+    b->weight[r] = (double) stats.weight;
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+  const base_graph_t* bg;
+  layered_ws_t* ws;
+  ldpc_batch_t batch;
+  ldpc_term_t term;
+  nr_crc_t crc;
+  size_t N;
+  int base_graph, Z, num_threads, n, failed;
+  char* method_str;
+  char gs_path[LDPC_GS_PATH_MAX];
+
+  /* check for proper number and format of arguments */
+  if(nrhs < 6 || nrhs > 10)
+    mexErrMsgIdAndTxt("ldpc_decode_layered:nrhs","Six to ten inputs required.");
+
+  if(nlhs > 5)
+    mexErrMsgIdAndTxt("ldpc_decode_layered:nlhs","At most five outputs required.");
+
+  /* get the input arguments */
+  batch.C = mxGetM(prhs[0]);
+  N = mxGetN(prhs[0]);
+  batch.LLRin = NULL;
+  batch.LLRq = NULL;
+  batch.in_int8 = mxIsInt8(prhs[0]);
+  if (batch.in_int8 || mxIsInt16(prhs[0]))
+    batch.LLRq = mxGetData(prhs[0]);
+  else if (mxIsDouble(prhs[0]))
+    batch.LLRin = mxGetPr(prhs[0]);
+  base_graph = (int) mxGetScalar(prhs[1]);
+  Z = (int) mxGetScalar(prhs[2]);
+  batch.max_iters = (int) mxGetScalar(prhs[3]);
+  batch.param = mxGetScalar(prhs[5]);
+  num_threads = (nrhs > 6) ? (int) mxGetScalar(prhs[6]) : 1;
+
+  if ((base_graph != 1 && base_graph != 2) || ldpc_lifting_set(Z) < 0)
+    mexErrMsgIdAndTxt("ldpc_decode_layered:graph","base_graph must be 1 or 2 and Z_c a lifting size of Table 5.3.2-1.");
+
+  if ((batch.LLRin == NULL && batch.LLRq == NULL) || mxIsComplex(prhs[0]))
+    mexErrMsgIdAndTxt("ldpc_decode_layered:LLRin","LLRin must be a real double, int16 or int8 matrix.");
+
+  mexAtExit(layered_release);
+  if (!ldpc_gs_opened && mex_file_path(LDPC_GS_FILE, gs_path, sizeof(gs_path)))
+    ldpc_graph_store_default(gs_path);
+  bg = ldpc_graph_lookup(base_graph, Z);
+  if (bg == NULL)
+    mexErrMsgIdAndTxt("ldpc_decode_layered:memory","Out of memory.");
+
+  if (N == (size_t) bg->cols * Z)
+    batch.n_punct = 0;
+  else if (N == (size_t) (bg->cols - N_PUNCT_COLS) * Z)
+    batch.n_punct = N_PUNCT_COLS;
+  else
+    mexErrMsgIdAndTxt("ldpc_decode_layered:LLRin","Row length of LLRin does not match the base graph and Z_c.");
+
+  method_str = mxArrayToString(prhs[4]);
+  if (strcmp(method_str, "NMS") == 0)
+    batch.method = LDPC_METHOD_NMS;
+  else if (strcmp(method_str, "OMS") == 0)
+    batch.method = LDPC_METHOD_OMS;
+  else
+    batch.method = -1;
+  mxFree(method_str);
+
+  if (batch.method < 0)
+    mexErrMsgIdAndTxt("ldpc_decode_layered:method","Invalid min-sum variant (NMS or OMS supported)");
+
+  term.crc = NULL;
+  term.crc_bits = (nrhs > 8) ? (size_t) mxGetScalar(prhs[8]) : 0;
+  term.patience = (nrhs > 9) ? (int) mxGetScalar(prhs[9]) : 0;
+  if (nrhs > 7 && !mxIsEmpty(prhs[7])) {
+    if (!nr_crc_init(&crc, mxGetPr(prhs[7]), mxGetN(prhs[7]) * mxGetM(prhs[7])) || term.crc_bits > (size_t) bg->cols * Z)
+      mexErrMsgIdAndTxt("ldpc_decode_layered:crc","Invalid CRC polynomial or number of CRC bits.");
+    term.crc = &crc;
+  }
+  batch.term = &term;
+
+  /* create the output matrix */
+  if (batch.LLRq != NULL) {
+    plhs[0] = mxCreateNumericMatrix((mwSize)batch.C, (mwSize)bg->cols * Z, mxUINT8_CLASS, mxREAL);
+    batch.sh_u8 = mxGetData(plhs[0]);
+  } else {
+    plhs[0] = mxCreateDoubleMatrix((mwSize)batch.C, (mwSize)bg->cols * Z, mxREAL);
+    batch.sh = mxGetPr(plhs[0]);
+  }
+
+  plhs[1] = mxCreateDoubleMatrix((mwSize)batch.C, 1, mxREAL);
+  batch.cw_valid = mxGetPr(plhs[1]);
+
+  plhs[2] = mxCreateDoubleMatrix((mwSize)batch.C, 1, mxREAL);
+  batch.iter = mxGetPr(plhs[2]);
+
+  batch.stop = NULL;
+  if (nlhs > 3) {
+    plhs[3] = mxCreateDoubleMatrix((mwSize)batch.C, 1, mxREAL);
+    batch.stop = mxGetPr(plhs[3]);
+  }
+
+  batch.weight = NULL;
+  if (nlhs > 4) {
+    plhs[4] = mxCreateDoubleMatrix((mwSize)batch.C, 1, mxREAL);
+    batch.weight = mxGetPr(plhs[4]);
+  }
+
+  batch.bg = bg;
+  batch.Z = Z;
+  ws = layered_ws_get(base_graph, Z);
+  batch.ws = ws->ws;
+  batch.ws16 = ws->ws16;
+  for (n = 0; n < THREAD_POOL_MAX; n++)
+    batch.failed[n] = 0;
+
+  layered_pool = thread_pool_reserve(layered_pool, ((size_t) num_threads > batch.C) ? (int) batch.C : num_threads);
+  if (layered_pool == NULL)
+    mexErrMsgIdAndTxt("ldpc_decode_layered:memory","Out of memory.");
+
+  /* call the computational routine */
+  thread_pool_exec(layered_pool, num_threads, (int) batch.C, ldpc_decode_task, &batch);
+
+  failed = 0;
+  for (n = 0; n < THREAD_POOL_MAX; n++)
+    failed |= batch.failed[n];
+
+  if (failed)
+    mexErrMsgIdAndTxt("ldpc_decode_layered:memory","Out of memory.");
+}
@@ -1,204 +1,271 @@
-/* [sh, cw_valid, iter] = ldpc_decode_spa_mex(H, LLRin, sumX1, sumX2, i_idx-1, j_idx-1, max_iter)
+/* h = ldpc_decode_spa_mex('create', H, sumX1, sumX2, i_idx-1, j_idx-1)
+ * [sh, cw_valid, iter, stop, weight] = ldpc_decode_spa_mex('decode', h, H, LLRin, max_iter, num_threads, crc_poly, crc_bits, patience)
+ * ldpc_decode_spa_mex('destroy', h)
  *
  * Matlab MEX acceleration for ldpc_decode_spa function.
  *
+ * 'create' returns a handle of a decoder of parity check matrix H, which
+ * keeps a copy of the graph tables and a pool of decoder contexts with
+ * message memory allocated once (see ldpc_spa.h). 'decode' decodes each
+ * row of LLRin as a separate codeword of H, rows are distributed over a
+ * pool of num_threads workers (0 selects the number of online CPUs) kept
+ * between calls, each worker using its own context. The optional crc_poly
+ * (generator polynomial as in nr_38_212_crc_calc, empty to disable),
+ * crc_bits and patience configure early termination (see ldpc_term.h),
+ * stop returns the LDPC_TERM_* reason and weight the final syndrome weight
+ * of every row.
+ *
+ * Handles are valid until 'destroy' or until the MEX file is cleared. They
+ * carry an id drawn from a session value of the loaded MEX file, so that a
+ * handle kept by the caller across clearing of the MEX file is rejected
+ * rather than resolved to another decoder, and 'decode' checks the size
+ * and number of nonzeros of H against the graph of the handle.
+ *
+ * The computational core is in ldpc_spa.h.
+ *
  * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
  */
 
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
 #include "mex.h"
 #include "matrix.h"
-#include <math.h>
-
-#define VMAX_MAX 200
-
-#define MAX(x,y) ((x < y) ? ( y) : (  x))
-#define MIN(x,y) ((x > y) ? ( y) : (  x))
-#define ABS(x)   ((x > 0) ? ( x) : (-(x)))
-#define SGN(x)   ((x < 0) ? (-1) : (  1))
-
-double ml[VMAX_MAX];
-double mr[VMAX_MAX];
-
-int check_syndrome(size_t ncheck, size_t nvar, size_t* H_ir, size_t* H_jc, double* LLR, int* syndrome) {
-  size_t v;
-  size_t c_idx;
-  size_t c;
-  int res;
-
-  for (v = 0; v < nvar; v++) {
-    for (c_idx = H_jc[v]; c_idx < H_jc[v+1]; c_idx++) {
-      c = H_ir[c_idx];
-      if (LLR[v] < 0.0) {
-        syndrome[c]++; 
-      }
-    }
-  }
+#include "ldpc_spa.h"
+#include "ldpc_term.h"
+#include "thread_pool.h"
+
+#define SPA_HANDLES_MAX 256
+/* handle ids stay below 2^44, so that id * SPA_HANDLES_MAX + slot is an
+ * exact double */
+#define SPA_ID_BITS 44
+
+static ldpc_spa_pool_t* spa_handles[SPA_HANDLES_MAX];
+static double spa_ids[SPA_HANDLES_MAX];
+static double spa_next_id = 0.0;
+static thread_pool_persistent_t* spa_workers = NULL;
+
+typedef struct {
+  ldpc_spa_pool_t* pool;
+  const double* LLRin;
+  size_t C;
+  int max_iters;
+  const ldpc_term_t* term;
+  double* sh;
+  double* cw_valid;
+  double* iter;
+  double* stop;
+  double* weight;
+  /* set by the worker that has no context */
+  int failed[THREAD_POOL_MAX];
+} spa_batch_t;
 
-  res = 1;
-  for (c = 0; c < ncheck; c++) {
-    if (syndrome[c] & 1) {
-      res = 0;
-    }
+static void spa_release(void) {
+  int n;
 
-    syndrome[c] = 0;
+  for (n = 0; n < SPA_HANDLES_MAX; n++) {
+    ldpc_spa_pool_destroy(spa_handles[n]);
+    spa_handles[n] = NULL;
   }
-
-  return res;
+  thread_pool_destroy(spa_workers);
+  spa_workers = NULL;
 }
 
-void llr2hardbit(size_t nvar, double* src, double* dest) {
-  int n;
-  for (n = 0; n < nvar; n++) {
-    dest[n] = (src[n] < 0.0) ? 1.0 : 0.0;
-  }
-}
+static void spa_decode_task(void* ctx, int r, int worker) {
+  spa_batch_t* b = (spa_batch_t*) ctx;
+  ldpc_spa_ctx_t* spa = ldpc_spa_pool_ctx(b->pool, worker);
+  ldpc_term_stats_t stats;
 
-void fill_mvc(size_t nvar, size_t cmax, double* LLRin, double* mvc) {
-  int n;
-  int c;  
-  for (n = 0; n < nvar; n++) {
-    for (c = 0; c < cmax; c++) {
-      mvc[n + c*nvar] = LLRin[n];
-    }
+  if (spa == NULL) {
+    b->failed[worker] = 1;
+    return;
   }
-}
-
-double boxplus(double a, double b) {
-  double x1, x2, x3;
 
-  x1 = SGN(a) * SGN(b) * MIN(ABS(a), ABS(b));
-  x2 = log(1.0 + exp(-ABS(a+b)));
-  x3 = log(1.0 + exp(-ABS(a-b)));
-  return x1 + x2 - x3;
+  ldpc_spa_decode(spa, b->LLRin + r, b->C, b->max_iters, b->term, b->sh + r, b->C, b->cw_valid + r, b->iter + r, &stats);
+  if (b->stop != NULL)
+    b->stop[r] = (double) stats.reason;
+  if (b->weight != NULL)
+    b->weight[r] = (double) stats.weight;
 }
 
-double boxplus_approx(double a, double b) {
-  double x1, x2, x3, r;
+/* graph of H and its tables in prhs[0..4] */
+static ldpc_spa_graph_t* spa_graph(const mxArray* prhs[]) {
+  if (!mxIsSparse(prhs[0]) || mxGetN(prhs[1]) * mxGetM(prhs[1]) != mxGetN(prhs[0]) ||
+      mxGetN(prhs[2]) * mxGetM(prhs[2]) != mxGetM(prhs[0]) ||
+      mxGetM(prhs[3]) != mxGetN(prhs[0]) || mxGetM(prhs[4]) != mxGetM(prhs[0]))
+    mexErrMsgIdAndTxt("ldpc_decode_spa:H","H must be sparse and the degree and index tables must match its size.");
 
-  x1 = SGN(a) * SGN(b) * MIN(ABS(a), ABS(b));
-
-  r = ABS(a+b);
-  x2 = (r < 2.5) ? (0.6 - 0.24 * r) : 0.0;
-
-  r = ABS(a-b);
-  x3 = (r < 2.5) ? (0.6 - 0.24 * r) : 0.0;
-
-  return x1 + x2 - x3;
+  return ldpc_spa_graph_create(mxGetM(prhs[0]), mxGetN(prhs[0]), mxGetN(prhs[3]), mxGetN(prhs[4]),
+    (const size_t*) mxGetIr(prhs[0]), (const size_t*) mxGetJc(prhs[0]),
+    mxGetPr(prhs[1]), mxGetPr(prhs[2]), mxGetPr(prhs[3]), mxGetPr(prhs[4]));
 }
 
-void ldpc_decode_spa(size_t ncheck, size_t nvar, size_t cmax, size_t vmax, size_t* H_ir, size_t* H_jc, double* LLRin, double* sumX1, double* sumX2, double* i_idx, double* j_idx, int max_iters, double* out, double* cw_valid, double* iter) {
-  int i, j, n;
-  int* syndrome;
-  double* mcv;
-  double* mvc;
+/* returns the id of the next handle, the first id of a loaded MEX file is
+ * drawn from the time and the load address, so that handles of a previous
+ * load are unlikely to be valid again */
+static double spa_new_id(void) {
+  uint64_t seed;
 
-  syndrome = mxMalloc(sizeof(int) * ncheck);
-  mcv = mxMalloc(sizeof(double) * ncheck * vmax);
-  mvc = mxMalloc(sizeof(double) * nvar * cmax);
-
-  for (i = 0; i < ncheck; i++) syndrome[i] = 0;
-  for (i = 0; i < ncheck * vmax; i++) mcv[i] = 0.0;
-  fill_mvc(nvar, cmax, LLRin, mvc);
-
-  if (check_syndrome(ncheck, nvar, H_ir, H_jc, LLRin, syndrome)) {
-    llr2hardbit(nvar, LLRin, out);
-    *cw_valid = 1;
-    *iter = 0;
-    return;
+  if (spa_next_id == 0.0) {
+    seed = (uint64_t) time(NULL) * 0x9E3779B97F4A7C15ULL ^ (uint64_t) clock() ^ ((uint64_t) (uintptr_t) &spa_next_id >> 4);
+    seed ^= seed >> 29;
+    spa_next_id = (double) ((seed & ((1ULL << (SPA_ID_BITS - 8)) - 1)) << 8) + 1.0;
   }
+  spa_next_id += 1.0;
+  if (spa_next_id >= (double) (1ULL << SPA_ID_BITS))
+    spa_next_id = 1.0;
 
-  *cw_valid = 0;
+  return spa_next_id;
+}
 
-  for ((*iter) = 0; (*iter) < max_iters; (*iter)++) {
-    for (j = 0; j < ncheck; j++) {
-      n = sumX2[j] - 1;
+/* slot of handle h, error if it is not a live handle */
+static int spa_slot(const mxArray* h) {
+  double v = mxGetScalar(h) - 1.0, id;
+  int n;
 
-      ml[0] = mvc[(int)j_idx[j]];
-      mr[0] =  mvc[(int)j_idx[j+n*ncheck]];
-      for(i = 1; i < n; i++ ) {
-        ml[i] = boxplus_approx( ml[i-1], mvc[(int)j_idx[j+i*ncheck]] );
-        mr[i] = boxplus_approx( mr[i-1], mvc[(int)j_idx[j+(n-i)*ncheck]] );
-      }
+  if (mxGetNumberOfElements(h) != 1 || v < 0.0)
+    mexErrMsgIdAndTxt("ldpc_decode_spa:handle","Invalid decoder handle.");
 
-      mcv[j] = mr[n-1];
-      mcv[j+n*ncheck] = ml[n-1];
-      for(i = 1; i < n; i++ )
-        mcv[j+i*ncheck] = boxplus_approx( ml[i-1], mr[n-1-i] );
-    }
+  id = floor(v / SPA_HANDLES_MAX);
+  n = (int) (v - id * SPA_HANDLES_MAX);
+  if (spa_handles[n] == NULL || spa_ids[n] != id)
+    mexErrMsgIdAndTxt("ldpc_decode_spa:handle","Invalid decoder handle.");
 
-    for (i = 0; i < nvar; i++) {
-      out[i] = LLRin[i];
-      for (j = 0; j < (int)sumX1[i]; j++) {
-        out[i] += mcv[(int)i_idx[i + j*nvar]];
-      }
-      for (j = 0; j < (int)sumX1[i]; j++) {
-        mvc[i + j*nvar] = out[i] - mcv[(int)i_idx[i + j*nvar]];
-      }
-    }
+  return n;
+}
 
-    if (check_syndrome(ncheck, nvar, H_ir, H_jc, out, syndrome)) {
-      *cw_valid = 1;
-      break;
-    }
-  }
+/* pool of handle h, whose graph must be that of parity check matrix H if
+ * H is given */
+static ldpc_spa_pool_t* spa_handle(const mxArray* h, const mxArray* H) {
+  ldpc_spa_pool_t* pool = spa_handles[spa_slot(h)];
 
-  llr2hardbit(nvar, out, out);
+  if (H != NULL && (!mxIsSparse(H) || mxGetM(H) != pool->g->ncheck || mxGetN(H) != pool->g->nvar ||
+      mxGetJc(H)[mxGetN(H)] != pool->g->H_jc[pool->g->nvar]))
+    mexErrMsgIdAndTxt("ldpc_decode_spa:handle","Decoder handle does not belong to H.");
 
-  mxFree(syndrome);
-  mxFree(mcv);
-  mxFree(mvc);
+  return pool;
 }
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
-  size_t ncheck, nvar, cmax, vmax;
-  size_t* H_ir;
-  size_t* H_jc;
-  double* LLRin;
-  double* sumX1;
-  double* sumX2;
-  double* i_idx;
-  double* j_idx;
-
-  double* sh;
-  double* cw_valid;
-  double* iter;
-
-  int max_iters;
+  ldpc_spa_graph_t* g;
+  ldpc_spa_pool_t* pool;
+  spa_batch_t batch;
+  ldpc_term_t term;
+  nr_crc_t crc;
+  size_t N;
+  char* cmd;
+  int n, num_threads, is_vec, failed;
+
+  mexAtExit(spa_release);
+
+  if (nrhs < 1 || !mxIsChar(prhs[0]))
+    mexErrMsgIdAndTxt("ldpc_decode_spa:cmd","Command must be create, decode or destroy.");
+
+  if(nlhs > 5)
+    mexErrMsgIdAndTxt("ldpc_decode_spa:nlhs","At most five outputs required.");
+
+  cmd = mxArrayToString(prhs[0]);
+
+  if (strcmp(cmd, "create") == 0) {
+    mxFree(cmd);
+    if (nrhs != 6)
+      mexErrMsgIdAndTxt("ldpc_decode_spa:nrhs","Six inputs required by create.");
+
+    for (n = 0; n < SPA_HANDLES_MAX && spa_handles[n] != NULL; n++)
+      ;
+    if (n == SPA_HANDLES_MAX)
+      mexErrMsgIdAndTxt("ldpc_decode_spa:handle","Too many decoder handles.");
+
+    g = spa_graph(prhs + 1);
+    spa_handles[n] = (g != NULL) ? ldpc_spa_pool_create(g, THREAD_POOL_MAX) : NULL;
+    if (spa_handles[n] == NULL) {
+      ldpc_spa_graph_destroy(g);
+      mexErrMsgIdAndTxt("ldpc_decode_spa:memory","Out of memory.");
+    }
+    spa_ids[n] = spa_new_id();
 
-  /* check for proper number and format of arguments */
-  if(nrhs != 7)
-    mexErrMsgIdAndTxt("ldpc_decode_spa:nrhs","Seven inputs required.");
+    plhs[0] = mxCreateDoubleScalar(spa_ids[n] * SPA_HANDLES_MAX + (double) (n + 1));
+    return;
+  } else if (strcmp(cmd, "destroy") == 0) {
+    mxFree(cmd);
+    if (nrhs != 2)
+      mexErrMsgIdAndTxt("ldpc_decode_spa:nrhs","Two inputs required by destroy.");
+
+    n = spa_slot(prhs[1]);
+    ldpc_spa_pool_destroy(spa_handles[n]);
+    spa_handles[n] = NULL;
+    return;
+  } else if (strcmp(cmd, "decode") != 0) {
+    mxFree(cmd);
+    mexErrMsgIdAndTxt("ldpc_decode_spa:cmd","Command must be create, decode or destroy.");
+  }
+  mxFree(cmd);
+
+  if (nrhs < 5 || nrhs > 9)
+    mexErrMsgIdAndTxt("ldpc_decode_spa:nrhs","Five to nine inputs required by decode.");
+
+  pool = spa_handle(prhs[1], prhs[2]);
+  is_vec = (mxGetM(prhs[3]) == 1 || mxGetN(prhs[3]) == 1) && mxGetM(prhs[3]) * mxGetN(prhs[3]) == pool->g->nvar;
+  batch.C = is_vec ? 1 : mxGetM(prhs[3]);
+  batch.LLRin = mxGetPr(prhs[3]);
+  batch.max_iters = (int) mxGetScalar(prhs[4]);
+  num_threads = (nrhs > 5) ? (int) mxGetScalar(prhs[5]) : 1;
+
+  if (!mxIsDouble(prhs[3]) || mxIsComplex(prhs[3]) || (!is_vec && mxGetN(prhs[3]) != pool->g->nvar))
+    mexErrMsgIdAndTxt("ldpc_decode_spa:LLRin","LLRin must be a real double matrix with a codeword in every row.");
+
+  term.crc = NULL;
+  term.crc_bits = (nrhs > 7) ? (size_t) mxGetScalar(prhs[7]) : 0;
+  term.patience = (nrhs > 8) ? (int) mxGetScalar(prhs[8]) : 0;
+  if (nrhs > 6 && !mxIsEmpty(prhs[6])) {
+    if (!nr_crc_init(&crc, mxGetPr(prhs[6]), mxGetN(prhs[6]) * mxGetM(prhs[6])) || term.crc_bits > pool->g->nvar)
+      mexErrMsgIdAndTxt("ldpc_decode_spa:crc","Invalid CRC polynomial or number of CRC bits.");
+    term.crc = &crc;
+  }
 
-  if(nlhs > 3)
-    mexErrMsgIdAndTxt("ldpc_decode_spa:nlhs","At most three outputs required.");
+  N = pool->g->nvar;
 
-  /* get the input arguments */
-  ncheck = mxGetM(prhs[0]);
-  nvar   = mxGetN(prhs[0]);
-  cmax   = mxGetN(prhs[4]);
-  vmax   = mxGetN(prhs[5]);
+  /* create the output matrix */
+  if (is_vec)
+    plhs[0] = mxCreateDoubleMatrix((mwSize)N, 1, mxREAL);
+  else
+    plhs[0] = mxCreateDoubleMatrix((mwSize)batch.C, (mwSize)N, mxREAL);
+  batch.sh = mxGetPr(plhs[0]);
+
+  plhs[1] = mxCreateDoubleMatrix((mwSize)batch.C, 1, mxREAL);
+  batch.cw_valid = mxGetPr(plhs[1]);
+
+  plhs[2] = mxCreateDoubleMatrix((mwSize)batch.C, 1, mxREAL);
+  batch.iter = mxGetPr(plhs[2]);
+
+  batch.stop = NULL;
+  if (nlhs > 3) {
+    plhs[3] = mxCreateDoubleMatrix((mwSize)batch.C, 1, mxREAL);
+    batch.stop = mxGetPr(plhs[3]);
+  }
 
-  H_ir = mxGetIr(prhs[0]);
-  H_jc = mxGetJc(prhs[0]);
+  batch.weight = NULL;
+  if (nlhs > 4) {
+    plhs[4] = mxCreateDoubleMatrix((mwSize)batch.C, 1, mxREAL);
+    batch.weight = mxGetPr(plhs[4]);
+  }
 
-  LLRin = mxGetPr(prhs[1]);
-  sumX1 = mxGetPr(prhs[2]);
-  sumX2 = mxGetPr(prhs[3]);
-  i_idx = mxGetPr(prhs[4]);
-  j_idx = mxGetPr(prhs[5]);
-  
-  max_iters = (int)mxGetScalar(prhs[6]);
+  batch.pool = pool;
+  batch.term = &term;
+  for (n = 0; n < THREAD_POOL_MAX; n++)
+    batch.failed[n] = 0;
 
-  /* create the output matrix */
-  plhs[0] = mxCreateDoubleMatrix((mwSize)nvar, 1, mxREAL);
-  sh = mxGetPr(plhs[0]);
+  spa_workers = thread_pool_reserve(spa_workers, ((size_t) num_threads > batch.C) ? (int) batch.C : num_threads);
+  if (spa_workers == NULL)
+    mexErrMsgIdAndTxt("ldpc_decode_spa:memory","Out of memory.");
 
-  plhs[1] = mxCreateDoubleMatrix(1, 1, mxREAL);
-  cw_valid = mxGetPr(plhs[1]);
+  /* call the computational routine */
+  thread_pool_exec(spa_workers, num_threads, (int) batch.C, spa_decode_task, &batch);
 
-  plhs[2] = mxCreateDoubleMatrix(1, 1, mxREAL);
-  iter = mxGetPr(plhs[2]);
+  failed = 0;
+  for (n = 0; n < THREAD_POOL_MAX; n++)
+    failed |= batch.failed[n];
 
-  /* call the computational routine */
-  ldpc_decode_spa(ncheck, nvar, cmax, vmax, H_ir, H_jc, LLRin, sumX1, sumX2, i_idx, j_idx, max_iters, sh, cw_valid, iter);
-}
\ No newline at end of file
+  if (failed)
+    mexErrMsgIdAndTxt("ldpc_decode_spa:memory","Out of memory.");
+}
@@ -0,0 +1,96 @@
+/* [d, ok] = ldpc_encode_nr_mex(c, base_graph, check)
+ *
+ * Matlab MEX acceleration for nr_38_212_channel_coding_ldpc function.
+ *
+ * All C codeblocks (rows of c, filler bits set to -1) are encoded in a
+ * single call by the quasi-cyclic encoder of ldpc_encoder.h, on the graph of
+ * the process-wide store of ldpc_graph_store.h. Rows of d hold
+ * the codeblocks without the 2*Z_c punctured systematic bits, followed by
+ * the parity bits. If check is non-zero, parity checks of every codeword
+ * are verified and ok is 0 if any of them fails.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#include "mex.h"
+#include "ldpc_layered.h"
+#include "ldpc_graph_store.h"
+#include "mex_file_path.h"
+#include "ldpc_encoder.h"
+
+#define N_PUNCT_COLS 2
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+  const base_graph_t* bg;
+  ldpc_enc_t enc;
+  size_t C, K, N, r, k;
+  int base_graph, Z, kb, cols, check, ok;
+  const double* c;
+  double* d;
+  char gs_path[LDPC_GS_PATH_MAX];
+
+  /* check for proper number and format of arguments */
+  if(nrhs < 2 || nrhs > 3)
+    mexErrMsgIdAndTxt("ldpc_encode_nr:nrhs","Two or three inputs required.");
+
+  if(nlhs > 2)
+    mexErrMsgIdAndTxt("ldpc_encode_nr:nlhs","At most two outputs required.");
+
+  if (!mxIsDouble(prhs[0]) || mxIsComplex(prhs[0]))
+    mexErrMsgIdAndTxt("ldpc_encode_nr:c","c must be a real double matrix.");
+
+  /* get the input arguments */
+  c = mxGetPr(prhs[0]);
+  C = mxGetM(prhs[0]);
+  K = mxGetN(prhs[0]);
+  base_graph = (int) mxGetScalar(prhs[1]);
+  check = (nrhs > 2) ? (mxGetScalar(prhs[2]) != 0) : 0;
+
+  if (base_graph == 1) {
+    kb = 22;
+    cols = 68;
+  } else if (base_graph == 2) {
+    kb = 10;
+    cols = 52;
+  } else {
+    mexErrMsgIdAndTxt("ldpc_encode_nr:base_graph","base_graph permitted values are 1 or 2.");
+    return;
+  }
+
+  mexAtExit(ldpc_graph_release);
+  if (!ldpc_gs_opened && mex_file_path(LDPC_GS_FILE, gs_path, sizeof(gs_path)))
+    ldpc_graph_store_default(gs_path);
+
+  Z = (int) (K / kb);
+  if (K % kb != 0 || ldpc_lifting_set(Z) < 0)
+    mexErrMsgIdAndTxt("ldpc_encode_nr:c","Row length of c is not a valid codeblock size of the base graph.");
+
+  bg = ldpc_graph_lookup(base_graph, Z);
+  if (bg == NULL)
+    mexErrMsgIdAndTxt("ldpc_encode_nr:memory","Out of memory.");
+
+  if (!ldpc_enc_init(&enc, bg, Z)) {
+    ldpc_enc_free(&enc);
+    mexErrMsgIdAndTxt("ldpc_encode_nr:memory","Out of memory.");
+  }
+
+  /* create the output matrix */
+  N = (size_t) (cols - N_PUNCT_COLS) * Z;
+  plhs[0] = mxCreateDoubleMatrix((mwSize)C, (mwSize)N, mxREAL);
+  d = mxGetPr(plhs[0]);
+
+  /* systematic bits, fillers are kept */
+  for (k = 0; k < K - N_PUNCT_COLS * Z; k++)
+    for (r = 0; r < C; r++)
+      d[k * C + r] = c[(k + N_PUNCT_COLS * Z) * C + r];
+
+  /* call the computational routine */
+  ok = 1;
+  for (r = 0; r < C; r++)
+    ok &= ldpc_encode_qc(&enc, c + r, C, d + (K - N_PUNCT_COLS * Z) * C + r, C, check);
+
+  ldpc_enc_free(&enc);
+
+  if (nlhs > 1)
+    plhs[1] = mxCreateDoubleScalar((double) ok);
+}
@@ -0,0 +1,251 @@
+/* Quasi-cyclic LDPC encoder core of 5G NR (3GPP 38.212 sec. 5.3.2) shared
+ * by ldpc_encode_nr_mex.c and native code.
+ *
+ * Parity is computed directly from the row-compressed base graph (see
+ * base_graph_init() of ldpc_layered.h) on Z_c-bit circulant columns packed
+ * into 64-bit words, so a circulant times vector product is a rotation and
+ * XOR of a few words. The first kb = cols - rows columns of the base graph
+ * carry information bits. The 4 core rows have a double-diagonal structure
+ * in columns kb..kb+3: their sum depends on the first core parity column
+ * only (P^x p_0), after which the core rows are solved one parity column at
+ * a time. Every extension row adds a single parity column on the diagonal.
+ * The core structure is verified by ldpc_enc_init() rather than assumed, so
+ * any lifting set of both base graphs is handled by the same code.
+ *
+ * Columns are stored doubled (bits [0,Z) repeated at [Z,2Z)), so that the
+ * rotation by V is a 64-bit window read at bit offset V.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef LDPC_ENCODER_H
+#define LDPC_ENCODER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ldpc_layered.h"
+
+#define LDPC_ENC_CORE_ROWS 4
+
+typedef struct {
+  const base_graph_t* bg;
+  int Z;
+  int kb;
+  /* words of a packed column and of its doubled copy */
+  int W;
+  int DW;
+  uint64_t mask;
+  /* sum of the core rows is P^p0_shift times the first core parity column */
+  int p0_shift;
+  uint64_t* x;
+  uint64_t* acc;
+} ldpc_enc_t;
+
+/* acc ^= P^V x, i.e. acc[k] ^= x[(k + V) % Z] for x stored doubled */
+static void qc_rot_xor(uint64_t* acc, const uint64_t* x, int W, uint64_t mask, int V) {
+  int w, q = V >> 6, b = V & 63;
+
+  if (b == 0) {
+    for (w = 0; w < W; w++)
+      acc[w] ^= x[q + w];
+  } else {
+    for (w = 0; w < W; w++)
+      acc[w] ^= (x[q + w] >> b) | (x[q + w + 1] << (64 - b));
+  }
+  acc[W-1] &= mask;
+}
+
+/* writes packed column src (W words) to x as its doubled copy */
+static void qc_store(uint64_t* x, const uint64_t* src, int Z, int W, int DW) {
+  int w, q = Z >> 6, s = Z & 63;
+
+  memcpy(x, src, sizeof(uint64_t) * W);
+  memset(x + W, 0, sizeof(uint64_t) * (DW - W));
+  for (w = 0; w < W; w++) {
+    x[q + w] |= src[w] << s;
+    if (s != 0)
+      x[q + w + 1] |= src[w] >> (64 - s);
+  }
+}
+
+static void ldpc_enc_free(ldpc_enc_t* enc) {
+  free(enc->x);
+  free(enc->acc);
+  enc->x = NULL;
+  enc->acc = NULL;
+}
+
+/* column of the edge, -1 for edges not in core parity columns */
+static int core_col(const ldpc_enc_t* enc, int e) {
+  int c = enc->bg->col[e] - enc->kb;
+  return (c >= 0 && c < LDPC_ENC_CORE_ROWS) ? c : -1;
+}
+
+/* prepares the encoder of base graph bg lifted by Z, returns 0 if out of
+ * memory or if the graph has no double-diagonal core structure */
+static int ldpc_enc_init(ldpc_enc_t* enc, const base_graph_t* bg, int Z) {
+  int r, e, e2, c, n_odd, odd_shift = 0, sh;
+
+  memset(enc, 0, sizeof(ldpc_enc_t));
+  enc->bg = bg;
+  enc->Z = Z;
+  enc->kb = bg->cols - bg->rows;
+  enc->W = (Z + 63) / 64;
+  enc->DW = (2 * Z + 63) / 64 + 1;
+  enc->mask = (Z & 63) ? (((uint64_t) 1 << (Z & 63)) - 1) : ~(uint64_t) 0;
+
+  if (bg->rows <= LDPC_ENC_CORE_ROWS || enc->kb <= 0)
+    return 0;
+
+  /* in the sum of core rows, circulants of a column cancel in pairs of
+   * equal shifts: exactly one must survive in column kb, none elsewhere */
+  for (c = 0; c < LDPC_ENC_CORE_ROWS; c++) {
+    n_odd = 0;
+    for (e = bg->row_ptr[0]; e < bg->row_ptr[LDPC_ENC_CORE_ROWS]; e++) {
+      if (core_col(enc, e) != c)
+        continue;
+      sh = bg->shift[e];
+      for (r = 0, e2 = bg->row_ptr[0]; e2 < bg->row_ptr[LDPC_ENC_CORE_ROWS]; e2++)
+        if (core_col(enc, e2) == c && bg->shift[e2] == sh)
+          r++;
+      if (r & 1) {
+        n_odd++;
+        odd_shift = sh;
+      }
+    }
+    if ((c == 0 && n_odd != 1) || (c > 0 && n_odd != 0))
+      return 0;
+  }
+  enc->p0_shift = odd_shift;
+
+  /* core rows other than kb must reference no parity columns beyond the
+   * core, extension rows only the diagonal one */
+  for (r = 0; r < bg->rows; r++)
+    for (e = bg->row_ptr[r]; e < bg->row_ptr[r+1]; e++)
+      if (bg->col[e] >= enc->kb + LDPC_ENC_CORE_ROWS && (r < LDPC_ENC_CORE_ROWS || bg->col[e] > enc->kb + r))
+        return 0;
+
+  enc->x = calloc((size_t) bg->cols * enc->DW, sizeof(uint64_t));
+  enc->acc = calloc((size_t) (LDPC_ENC_CORE_ROWS + 1) * enc->W, sizeof(uint64_t));
+  if (enc->x == NULL || enc->acc == NULL) {
+    ldpc_enc_free(enc);
+    return 0;
+  }
+
+  return 1;
+}
+
+/* Encodes a single code block. s holds kb * Z information bits read with
+ * stride s_stride (bits equal to 1.0 are ones, filler bits -1 are zeros),
+ * rows * Z parity bits are written to p with stride p_stride. If check is
+ * set, all parity checks of the codeword are verified. Returns 0 if the
+ * check fails, or if the core equations are not solvable. */
+static int ldpc_encode_qc(ldpc_enc_t* enc, const double* s, size_t s_stride, double* p, size_t p_stride, int check) {
+  const base_graph_t* bg = enc->bg;
+  int Z = enc->Z, W = enc->W, DW = enc->DW, kb = enc->kb;
+  int r, e, c, k, u, n_unknown, known = 1, pass;
+  uint64_t* lambda = enc->acc;
+  uint64_t* tmp = enc->acc + LDPC_ENC_CORE_ROWS * W;
+  uint64_t* x;
+  uint64_t v;
+
+  /* pack information columns */
+  for (c = 0; c < kb; c++) {
+    memset(tmp, 0, sizeof(uint64_t) * W);
+    for (k = 0; k < Z; k++)
+      if (s[((size_t) c * Z + k) * s_stride] == 1.0)
+        tmp[k >> 6] |= (uint64_t) 1 << (k & 63);
+    qc_store(enc->x + (size_t) c * DW, tmp, Z, W, DW);
+  }
+
+  /* syndromes of information bits in the core rows */
+  memset(lambda, 0, sizeof(uint64_t) * LDPC_ENC_CORE_ROWS * W);
+  for (r = 0; r < LDPC_ENC_CORE_ROWS; r++)
+    for (e = bg->row_ptr[r]; e < bg->row_ptr[r+1]; e++)
+      if (bg->col[e] < kb)
+        qc_rot_xor(lambda + r * W, enc->x + (size_t) bg->col[e] * DW, W, enc->mask, bg->shift[e]);
+
+  /* p_0 = P^-x (lambda_0 + ... + lambda_3) */
+  memset(tmp, 0, sizeof(uint64_t) * W);
+  for (r = 0; r < LDPC_ENC_CORE_ROWS; r++)
+    for (k = 0; k < W; k++)
+      tmp[k] ^= lambda[r * W + k];
+  qc_store(enc->x + (size_t) kb * DW, tmp, Z, W, DW);
+  memset(tmp, 0, sizeof(uint64_t) * W);
+  qc_rot_xor(tmp, enc->x + (size_t) kb * DW, W, enc->mask, (Z - enc->p0_shift) % Z);
+  qc_store(enc->x + (size_t) kb * DW, tmp, Z, W, DW);
+
+  /* remaining core columns, each from a row with a single unknown one */
+  for (pass = 0; pass < LDPC_ENC_CORE_ROWS && known != (1 << LDPC_ENC_CORE_ROWS) - 1; pass++) {
+    for (r = 0; r < LDPC_ENC_CORE_ROWS; r++) {
+      n_unknown = 0;
+      u = -1;
+      for (e = bg->row_ptr[r]; e < bg->row_ptr[r+1]; e++) {
+        c = core_col(enc, e);
+        if (c >= 0 && !(known & (1 << c))) {
+          n_unknown++;
+          u = e;
+        }
+      }
+      if (n_unknown != 1)
+        continue;
+
+      memcpy(tmp, lambda + r * W, sizeof(uint64_t) * W);
+      for (e = bg->row_ptr[r]; e < bg->row_ptr[r+1]; e++)
+        if (e != u && core_col(enc, e) >= 0)
+          qc_rot_xor(tmp, enc->x + (size_t) bg->col[e] * DW, W, enc->mask, bg->shift[e]);
+      x = enc->x + (size_t) bg->col[u] * DW;
+      qc_store(x, tmp, Z, W, DW);
+      memset(tmp, 0, sizeof(uint64_t) * W);
+      qc_rot_xor(tmp, x, W, enc->mask, (Z - bg->shift[u]) % Z);
+      qc_store(x, tmp, Z, W, DW);
+      known |= 1 << core_col(enc, u);
+    }
+  }
+  if (known != (1 << LDPC_ENC_CORE_ROWS) - 1)
+    return 0;
+
+  /* extension rows, parity column kb + r on the diagonal */
+  for (r = LDPC_ENC_CORE_ROWS; r < bg->rows; r++) {
+    memset(tmp, 0, sizeof(uint64_t) * W);
+    u = -1;
+    for (e = bg->row_ptr[r]; e < bg->row_ptr[r+1]; e++) {
+      if (bg->col[e] == kb + r)
+        u = e;
+      else
+        qc_rot_xor(tmp, enc->x + (size_t) bg->col[e] * DW, W, enc->mask, bg->shift[e]);
+    }
+    x = enc->x + (size_t) (kb + r) * DW;
+    qc_store(x, tmp, Z, W, DW);
+    if (u >= 0 && bg->shift[u] != 0) {
+      memset(tmp, 0, sizeof(uint64_t) * W);
+      qc_rot_xor(tmp, x, W, enc->mask, (Z - bg->shift[u]) % Z);
+      qc_store(x, tmp, Z, W, DW);
+    }
+  }
+
+  if (check) {
+    for (r = 0; r < bg->rows; r++) {
+      memset(tmp, 0, sizeof(uint64_t) * W);
+      for (e = bg->row_ptr[r]; e < bg->row_ptr[r+1]; e++)
+        qc_rot_xor(tmp, enc->x + (size_t) bg->col[e] * DW, W, enc->mask, bg->shift[e]);
+      for (k = 0; k < W; k++)
+        if (tmp[k] != 0)
+          return 0;
+    }
+  }
+
+  /* unpack parity columns */
+  for (c = 0; c < bg->rows; c++) {
+    x = enc->x + (size_t) (kb + c) * DW;
+    for (k = 0; k < Z; k++) {
+      v = x[k >> 6] >> (k & 63);
+      p[((size_t) c * Z + k) * p_stride] = (double) (v & 1);
+    }
+  }
+
+  return 1;
+}
+
+#endif
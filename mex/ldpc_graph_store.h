@@ -0,0 +1,357 @@
+/* Store of precomputed 5G NR LDPC graphs for all base graphs and lifting
+ * sizes of 3GPP 38.212 Table 5.3.2-1.
+ *
+ * The store file is written offline by native/ldpc_graph_store_gen.c and
+ * holds the row-compressed base graph (see base_graph_t of ldpc_layered.h)
+ * of every (BG, Z_c) pair, shifts already reduced modulo Z_c. All fields are
+ * native-endian int32, laid out as
+ *   header    - magic "NRLDPCGS", version, number of graphs, LDPC_GS_Z_MAX
+ *   directory - byte offsets of the graph records, indexed by
+ *               [bg-1][Z_c], 0 for lifting sizes not in the table
+ *   records   - bg, Z_c, i_LS, rows, cols, edges, deg_max, followed by
+ *               row_ptr[rows+1], col[edges] and shift[edges]
+ * nr_ldpc_graph_store.m reads the same format.
+ *
+ * ldpc_graph_store_open() maps the file into memory (read into a buffer on
+ * Windows) and ldpc_graph_store_get() returns base_graph_t views pointing
+ * into the mapping, so a lookup is an index into the directory.
+ *
+ * ldpc_graph_lookup() is the process-wide entry point of the decoders and
+ * the encoder: on the first call it opens the store named by environment
+ * variable NR_LDPC_GRAPH_STORE or, if the variable is not set, the default
+ * file of ldpc_graph_store_default() (the mex functions set ldpc_graphs.bin
+ * in their own directory, the lookup order of nr_ldpc_graph_store.m). Graphs
+ * are built from ldpc_base_graph_tbl.h on first use if there is no store or
+ * it fails ldpc_graph_store_valid(), which checks every record once. Graphs
+ * stay valid until ldpc_graph_release(). Lookup is not thread-safe, graphs
+ * are to be looked up before worker threads are started.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef LDPC_GRAPH_STORE_H
+#define LDPC_GRAPH_STORE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "ldpc_layered.h"
+#include "ldpc_base_graph_tbl.h"
+
+#define LDPC_GS_MAGIC "NRLDPCGS"
+#define LDPC_GS_VERSION 1
+#define LDPC_GS_Z_MAX 384
+#define LDPC_GS_HDR_WORDS 5
+#define LDPC_GS_DIR_WORDS (2 * (LDPC_GS_Z_MAX + 1))
+#define LDPC_GS_REC_WORDS 7
+#define LDPC_GS_ENV "NR_LDPC_GRAPH_STORE"
+#define LDPC_GS_FILE "ldpc_graphs.bin"
+#define LDPC_GS_PATH_MAX 4096
+
+typedef struct {
+  const int32_t* words;
+  size_t size;
+  int mapped;
+} ldpc_graph_store_t;
+
+static void ldpc_graph_store_close(ldpc_graph_store_t* gs) {
+  if (gs->words == NULL)
+    return;
+#ifndef _WIN32
+  if (gs->mapped)
+    munmap((void*) gs->words, gs->size);
+  else
+#endif
+    free((void*) gs->words);
+  gs->words = NULL;
+}
+
+/* checks record rec of the directory slot of (bg_num, Z) ending at word
+ * end of the store, returns non-zero if the decoders may use the graph as
+ * is: row_ptr rises from 0 to edges, columns and shifts are in range and
+ * deg_max is the largest row degree */
+static int ldpc_graph_record_valid(const int32_t* rec, size_t end, int bg_num, int Z) {
+  const int32_t *row_ptr, *col, *shift;
+  int32_t rows, cols, edges, deg, deg_max = 0, r, e;
+
+  if (LDPC_GS_REC_WORDS > end || Z < 1 || rec[0] != bg_num || rec[1] != Z || ldpc_lifting_set(Z) != rec[2])
+    return 0;
+  rows = rec[3];
+  cols = rec[4];
+  edges = rec[5];
+  if (cols != ((bg_num == 1) ? 68 : 52) || rows <= 0 || rows > cols || edges <= 0 || edges > rows * cols ||
+      (size_t) LDPC_GS_REC_WORDS + (size_t) rows + 1 + 2 * (size_t) edges > end)
+    return 0;
+
+  row_ptr = rec + LDPC_GS_REC_WORDS;
+  col = row_ptr + rows + 1;
+  shift = col + edges;
+
+  if (row_ptr[0] != 0 || row_ptr[rows] != edges)
+    return 0;
+  for (r = 0; r < rows; r++) {
+    deg = row_ptr[r+1] - row_ptr[r];
+    if (deg < 0)
+      return 0;
+    if (deg > deg_max)
+      deg_max = deg;
+  }
+  if (rec[6] != deg_max)
+    return 0;
+
+  for (e = 0; e < edges; e++)
+    if (col[e] < 0 || col[e] >= cols || shift[e] < 0 || shift[e] >= Z)
+      return 0;
+
+  return 1;
+}
+
+/* checks header, directory and every graph record of a store of size
+ * bytes, returns non-zero if the store is valid */
+static int ldpc_graph_store_valid(const int32_t* w, size_t size) {
+  size_t n, off;
+  int bg_num, Z;
+
+  if (size < sizeof(int32_t) * (LDPC_GS_HDR_WORDS + LDPC_GS_DIR_WORDS) || memcmp(w, LDPC_GS_MAGIC, 8) != 0 ||
+      w[2] != LDPC_GS_VERSION || w[4] != LDPC_GS_Z_MAX)
+    return 0;
+
+  for (n = 0; n < LDPC_GS_DIR_WORDS; n++) {
+    off = (size_t) (uint32_t) w[LDPC_GS_HDR_WORDS + n];
+    if (off == 0)
+      continue;
+    bg_num = (int) (n / (LDPC_GS_Z_MAX + 1)) + 1;
+    Z = (int) (n % (LDPC_GS_Z_MAX + 1));
+    if (off % sizeof(int32_t) != 0 || off >= size ||
+        !ldpc_graph_record_valid(w + off / sizeof(int32_t), (size - off) / sizeof(int32_t), bg_num, Z))
+      return 0;
+  }
+
+  return 1;
+}
+
+/* maps store file path, returns 0 if it cannot be read or is not valid */
+static int ldpc_graph_store_open(ldpc_graph_store_t* gs, const char* path) {
+#ifdef _WIN32
+  FILE* fp;
+  long len;
+  void* buf;
+
+  gs->words = NULL;
+  gs->mapped = 0;
+  fp = fopen(path, "rb");
+  if (fp == NULL)
+    return 0;
+  fseek(fp, 0, SEEK_END);
+  len = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  buf = (len > 0) ? malloc((size_t) len) : NULL;
+  if (buf == NULL || fread(buf, 1, (size_t) len, fp) != (size_t) len) {
+    free(buf);
+    fclose(fp);
+    return 0;
+  }
+  fclose(fp);
+  gs->words = (const int32_t*) buf;
+  gs->size = (size_t) len;
+#else
+  struct stat st;
+  void* p;
+  int fd;
+
+  gs->words = NULL;
+  gs->mapped = 1;
+  fd = open(path, O_RDONLY);
+  if (fd < 0)
+    return 0;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return 0;
+  }
+  p = mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (p == MAP_FAILED)
+    return 0;
+  gs->words = (const int32_t*) p;
+  gs->size = (size_t) st.st_size;
+#endif
+
+  if (!ldpc_graph_store_valid(gs->words, gs->size)) {
+    ldpc_graph_store_close(gs);
+    return 0;
+  }
+
+  return 1;
+}
+
+/* fills bg with a view of graph (bg_num, Z) in the store, returns 0 if the
+ * store does not hold it */
+static int ldpc_graph_store_get(const ldpc_graph_store_t* gs, int bg_num, int Z, base_graph_t* bg) {
+  const int32_t* rec;
+  size_t off;
+
+  if (gs->words == NULL || bg_num < 1 || bg_num > 2 || Z < 1 || Z > LDPC_GS_Z_MAX)
+    return 0;
+
+  off = (size_t) (uint32_t) gs->words[LDPC_GS_HDR_WORDS + (bg_num - 1) * (LDPC_GS_Z_MAX + 1) + Z];
+  if (off == 0)
+    return 0;
+
+  rec = gs->words + off / sizeof(int32_t);
+  bg->rows = rec[3];
+  bg->cols = rec[4];
+  bg->edges = rec[5];
+  bg->deg_max = rec[6];
+  bg->row_ptr = (int*) (rec + LDPC_GS_REC_WORDS);
+  bg->col = bg->row_ptr + bg->rows + 1;
+  bg->shift = bg->col + bg->edges;
+
+  return 1;
+}
+
+/* writes the store of all graphs to fp, returns the number of graphs or
+ * 0 on error */
+static int ldpc_graph_store_write(FILE* fp) {
+  double i_tbl[LDPC_BG1_EDGES], j_tbl[LDPC_BG1_EDGES], V_tbl[LDPC_BG1_EDGES];
+  int32_t hdr[LDPC_GS_HDR_WORDS], dir[LDPC_GS_DIR_WORDS], rec[LDPC_GS_REC_WORDS];
+  base_graph_t bg;
+  size_t edges, off;
+  int bg_num, Z, n_graphs = 0, pass, ok = 1;
+
+  /* the first pass sizes the directory, the second writes the records */
+  for (pass = 0; pass < 2 && ok; pass++) {
+    off = sizeof(int32_t) * (LDPC_GS_HDR_WORDS + LDPC_GS_DIR_WORDS);
+    if (pass == 1) {
+      memcpy(hdr, LDPC_GS_MAGIC, 8);
+      hdr[2] = LDPC_GS_VERSION;
+      hdr[3] = n_graphs;
+      hdr[4] = LDPC_GS_Z_MAX;
+      ok &= fwrite(hdr, sizeof(hdr), 1, fp) == 1;
+      ok &= fwrite(dir, sizeof(dir), 1, fp) == 1;
+    } else {
+      memset(dir, 0, sizeof(dir));
+    }
+
+    for (bg_num = 1; bg_num <= 2 && ok; bg_num++) {
+      for (Z = 1; Z <= LDPC_GS_Z_MAX && ok; Z++) {
+        edges = ldpc_base_graph_tbl(bg_num, Z, i_tbl, j_tbl, V_tbl);
+        if (edges == 0)
+          continue;
+
+        if (!base_graph_init(&bg, Z, (bg_num == 1) ? 68 : 52, i_tbl, j_tbl, V_tbl, edges)) {
+          base_graph_free(&bg);
+          return 0;
+        }
+
+        if (pass == 0) {
+          dir[(bg_num - 1) * (LDPC_GS_Z_MAX + 1) + Z] = (int32_t) off;
+          n_graphs++;
+        } else {
+          rec[0] = bg_num;
+          rec[1] = Z;
+          rec[2] = ldpc_lifting_set(Z);
+          rec[3] = bg.rows;
+          rec[4] = bg.cols;
+          rec[5] = bg.edges;
+          rec[6] = bg.deg_max;
+          ok &= fwrite(rec, sizeof(rec), 1, fp) == 1;
+          ok &= fwrite(bg.row_ptr, sizeof(int32_t), bg.rows + 1, fp) == (size_t) bg.rows + 1;
+          ok &= fwrite(bg.col, sizeof(int32_t), edges, fp) == edges;
+          ok &= fwrite(bg.shift, sizeof(int32_t), edges, fp) == edges;
+        }
+        off += sizeof(int32_t) * (LDPC_GS_REC_WORDS + (size_t) bg.rows + 1 + 2 * edges);
+        base_graph_free(&bg);
+      }
+    }
+  }
+
+  return ok ? n_graphs : 0;
+}
+
+/* process-wide graphs of ldpc_graph_lookup() */
+static ldpc_graph_store_t ldpc_gs_global;
+static int ldpc_gs_opened = 0;
+static base_graph_t* ldpc_gs_graph[2][LDPC_GS_Z_MAX + 1];
+static char ldpc_gs_default[LDPC_GS_PATH_MAX];
+
+/* sets the store file opened by ldpc_graph_lookup() if environment variable
+ * NR_LDPC_GRAPH_STORE is not set, takes effect before the first lookup */
+static void ldpc_graph_store_default(const char* path) {
+  if (strlen(path) < LDPC_GS_PATH_MAX)
+    strcpy(ldpc_gs_default, path);
+}
+
+/* releases all graphs returned by ldpc_graph_lookup() */
+static void ldpc_graph_release(void) {
+  int b, Z;
+
+  for (b = 0; b < 2; b++) {
+    for (Z = 0; Z <= LDPC_GS_Z_MAX; Z++) {
+      if (ldpc_gs_graph[b][Z] == NULL)
+        continue;
+      if (ldpc_gs_global.words == NULL)
+        base_graph_free(ldpc_gs_graph[b][Z]);
+      free(ldpc_gs_graph[b][Z]);
+      ldpc_gs_graph[b][Z] = NULL;
+    }
+  }
+  ldpc_graph_store_close(&ldpc_gs_global);
+  ldpc_gs_opened = 0;
+}
+
+/* returns graph of base graph bg_num lifted by Z, NULL if Z is not a valid
+ * lifting size or out of memory */
+static const base_graph_t* ldpc_graph_lookup(int bg_num, int Z) {
+  double i_tbl[LDPC_BG1_EDGES], j_tbl[LDPC_BG1_EDGES], V_tbl[LDPC_BG1_EDGES];
+  base_graph_t* bg;
+  const char* path;
+  size_t edges;
+  int ok;
+
+  if (bg_num < 1 || bg_num > 2 || Z < 1 || Z > LDPC_GS_Z_MAX)
+    return NULL;
+
+  if (!ldpc_gs_opened) {
+    ldpc_gs_opened = 1;
+    path = getenv(LDPC_GS_ENV);
+    if (path == NULL || path[0] == '\0')
+      path = ldpc_gs_default;
+    if (path[0] == '\0' || !ldpc_graph_store_open(&ldpc_gs_global, path))
+      ldpc_gs_global.words = NULL;
+  }
+
+  if (ldpc_gs_graph[bg_num-1][Z] != NULL)
+    return ldpc_gs_graph[bg_num-1][Z];
+
+  bg = calloc(1, sizeof(base_graph_t));
+  if (bg == NULL)
+    return NULL;
+
+  if (ldpc_gs_global.words != NULL) {
+    ok = ldpc_graph_store_get(&ldpc_gs_global, bg_num, Z, bg);
+  } else {
+    edges = ldpc_base_graph_tbl(bg_num, Z, i_tbl, j_tbl, V_tbl);
+    ok = (edges > 0) && base_graph_init(bg, Z, (bg_num == 1) ? 68 : 52, i_tbl, j_tbl, V_tbl, edges);
+    if (!ok)
+      base_graph_free(bg);
+  }
+
+  if (!ok) {
+    free(bg);
+    return NULL;
+  }
+
+  ldpc_gs_graph[bg_num-1][Z] = bg;
+  return bg;
+}
+
+#endif
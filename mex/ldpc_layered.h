@@ -0,0 +1,405 @@
+/* Layered min-sum LDPC decoder core operating on quasi-cyclic base graphs.
+ *
+ * Base graph rows are processed one at a time. All Z_c check nodes of a row
+ * are updated together - circulant columns are rotated into contiguous lane
+ * buffers, so that the check node update is a plain SIMD loop over Z_c lanes.
+ * The core does not use the mx* API and may be called from worker threads,
+ * provided that each thread owns its workspace. Besides the syndrome check,
+ * decoding may be terminated early by the policies of ldpc_term.h.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef LDPC_LAYERED_H
+#define LDPC_LAYERED_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ldpc_term.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define SIMD_W 8
+typedef __m256 vfloat;
+#define VLOAD(p)      _mm256_loadu_ps(p)
+#define VSTORE(p,x)   _mm256_storeu_ps(p,x)
+#define VSET1(x)      _mm256_set1_ps(x)
+#define VADD(a,b)     _mm256_add_ps(a,b)
+#define VSUB(a,b)     _mm256_sub_ps(a,b)
+#define VMUL(a,b)     _mm256_mul_ps(a,b)
+#define VMIN(a,b)     _mm256_min_ps(a,b)
+#define VMAX(a,b)     _mm256_max_ps(a,b)
+#define VAND(a,b)     _mm256_and_ps(a,b)
+#define VANDNOT(a,b)  _mm256_andnot_ps(a,b)
+#define VXOR(a,b)     _mm256_xor_ps(a,b)
+#define VCMPEQ(a,b)   _mm256_cmp_ps(a,b,_CMP_EQ_OQ)
+#define VBLEND(a,b,m) _mm256_blendv_ps(a,b,m)
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_W 4
+typedef __m128 vfloat;
+#define VLOAD(p)      _mm_loadu_ps(p)
+#define VSTORE(p,x)   _mm_storeu_ps(p,x)
+#define VSET1(x)      _mm_set1_ps(x)
+#define VADD(a,b)     _mm_add_ps(a,b)
+#define VSUB(a,b)     _mm_sub_ps(a,b)
+#define VMUL(a,b)     _mm_mul_ps(a,b)
+#define VMIN(a,b)     _mm_min_ps(a,b)
+#define VMAX(a,b)     _mm_max_ps(a,b)
+#define VAND(a,b)     _mm_and_ps(a,b)
+#define VANDNOT(a,b)  _mm_andnot_ps(a,b)
+#define VXOR(a,b)     _mm_xor_ps(a,b)
+#define VCMPEQ(a,b)   _mm_cmpeq_ps(a,b)
+#define VBLEND(a,b,m) _mm_or_ps(_mm_andnot_ps(m,a), _mm_and_ps(m,b))
+#else
+#define SIMD_W 1
+typedef float vfloat;
+#define VLOAD(p)      (*(p))
+#define VSTORE(p,x)   (*(p) = (x))
+#define VSET1(x)      (x)
+#define VADD(a,b)     ((a) + (b))
+#define VSUB(a,b)     ((a) - (b))
+#define VMUL(a,b)     ((a) * (b))
+#define VMIN(a,b)     (((a) < (b)) ? (a) : (b))
+#define VMAX(a,b)     (((a) > (b)) ? (a) : (b))
+#endif
+
+#define ROUND_UP(x,n) ((((x) + (n) - 1) / (n)) * (n))
+
+#define LDPC_METHOD_NMS 0
+#define LDPC_METHOD_OMS 1
+
+typedef struct {
+  int rows;
+  int cols;
+  int edges;
+  int deg_max;
+  int* row_ptr;
+  int* col;
+  int* shift;
+} base_graph_t;
+
+typedef struct {
+  int Z;
+  int Zp;
+  float* L;
+  float* R;
+  float* Q;
+  float* min1;
+  float* min2;
+  float* sgn;
+  unsigned char* parity;
+  /* hard decisions of L, kept for early termination */
+  unsigned char* hard;
+} ldpc_layered_ws_t;
+
+/* copy circulant column rotated by shift into contiguous lane buffer */
+static void gather_rotated(const float* L_col, int Z, int shift, float* dst) {
+  memcpy(dst, L_col + shift, sizeof(float) * (Z - shift));
+  memcpy(dst + Z - shift, L_col, sizeof(float) * shift);
+}
+
+/* inverse of gather_rotated */
+static void scatter_rotated(float* L_col, int Z, int shift, const float* src) {
+  memcpy(L_col + shift, src, sizeof(float) * (Z - shift));
+  memcpy(L_col, src + Z - shift, sizeof(float) * shift);
+}
+
+#if SIMD_W > 1
+static void layer_update(int deg, int Zp, float* Q, float* R, float* min1, float* min2, float* sgn, float alpha, float beta) {
+  int e, z;
+  const vfloat sign_mask = VSET1(-0.0f);
+  const vfloat v_alpha = VSET1(alpha);
+  const vfloat v_beta = VSET1(beta);
+  const vfloat v_zero = VSET1(0.0f);
+  vfloat q, a, m1, m2, s, mag;
+
+  for (z = 0; z < Zp; z += SIMD_W) {
+    VSTORE(min1 + z, VSET1(HUGE_VALF));
+    VSTORE(min2 + z, VSET1(HUGE_VALF));
+    VSTORE(sgn + z, v_zero);
+  }
+
+  /* variable-to-check messages, two smallest magnitudes and sign product */
+  for (e = 0; e < deg; e++) {
+    for (z = 0; z < Zp; z += SIMD_W) {
+      q = VSUB(VLOAD(Q + e*Zp + z), VLOAD(R + e*Zp + z));
+      VSTORE(Q + e*Zp + z, q);
+      a = VANDNOT(sign_mask, q);
+      m1 = VLOAD(min1 + z);
+      VSTORE(min2 + z, VMIN(VLOAD(min2 + z), VMAX(m1, a)));
+      VSTORE(min1 + z, VMIN(m1, a));
+      VSTORE(sgn + z, VXOR(VLOAD(sgn + z), VAND(sign_mask, q)));
+    }
+  }
+
+  /* check-to-variable messages and a posteriori LLR update */
+  for (e = 0; e < deg; e++) {
+    for (z = 0; z < Zp; z += SIMD_W) {
+      q = VLOAD(Q + e*Zp + z);
+      a = VANDNOT(sign_mask, q);
+      m1 = VLOAD(min1 + z);
+      m2 = VLOAD(min2 + z);
+      mag = VBLEND(m1, m2, VCMPEQ(a, m1));
+      mag = VMAX(VSUB(VMUL(mag, v_alpha), v_beta), v_zero);
+      s = VXOR(VLOAD(sgn + z), VAND(sign_mask, q));
+      mag = VXOR(mag, s);
+      VSTORE(R + e*Zp + z, mag);
+      VSTORE(Q + e*Zp + z, VADD(q, mag));
+    }
+  }
+}
+#else
+static void layer_update(int deg, int Zp, float* Q, float* R, float* min1, float* min2, float* sgn, float alpha, float beta) {
+  int e, z;
+  float q, a, mag;
+
+  for (z = 0; z < Zp; z++) {
+    min1[z] = HUGE_VALF;
+    min2[z] = HUGE_VALF;
+    sgn[z] = 1.0f;
+  }
+
+  for (e = 0; e < deg; e++) {
+    for (z = 0; z < Zp; z++) {
+      q = Q[e*Zp + z] - R[e*Zp + z];
+      Q[e*Zp + z] = q;
+      a = fabsf(q);
+      min2[z] = VMIN(min2[z], VMAX(min1[z], a));
+      min1[z] = VMIN(min1[z], a);
+      sgn[z] = (q < 0.0f) ? -sgn[z] : sgn[z];
+    }
+  }
+
+  for (e = 0; e < deg; e++) {
+    for (z = 0; z < Zp; z++) {
+      q = Q[e*Zp + z];
+      mag = (fabsf(q) == min1[z]) ? min2[z] : min1[z];
+      mag = VMAX(mag * alpha - beta, 0.0f);
+      mag = ((q < 0.0f) ? -sgn[z] : sgn[z]) * mag;
+      R[e*Zp + z] = mag;
+      Q[e*Zp + z] = q + mag;
+    }
+  }
+}
+#endif
+
+/* returns non-zero if hard decisions of L satisfy all parity checks */
+static int check_syndrome(const base_graph_t* bg, int Z, const float* L, unsigned char* parity) {
+  int r, e, z, c, s;
+  const float* L_col;
+
+  for (r = 0; r < bg->rows; r++) {
+    memset(parity, 0, Z);
+    for (e = bg->row_ptr[r]; e < bg->row_ptr[r+1]; e++) {
+      L_col = L + bg->col[e] * Z;
+      s = bg->shift[e];
+      for (z = 0; z < Z - s; z++)
+        parity[z] ^= (L_col[z + s] < 0.0f);
+      for (z = Z - s; z < Z; z++)
+        parity[z] ^= (L_col[z + s - Z] < 0.0f);
+    }
+    c = 0;
+    for (z = 0; z < Z; z++)
+      c |= parity[z];
+    if (c)
+      return 0;
+  }
+
+  return 1;
+}
+
+/* returns the number of unsatisfied parity checks of hard decisions of L */
+static int syndrome_weight(const base_graph_t* bg, int Z, const float* L, unsigned char* parity) {
+  int r, e, z, s, weight = 0;
+  const float* L_col;
+
+  for (r = 0; r < bg->rows; r++) {
+    memset(parity, 0, Z);
+    for (e = bg->row_ptr[r]; e < bg->row_ptr[r+1]; e++) {
+      L_col = L + bg->col[e] * Z;
+      s = bg->shift[e];
+      for (z = 0; z < Z - s; z++)
+        parity[z] ^= (L_col[z + s] < 0.0f);
+      for (z = Z - s; z < Z; z++)
+        parity[z] ^= (L_col[z + s - Z] < 0.0f);
+    }
+    for (z = 0; z < Z; z++)
+      weight += parity[z];
+  }
+
+  return weight;
+}
+
+/* updates n hard decisions of L, returns the number of flipped bits */
+static int hard_flips(int n, const float* L, unsigned char* hard) {
+  int i, flips = 0;
+  unsigned char h;
+
+  for (i = 0; i < n; i++) {
+    h = (L[i] < 0.0f);
+    flips += (h != hard[i]);
+    hard[i] = h;
+  }
+
+  return flips;
+}
+
+/* builds row-compressed base graph from (i, j, V_i_j) table sorted by rows,
+ * returns non-zero on success */
+static int base_graph_init(base_graph_t* bg, int Z, int cols, const double* i_tbl, const double* j_tbl, const double* V_tbl, size_t edges) {
+  int e, r;
+
+  bg->edges = (int) edges;
+  bg->cols = cols;
+  bg->rows = (int) i_tbl[edges-1] + 1;
+  bg->row_ptr = calloc(bg->rows + 1, sizeof(int));
+  bg->col = malloc(sizeof(int) * edges);
+  bg->shift = malloc(sizeof(int) * edges);
+
+  if (bg->row_ptr == NULL || bg->col == NULL || bg->shift == NULL)
+    return 0;
+
+  for (e = 0; e < bg->edges; e++) {
+    bg->row_ptr[(int) i_tbl[e] + 1]++;
+    bg->col[e] = (int) j_tbl[e];
+    bg->shift[e] = ((int) V_tbl[e]) % Z;
+  }
+
+  bg->deg_max = 0;
+  for (r = 0; r < bg->rows; r++) {
+    if (bg->row_ptr[r+1] > bg->deg_max)
+      bg->deg_max = bg->row_ptr[r+1];
+    bg->row_ptr[r+1] += bg->row_ptr[r];
+  }
+
+  return 1;
+}
+
+static void base_graph_free(base_graph_t* bg) {
+  free(bg->row_ptr);
+  free(bg->col);
+  free(bg->shift);
+}
+
+static void ldpc_layered_ws_free(ldpc_layered_ws_t* ws) {
+  if (ws == NULL)
+    return;
+  free(ws->L);
+  free(ws->R);
+  free(ws->Q);
+  free(ws->min1);
+  free(ws->min2);
+  free(ws->sgn);
+  free(ws->parity);
+  free(ws->hard);
+  free(ws);
+}
+
+/* allocates decoder workspace for a given base graph and lifting size,
+ * returns NULL if out of memory */
+static ldpc_layered_ws_t* ldpc_layered_ws_alloc(const base_graph_t* bg, int Z) {
+  ldpc_layered_ws_t* ws = calloc(1, sizeof(ldpc_layered_ws_t));
+
+  if (ws == NULL)
+    return NULL;
+
+  ws->Z = Z;
+  ws->Zp = ROUND_UP(Z, SIMD_W);
+  ws->L = malloc(sizeof(float) * bg->cols * Z);
+  ws->R = malloc(sizeof(float) * bg->edges * ws->Zp);
+  ws->Q = calloc((size_t) bg->deg_max * ws->Zp, sizeof(float));
+  ws->min1 = malloc(sizeof(float) * ws->Zp);
+  ws->min2 = malloc(sizeof(float) * ws->Zp);
+  ws->sgn = malloc(sizeof(float) * ws->Zp);
+  ws->parity = malloc(Z);
+  ws->hard = malloc((size_t) bg->cols * Z);
+
+  if (ws->L == NULL || ws->R == NULL || ws->Q == NULL || ws->min1 == NULL || ws->min2 == NULL || ws->sgn == NULL || ws->parity == NULL || ws->hard == NULL) {
+    ldpc_layered_ws_free(ws);
+    return NULL;
+  }
+
+  return ws;
+}
+
+/* Decodes a single codeword. LLRin holds (bg->cols - n_punct) * Z values read
+ * with stride llr_stride; the first n_punct * Z (punctured) positions are set
+ * to zero. Hard decisions of all bg->cols * Z bits are written with stride
+ * out_stride. Early termination policies are given by term (NULL - syndrome
+ * check only, see ldpc_term.h), stats may be NULL. */
+static void ldpc_layered_decode(const base_graph_t* bg, ldpc_layered_ws_t* ws, const double* LLRin, size_t llr_stride, int n_punct, int max_iters, int method, double param, const ldpc_term_t* term, double* out, size_t out_stride, double* cw_valid, double* iter, ldpc_term_stats_t* stats) {
+  int n, r, e, d;
+  int Z = ws->Z;
+  int Zp = ws->Zp;
+  int active = ldpc_term_active(term);
+  ldpc_term_state_t ts = {0, 0, 0};
+  int weight = 0, reason = LDPC_TERM_MAX_ITER;
+  float alpha, beta;
+
+  if (method == LDPC_METHOD_OMS) {
+    alpha = 1.0f;
+    beta = (float) param;
+  } else {
+    alpha = (float) param;
+    beta = 0.0f;
+  }
+
+  memset(ws->R, 0, sizeof(float) * bg->edges * Zp);
+
+  for (n = 0; n < n_punct * Z; n++)
+    ws->L[n] = 0.0f;
+  for (n = n_punct * Z; n < bg->cols * Z; n++)
+    ws->L[n] = (float) LLRin[(n - n_punct * Z) * llr_stride];
+
+  *cw_valid = check_syndrome(bg, Z, ws->L, ws->parity);
+  *iter = 0;
+
+  if (!(*cw_valid) && active) {
+    weight = syndrome_weight(bg, Z, ws->L, ws->parity);
+    memset(ws->hard, 0, (size_t) bg->cols * Z);
+    ldpc_term_reset(&ts, weight, hard_flips(bg->cols * Z, ws->L, ws->hard));
+  }
+
+  while (!(*cw_valid) && (*iter) < max_iters) {
+    for (r = 0; r < bg->rows; r++) {
+      for (e = bg->row_ptr[r], d = 0; e < bg->row_ptr[r+1]; e++, d++)
+        gather_rotated(ws->L + bg->col[e] * Z, Z, bg->shift[e], ws->Q + d*Zp);
+
+      layer_update(d, Zp, ws->Q, ws->R + bg->row_ptr[r] * Zp, ws->min1, ws->min2, ws->sgn, alpha, beta);
+
+      for (e = bg->row_ptr[r], d = 0; e < bg->row_ptr[r+1]; e++, d++)
+        scatter_rotated(ws->L + bg->col[e] * Z, Z, bg->shift[e], ws->Q + d*Zp);
+    }
+
+    (*iter)++;
+    if (active) {
+      weight = syndrome_weight(bg, Z, ws->L, ws->parity);
+      *cw_valid = (weight == 0);
+      if (!(*cw_valid)) {
+        reason = ldpc_term_step(term, &ts, ws->hard, weight, hard_flips(bg->cols * Z, ws->L, ws->hard));
+        if (reason != 0)
+          break;
+      }
+    } else {
+      *cw_valid = check_syndrome(bg, Z, ws->L, ws->parity);
+    }
+  }
+
+  if (stats != NULL) {
+    if (*cw_valid) {
+      reason = LDPC_TERM_SYNDROME;
+      weight = 0;
+    } else if (!active) {
+      weight = syndrome_weight(bg, Z, ws->L, ws->parity);
+    }
+    stats->reason = reason;
+    stats->weight = weight;
+  }
+
+  for (n = 0; n < bg->cols * Z; n++)
+    out[n * out_stride] = (ws->L[n] < 0.0f) ? 1.0 : 0.0;
+}
+
+#endif
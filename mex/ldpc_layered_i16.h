@@ -0,0 +1,366 @@
+/* Fixed-point variant of the layered min-sum LDPC decoder in ldpc_layered.h.
+ *
+ * Messages and a posteriori LLRs are int16 with saturating arithmetic,
+ * which doubles the number of lanes per SIMD register with respect to the
+ * float decoder (16 with AVX2, 8 with SSE2). Input LLRs are int16 or int8
+ * (see llr_quant.h), output hard bits are bytes. Normalization of NMS is a
+ * fixed-point multiplication by alpha with 16 fractional bits, the OMS
+ * offset is given in LLR units of the input.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef LDPC_LAYERED_I16_H
+#define LDPC_LAYERED_I16_H
+
+#include <stdint.h>
+#include "ldpc_layered.h"
+
+#define I16_MAX 32767
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_W16 16
+typedef __m256i vint16;
+#define WLOAD(p)      _mm256_loadu_si256((const __m256i*)(p))
+#define WSTORE(p,x)   _mm256_storeu_si256((__m256i*)(p),x)
+#define WSET1(x)      _mm256_set1_epi16(x)
+#define WADDS(a,b)    _mm256_adds_epi16(a,b)
+#define WSUBS(a,b)    _mm256_subs_epi16(a,b)
+#define WSUB(a,b)     _mm256_sub_epi16(a,b)
+#define WMIN(a,b)     _mm256_min_epi16(a,b)
+#define WMAX(a,b)     _mm256_max_epi16(a,b)
+#define WXOR(a,b)     _mm256_xor_si256(a,b)
+#define WCMPEQ(a,b)   _mm256_cmpeq_epi16(a,b)
+#define WBLEND(a,b,m) _mm256_blendv_epi8(a,b,m)
+#define WMULHI(a,b)   _mm256_mulhi_epi16(a,b)
+#define WSRAI(a,n)    _mm256_srai_epi16(a,n)
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_W16 8
+typedef __m128i vint16;
+#define WLOAD(p)      _mm_loadu_si128((const __m128i*)(p))
+#define WSTORE(p,x)   _mm_storeu_si128((__m128i*)(p),x)
+#define WSET1(x)      _mm_set1_epi16(x)
+#define WADDS(a,b)    _mm_adds_epi16(a,b)
+#define WSUBS(a,b)    _mm_subs_epi16(a,b)
+#define WSUB(a,b)     _mm_sub_epi16(a,b)
+#define WMIN(a,b)     _mm_min_epi16(a,b)
+#define WMAX(a,b)     _mm_max_epi16(a,b)
+#define WXOR(a,b)     _mm_xor_si128(a,b)
+#define WCMPEQ(a,b)   _mm_cmpeq_epi16(a,b)
+#define WBLEND(a,b,m) _mm_or_si128(_mm_andnot_si128(m,a), _mm_and_si128(m,b))
+#define WMULHI(a,b)   _mm_mulhi_epi16(a,b)
+#define WSRAI(a,n)    _mm_srai_epi16(a,n)
+#else
+#define SIMD_W16 1
+#endif
+
+typedef struct {
+  int Z;
+  int Zp;
+  int16_t* L;
+  int16_t* R;
+  int16_t* Q;
+  int16_t* min1;
+  int16_t* min2;
+  int16_t* sgn;
+  unsigned char* parity;
+  /* hard decisions of L, kept for early termination */
+  unsigned char* hard;
+} ldpc_layered_i16_ws_t;
+
+/* check node magnitude scaling: NMS by alpha = k/65536 (sub = 0) or
+ * 1 - k/65536 (sub = 1), OMS by subtracting beta */
+typedef struct {
+  int oms;
+  int sub;
+  int16_t k;
+  int16_t beta;
+} i16_scale_t;
+
+static int16_t sat16(int x) {
+  return (int16_t)((x > I16_MAX) ? I16_MAX : ((x < -I16_MAX) ? -I16_MAX : x));
+}
+
+static void gather_rotated_i16(const int16_t* L_col, int Z, int shift, int16_t* dst) {
+  memcpy(dst, L_col + shift, sizeof(int16_t) * (Z - shift));
+  memcpy(dst + Z - shift, L_col, sizeof(int16_t) * shift);
+}
+
+static void scatter_rotated_i16(int16_t* L_col, int Z, int shift, const int16_t* src) {
+  memcpy(L_col + shift, src, sizeof(int16_t) * (Z - shift));
+  memcpy(L_col, src + Z - shift, sizeof(int16_t) * shift);
+}
+
+#if SIMD_W16 > 1
+static void layer_update_i16(int deg, int Zp, int16_t* Q, int16_t* R, int16_t* min1, int16_t* min2, int16_t* sgn, const i16_scale_t* sc) {
+  int e, z;
+  const vint16 v_zero = WSET1(0);
+  const vint16 v_k = WSET1(sc->k);
+  const vint16 v_beta = WSET1(sc->beta);
+  vint16 q, a, m1, m2, s, mag;
+
+  for (z = 0; z < Zp; z += SIMD_W16) {
+    WSTORE(min1 + z, WSET1(I16_MAX));
+    WSTORE(min2 + z, WSET1(I16_MAX));
+    WSTORE(sgn + z, v_zero);
+  }
+
+  /* variable-to-check messages, two smallest magnitudes and sign product
+   * (in the sign bit of sgn) */
+  for (e = 0; e < deg; e++) {
+    for (z = 0; z < Zp; z += SIMD_W16) {
+      q = WSUBS(WLOAD(Q + e*Zp + z), WLOAD(R + e*Zp + z));
+      WSTORE(Q + e*Zp + z, q);
+      a = WMAX(q, WSUBS(v_zero, q));
+      m1 = WLOAD(min1 + z);
+      WSTORE(min2 + z, WMIN(WLOAD(min2 + z), WMAX(m1, a)));
+      WSTORE(min1 + z, WMIN(m1, a));
+      WSTORE(sgn + z, WXOR(WLOAD(sgn + z), q));
+    }
+  }
+
+  /* check-to-variable messages and a posteriori LLR update */
+  for (e = 0; e < deg; e++) {
+    for (z = 0; z < Zp; z += SIMD_W16) {
+      q = WLOAD(Q + e*Zp + z);
+      a = WMAX(q, WSUBS(v_zero, q));
+      m1 = WLOAD(min1 + z);
+      m2 = WLOAD(min2 + z);
+      mag = WBLEND(m1, m2, WCMPEQ(a, m1));
+      if (sc->oms)
+        mag = WMAX(WSUBS(mag, v_beta), v_zero);
+      else if (sc->sub)
+        mag = WSUB(mag, WMULHI(mag, v_k));
+      else
+        mag = WMULHI(mag, v_k);
+      /* all ones in lanes with negative sign, conditional negation */
+      s = WSRAI(WXOR(WLOAD(sgn + z), q), 15);
+      mag = WSUB(WXOR(mag, s), s);
+      WSTORE(R + e*Zp + z, mag);
+      WSTORE(Q + e*Zp + z, WADDS(q, mag));
+    }
+  }
+}
+#else
+static void layer_update_i16(int deg, int Zp, int16_t* Q, int16_t* R, int16_t* min1, int16_t* min2, int16_t* sgn, const i16_scale_t* sc) {
+  int e, z, q, a, mag;
+
+  for (z = 0; z < Zp; z++) {
+    min1[z] = I16_MAX;
+    min2[z] = I16_MAX;
+    sgn[z] = 1;
+  }
+
+  for (e = 0; e < deg; e++) {
+    for (z = 0; z < Zp; z++) {
+      q = sat16(Q[e*Zp + z] - R[e*Zp + z]);
+      Q[e*Zp + z] = (int16_t) q;
+      a = (q < 0) ? -q : q;
+      min2[z] = (int16_t) VMIN(min2[z], VMAX(min1[z], a));
+      min1[z] = (int16_t) VMIN(min1[z], a);
+      sgn[z] = (q < 0) ? -sgn[z] : sgn[z];
+    }
+  }
+
+  for (e = 0; e < deg; e++) {
+    for (z = 0; z < Zp; z++) {
+      q = Q[e*Zp + z];
+      a = (q < 0) ? -q : q;
+      mag = (a == min1[z]) ? min2[z] : min1[z];
+      if (sc->oms)
+        mag = VMAX(mag - sc->beta, 0);
+      else if (sc->sub)
+        mag = mag - ((mag * sc->k) >> 16);
+      else
+        mag = (mag * sc->k) >> 16;
+      mag = ((q < 0) ? -sgn[z] : sgn[z]) * mag;
+      R[e*Zp + z] = (int16_t) mag;
+      Q[e*Zp + z] = sat16(q + mag);
+    }
+  }
+}
+#endif
+
+static int check_syndrome_i16(const base_graph_t* bg, int Z, const int16_t* L, unsigned char* parity) {
+  int r, e, z, c, s;
+  const int16_t* L_col;
+
+  for (r = 0; r < bg->rows; r++) {
+    memset(parity, 0, Z);
+    for (e = bg->row_ptr[r]; e < bg->row_ptr[r+1]; e++) {
+      L_col = L + bg->col[e] * Z;
+      s = bg->shift[e];
+      for (z = 0; z < Z - s; z++)
+        parity[z] ^= (L_col[z + s] < 0);
+      for (z = Z - s; z < Z; z++)
+        parity[z] ^= (L_col[z + s - Z] < 0);
+    }
+    c = 0;
+    for (z = 0; z < Z; z++)
+      c |= parity[z];
+    if (c)
+      return 0;
+  }
+
+  return 1;
+}
+
+/* returns the number of unsatisfied parity checks of hard decisions of L */
+static int syndrome_weight_i16(const base_graph_t* bg, int Z, const int16_t* L, unsigned char* parity) {
+  int r, e, z, s, weight = 0;
+  const int16_t* L_col;
+
+  for (r = 0; r < bg->rows; r++) {
+    memset(parity, 0, Z);
+    for (e = bg->row_ptr[r]; e < bg->row_ptr[r+1]; e++) {
+      L_col = L + bg->col[e] * Z;
+      s = bg->shift[e];
+      for (z = 0; z < Z - s; z++)
+        parity[z] ^= (L_col[z + s] < 0);
+      for (z = Z - s; z < Z; z++)
+        parity[z] ^= (L_col[z + s - Z] < 0);
+    }
+    for (z = 0; z < Z; z++)
+      weight += parity[z];
+  }
+
+  return weight;
+}
+
+/* updates n hard decisions of L, returns the number of flipped bits */
+static int hard_flips_i16(int n, const int16_t* L, unsigned char* hard) {
+  int i, flips = 0;
+  unsigned char h;
+
+  for (i = 0; i < n; i++) {
+    h = (L[i] < 0);
+    flips += (h != hard[i]);
+    hard[i] = h;
+  }
+
+  return flips;
+}
+
+static void ldpc_layered_i16_ws_free(ldpc_layered_i16_ws_t* ws) {
+  if (ws == NULL)
+    return;
+  free(ws->L);
+  free(ws->R);
+  free(ws->Q);
+  free(ws->min1);
+  free(ws->min2);
+  free(ws->sgn);
+  free(ws->parity);
+  free(ws->hard);
+  free(ws);
+}
+
+/* allocates decoder workspace for a given base graph and lifting size,
+ * returns NULL if out of memory */
+static ldpc_layered_i16_ws_t* ldpc_layered_i16_ws_alloc(const base_graph_t* bg, int Z) {
+  ldpc_layered_i16_ws_t* ws = calloc(1, sizeof(ldpc_layered_i16_ws_t));
+
+  if (ws == NULL)
+    return NULL;
+
+  ws->Z = Z;
+  ws->Zp = ROUND_UP(Z, SIMD_W16);
+  ws->L = malloc(sizeof(int16_t) * bg->cols * Z);
+  ws->R = malloc(sizeof(int16_t) * bg->edges * ws->Zp);
+  ws->Q = calloc((size_t) bg->deg_max * ws->Zp, sizeof(int16_t));
+  ws->min1 = malloc(sizeof(int16_t) * ws->Zp);
+  ws->min2 = malloc(sizeof(int16_t) * ws->Zp);
+  ws->sgn = malloc(sizeof(int16_t) * ws->Zp);
+  ws->parity = malloc(Z);
+  ws->hard = malloc((size_t) bg->cols * Z);
+
+  if (ws->L == NULL || ws->R == NULL || ws->Q == NULL || ws->min1 == NULL || ws->min2 == NULL || ws->sgn == NULL || ws->parity == NULL || ws->hard == NULL) {
+    ldpc_layered_i16_ws_free(ws);
+    return NULL;
+  }
+
+  return ws;
+}
+
+/* Decodes a single codeword, see ldpc_layered_decode. LLRin points to int8_t
+ * values if in_int8 is set and to int16_t values otherwise. For OMS, param is
+ * the offset in units of the quantized LLRs. */
+static void ldpc_layered_decode_i16(const base_graph_t* bg, ldpc_layered_i16_ws_t* ws, const void* LLRin, int in_int8, size_t llr_stride, int n_punct, int max_iters, int method, double param, const ldpc_term_t* term, unsigned char* out, size_t out_stride, double* cw_valid, double* iter, ldpc_term_stats_t* stats) {
+  int n, r, e, d;
+  int Z = ws->Z;
+  int Zp = ws->Zp;
+  int active = ldpc_term_active(term);
+  ldpc_term_state_t ts = {0, 0, 0};
+  int weight = 0, reason = LDPC_TERM_MAX_ITER;
+  i16_scale_t sc;
+  double k;
+
+  sc.oms = (method == LDPC_METHOD_OMS);
+  sc.beta = sat16((int) lrint(param));
+  sc.sub = (param >= 0.5);
+  k = (sc.sub ? 1.0 - param : param) * 65536.0;
+  sc.k = sat16((int) lrint((k < 0.0) ? 0.0 : k));
+
+  memset(ws->R, 0, sizeof(int16_t) * bg->edges * Zp);
+
+  for (n = 0; n < n_punct * Z; n++)
+    ws->L[n] = 0;
+  if (in_int8)
+    for (n = n_punct * Z; n < bg->cols * Z; n++)
+      ws->L[n] = ((const int8_t*) LLRin)[(n - n_punct * Z) * llr_stride];
+  else
+    for (n = n_punct * Z; n < bg->cols * Z; n++)
+      ws->L[n] = sat16(((const int16_t*) LLRin)[(n - n_punct * Z) * llr_stride]);
+
+  *cw_valid = check_syndrome_i16(bg, Z, ws->L, ws->parity);
+  *iter = 0;
+
+  if (!(*cw_valid) && active) {
+    weight = syndrome_weight_i16(bg, Z, ws->L, ws->parity);
+    memset(ws->hard, 0, (size_t) bg->cols * Z);
+    ldpc_term_reset(&ts, weight, hard_flips_i16(bg->cols * Z, ws->L, ws->hard));
+  }
+
+  while (!(*cw_valid) && (*iter) < max_iters) {
+    for (r = 0; r < bg->rows; r++) {
+      for (e = bg->row_ptr[r], d = 0; e < bg->row_ptr[r+1]; e++, d++)
+        gather_rotated_i16(ws->L + bg->col[e] * Z, Z, bg->shift[e], ws->Q + d*Zp);
+
+      layer_update_i16(d, Zp, ws->Q, ws->R + bg->row_ptr[r] * Zp, ws->min1, ws->min2, ws->sgn, &sc);
+
+      for (e = bg->row_ptr[r], d = 0; e < bg->row_ptr[r+1]; e++, d++)
+        scatter_rotated_i16(ws->L + bg->col[e] * Z, Z, bg->shift[e], ws->Q + d*Zp);
+    }
+
+    (*iter)++;
+    if (active) {
+      weight = syndrome_weight_i16(bg, Z, ws->L, ws->parity);
+      *cw_valid = (weight == 0);
+      if (!(*cw_valid)) {
+        reason = ldpc_term_step(term, &ts, ws->hard, weight, hard_flips_i16(bg->cols * Z, ws->L, ws->hard));
+        if (reason != 0)
+          break;
+      }
+    } else {
+      *cw_valid = check_syndrome_i16(bg, Z, ws->L, ws->parity);
+    }
+  }
+
+  if (stats != NULL) {
+    if (*cw_valid) {
+      reason = LDPC_TERM_SYNDROME;
+      weight = 0;
+    } else if (!active) {
+      weight = syndrome_weight_i16(bg, Z, ws->L, ws->parity);
+    }
+    stats->reason = reason;
+    stats->weight = weight;
+  }
+
+  for (n = 0; n < bg->cols * Z; n++)
+    out[n * out_stride] = (ws->L[n] < 0);
+}
+
+#endif
@@ -0,0 +1,358 @@
+/* Sum-product LDPC decoder core shared by ldpc_decode_spa_mex.c and native
+ * code.
+ *
+ * The parity check matrix is given in compressed column form (H_ir, H_jc),
+ * together with the node degrees sumX1 (per variable) and sumX2 (per check)
+ * and the zero-based message index tables i_idx and j_idx prepared by
+ * ldpc_decode_spa.m. Check node updates use the forward-backward recursion
+ * of the approximated boxplus operator.
+ *
+ * ldpc_spa_graph_create() copies these tables into a single allocation
+ * owned by the graph. A decoder context (ldpc_spa_ctx_create()) owns an
+ * arena of message memory sized once for its graph, so decoding allocates
+ * nothing and contexts of the same graph may decode concurrently. A pool
+ * (ldpc_spa_pool_t) hands one context to every worker thread, contexts are
+ * created on first use by the worker.
+ *
+ * Besides the syndrome check, decoding may be terminated early by the
+ * policies of ldpc_term.h.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef LDPC_SPA_H
+#define LDPC_SPA_H
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "ldpc_term.h"
+
+#define SPA_MIN(x,y) ((x > y) ? ( y) : (  x))
+#define SPA_ABS(x)   ((x > 0) ? ( x) : (-(x)))
+#define SPA_SGN(x)   ((x < 0) ? (-1) : (  1))
+
+#define SPA_ARENA_ALIGN(n) (((n) + 63) & ~(size_t) 63)
+
+typedef struct {
+  size_t ncheck, nvar, cmax, vmax;
+  size_t* H_ir;
+  size_t* H_jc;
+  /* node degrees and message index tables */
+  int* deg_v;
+  int* deg_c;
+  size_t* i_idx;
+  size_t* j_idx;
+} ldpc_spa_graph_t;
+
+typedef struct {
+  const ldpc_spa_graph_t* g;
+  int* syndrome;
+  double* L;
+  /* hard decisions of L, kept for early termination */
+  unsigned char* hard;
+  double* mcv;
+  double* mvc;
+  /* forward-backward partial sums of a check node */
+  double* ml;
+  double* mr;
+} ldpc_spa_ctx_t;
+
+typedef struct {
+  ldpc_spa_graph_t* g;
+  int n_ctx;
+  ldpc_spa_ctx_t** ctx;
+} ldpc_spa_pool_t;
+
+/* returns the number of unsatisfied parity checks */
+static int spa_syndrome_weight(size_t ncheck, size_t nvar, const size_t* H_ir, const size_t* H_jc, const double* LLR, int* syndrome) {
+  size_t v;
+  size_t c_idx;
+  size_t c;
+  int weight;
+
+  for (v = 0; v < nvar; v++) {
+    for (c_idx = H_jc[v]; c_idx < H_jc[v+1]; c_idx++) {
+      c = H_ir[c_idx];
+      if (LLR[v] < 0.0) {
+        syndrome[c]++;
+      }
+    }
+  }
+
+  weight = 0;
+  for (c = 0; c < ncheck; c++) {
+    weight += syndrome[c] & 1;
+    syndrome[c] = 0;
+  }
+
+  return weight;
+}
+
+/* updates hard decisions of L, returns the number of flipped bits */
+static int spa_hard_flips(size_t nvar, const double* L, unsigned char* hard) {
+  size_t v;
+  int flips = 0;
+  unsigned char h;
+
+  for (v = 0; v < nvar; v++) {
+    h = (L[v] < 0.0);
+    flips += (h != hard[v]);
+    hard[v] = h;
+  }
+
+  return flips;
+}
+
+static void spa_fill_mvc(size_t nvar, size_t cmax, const double* LLRin, double* mvc) {
+  size_t n;
+  size_t c;
+  for (n = 0; n < nvar; n++) {
+    for (c = 0; c < cmax; c++) {
+      mvc[n + c*nvar] = LLRin[n];
+    }
+  }
+}
+
+static double boxplus(double a, double b) {
+  double x1, x2, x3;
+
+  x1 = SPA_SGN(a) * SPA_SGN(b) * SPA_MIN(SPA_ABS(a), SPA_ABS(b));
+  x2 = log(1.0 + exp(-SPA_ABS(a+b)));
+  x3 = log(1.0 + exp(-SPA_ABS(a-b)));
+  return x1 + x2 - x3;
+}
+
+static double boxplus_approx(double a, double b) {
+  double x1, x2, x3, r;
+
+  x1 = SPA_SGN(a) * SPA_SGN(b) * SPA_MIN(SPA_ABS(a), SPA_ABS(b));
+
+  r = SPA_ABS(a+b);
+  x2 = (r < 2.5) ? (0.6 - 0.24 * r) : 0.0;
+
+  r = SPA_ABS(a-b);
+  x3 = (r < 2.5) ? (0.6 - 0.24 * r) : 0.0;
+
+  return x1 + x2 - x3;
+}
+
+/* copies the parity check matrix and message index tables into a new
+ * graph, returns NULL if out of memory */
+static ldpc_spa_graph_t* ldpc_spa_graph_create(size_t ncheck, size_t nvar, size_t cmax, size_t vmax, const size_t* H_ir, const size_t* H_jc, const double* sumX1, const double* sumX2, const double* i_idx, const double* j_idx) {
+  size_t nnz = H_jc[nvar], n, off[7];
+  unsigned char* arena;
+  ldpc_spa_graph_t* g;
+
+  off[0] = SPA_ARENA_ALIGN(sizeof(ldpc_spa_graph_t));
+  off[1] = off[0] + SPA_ARENA_ALIGN(sizeof(size_t) * nnz);
+  off[2] = off[1] + SPA_ARENA_ALIGN(sizeof(size_t) * (nvar + 1));
+  off[3] = off[2] + SPA_ARENA_ALIGN(sizeof(int) * nvar);
+  off[4] = off[3] + SPA_ARENA_ALIGN(sizeof(int) * ncheck);
+  off[5] = off[4] + SPA_ARENA_ALIGN(sizeof(size_t) * nvar * cmax);
+  off[6] = off[5] + SPA_ARENA_ALIGN(sizeof(size_t) * ncheck * vmax);
+
+  arena = malloc(off[6]);
+  if (arena == NULL)
+    return NULL;
+
+  g = (ldpc_spa_graph_t*) arena;
+  g->ncheck = ncheck;
+  g->nvar = nvar;
+  g->cmax = cmax;
+  g->vmax = vmax;
+  g->H_ir = (size_t*) (arena + off[0]);
+  g->H_jc = (size_t*) (arena + off[1]);
+  g->deg_v = (int*) (arena + off[2]);
+  g->deg_c = (int*) (arena + off[3]);
+  g->i_idx = (size_t*) (arena + off[4]);
+  g->j_idx = (size_t*) (arena + off[5]);
+
+  memcpy(g->H_ir, H_ir, sizeof(size_t) * nnz);
+  memcpy(g->H_jc, H_jc, sizeof(size_t) * (nvar + 1));
+  for (n = 0; n < nvar; n++)
+    g->deg_v[n] = (int) sumX1[n];
+  for (n = 0; n < ncheck; n++)
+    g->deg_c[n] = (int) sumX2[n];
+  for (n = 0; n < nvar * cmax; n++)
+    g->i_idx[n] = (i_idx[n] > 0.0) ? (size_t) i_idx[n] : 0;
+  for (n = 0; n < ncheck * vmax; n++)
+    g->j_idx[n] = (j_idx[n] > 0.0) ? (size_t) j_idx[n] : 0;
+
+  return g;
+}
+
+static void ldpc_spa_graph_destroy(ldpc_spa_graph_t* g) {
+  free(g);
+}
+
+/* allocates the message memory of a decoder of graph g, returns NULL if out
+ * of memory */
+static ldpc_spa_ctx_t* ldpc_spa_ctx_create(const ldpc_spa_graph_t* g) {
+  size_t off[7];
+  unsigned char* arena;
+  ldpc_spa_ctx_t* ctx;
+
+  off[0] = SPA_ARENA_ALIGN(sizeof(ldpc_spa_ctx_t));
+  off[1] = off[0] + SPA_ARENA_ALIGN(sizeof(int) * g->ncheck);
+  off[2] = off[1] + SPA_ARENA_ALIGN(sizeof(double) * g->nvar);
+  off[3] = off[2] + SPA_ARENA_ALIGN(sizeof(double) * g->ncheck * g->vmax);
+  off[4] = off[3] + SPA_ARENA_ALIGN(sizeof(double) * g->nvar * g->cmax);
+  off[5] = off[4] + SPA_ARENA_ALIGN(sizeof(double) * g->vmax);
+  off[6] = off[5] + SPA_ARENA_ALIGN(sizeof(double) * g->vmax);
+
+  arena = malloc(off[6] + g->nvar);
+  if (arena == NULL)
+    return NULL;
+
+  ctx = (ldpc_spa_ctx_t*) arena;
+  ctx->g = g;
+  ctx->syndrome = (int*) (arena + off[0]);
+  ctx->L = (double*) (arena + off[1]);
+  ctx->mcv = (double*) (arena + off[2]);
+  ctx->mvc = (double*) (arena + off[3]);
+  ctx->ml = (double*) (arena + off[4]);
+  ctx->mr = (double*) (arena + off[5]);
+  ctx->hard = arena + off[6];
+
+  /* spa_syndrome_weight() leaves the counters cleared */
+  memset(ctx->syndrome, 0, sizeof(int) * g->ncheck);
+
+  return ctx;
+}
+
+static void ldpc_spa_ctx_destroy(ldpc_spa_ctx_t* ctx) {
+  free(ctx);
+}
+
+/* decodes a single codeword of nvar LLRs read with stride llr_stride into
+ * nvar hard bits written with stride out_stride, with the early termination
+ * policies of term (NULL - syndrome check only); stats may be NULL */
+static void ldpc_spa_decode(ldpc_spa_ctx_t* ctx, const double* LLRin, size_t llr_stride, int max_iters, const ldpc_term_t* term, double* out, size_t out_stride, double* cw_valid, double* iter, ldpc_term_stats_t* stats) {
+  const ldpc_spa_graph_t* g = ctx->g;
+  size_t ncheck = g->ncheck, nvar = g->nvar;
+  const size_t* i_idx = g->i_idx;
+  const size_t* j_idx = g->j_idx;
+  double* mcv = ctx->mcv;
+  double* mvc = ctx->mvc;
+  double* ml = ctx->ml;
+  double* mr = ctx->mr;
+  double* L = ctx->L;
+  int active = ldpc_term_active(term);
+  ldpc_term_state_t ts = {0, 0, 0};
+  int i, j, n, weight, flips, reason;
+
+  for (i = 0; i < (int)nvar; i++)
+    L[i] = LLRin[i * llr_stride];
+
+  spa_fill_mvc(nvar, g->cmax, L, mvc);
+
+  *cw_valid = 0;
+  *iter = 0;
+  reason = LDPC_TERM_MAX_ITER;
+
+  weight = spa_syndrome_weight(ncheck, nvar, g->H_ir, g->H_jc, L, ctx->syndrome);
+  if (weight == 0) {
+    *cw_valid = 1;
+    reason = LDPC_TERM_SYNDROME;
+  } else {
+    if (active) {
+      memset(ctx->hard, 0, nvar);
+      ldpc_term_reset(&ts, weight, spa_hard_flips(nvar, L, ctx->hard));
+    }
+    for ((*iter) = 0; (*iter) < max_iters; (*iter)++) {
+      for (j = 0; j < (int)ncheck; j++) {
+        n = g->deg_c[j] - 1;
+
+        ml[0] = mvc[j_idx[j]];
+        mr[0] = mvc[j_idx[j+n*ncheck]];
+        for(i = 1; i < n; i++ ) {
+          ml[i] = boxplus_approx( ml[i-1], mvc[j_idx[j+i*ncheck]] );
+          mr[i] = boxplus_approx( mr[i-1], mvc[j_idx[j+(n-i)*ncheck]] );
+        }
+
+        mcv[j] = mr[n-1];
+        mcv[j+n*ncheck] = ml[n-1];
+        for(i = 1; i < n; i++ )
+          mcv[j+i*ncheck] = boxplus_approx( ml[i-1], mr[n-1-i] );
+      }
+
+      for (i = 0; i < (int)nvar; i++) {
+        L[i] = LLRin[i * llr_stride];
+        for (j = 0; j < g->deg_v[i]; j++) {
+          L[i] += mcv[i_idx[i + j*nvar]];
+        }
+        for (j = 0; j < g->deg_v[i]; j++) {
+          mvc[i + j*nvar] = L[i] - mcv[i_idx[i + j*nvar]];
+        }
+      }
+
+      weight = spa_syndrome_weight(ncheck, nvar, g->H_ir, g->H_jc, L, ctx->syndrome);
+      if (weight == 0) {
+        *cw_valid = 1;
+        reason = LDPC_TERM_SYNDROME;
+        (*iter)++;
+        break;
+      }
+
+      if (active) {
+        flips = spa_hard_flips(nvar, L, ctx->hard);
+        reason = ldpc_term_step(term, &ts, ctx->hard, weight, flips);
+        if (reason != 0) {
+          (*iter)++;
+          break;
+        }
+      }
+    }
+  }
+
+  if (stats != NULL) {
+    stats->reason = reason;
+    stats->weight = weight;
+  }
+
+  for (i = 0; i < (int)nvar; i++)
+    out[i * out_stride] = (L[i] < 0.0) ? 1.0 : 0.0;
+}
+
+/* creates a pool of up to n_ctx contexts of graph g, which is owned by the
+ * pool, returns NULL if out of memory */
+static ldpc_spa_pool_t* ldpc_spa_pool_create(ldpc_spa_graph_t* g, int n_ctx) {
+  ldpc_spa_pool_t* pool = malloc(sizeof(ldpc_spa_pool_t));
+
+  if (pool == NULL)
+    return NULL;
+
+  pool->g = g;
+  pool->n_ctx = n_ctx;
+  pool->ctx = calloc(n_ctx, sizeof(ldpc_spa_ctx_t*));
+  if (pool->ctx == NULL) {
+    free(pool);
+    return NULL;
+  }
+
+  return pool;
+}
+
+/* context of worker, created on first use, NULL if out of memory */
+static ldpc_spa_ctx_t* ldpc_spa_pool_ctx(ldpc_spa_pool_t* pool, int worker) {
+  if (worker < 0 || worker >= pool->n_ctx)
+    return NULL;
+  if (pool->ctx[worker] == NULL)
+    pool->ctx[worker] = ldpc_spa_ctx_create(pool->g);
+  return pool->ctx[worker];
+}
+
+static void ldpc_spa_pool_destroy(ldpc_spa_pool_t* pool) {
+  int n;
+
+  if (pool == NULL)
+    return;
+  for (n = 0; n < pool->n_ctx; n++)
+    ldpc_spa_ctx_destroy(pool->ctx[n]);
+  free(pool->ctx);
+  ldpc_spa_graph_destroy(pool->g);
+  free(pool);
+}
+
+#endif
@@ -0,0 +1,116 @@
+/* Early termination policies of the LDPC decoders (ldpc_spa.h,
+ * ldpc_layered.h, ldpc_layered_i16.h).
+ *
+ * Decoding always stops when all parity checks are satisfied. In addition,
+ * after every iteration
+ *  - CRC-aided termination checks the CRC (codeblock CRC24B, or transport
+ *    block CRC of a single codeblock) of the tentative hard decision, which
+ *    covers the first crc_bits bits of the codeword (data followed by the
+ *    CRC parity bits),
+ *  - stall detection gives up a codeword that made no progress for patience
+ *    iterations in a row. An iteration makes progress if the syndrome
+ *    weight (number of unsatisfied checks) reaches a new minimum, or if
+ *    fewer hard decisions flipped than in the previous iteration. Decoding
+ *    oscillating or trapped in a fixed point with unsatisfied checks does
+ *    neither.
+ * Hard decisions are kept by the decoders as one byte per bit, the policies
+ * are evaluated only if enabled.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef LDPC_TERM_H
+#define LDPC_TERM_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "nr_crc.h"
+
+/* reasons of termination */
+#define LDPC_TERM_MAX_ITER 0
+#define LDPC_TERM_SYNDROME 1
+#define LDPC_TERM_CRC      2
+#define LDPC_TERM_STALL    3
+
+typedef struct {
+  const nr_crc_t* crc;  /* NULL disables CRC-aided termination */
+  size_t crc_bits;      /* bits covered by crc, including its parity bits */
+  int patience;         /* 0 disables stall detection */
+} ldpc_term_t;
+
+/* per-codeword statistics of the decoders */
+typedef struct {
+  int reason;           /* LDPC_TERM_* */
+  int weight;           /* final syndrome weight */
+} ldpc_term_stats_t;
+
+/* progress of a codeword being decoded */
+typedef struct {
+  int best_weight;
+  int prev_flips;
+  int idle;
+} ldpc_term_state_t;
+
+/* returns non-zero if policies beyond the syndrome check are enabled */
+static int ldpc_term_active(const ldpc_term_t* t) {
+  return t != NULL && ((t->crc != NULL && t->crc_bits > (size_t) t->crc->len) || t->patience > 0);
+}
+
+static void ldpc_term_reset(ldpc_term_state_t* s, int weight, int flips) {
+  s->best_weight = weight;
+  s->prev_flips = flips;
+  s->idle = 0;
+}
+
+/* returns non-zero if the CRC of hard decisions (one byte per bit, non-zero
+ * is a one) passes */
+static int ldpc_term_crc_ok(const ldpc_term_t* t, const unsigned char* hard) {
+  const nr_crc_t* crc = t->crc;
+  size_t n_data = t->crc_bits - crc->len, i, k;
+  uint32_t reg = nr_crc_init_reg(crc), val;
+  uint8_t buf[64];
+  size_t nb;
+  int n;
+
+  for (i = 0; i + 8 <= n_data; ) {
+    nb = (n_data - i) / 8;
+    nb = (nb < sizeof(buf)) ? nb : sizeof(buf);
+    for (k = 0; k < nb; k++, i += 8)
+      buf[k] = (uint8_t)((hard[i] != 0) << 7 | (hard[i+1] != 0) << 6 | (hard[i+2] != 0) << 5 | (hard[i+3] != 0) << 4 |
+                         (hard[i+4] != 0) << 3 | (hard[i+5] != 0) << 2 | (hard[i+6] != 0) << 1 | (hard[i+7] != 0));
+    reg = nr_crc_update_bytes(crc, reg, buf, nb);
+  }
+  for (; i < n_data; i++)
+    reg = nr_crc_update_bit(crc, reg, hard[i] != 0);
+
+  val = nr_crc_final(crc, reg);
+  for (n = 0; n < crc->len; n++)
+    if ((hard[n_data + n] != 0) != (int)((val >> (crc->len - 1 - n)) & 1))
+      return 0;
+
+  return 1;
+}
+
+/* Evaluates the policies after an iteration that left weight unsatisfied
+ * checks (non-zero) and flipped flips hard decisions. Returns LDPC_TERM_CRC
+ * or LDPC_TERM_STALL to stop, 0 to continue. */
+static int ldpc_term_step(const ldpc_term_t* t, ldpc_term_state_t* s, const unsigned char* hard, int weight, int flips) {
+  if (t->crc != NULL && t->crc_bits > (size_t) t->crc->len && ldpc_term_crc_ok(t, hard))
+    return LDPC_TERM_CRC;
+
+  if (t->patience > 0) {
+    if (weight < s->best_weight) {
+      s->best_weight = weight;
+      s->idle = 0;
+    } else if (flips >= s->prev_flips) {
+      s->idle++;
+    }
+    s->prev_flips = flips;
+    if (s->idle >= t->patience)
+      return LDPC_TERM_STALL;
+  }
+
+  return 0;
+}
+
+#endif
@@ -0,0 +1,42 @@
+/* Fixed-point LLR formats shared by the reduced-precision receive path.
+ *
+ * LLRs are stored as round(llr * scale) saturated to the symmetric range
+ * [-LIM, LIM], so that negation never overflows. Combining of LLRs (HARQ,
+ * repeated bits of the circular buffer) saturates as well.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef LLR_QUANT_H
+#define LLR_QUANT_H
+
+#include <stdint.h>
+#include <math.h>
+
+#define LLR_DOUBLE 0
+#define LLR_INT16 1
+#define LLR_INT8 2
+
+#define LLR_INT16_LIM 32767
+#define LLR_INT8_LIM 127
+
+/* llr_quant_<suffix>(x) rounds and saturates x, llr_sadd_<suffix>(a, b)
+ * is the saturated sum of a and b */
+#define LLR_QUANT_DEFINE(suffix, T, LIM) \
+static T llr_quant_##suffix(double x) { \
+  if (x >= (double)(LIM)) \
+    return (T)(LIM); \
+  if (x <= -(double)(LIM)) \
+    return (T)(-(LIM)); \
+  return (T)lrint(x); \
+} \
+\
+static T llr_sadd_##suffix(T a, T b) { \
+  int s = (int)a + (int)b; \
+  return (T)((s > (LIM)) ? (LIM) : ((s < -(LIM)) ? -(LIM) : s)); \
+}
+
+LLR_QUANT_DEFINE(i16, int16_t, LLR_INT16_LIM)
+LLR_QUANT_DEFINE(i8, int8_t, LLR_INT8_LIM)
+
+#endif
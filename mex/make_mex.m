@@ -1,8 +1,21 @@
 mex crc_calc_mex.c              
 mex fading_channel_zheng_mex.c  
 mex gold31seq_mex.c             
-mex -largeArrayDims ldpc_decode_spa_mex.c       
+if isunix
+  mex -largeArrayDims ldpc_decode_spa_mex.c -lpthread
+  mex ldpc_decode_layered_mex.c -lpthread
+else
+  mex -largeArrayDims ldpc_decode_spa_mex.c
+  mex ldpc_decode_layered_mex.c
+end
+mex ldpc_encode_nr_mex.c
+mex mimo_equalizer_mex.c
 mex modulation_demapper_soft_mex.c
 mex modulation_mapper_mex.c
 mex nr_38_212_circbuff_deinterleave_mex.c
-mex nr_38_212_circbuff_interleave_mex.c
\ No newline at end of file
+mex nr_38_212_circbuff_interleave_mex.c
+mex nr_38_212_code_block_desegmentation_ldpc_mex.c
+mex nr_ofdma_demodulator_mex.c
+mex nr_ofdma_modulator_mex.c
+mex nr_sch_rx_backend_mex.c
+mex tapped_delay_line_mex.c
\ No newline at end of file
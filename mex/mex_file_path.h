@@ -0,0 +1,44 @@
+/* Path of a file in the directory of the running mex function, resolved by
+ * which(mexFunctionName()) through the interpreter.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef MEX_FILE_PATH_H
+#define MEX_FILE_PATH_H
+
+#include <string.h>
+#include "mex.h"
+
+/* writes the path of file name next to the mex file to path of len bytes,
+ * returns 0 if the directory cannot be resolved or the path does not fit */
+static int mex_file_path(const char* name, char* path, size_t len) {
+  mxArray* in;
+  mxArray* out = NULL;
+  char* file;
+  size_t n;
+  int ok = 0;
+
+  in = mxCreateString(mexFunctionName());
+  if (mexCallMATLAB(1, &out, 1, &in, "which") == 0 && out != NULL) {
+    file = mxArrayToString(out);
+    if (file != NULL) {
+      /* keep the directory with its trailing separator */
+      n = strlen(file);
+      while (n > 0 && file[n-1] != '/' && file[n-1] != '\\')
+        n--;
+      if (n > 0 && n + strlen(name) < len) {
+        memcpy(path, file, n);
+        strcpy(path + n, name);
+        ok = 1;
+      }
+      mxFree(file);
+    }
+    mxDestroyArray(out);
+  }
+  mxDestroyArray(in);
+
+  return ok;
+}
+
+#endif
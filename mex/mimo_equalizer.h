@@ -0,0 +1,360 @@
+/* Linear MIMO equalizer core shared by mimo_equalizer_mex.c and native code.
+ *
+ * REs are processed in blocks, each step of the Gram matrix calculation,
+ * the Cholesky factorization and the triangular solves is a loop over the
+ * REs of a block, which is vectorized by the compiler. 2 x 2 systems are
+ * solved in closed form. Noise and interference covariance is handled by
+ * whitening with the inverse of its lower Cholesky factor (see
+ * whitening_matrix), after which the noise variance is 1.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef MIMO_EQUALIZER_H
+#define MIMO_EQUALIZER_H
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define EQ_MAX_LAYER 4
+#define EQ_MAX_RX 8
+#define EQ_BLOCK 64
+
+#define EQ_ZF 0
+#define EQ_MMSE 1
+
+typedef struct {
+  size_t N, N_layer, N_rx;
+  /* y, H, x and n0 are float arrays if set, double otherwise; processing
+   * is in double precision in both cases */
+  int single;
+  const void* y_re;
+  const void* y_im;
+  const void* H_re;
+  const void* H_im;
+  /* noise variance, regularises MMSE and scales the post-equalisation
+   * noise variance n0 of both methods, 1 if W is set */
+  double sigma2;
+  /* inverse of the lower Cholesky factor of the noise covariance, NULL if white */
+  const double* W_re;
+  const double* W_im;
+  int method;
+  void* x_re;
+  void* x_im;
+  void* n0;
+} eq_t;
+
+typedef struct {
+  double h_re[EQ_MAX_LAYER][EQ_MAX_RX][EQ_BLOCK];
+  double h_im[EQ_MAX_LAYER][EQ_MAX_RX][EQ_BLOCK];
+  double y_re[EQ_MAX_RX][EQ_BLOCK];
+  double y_im[EQ_MAX_RX][EQ_BLOCK];
+  /* Hermitian system matrix (lower triangle) and right hand side */
+  double a_re[EQ_MAX_LAYER][EQ_MAX_LAYER][EQ_BLOCK];
+  double a_im[EQ_MAX_LAYER][EQ_MAX_LAYER][EQ_BLOCK];
+  double b_re[EQ_MAX_LAYER][EQ_BLOCK];
+  double b_im[EQ_MAX_LAYER][EQ_BLOCK];
+  /* solution and diagonal of the inverted system matrix */
+  double s_re[EQ_MAX_LAYER][EQ_BLOCK];
+  double s_im[EQ_MAX_LAYER][EQ_BLOCK];
+  double s_diag[EQ_MAX_LAYER][EQ_BLOCK];
+} eq_block_t;
+
+/* copies blk values from offset off of a float or double array, zeros if
+ * the array is NULL (real input) */
+static void eq_read(double* dst, const void* src, size_t off, size_t blk, int single) {
+  size_t n;
+
+  if (src == NULL)
+    memset(dst, 0, blk * sizeof(double));
+  else if (single)
+    for (n = 0; n < blk; n++)
+      dst[n] = (double) ((const float*) src)[off + n];
+  else
+    memcpy(dst, (const double*) src + off, blk * sizeof(double));
+}
+
+static void eq_write(void* dst, size_t idx, double v, int single) {
+  if (single)
+    ((float*) dst)[idx] = (float) v;
+  else
+    ((double*) dst)[idx] = v;
+}
+
+/* loads a block of REs, whitening the signal if required */
+static void eq_load(const eq_t* p, size_t n0, size_t blk, eq_block_t* b) {
+  size_t l, r, k, n;
+  double re, im;
+
+  for (r = 0; r < p->N_rx; r++) {
+    eq_read(b->y_re[r], p->y_re, n0 + p->N * r, blk, p->single);
+    eq_read(b->y_im[r], p->y_im, n0 + p->N * r, blk, p->single);
+
+    for (l = 0; l < p->N_layer; l++) {
+      eq_read(b->h_re[l][r], p->H_re, n0 + p->N * (l + p->N_layer * r), blk, p->single);
+      eq_read(b->h_im[l][r], p->H_im, n0 + p->N * (l + p->N_layer * r), blk, p->single);
+    }
+  }
+
+  if (p->W_re == NULL)
+    return;
+
+  /* W is lower triangular, rows are updated bottom-up in place */
+  for (r = p->N_rx; r-- > 0; ) {
+    for (n = 0; n < blk; n++) {
+      re = 0.0;
+      im = 0.0;
+      for (k = 0; k <= r; k++) {
+        re += p->W_re[r + p->N_rx*k] * b->y_re[k][n] - p->W_im[r + p->N_rx*k] * b->y_im[k][n];
+        im += p->W_re[r + p->N_rx*k] * b->y_im[k][n] + p->W_im[r + p->N_rx*k] * b->y_re[k][n];
+      }
+      b->y_re[r][n] = re;
+      b->y_im[r][n] = im;
+    }
+    for (l = 0; l < p->N_layer; l++) {
+      for (n = 0; n < blk; n++) {
+        re = 0.0;
+        im = 0.0;
+        for (k = 0; k <= r; k++) {
+          re += p->W_re[r + p->N_rx*k] * b->h_re[l][k][n] - p->W_im[r + p->N_rx*k] * b->h_im[l][k][n];
+          im += p->W_re[r + p->N_rx*k] * b->h_im[l][k][n] + p->W_im[r + p->N_rx*k] * b->h_re[l][k][n];
+        }
+        b->h_re[l][r][n] = re;
+        b->h_im[l][r][n] = im;
+      }
+    }
+  }
+}
+
+/* A = H^H H + reg * I (lower triangle), b = H^H y */
+static void eq_gram(const eq_t* p, size_t blk, double reg, eq_block_t* b) {
+  size_t i, j, r, n, L = p->N_layer;
+
+  for (i = 0; i < L; i++) {
+    for (j = 0; j <= i; j++) {
+      for (n = 0; n < blk; n++) {
+        b->a_re[i][j][n] = (i == j) ? reg : 0.0;
+        b->a_im[i][j][n] = 0.0;
+      }
+      for (r = 0; r < p->N_rx; r++) {
+        for (n = 0; n < blk; n++) {
+          /* A(i,j) += conj(h_i) h_j */
+          b->a_re[i][j][n] += b->h_re[i][r][n] * b->h_re[j][r][n] + b->h_im[i][r][n] * b->h_im[j][r][n];
+          b->a_im[i][j][n] += b->h_re[i][r][n] * b->h_im[j][r][n] - b->h_im[i][r][n] * b->h_re[j][r][n];
+        }
+      }
+    }
+
+    for (n = 0; n < blk; n++) {
+      b->b_re[i][n] = 0.0;
+      b->b_im[i][n] = 0.0;
+    }
+    for (r = 0; r < p->N_rx; r++) {
+      for (n = 0; n < blk; n++) {
+        b->b_re[i][n] += b->h_re[i][r][n] * b->y_re[r][n] + b->h_im[i][r][n] * b->y_im[r][n];
+        b->b_im[i][n] += b->h_re[i][r][n] * b->y_im[r][n] - b->h_im[i][r][n] * b->y_re[r][n];
+      }
+    }
+  }
+}
+
+/* closed-form inverse of Hermitian 2 x 2 matrices [a c'; c d] */
+static void eq_solve_2x2(size_t blk, eq_block_t* b) {
+  size_t n;
+  double a, d, c_re, c_im, det_inv;
+
+  for (n = 0; n < blk; n++) {
+    a = b->a_re[0][0][n];
+    d = b->a_re[1][1][n];
+    c_re = b->a_re[1][0][n];
+    c_im = b->a_im[1][0][n];
+    det_inv = 1.0 / (a * d - c_re * c_re - c_im * c_im);
+
+    b->s_diag[0][n] = d * det_inv;
+    b->s_diag[1][n] = a * det_inv;
+
+    /* inverse is [d -c'; -c a] / det */
+    b->s_re[0][n] = (d * b->b_re[0][n] - (c_re * b->b_re[1][n] + c_im * b->b_im[1][n])) * det_inv;
+    b->s_im[0][n] = (d * b->b_im[0][n] - (c_re * b->b_im[1][n] - c_im * b->b_re[1][n])) * det_inv;
+    b->s_re[1][n] = (a * b->b_re[1][n] - (c_re * b->b_re[0][n] - c_im * b->b_im[0][n])) * det_inv;
+    b->s_im[1][n] = (a * b->b_im[1][n] - (c_re * b->b_im[0][n] + c_im * b->b_re[0][n])) * det_inv;
+  }
+}
+
+/* Cholesky factorization A = L L^H, inversion of L and solution
+ * s = L^-H L^-1 b, diag(A^-1) = column norms of L^-1 */
+static void eq_solve_cholesky(size_t L, size_t blk, eq_block_t* b) {
+  double l_re[EQ_MAX_LAYER][EQ_MAX_LAYER][EQ_BLOCK];
+  double l_im[EQ_MAX_LAYER][EQ_MAX_LAYER][EQ_BLOCK];
+  double d_inv[EQ_MAX_LAYER][EQ_BLOCK];
+  double z_re[EQ_MAX_LAYER][EQ_BLOCK];
+  double z_im[EQ_MAX_LAYER][EQ_BLOCK];
+  double re, im;
+  size_t i, j, k, n;
+
+  /* factorization, L(i,j) for i > j, 1/L(j,j) in d_inv */
+  for (j = 0; j < L; j++) {
+    for (n = 0; n < blk; n++) {
+      re = b->a_re[j][j][n];
+      for (k = 0; k < j; k++)
+        re -= l_re[j][k][n] * l_re[j][k][n] + l_im[j][k][n] * l_im[j][k][n];
+      d_inv[j][n] = 1.0 / sqrt(re);
+    }
+    for (i = j + 1; i < L; i++) {
+      for (n = 0; n < blk; n++) {
+        re = b->a_re[i][j][n];
+        im = b->a_im[i][j][n];
+        for (k = 0; k < j; k++) {
+          re -= l_re[i][k][n] * l_re[j][k][n] + l_im[i][k][n] * l_im[j][k][n];
+          im -= l_im[i][k][n] * l_re[j][k][n] - l_re[i][k][n] * l_im[j][k][n];
+        }
+        l_re[i][j][n] = re * d_inv[j][n];
+        l_im[i][j][n] = im * d_inv[j][n];
+      }
+    }
+  }
+
+  /* inverse of L overwrites L column by column: Linv(j,j) = d_inv(j),
+   * Linv(i,j) = -d_inv(i) * sum_{k=j..i-1} L(i,k) Linv(k,j) */
+  for (j = 0; j < L; j++) {
+    for (i = j + 1; i < L; i++) {
+      for (n = 0; n < blk; n++) {
+        re = l_re[i][j][n] * d_inv[j][n];
+        im = l_im[i][j][n] * d_inv[j][n];
+        for (k = j + 1; k < i; k++) {
+          re += l_re[i][k][n] * l_re[k][j][n] - l_im[i][k][n] * l_im[k][j][n];
+          im += l_re[i][k][n] * l_im[k][j][n] + l_im[i][k][n] * l_re[k][j][n];
+        }
+        l_re[i][j][n] = -re * d_inv[i][n];
+        l_im[i][j][n] = -im * d_inv[i][n];
+      }
+    }
+  }
+
+  /* z = Linv b */
+  for (i = 0; i < L; i++) {
+    for (n = 0; n < blk; n++) {
+      z_re[i][n] = d_inv[i][n] * b->b_re[i][n];
+      z_im[i][n] = d_inv[i][n] * b->b_im[i][n];
+    }
+    for (k = 0; k < i; k++) {
+      for (n = 0; n < blk; n++) {
+        z_re[i][n] += l_re[i][k][n] * b->b_re[k][n] - l_im[i][k][n] * b->b_im[k][n];
+        z_im[i][n] += l_re[i][k][n] * b->b_im[k][n] + l_im[i][k][n] * b->b_re[k][n];
+      }
+    }
+  }
+
+  /* s = Linv^H z, diag(A^-1)(k) = sum_{i>=k} |Linv(i,k)|^2 */
+  for (k = 0; k < L; k++) {
+    for (n = 0; n < blk; n++) {
+      b->s_re[k][n] = d_inv[k][n] * z_re[k][n];
+      b->s_im[k][n] = d_inv[k][n] * z_im[k][n];
+      b->s_diag[k][n] = d_inv[k][n] * d_inv[k][n];
+    }
+    for (i = k + 1; i < L; i++) {
+      for (n = 0; n < blk; n++) {
+        b->s_re[k][n] += l_re[i][k][n] * z_re[i][n] + l_im[i][k][n] * z_im[i][n];
+        b->s_im[k][n] += l_re[i][k][n] * z_im[i][n] - l_im[i][k][n] * z_re[i][n];
+        b->s_diag[k][n] += l_re[i][k][n] * l_re[i][k][n] + l_im[i][k][n] * l_im[i][k][n];
+      }
+    }
+  }
+}
+
+/* equalizes all REs, returns zero if out of memory */
+static int mimo_equalizer(const eq_t* p) {
+  eq_block_t* b;
+  size_t n0, blk, k, n, idx;
+  double beta;
+
+  b = (eq_block_t*) malloc(sizeof(eq_block_t));
+  if (b == NULL)
+    return 0;
+
+  for (n0 = 0; n0 < p->N; n0 += blk) {
+    blk = (p->N - n0 < EQ_BLOCK) ? p->N - n0 : EQ_BLOCK;
+
+    eq_load(p, n0, blk, b);
+    eq_gram(p, blk, (p->method == EQ_MMSE) ? p->sigma2 : 0.0, b);
+
+    if (p->N_layer == 2)
+      eq_solve_2x2(blk, b);
+    else
+      eq_solve_cholesky(p->N_layer, blk, b);
+
+    for (k = 0; k < p->N_layer; k++) {
+      for (n = 0; n < blk; n++) {
+        idx = n0 + n + p->N * k;
+        if (p->method == EQ_MMSE) {
+          /* MMSE estimate is biased by 1 - sigma2 * diag(A^-1) */
+          beta = 1.0 - p->sigma2 * b->s_diag[k][n];
+          if (beta < 1e-12)
+            beta = 1e-12;
+          eq_write(p->x_re, idx, b->s_re[k][n] / beta, p->single);
+          eq_write(p->x_im, idx, b->s_im[k][n] / beta, p->single);
+          eq_write(p->n0, idx, p->sigma2 * b->s_diag[k][n] / beta, p->single);
+        } else {
+          eq_write(p->x_re, idx, b->s_re[k][n], p->single);
+          eq_write(p->x_im, idx, b->s_im[k][n], p->single);
+          eq_write(p->n0, idx, p->sigma2 * b->s_diag[k][n], p->single);
+        }
+      }
+    }
+  }
+
+  free(b);
+  return 1;
+}
+
+/* inverse of the lower Cholesky factor of Hermitian matrix R (column major) */
+static int whitening_matrix(const double* R_re, const double* R_im, size_t M, double* W_re, double* W_im) {
+  double L_re[EQ_MAX_RX*EQ_MAX_RX], L_im[EQ_MAX_RX*EQ_MAX_RX];
+  double re, im;
+  size_t i, j, k;
+
+  memset(L_re, 0, sizeof(L_re));
+  memset(L_im, 0, sizeof(L_im));
+
+  for (j = 0; j < M; j++) {
+    re = R_re[j + M*j];
+    for (k = 0; k < j; k++)
+      re -= L_re[j + M*k] * L_re[j + M*k] + L_im[j + M*k] * L_im[j + M*k];
+    if (re <= 0.0)
+      return 0;
+    L_re[j + M*j] = sqrt(re);
+
+    for (i = j + 1; i < M; i++) {
+      re = R_re[i + M*j];
+      im = (R_im != NULL) ? R_im[i + M*j] : 0.0;
+      for (k = 0; k < j; k++) {
+        re -= L_re[i + M*k] * L_re[j + M*k] + L_im[i + M*k] * L_im[j + M*k];
+        im -= L_im[i + M*k] * L_re[j + M*k] - L_re[i + M*k] * L_im[j + M*k];
+      }
+      L_re[i + M*j] = re / L_re[j + M*j];
+      L_im[i + M*j] = im / L_re[j + M*j];
+    }
+  }
+
+  /* forward substitution column by column */
+  memset(W_re, 0, M * M * sizeof(double));
+  memset(W_im, 0, M * M * sizeof(double));
+  for (j = 0; j < M; j++) {
+    W_re[j + M*j] = 1.0 / L_re[j + M*j];
+    for (i = j + 1; i < M; i++) {
+      re = 0.0;
+      im = 0.0;
+      for (k = j; k < i; k++) {
+        re += L_re[i + M*k] * W_re[k + M*j] - L_im[i + M*k] * W_im[k + M*j];
+        im += L_re[i + M*k] * W_im[k + M*j] + L_im[i + M*k] * W_re[k + M*j];
+      }
+      W_re[i + M*j] = -re / L_re[i + M*i];
+      W_im[i + M*j] = -im / L_re[i + M*i];
+    }
+  }
+
+  return 1;
+}
+
+#endif
@@ -0,0 +1,110 @@
+/* [x, N0_eq] = mimo_equalizer_mex(y, H, N0, method)
+ *
+ * Matlab MEX acceleration for mimo_equalizer function.
+ *
+ * Linear MIMO equalizer of N_layer streams received with N_rx antennas.
+ * Inputs are the received RE grid y of size [N_re,N_sym,N_rx] and the
+ * channel estimate H of size [N_re,N_sym,N_layer,N_rx]. N0 is either the
+ * noise variance (scalar) or the N_rx x N_rx noise and interference
+ * covariance matrix, in which case the received signal is whitened first
+ * (MMSE-IRC). Methods: 'ZF' and 'MMSE'.
+ *
+ * Returns the equalized symbols x of size [N_re,N_sym,N_layer] (MMSE
+ * estimates are scaled to be unbiased) and the post-equalization noise
+ * variance N0_eq of the same size, i.e. 1/SINR per RE and layer for unit
+ * power constellations.
+ *
+ * y and H may be single precision, in which case x and N0_eq are returned as
+ * single; processing is in double precision.
+ *
+ * The computational core is in mimo_equalizer.h.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#include <string.h>
+#include "mex.h"
+#include "mimo_equalizer.h"
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+  eq_t p;
+  double W_re[EQ_MAX_RX*EQ_MAX_RX], W_im[EQ_MAX_RX*EQ_MAX_RX];
+  const mwSize* dims;
+  mwSize out_dims[3];
+  size_t N_dims;
+  char* method;
+
+  /* check for proper number of arguments */
+  if(nrhs != 4) {
+    mexErrMsgIdAndTxt("mimo_equalizer:nrhs","Four inputs required.");
+  }
+
+  if(nlhs > 2) {
+    mexErrMsgIdAndTxt("mimo_equalizer:nlhs","One or two outputs required.");
+  }
+
+  /* get the input arguments */
+  dims = mxGetDimensions(prhs[0]);
+  N_dims = mxGetNumberOfDimensions(prhs[0]);
+  out_dims[0] = dims[0];
+  out_dims[1] = (N_dims > 1) ? dims[1] : 1;
+  p.N_rx = (N_dims > 2) ? dims[2] : 1;
+  p.N = out_dims[0] * out_dims[1];
+
+  if (p.N == 0 || mxGetNumberOfElements(prhs[1]) % (p.N * p.N_rx) != 0)
+    mexErrMsgIdAndTxt("mimo_equalizer:H","H must be of size [N_re,N_sym,N_layer,N_rx].");
+  p.N_layer = mxGetNumberOfElements(prhs[1]) / (p.N * p.N_rx);
+
+  if (p.N_layer < 1 || p.N_layer > EQ_MAX_LAYER || p.N_rx > EQ_MAX_RX)
+    mexErrMsgIdAndTxt("mimo_equalizer:N_layer","Up to 4 layers and 8 receive antennas supported.");
+
+  if (p.N_layer > p.N_rx)
+    mexErrMsgIdAndTxt("mimo_equalizer:N_layer","Number of layers must not exceed number of receive antennas.");
+
+  method = mxArrayToString(prhs[3]);
+  if (method != NULL && strcmp(method, "ZF") == 0)
+    p.method = EQ_ZF;
+  else if (method != NULL && strcmp(method, "MMSE") == 0)
+    p.method = EQ_MMSE;
+  else
+    p.method = -1;
+  mxFree(method);
+  if (p.method < 0)
+    mexErrMsgIdAndTxt("mimo_equalizer:method","Equalizer algorithm not supported (ZF or MMSE).");
+
+  p.W_re = NULL;
+  p.W_im = NULL;
+  p.sigma2 = 0.0;
+  if (mxGetNumberOfElements(prhs[2]) == 1) {
+    p.sigma2 = mxGetScalar(prhs[2]);
+  } else if (mxGetM(prhs[2]) == p.N_rx && mxGetN(prhs[2]) == p.N_rx) {
+    if (!whitening_matrix(mxGetPr(prhs[2]), mxGetPi(prhs[2]), p.N_rx, W_re, W_im))
+      mexErrMsgIdAndTxt("mimo_equalizer:N0","Noise covariance matrix is not positive definite.");
+    p.W_re = W_re;
+    p.W_im = W_im;
+    p.sigma2 = 1.0;
+  } else {
+    mexErrMsgIdAndTxt("mimo_equalizer:N0","N0 must be a scalar or N_rx x N_rx covariance matrix.");
+  }
+
+  p.single = mxIsSingle(prhs[0]);
+  if (!(p.single || mxIsDouble(prhs[0])) || mxIsSingle(prhs[1]) != p.single)
+    mexErrMsgIdAndTxt("mimo_equalizer:class","y and H must be both double or both single.");
+
+  p.y_re = mxGetData(prhs[0]);
+  p.y_im = mxGetImagData(prhs[0]);
+  p.H_re = mxGetData(prhs[1]);
+  p.H_im = mxGetImagData(prhs[1]);
+
+  /* create the output matrices */
+  out_dims[2] = (mwSize) p.N_layer;
+  plhs[0] = mxCreateNumericArray(3, out_dims, p.single ? mxSINGLE_CLASS : mxDOUBLE_CLASS, mxCOMPLEX);
+  plhs[1] = mxCreateNumericArray(3, out_dims, p.single ? mxSINGLE_CLASS : mxDOUBLE_CLASS, mxREAL);
+  p.x_re = mxGetData(plhs[0]);
+  p.x_im = mxGetImagData(plhs[0]);
+  p.n0 = mxGetData(plhs[1]);
+
+  /* call the computational routine */
+  if (!mimo_equalizer(&p))
+    mexErrMsgIdAndTxt("mimo_equalizer:memory","Out of memory.");
+}
@@ -1,78 +1,20 @@
 /* x = modulation_demapper_soft_mex(iq, ord, method, N0, A, S0-1, S1-1)
+ * x = modulation_demapper_soft_mex(iq, ord, 'Approx LLR PAM', N0)
  *
  * Matlab MEX acceleration for modulation_demapper_soft function.
  *
+ * 'Approx LLR PAM' yields the same max-log LLRs as 'Approx LLR' in O(Q_m) per
+ * symbol and without alphabet tables (see demapper_pam.h), iq and N0 may be
+ * single precision for this method (LLRs are double). The other methods
+ * search the alphabet given by A, S0 and S1 (see demapper_alphabet.h).
+ *
  * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
  */
 
 #include "mex.h"
 #include <string.h>
-#include <math.h>
-
-#define POW2(X) ((X)*(X))
-
-void demapprt_true_llr(double* iq_re, double* iq_im, size_t iq_size, int ord, double* N0, double* A_re, double* A_im, double* S0, double* S1, double* llr) {
-  int i, q, a, s_idx;
-  double P0, P1, P0_metric, P1_metric;
-  int alphabet_size = (1<<ord);
-
-  for (i = 0; i < iq_size; i++) {
-    for (q = 0; q < ord; q++) {
-      P0 = 0.0;
-      P1 = 0.0;
-      for (a = 0; a < alphabet_size / 2; a++) {
-        s_idx = q + a*ord;
-        P0_metric = POW2(iq_re[i] - A_re[(int)S0[s_idx]]) + POW2(iq_im[i] - A_im[(int)S0[s_idx]]);
-        P1_metric = POW2(iq_re[i] - A_re[(int)S1[s_idx]]) + POW2(iq_im[i] - A_im[(int)S1[s_idx]]);
-        P0 += exp(-1.0 * P0_metric / N0[i]);
-        P1 += exp(-1.0 * P1_metric / N0[i]);
-      }
-      llr[(i+1)*ord-q-1] = log(P0) - log(P1);
-    }
-  }
-}
-
-void demapprt_approx_llr(double* iq_re, double* iq_im, size_t iq_size, int ord, double* N0, double* A_re, double* A_im, double* S0, double* S1, double* llr) {
-  int i, q, a, s_idx;
-  double d0, d1, v;
-  int alphabet_size = (1<<ord);
-
-  for (i = 0; i < iq_size; i++) {
-    for (q = 0; q < ord; q++) {
-      d0 = 9999999.0;
-      d1 = 9999999.0;
-      for (a = 0; a < alphabet_size / 2; a++) {
-        s_idx = q + a*ord;
-        v = POW2(iq_re[i] - A_re[(int)S0[s_idx]]) + POW2(iq_im[i] - A_im[(int)S0[s_idx]]);
-        d0 = d0 < v ? d0 : v;
-        v = POW2(iq_re[i] - A_re[(int)S1[s_idx]]) + POW2(iq_im[i] - A_im[(int)S1[s_idx]]);
-        d1 = d1 < v ? d1 : v;
-      }
-      llr[(i+1)*ord-q-1] = -1.0 * (d0 - d1) / N0[i];
-    }
-  }
-}
-
-void demapprt_hard(double* iq_re, double* iq_im, size_t iq_size, int ord, double* N0, double* A_re, double* A_im, double* S0, double* S1, double* llr) {
-  int i, q, a, s_idx;
-  double d0, d1, v;
-  int alphabet_size = (1<<ord);
-
-  for (i = 0; i < iq_size; i++) {
-    for (q = 0; q < ord; q++) {
-      d0 = 9999999.0;
-      d1 = 9999999.0;
-      for (a = 0; a < alphabet_size / 2; a++) {
-        s_idx = q + a*ord;
-        v = POW2(iq_re[i] - A_re[(int)S0[s_idx]]) + POW2(iq_im[i] - A_im[(int)S0[s_idx]]);
-        d0 = d0 < v ? d0 : v;
-        v = POW2(iq_re[i] - A_re[(int)S1[s_idx]]) + POW2(iq_im[i] - A_im[(int)S1[s_idx]]);
-        d1 = d1 < v ? d1 : v;
-      }
-      llr[(i+1)*ord-q-1] = (d0 > d1) ? (-1.0 / N0[i]) : (1.0 / N0[i]);
-    }
-  }
-}
+#include "demapper_pam.h"
+#include "demapper_alphabet.h"
 
 void modulation_demapper_soft(double* iq_re, double* iq_im, size_t iq_size, int ord, char* method, double* N0, double* A_re, double* A_im, double* S0, double* S1, double* llr) {
   if (strcmp(method,"True LLR") == 0)
@@ -93,18 +35,19 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
   char* method;
   double* N0;
   size_t N0_size;
+  int pam, single;
 
-  double* A_re;
-  double* A_im;
-  double* S0;
-  double* S1;
+  double* A_re = NULL;
+  double* A_im = NULL;
+  double* S0 = NULL;
+  double* S1 = NULL;
 
   size_t llr_size;
   double* llr;
 
   /* check for proper number of arguments */
-  if(nrhs != 7) {
-    mexErrMsgIdAndTxt("modulation_demapper_soft:nrhs","Seven inputs required.");
+  if(nrhs != 7 && nrhs != 4) {
+    mexErrMsgIdAndTxt("modulation_demapper_soft:nrhs","Seven or four inputs required.");
   }
 
   if(nlhs != 1) {
@@ -113,20 +56,36 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
   /* get the input arguments */
   iq_size = mxGetM(prhs[0]) * mxGetN(prhs[0]);
-  iq_re = mxGetPr(prhs[0]);
-  iq_im = mxGetPi(prhs[0]);
+  single = mxIsSingle(prhs[0]);
+  iq_re = mxGetData(prhs[0]);
+  iq_im = mxGetImagData(prhs[0]);
 
   ord = (int) mxGetScalar(prhs[1]);
 
   method = mxArrayToString(prhs[2]);
+  pam = (strcmp(method,"Approx LLR PAM") == 0);
+
+  N0 = mxGetData(prhs[3]);
+  N0_size = mxGetM(prhs[3]) * mxGetN(prhs[3]);
+
+  if (pam) {
+    if (ord != 1 && ord != 2 && ord != 4 && ord != 6 && ord != 8 && ord != 10)
+      mexErrMsgIdAndTxt("modulation_demapper_soft:ord","Modulation order not supported");
+    if (N0_size != iq_size && N0_size != 1)
+      mexErrMsgIdAndTxt("modulation_demapper_soft:N0","N0 must be a scalar or match the size of iq");
+    if (mxIsSingle(prhs[3]) != single)
+      mexErrMsgIdAndTxt("modulation_demapper_soft:N0","iq and N0 must be both double or both single");
+  } else if (single) {
+    mexErrMsgIdAndTxt("modulation_demapper_soft:iq","Single precision input supported only by Approx LLR PAM");
+  } else if (nrhs != 7) {
+    mexErrMsgIdAndTxt("modulation_demapper_soft:nrhs","Seven inputs required.");
+  } else {
+    A_re = mxGetPr(prhs[4]);
+    A_im = mxGetPi(prhs[4]);
 
-  N0 = mxGetPr(prhs[3]);
-
-  A_re = mxGetPr(prhs[4]);
-  A_im = mxGetPi(prhs[4]);
-
-  S0 = mxGetPr(prhs[5]);
-  S1 = mxGetPr(prhs[6]);
+    S0 = mxGetPr(prhs[5]);
+    S1 = mxGetPr(prhs[6]);
+  }
 
   /* create the output matrix */
   llr_size = iq_size * ord;
@@ -136,5 +95,12 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
   llr = mxGetPr(plhs[0]);
 
   /* call the computational routine */
-  modulation_demapper_soft(iq_re, iq_im, iq_size, ord, method, N0, A_re, A_im, S0, S1, llr);
+  if (pam && single)
+    demapprt_approx_llr_pam_f32((const float*) iq_re, (const float*) iq_im, iq_size, ord, (const float*) N0, N0_size, llr);
+  else if (pam)
+    demapprt_approx_llr_pam(iq_re, iq_im, iq_size, ord, N0, N0_size, llr);
+  else
+    modulation_demapper_soft(iq_re, iq_im, iq_size, ord, method, N0, A_re, A_im, S0, S1, llr);
+
+  mxFree(method);
 }
\ No newline at end of file
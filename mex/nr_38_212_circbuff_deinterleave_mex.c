@@ -1,51 +1,30 @@
-/* d = nr_38_212_circbuff_deinterleave_mex(f, N, Q_m, k_0, Fbst, Fbsz)
+/* d = nr_38_212_circbuff_deinterleave_mex(f, N, Q_m, k_0, Fbst, Fbsz, d0)
  *
  * Matlab MEX acceleration for nr_38_212_rate_unmatching_ldpc function.
+ * If d0 is given (a vector of N soft bits, e.g. a HARQ buffer), LLRs are
+ * combined on top of it instead of a zeroed circular buffer. For int16 or
+ * int8 f, d (and d0) are of the same class and combining saturates.
+ *
+ * The computational core is in circbuff.h.
  *
  * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
  */
 
-#include <stdlib.h>
+#include <string.h>
 #include "mex.h"
-
-void circbuff_deinterleave(double* bits_f, size_t bits_f_len, double* bits_d, size_t bits_d_len, int Q_m, int k_0, int Fbst, int Fbsz) {
-  double* bits_e;
-  int i, j, EdQm, k_ptr;
-
-  bits_e = mxMalloc(bits_f_len * sizeof(double));
-
-  EdQm = (int) (bits_f_len / Q_m);
-
-  for (i = 0; i < EdQm; i++)
-    for (j = 0; j < Q_m; j++)
-      bits_e[j*EdQm+i] = bits_f[j+i*Q_m];
-
-  i = k_0;
-  j = 0;
-
-  for (i = 0; i < bits_f_len; i++) {
-    k_ptr = (k_0 + i) % bits_d_len;
-    if (k_ptr == Fbst) {
-      i += Fbsz - 1;
-    } else {
-      bits_d[k_ptr] += bits_e[j];
-      j++;
-    }
-  }
-
-  mxFree(bits_e);
-}
+#include "circbuff.h"
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
-  double* bits_f;
+  void* bits_f;
   size_t bits_f_len;
-  double* bits_d;
+  void* bits_d;
   size_t bits_d_len;
   int Q_m, k_0, Fbst, Fbsz;
+  mxClassID class_id;
 
   /* check for proper number of arguments */
-  if(nrhs != 6) {
-    mexErrMsgIdAndTxt("nr_38_212_circbuff_interleave:nrhs","Six inputs required.");
+  if(nrhs != 6 && nrhs != 7) {
+    mexErrMsgIdAndTxt("nr_38_212_circbuff_interleave:nrhs","Six or seven inputs required.");
   }
 
   if(nlhs != 1) {
@@ -54,7 +33,10 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
 
   /* get the input arguments */
   bits_f_len = mxGetM(prhs[0]) * mxGetN(prhs[0]);
-  bits_f = mxGetPr(prhs[0]);
+  bits_f = mxGetData(prhs[0]);
+  class_id = mxGetClassID(prhs[0]);
+  if (class_id != mxDOUBLE_CLASS && class_id != mxINT16_CLASS && class_id != mxINT8_CLASS)
+    mexErrMsgIdAndTxt("nr_38_212_circbuff_interleave:f","f must be double, int16 or int8.");
   bits_d_len = (int) mxGetScalar(prhs[1]);
   Q_m = (int) mxGetScalar(prhs[2]);
   k_0 = (int) mxGetScalar(prhs[3]);
@@ -62,11 +44,22 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
   Fbsz = (int) mxGetScalar(prhs[5]);
 
   /* create the output matrix */
-  plhs[0] = mxCreateDoubleMatrix(1, (mwSize)bits_d_len, mxREAL);
+  plhs[0] = mxCreateNumericMatrix(1, (mwSize)bits_d_len, class_id, mxREAL);
 
   /* get a pointer to the real data in the output matrix */
-  bits_d = mxGetPr(plhs[0]);
+  bits_d = mxGetData(plhs[0]);
+
+  if (nrhs > 6 && !mxIsEmpty(prhs[6])) {
+    if (mxGetM(prhs[6]) * mxGetN(prhs[6]) != bits_d_len || mxGetClassID(prhs[6]) != class_id)
+      mexErrMsgIdAndTxt("nr_38_212_circbuff_interleave:d0","d0 must be a vector of length N of the class of f.");
+    memcpy(bits_d, mxGetData(prhs[6]), bits_d_len * mxGetElementSize(prhs[6]));
+  }
 
   /* call the computational routine */
-  circbuff_deinterleave(bits_f, bits_f_len, bits_d, bits_d_len, Q_m, k_0, Fbst, Fbsz);
+  if (class_id == mxINT16_CLASS)
+    circbuff_deinterleave_i16(bits_f, bits_f_len, bits_d, bits_d_len, Q_m, k_0, Fbst, Fbsz);
+  else if (class_id == mxINT8_CLASS)
+    circbuff_deinterleave_i8(bits_f, bits_f_len, bits_d, bits_d_len, Q_m, k_0, Fbst, Fbsz);
+  else
+    circbuff_deinterleave(bits_f, bits_f_len, bits_d, bits_d_len, Q_m, k_0, Fbst, Fbsz);
 }
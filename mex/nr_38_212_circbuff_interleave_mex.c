@@ -2,42 +2,13 @@
  *
  * Matlab MEX acceleration for nr_38_212_rate_matching_ldpc function.
  *
+ * The computational core is in circbuff.h.
+ *
  * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
  */
 
-#include <stdlib.h>
 #include "mex.h"
-
-void circbuff_interleave(double* bits_d, size_t bits_d_len, double* bits_f, size_t bits_f_len, int Q_m, int k_0) {
-  double* bits_e;
-  int i, j, EdQm;
-
-  bits_e = mxMalloc(bits_f_len * sizeof(double));
-
-  i = k_0;
-  j = 0;
-
-  while (j < bits_f_len) {
-    if (bits_d[i] != -1.0) {
-      bits_e[j] = bits_d[i];
-      j++;
-    }
-
-    if (i >= bits_d_len - 1) {
-      i = 0;
-    } else {
-      i++;
-    }
-  }
-
-  EdQm = (int) (bits_f_len / Q_m);
-
-  for (i = 0; i < EdQm; i++)
-    for (j = 0; j < Q_m; j++)
-      bits_f[j+i*Q_m] = bits_e[j*EdQm+i];
-
-  mxFree(bits_e);
-}
+#include "circbuff.h"
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
   double* bits_d;
@@ -0,0 +1,78 @@
+/* [b, cb_crc_ok, tb_crc_ok] = nr_38_212_code_block_desegmentation_ldpc_mex(c, Kp, B, cb_crc_poly, tb_crc_poly)
+ *
+ * Matlab MEX acceleration for nr_38_212_code_block_desegmentation_ldpc
+ * function.
+ *
+ * Concatenates Kp-L information bits of each codeblock (row of c) into b,
+ * checking codeblock CRCs (cb_crc_poly, empty for a single codeblock) and
+ * the transport block CRC attached to the last bits of b (tb_crc_poly) in
+ * a single pass over the decoded bits (see cb_desegmentation.h). c may be
+ * a double or uint8 matrix.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#include "mex.h"
+#include "cb_desegmentation.h"
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+  void* c;
+  size_t C, K, Kp, B, L, L_tb;
+  double* b;
+  double* cb_crc_ok;
+  nr_crc_t* cb_crc = NULL;
+  nr_crc_t* tb_crc;
+  int tb_ok;
+
+  /* check for proper number of arguments */
+  if(nrhs != 5) {
+    mexErrMsgIdAndTxt("nr_38_212_code_block_desegmentation_ldpc:nrhs","Five inputs required.");
+  }
+
+  if(nlhs > 3) {
+    mexErrMsgIdAndTxt("nr_38_212_code_block_desegmentation_ldpc:nlhs","At most three outputs required.");
+  }
+
+  /* get the input arguments */
+  C = mxGetM(prhs[0]);
+  K = mxGetN(prhs[0]);
+  c = mxGetData(prhs[0]);
+  if (!mxIsDouble(prhs[0]) && !mxIsUint8(prhs[0]))
+    mexErrMsgIdAndTxt("nr_38_212_code_block_desegmentation_ldpc:c","c must be a double or uint8 matrix.");
+  Kp = (size_t) mxGetScalar(prhs[1]);
+  B = (size_t) mxGetScalar(prhs[2]);
+
+  tb_crc = (nr_crc_t*) mxMalloc(sizeof(nr_crc_t));
+  if (!nr_crc_init(tb_crc, mxGetPr(prhs[4]), mxGetM(prhs[4]) * mxGetN(prhs[4])))
+    mexErrMsgIdAndTxt("nr_38_212_code_block_desegmentation_ldpc:poly","Invalid transport block CRC polynomial.");
+  L_tb = (size_t) tb_crc->len;
+
+  L = 0;
+  if (mxGetM(prhs[3]) * mxGetN(prhs[3]) > 0) {
+    cb_crc = (nr_crc_t*) mxMalloc(sizeof(nr_crc_t));
+    if (!nr_crc_init(cb_crc, mxGetPr(prhs[3]), mxGetM(prhs[3]) * mxGetN(prhs[3])))
+      mexErrMsgIdAndTxt("nr_38_212_code_block_desegmentation_ldpc:poly","Invalid codeblock CRC polynomial.");
+    L = (size_t) cb_crc->len;
+  }
+
+  if (Kp > K || Kp < L || C * (Kp - L) != B || B < L_tb)
+    mexErrMsgIdAndTxt("nr_38_212_code_block_desegmentation_ldpc:size","Codeblock dimensions do not match the transport block size.");
+
+  /* create the output matrix */
+  plhs[0] = mxCreateDoubleMatrix(1, (mwSize)B, mxREAL);
+  b = mxGetPr(plhs[0]);
+
+  plhs[1] = mxCreateDoubleMatrix(1, (mwSize)C, mxREAL);
+  cb_crc_ok = mxGetPr(plhs[1]);
+
+  /* call the computational routine */
+  if (mxIsUint8(prhs[0]))
+    tb_ok = code_block_desegmentation_u8(c, C, Kp, B, cb_crc, tb_crc, b, cb_crc_ok);
+  else
+    tb_ok = code_block_desegmentation(c, C, Kp, B, cb_crc, tb_crc, b, cb_crc_ok);
+  plhs[2] = mxCreateDoubleScalar((double) tb_ok);
+
+  mxFree(tb_crc);
+  if (cb_crc != NULL)
+    mxFree(cb_crc);
+}
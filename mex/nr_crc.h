@@ -0,0 +1,135 @@
+/* Table-driven CRC engine for 3GPP 38.212 sec. 5.1 polynomials.
+ *
+ * The register is kept left-aligned in 32 bits, so that a single code path
+ * serves CRC6 up to CRC24 (and any generator up to 32 bits). Input is
+ * consumed eight bytes at a time with slicing-by-8 tables, remaining bytes
+ * with the single byte table and the remaining bits serially.
+ *
+ * Updates are incremental: a register value returned from one update call
+ * may be passed to the next one, with bits split at arbitrary positions.
+ * Several CRCs over overlapping ranges (e.g. code block and transport block
+ * CRC) can thus be calculated in one pass over the data.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef NR_CRC_H
+#define NR_CRC_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NR_CRC_LEN_MAX 32
+
+typedef struct {
+  int len;                /* CRC length L in bits */
+  uint32_t poly;          /* generator without the D^L term, left-aligned */
+  uint32_t table[8][256]; /* slicing-by-8 tables */
+} nr_crc_t;
+
+/* Initializes the engine from a generator polynomial given as a binary
+ * vector of length L+1 with the D^L coefficient first (as used by
+ * nr_38_212_crc_calc). Returns zero if the polynomial is invalid. */
+static int nr_crc_init(nr_crc_t* crc, const double* poly, size_t poly_len) {
+  uint32_t r;
+  int i, k, n;
+
+  if (poly_len < 2 || poly_len > NR_CRC_LEN_MAX + 1 || poly[0] == 0)
+    return 0;
+
+  crc->len = (int)poly_len - 1;
+  crc->poly = 0;
+  for (n = 1; n < (int)poly_len; n++)
+    if (poly[n] != 0)
+      crc->poly |= (uint32_t)1 << (32 - n);
+
+  for (i = 0; i < 256; i++) {
+    r = (uint32_t)i << 24;
+    for (k = 0; k < 8; k++)
+      r = (r & 0x80000000u) ? (r << 1) ^ crc->poly : (r << 1);
+    crc->table[0][i] = r;
+  }
+
+  for (k = 1; k < 8; k++)
+    for (i = 0; i < 256; i++)
+      crc->table[k][i] = (crc->table[k-1][i] << 8) ^ crc->table[0][crc->table[k-1][i] >> 24];
+
+  return 1;
+}
+
+static uint32_t nr_crc_init_reg(const nr_crc_t* crc) {
+  (void)crc;
+  return 0;
+}
+
+/* processes packed bytes, most significant bit first */
+static uint32_t nr_crc_update_bytes(const nr_crc_t* crc, uint32_t reg, const uint8_t* p, size_t n) {
+  const uint32_t (*T)[256] = crc->table;
+
+  while (n >= 8) {
+    reg ^= ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+    reg = T[7][reg >> 24] ^ T[6][(reg >> 16) & 0xFF] ^ T[5][(reg >> 8) & 0xFF] ^ T[4][reg & 0xFF] ^
+          T[3][p[4]] ^ T[2][p[5]] ^ T[1][p[6]] ^ T[0][p[7]];
+    p += 8;
+    n -= 8;
+  }
+
+  while (n-- > 0)
+    reg = (reg << 8) ^ T[0][(reg >> 24) ^ *p++];
+
+  return reg;
+}
+
+/* processes single bits (non-zero value is a one) */
+static uint32_t nr_crc_update_bit(const nr_crc_t* crc, uint32_t reg, int bit) {
+  reg ^= bit ? 0x80000000u : 0;
+  return (reg & 0x80000000u) ? (reg << 1) ^ crc->poly : (reg << 1);
+}
+
+/* Processes n bits stored as doubles with a given stride (bits greater than
+ * zero are ones, so that -1 filler bits count as zeros). Bits are packed on
+ * the fly into 64-bit blocks for the slicing-by-8 loop. */
+static uint32_t nr_crc_update_bits(const nr_crc_t* crc, uint32_t reg, const double* b, size_t n, size_t stride) {
+  uint8_t buf[64];
+  size_t i, k, nb;
+
+  while (n >= 8) {
+    nb = (n / 8 < sizeof(buf)) ? n / 8 : sizeof(buf);
+    for (i = 0; i < nb; i++) {
+      uint8_t v = 0;
+      for (k = 0; k < 8; k++, b += stride)
+        v = (uint8_t)((v << 1) | (*b > 0));
+      buf[i] = v;
+    }
+    reg = nr_crc_update_bytes(crc, reg, buf, nb);
+    n -= nb * 8;
+  }
+
+  for (; n > 0; n--, b += stride)
+    reg = nr_crc_update_bit(crc, reg, *b > 0);
+
+  return reg;
+}
+
+/* returns CRC value (parity bits p(0)..p(L-1) from MSB to LSB) */
+static uint32_t nr_crc_final(const nr_crc_t* crc, uint32_t reg) {
+  return reg >> (32 - crc->len);
+}
+
+/* writes CRC value as L doubles, p(0) first */
+static void nr_crc_to_bits(const nr_crc_t* crc, uint32_t val, double* p, size_t stride) {
+  int n;
+  for (n = 0; n < crc->len; n++)
+    p[n * stride] = (double)((val >> (crc->len - 1 - n)) & 1);
+}
+
+/* compares CRC value against L parity bits stored as doubles */
+static int nr_crc_check_bits(const nr_crc_t* crc, uint32_t val, const double* p, size_t stride) {
+  int n;
+  for (n = 0; n < crc->len; n++)
+    if ((p[n * stride] > 0) != (int)((val >> (crc->len - 1 - n)) & 1))
+      return 0;
+  return 1;
+}
+
+#endif
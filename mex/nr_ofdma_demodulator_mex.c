@@ -0,0 +1,77 @@
+/* x = nr_ofdma_demodulator_mex(y, N_fft, N_sc, N_cp_first, N_cp_other, N_slot_symbol, sc_range)
+ *
+ * Matlab MEX acceleration for nr_ofdma_demodulator function.
+ *
+ * All symbols of all antennas (columns of y) are demodulated in one call.
+ * FFT plans are cached per N_fft between calls (see fft_plan_cache.h),
+ * fftshift and guardband removal are folded into output indexing. If
+ * sc_range = [k_first, k_num] is given, only subcarriers k_first ..
+ * k_first+k_num-1 (0-based) of the N_sc x N_slot_symbol x N_ant output
+ * grid are written, others are zero. The computational core is in
+ * ofdma_demodulator.h.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#include <string.h>
+#include "mex.h"
+#include "fft_plan_cache.h"
+#include "ofdma_demodulator.h"
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+  size_t N_fft, N_sc, N_cp_first, N_cp_other, N_sym, N_ant, k_first, k_num;
+  mwSize dims[3];
+  double* s;
+  const fft_radix2_t* plan;
+
+  /* check for proper number of arguments */
+  if(nrhs != 6 && nrhs != 7) {
+    mexErrMsgIdAndTxt("nr_ofdma_demodulator:nrhs","Six or seven inputs required.");
+  }
+
+  if(nlhs != 1) {
+    mexErrMsgIdAndTxt("nr_ofdma_demodulator:nlhs","One output required.");
+  }
+
+  /* get the input arguments */
+  N_fft = (size_t) mxGetScalar(prhs[1]);
+  N_sc = (size_t) mxGetScalar(prhs[2]);
+  N_cp_first = (size_t) mxGetScalar(prhs[3]);
+  N_cp_other = (size_t) mxGetScalar(prhs[4]);
+  N_sym = (size_t) mxGetScalar(prhs[5]);
+  N_ant = mxGetN(prhs[0]);
+
+  if (N_fft < 2 || (N_fft & (N_fft - 1)) != 0)
+    mexErrMsgIdAndTxt("nr_ofdma_demodulator:N_fft","N_fft must be a power of two.");
+
+  if (N_sc > N_fft || N_sc % 2 != 0)
+    mexErrMsgIdAndTxt("nr_ofdma_demodulator:N_sc","Invalid number of subcarriers.");
+
+  if (N_sym == 0 || mxGetM(prhs[0]) < N_cp_first + (N_sym - 1) * N_cp_other + N_sym * N_fft)
+    mexErrMsgIdAndTxt("nr_ofdma_demodulator:y","Input signal is shorter than a slot.");
+
+  k_first = 0;
+  k_num = N_sc;
+  if (nrhs > 6 && !mxIsEmpty(prhs[6])) {
+    if (mxGetNumberOfElements(prhs[6]) != 2)
+      mexErrMsgIdAndTxt("nr_ofdma_demodulator:sc_range","sc_range must be a two element vector.");
+    k_first = (size_t) mxGetPr(prhs[6])[0];
+    k_num = (size_t) mxGetPr(prhs[6])[1];
+    if (k_first + k_num > N_sc)
+      mexErrMsgIdAndTxt("nr_ofdma_demodulator:sc_range","Subcarrier range exceeds N_sc.");
+  }
+
+  /* create the output matrix */
+  dims[0] = (mwSize) N_sc;
+  dims[1] = (mwSize) N_sym;
+  dims[2] = (mwSize) N_ant;
+  plhs[0] = mxCreateNumericArray(3, dims, mxDOUBLE_CLASS, mxCOMPLEX);
+
+  /* call the computational routine */
+  fft_plan_cache_begin();
+  plan = fft_plan_get(N_fft);
+  s = (double*) mxMalloc(2 * N_fft * sizeof(double));
+  nr_ofdma_demodulator(mxGetPr(prhs[0]), mxGetPi(prhs[0]), mxGetM(prhs[0]), N_ant, N_fft, N_sc, N_cp_first, N_cp_other, N_sym,
+                       k_first, k_num, plan, s, s + N_fft, mxGetPr(plhs[0]), mxGetPi(plhs[0]));
+  mxFree(s);
+}
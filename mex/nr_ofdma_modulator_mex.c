@@ -0,0 +1,235 @@
+/* [y, state] = nr_ofdma_modulator_mex(x, N_fft, N_cp_first, N_cp_other, tx_filter, state)
+ *
+ * Matlab MEX acceleration for nr_ofdma_modulator function.
+ *
+ * All symbols of all antennas of the N_sc x N_slot_symbol x N_ant RE grid x
+ * are modulated in one call with FFT plans cached per size (see
+ * fft_plan_cache.h). ifftshift and guardband insertion are folded into
+ * input indexing and the cyclic prefix is copied in place.
+ *
+ * If tx_filter is not empty, the FIR filter is applied to the slot by
+ * FFT overlap-save. Without the state argument the result equals
+ * conv(y, tx_filter, 'same') of each antenna signal. With the state
+ * argument (last numel(tx_filter)-1 input samples of each antenna from the
+ * previous call, empty at the start) the filter runs in streaming mode:
+ * the output is the causal filter response, so that outputs of subsequent
+ * calls concatenate to the filtered continuous signal.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#include <string.h>
+#include "mex.h"
+#include "fft_plan_cache.h"
+
+/* OFDM modulation of one antenna, u receives N_y samples */
+void ofdma_modulate(const double* x_re, const double* x_im, size_t N_sc, size_t N_sym, size_t N_fft,
+                    size_t N_cp_first, size_t N_cp_other, const fft_radix2_t* plan, double* s_re, double* s_im,
+                    double* u_re, double* u_im) {
+  size_t l, k, i, N_cp, sidx = 0, N_guard = (N_fft - N_sc) / 2;
+  double scale = 1.0 / sqrt((double) N_fft);
+  int nonzero;
+
+  for (l = 0; l < N_sym; l++) {
+    N_cp = (l == 0) ? N_cp_first : N_cp_other;
+
+    memset(s_re, 0, N_fft * sizeof(double));
+    memset(s_im, 0, N_fft * sizeof(double));
+
+    /* subcarrier k of the grid goes to bin (N_guard + k + N_fft/2) mod N_fft */
+    nonzero = 0;
+    for (k = 0; k < N_sc; k++) {
+      i = (N_guard + k + N_fft/2) & (N_fft - 1);
+      s_re[i] = x_re[k + N_sc * l];
+      s_im[i] = (x_im != NULL) ? x_im[k + N_sc * l] : 0.0;
+      nonzero |= (s_re[i] != 0.0) || (s_im[i] != 0.0);
+    }
+
+    if (nonzero) {
+      fft_radix2(plan, s_re, s_im, 1);
+      for (i = 0; i < N_fft; i++) {
+        u_re[sidx + N_cp + i] = scale * s_re[i];
+        u_im[sidx + N_cp + i] = scale * s_im[i];
+      }
+    } else {
+      memset(u_re + sidx + N_cp, 0, N_fft * sizeof(double));
+      memset(u_im + sidx + N_cp, 0, N_fft * sizeof(double));
+    }
+
+    /* cyclic prefix */
+    memcpy(u_re + sidx, u_re + sidx + N_fft, N_cp * sizeof(double));
+    memcpy(u_im + sidx, u_im + sidx + N_fft, N_cp * sizeof(double));
+
+    sidx += N_cp + N_fft;
+  }
+}
+
+/* out[n] = sum_k h[k] * v[n + c - k], where v[i] = u[i] for 0 <= i < N_y,
+ * v[i] = st[N_h-1+i] for i < 0 and zero for i >= N_y */
+void fir_overlap_save(const double* u_re, const double* u_im, size_t N_y, const double* st_re, const double* st_im,
+                      size_t c, const double* H_re, const double* H_im, size_t N_h, const fft_radix2_t* plan,
+                      double* s_re, double* s_im, double* out_re, double* out_im) {
+  size_t n_fft = plan->n, B = n_fft - N_h + 1, n0, blk, j;
+  long idx;
+  double t_re, t_im, scale = 1.0 / (double) n_fft;
+
+  for (n0 = 0; n0 < N_y; n0 += blk) {
+    blk = (N_y - n0 < B) ? N_y - n0 : B;
+
+    /* segment v[n0 + c - (N_h-1) .. n0 + c + B - 1] */
+    for (j = 0; j < n_fft; j++) {
+      idx = (long)(n0 + c + j) - (long)(N_h - 1);
+      if (idx < 0) {
+        s_re[j] = (st_re != NULL) ? st_re[N_h - 1 + idx] : 0.0;
+        s_im[j] = (st_im != NULL) ? st_im[N_h - 1 + idx] : 0.0;
+      } else if ((size_t) idx < N_y) {
+        s_re[j] = u_re[idx];
+        s_im[j] = u_im[idx];
+      } else {
+        s_re[j] = 0.0;
+        s_im[j] = 0.0;
+      }
+    }
+
+    fft_radix2(plan, s_re, s_im, 0);
+    for (j = 0; j < n_fft; j++) {
+      t_re = s_re[j] * H_re[j] - s_im[j] * H_im[j];
+      t_im = s_re[j] * H_im[j] + s_im[j] * H_re[j];
+      s_re[j] = t_re;
+      s_im[j] = t_im;
+    }
+    fft_radix2(plan, s_re, s_im, 1);
+
+    for (j = 0; j < blk; j++) {
+      out_re[n0 + j] = scale * s_re[N_h - 1 + j];
+      out_im[n0 + j] = scale * s_im[N_h - 1 + j];
+    }
+  }
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+  size_t N_sc, N_sym, N_ant, N_fft, N_cp_first, N_cp_other, N_y, N_h, n_fft_fir, ant, i, c;
+  const mwSize* dims;
+  const double *x_re, *x_im, *h, *st_re = NULL, *st_im = NULL;
+  double *y_re, *y_im, *u, *s, *H = NULL, *st_out_re, *st_out_im;
+  const fft_radix2_t* plan;
+  const fft_radix2_t* plan_fir = NULL;
+  int streaming;
+
+  /* check for proper number of arguments */
+  if(nrhs != 5 && nrhs != 6) {
+    mexErrMsgIdAndTxt("nr_ofdma_modulator:nrhs","Five or six inputs required.");
+  }
+
+  streaming = (nrhs == 6);
+
+  if(nlhs > 1 + streaming) {
+    mexErrMsgIdAndTxt("nr_ofdma_modulator:nlhs","One output required (two in streaming mode).");
+  }
+
+  /* get the input arguments */
+  dims = mxGetDimensions(prhs[0]);
+  N_sc = dims[0];
+  N_sym = (mxGetNumberOfDimensions(prhs[0]) > 1) ? dims[1] : 1;
+  N_ant = (mxGetNumberOfDimensions(prhs[0]) > 2) ? dims[2] : 1;
+  N_fft = (size_t) mxGetScalar(prhs[1]);
+  N_cp_first = (size_t) mxGetScalar(prhs[2]);
+  N_cp_other = (size_t) mxGetScalar(prhs[3]);
+  N_h = mxGetNumberOfElements(prhs[4]);
+  h = mxGetPr(prhs[4]);
+
+  if (N_fft < 2 || (N_fft & (N_fft - 1)) != 0)
+    mexErrMsgIdAndTxt("nr_ofdma_modulator:N_fft","N_fft must be a power of two.");
+
+  if (N_sc > N_fft || N_sc % 2 != 0 || N_sym == 0)
+    mexErrMsgIdAndTxt("nr_ofdma_modulator:x","Invalid size of RE grid.");
+
+  if (N_cp_first > N_fft || N_cp_other > N_fft)
+    mexErrMsgIdAndTxt("nr_ofdma_modulator:N_cp","Cyclic prefix longer than a symbol.");
+
+  if (N_h > 0 && mxIsComplex(prhs[4]))
+    mexErrMsgIdAndTxt("nr_ofdma_modulator:tx_filter","Filter coefficients must be real.");
+
+  if (streaming && !mxIsEmpty(prhs[5])) {
+    if (mxGetM(prhs[5]) != (N_h > 0 ? N_h - 1 : 0) || mxGetN(prhs[5]) != N_ant)
+      mexErrMsgIdAndTxt("nr_ofdma_modulator:state","Filter state must be of size [numel(tx_filter)-1, N_ant].");
+    st_re = mxGetPr(prhs[5]);
+    st_im = mxGetPi(prhs[5]);
+  }
+
+  x_re = mxGetPr(prhs[0]);
+  x_im = mxGetPi(prhs[0]);
+  N_y = N_cp_first + (N_sym - 1) * N_cp_other + N_sym * N_fft;
+
+  /* create the output matrix */
+  plhs[0] = mxCreateDoubleMatrix((mwSize)N_y, (mwSize)N_ant, mxCOMPLEX);
+  y_re = mxGetPr(plhs[0]);
+  y_im = mxGetPi(plhs[0]);
+
+  /* plan_fir and plan stay valid together (see fft_plan_cache.h) */
+  fft_plan_cache_begin();
+
+  if (N_h > 0) {
+    /* overlap-save block of at least 4 filter lengths */
+    n_fft_fir = fft_radix2_len(4 * N_h);
+    plan_fir = fft_plan_get(n_fft_fir);
+
+    H = (double*) mxMalloc(2 * n_fft_fir * sizeof(double));
+    memset(H, 0, 2 * n_fft_fir * sizeof(double));
+    memcpy(H, h, N_h * sizeof(double));
+    fft_radix2(plan_fir, H, H + n_fft_fir, 0);
+
+    u = (double*) mxMalloc(2 * N_y * sizeof(double));
+    s = (double*) mxMalloc(2 * ((n_fft_fir > N_fft) ? n_fft_fir : N_fft) * sizeof(double));
+  } else {
+    n_fft_fir = 0;
+    u = NULL;
+    s = (double*) mxMalloc(2 * N_fft * sizeof(double));
+  }
+
+  plan = fft_plan_get(N_fft);
+
+  /* 'same' convolution is centered, streaming mode is causal */
+  c = streaming ? 0 : N_h / 2;
+
+  /* call the computational routine */
+  for (ant = 0; ant < N_ant; ant++) {
+    if (N_h == 0) {
+      ofdma_modulate(x_re + ant*N_sc*N_sym, (x_im != NULL) ? x_im + ant*N_sc*N_sym : NULL, N_sc, N_sym, N_fft,
+                     N_cp_first, N_cp_other, plan, s, s + N_fft, y_re + ant*N_y, y_im + ant*N_y);
+      continue;
+    }
+
+    ofdma_modulate(x_re + ant*N_sc*N_sym, (x_im != NULL) ? x_im + ant*N_sc*N_sym : NULL, N_sc, N_sym, N_fft,
+                   N_cp_first, N_cp_other, plan, s, s + N_fft, u, u + N_y);
+    fir_overlap_save(u, u + N_y, N_y, (st_re != NULL) ? st_re + ant*(N_h-1) : NULL,
+                     (st_im != NULL) ? st_im + ant*(N_h-1) : NULL, c, H, H + n_fft_fir, N_h, plan_fir,
+                     s, s + n_fft_fir, y_re + ant*N_y, y_im + ant*N_y);
+
+    /* filter state for the next call: last N_h-1 input samples */
+    if (streaming && nlhs > 1) {
+      if (ant == 0)
+        plhs[1] = mxCreateDoubleMatrix((mwSize)(N_h-1), (mwSize)N_ant, mxCOMPLEX);
+      st_out_re = mxGetPr(plhs[1]) + ant*(N_h-1);
+      st_out_im = mxGetPi(plhs[1]) + ant*(N_h-1);
+      for (i = 0; i < N_h - 1; i++) {
+        if (i + N_y >= N_h - 1) {
+          st_out_re[i] = u[i + N_y - (N_h - 1)];
+          st_out_im[i] = u[N_y + i + N_y - (N_h - 1)];
+        } else {
+          st_out_re[i] = (st_re != NULL) ? st_re[ant*(N_h-1) + i + N_y] : 0.0;
+          st_out_im[i] = (st_im != NULL) ? st_im[ant*(N_h-1) + i + N_y] : 0.0;
+        }
+      }
+    }
+  }
+
+  if (streaming && nlhs > 1 && N_h == 0)
+    plhs[1] = mxCreateDoubleMatrix(0, (mwSize)N_ant, mxCOMPLEX);
+
+  if (H != NULL)
+    mxFree(H);
+  if (u != NULL)
+    mxFree(u);
+  mxFree(s);
+}
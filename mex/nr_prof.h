@@ -0,0 +1,172 @@
+/* Stage timers and event counters of the native receive chain, with an
+ * optional timeline of stage calls exported in Chrome trace event format
+ * (JSON, opened by chrome://tracing or ui.perfetto.dev), matching the
+ * output of nr_profiler.m.
+ *
+ * Stages and counters are indices into tables of names given to
+ * nr_prof_init. A disabled profiler costs a branch per call. The profiler
+ * is not thread safe: stages are timed by the thread driving the chain, so
+ * work distributed over the thread pool is accounted to the enclosing
+ * stage, and counters of workers are summed by the caller.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef NR_PROF_H
+#define NR_PROF_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define NR_PROF_MAX_STAGES 32
+#define NR_PROF_MAX_COUNTERS 16
+
+typedef struct {
+  int stage;
+  long slot;
+  double ts;
+  double dur;
+} nr_prof_event_t;
+
+typedef struct {
+  int enabled;
+  int trace;
+  const char* const* stage_names;
+  int n_stages;
+  const char* const* counter_names;
+  int n_counters;
+  double t0;
+  long slot;
+  long calls[NR_PROF_MAX_STAGES];
+  double time[NR_PROF_MAX_STAGES];
+  double counters[NR_PROF_MAX_COUNTERS];
+  nr_prof_event_t* ev;
+  size_t n_ev;
+  size_t cap_ev;
+} nr_prof_t;
+
+/* monotonic time in seconds */
+static double nr_prof_now(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (double) ts.tv_sec + 1e-9 * (double) ts.tv_nsec;
+}
+
+static void nr_prof_init(nr_prof_t* p, int enabled, int trace, const char* const* stage_names, int n_stages,
+                         const char* const* counter_names, int n_counters) {
+  int n;
+
+  p->enabled = enabled;
+  p->trace = enabled && trace;
+  p->stage_names = stage_names;
+  p->n_stages = (n_stages < NR_PROF_MAX_STAGES) ? n_stages : NR_PROF_MAX_STAGES;
+  p->counter_names = counter_names;
+  p->n_counters = (n_counters < NR_PROF_MAX_COUNTERS) ? n_counters : NR_PROF_MAX_COUNTERS;
+  p->t0 = nr_prof_now();
+  p->slot = 0;
+  for (n = 0; n < NR_PROF_MAX_STAGES; n++) {
+    p->calls[n] = 0;
+    p->time[n] = 0.0;
+  }
+  for (n = 0; n < NR_PROF_MAX_COUNTERS; n++)
+    p->counters[n] = 0.0;
+  p->ev = NULL;
+  p->n_ev = 0;
+  p->cap_ev = 0;
+}
+
+static void nr_prof_free(nr_prof_t* p) {
+  free(p->ev);
+  p->ev = NULL;
+  p->n_ev = 0;
+  p->cap_ev = 0;
+}
+
+/* sets the slot number attached to the following events */
+static void nr_prof_slot(nr_prof_t* p, long slot) {
+  p->slot = slot;
+}
+
+/* returns the start time of a stage, to be passed to nr_prof_end */
+static double nr_prof_begin(const nr_prof_t* p) {
+  return p->enabled ? nr_prof_now() : 0.0;
+}
+
+/* accounts the call of stage started at t_begin, tracing stops if the
+ * event buffer cannot grow */
+static void nr_prof_end(nr_prof_t* p, int stage, double t_begin) {
+  nr_prof_event_t* ev;
+  double dur;
+  size_t cap;
+
+  if (!p->enabled || stage < 0 || stage >= p->n_stages)
+    return;
+
+  dur = nr_prof_now() - t_begin;
+  p->calls[stage]++;
+  p->time[stage] += dur;
+
+  if (p->trace) {
+    if (p->n_ev == p->cap_ev) {
+      cap = (p->cap_ev > 0) ? 2 * p->cap_ev : 1024;
+      ev = (nr_prof_event_t*) realloc(p->ev, cap * sizeof(nr_prof_event_t));
+      if (ev == NULL) {
+        p->trace = 0;
+        return;
+      }
+      p->ev = ev;
+      p->cap_ev = cap;
+    }
+    p->ev[p->n_ev].stage = stage;
+    p->ev[p->n_ev].slot = p->slot;
+    p->ev[p->n_ev].ts = t_begin - p->t0;
+    p->ev[p->n_ev].dur = dur;
+    p->n_ev++;
+  }
+}
+
+static void nr_prof_count(nr_prof_t* p, int counter, double n) {
+  if (p->enabled && counter >= 0 && counter < p->n_counters)
+    p->counters[counter] += n;
+}
+
+/* writes stage times and counters as text lines */
+static void nr_prof_report(const nr_prof_t* p, FILE* fp) {
+  int n;
+
+  if (!p->enabled)
+    return;
+
+  fprintf(fp, "# stage calls total_ms mean_us\n");
+  for (n = 0; n < p->n_stages; n++)
+    fprintf(fp, "%s %ld %.3f %.3f\n", p->stage_names[n], p->calls[n], 1e3 * p->time[n],
+      (p->calls[n] > 0) ? 1e6 * p->time[n] / (double) p->calls[n] : 0.0);
+  fprintf(fp, "# counter value\n");
+  for (n = 0; n < p->n_counters; n++)
+    fprintf(fp, "%s %.0f\n", p->counter_names[n], p->counters[n]);
+}
+
+/* writes the timeline as complete ('X') events with times in microseconds,
+ * returns zero if the file cannot be written */
+static int nr_prof_export(const nr_prof_t* p, const char* path) {
+  FILE* fp;
+  size_t n;
+  int ok;
+
+  fp = fopen(path, "w");
+  if (fp == NULL)
+    return 0;
+
+  fprintf(fp, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  for (n = 0; n < p->n_ev; n++)
+    fprintf(fp, "%s{\"name\":\"%s\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"slot\":%ld}}",
+      (n > 0) ? ",\n" : "", p->stage_names[p->ev[n].stage], 1e6 * p->ev[n].ts, 1e6 * p->ev[n].dur, p->ev[n].slot);
+  fprintf(fp, "\n]}\n");
+
+  ok = !ferror(fp);
+  return (fclose(fp) == 0) && ok;
+}
+
+#endif
@@ -0,0 +1,125 @@
+/* D = nr_sch_rx_backend_mex(d, N0, Q_m, c_init, E, N, k_0, Fbst, Fbsz, D0)
+ * D = nr_sch_rx_backend_mex(d, N0, Q_m, c_init, E, N, k_0, Fbst, Fbsz, D0, llr_class, llr_scale)
+ *
+ * Fused receive back-end of 5G NR SCH: soft demapping (max-log, see
+ * demapper_pam.h), descrambling (3GPP 38.211 sec. 6.3.1.1), codeblock
+ * deconcatenation, bit deinterleaving and rate unmatching (3GPP 38.212
+ * sec. 5.4.2 and 5.5). LLRs of equalized symbols d (with noise variance N0,
+ * scalar or one per symbol) are written straight into the C x N decoder
+ * input matrix D, where C = numel(E). Scrambling sequence is generated
+ * on the fly from c_init and no intermediate LLR vectors are created.
+ * Optional C x N matrix D0 (HARQ soft buffer of previous transmissions)
+ * is the starting point of LLR combining.
+ *
+ * d and N0 are both double or both single. D is double unless llr_class is
+ * 'int16' or 'int8', in which case LLRs are multiplied by llr_scale, rounded
+ * and combined with saturation; D0 must then be of the same class.
+ *
+ * Bit q of the j-th symbol of a codeblock is the (q*E/Q_m + j)-th bit of
+ * the deinterleaved sequence, so the circular buffer is walked with Q_m
+ * cursors, one per bit position. Cursors run over a compressed index space
+ * of length N - Fbsz that excludes filler bits.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#include "mex.h"
+#include <stdint.h>
+#include <string.h>
+#include "sch_rx_backend.h"
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+  void* d_re;
+  void* d_im;
+  size_t n_sym, N0_size, C, N, k_0, Fbst, Fbsz, r, E_sum;
+  void* N0;
+  double* E;
+  int Q_m, single, llr_format;
+  uint32_t c_init;
+  double scale;
+  char* llr_class;
+  mxClassID class_id;
+  size_t elem_size;
+
+  /* check for proper number of arguments */
+  if(nrhs != 9 && nrhs != 10 && nrhs != 12) {
+    mexErrMsgIdAndTxt("nr_sch_rx_backend:nrhs","Nine, ten or twelve inputs required.");
+  }
+
+  if(nlhs != 1) {
+    mexErrMsgIdAndTxt("nr_sch_rx_backend:nlhs","One output required.");
+  }
+
+  /* get the input arguments */
+  n_sym = mxGetM(prhs[0]) * mxGetN(prhs[0]);
+  single = mxIsSingle(prhs[0]);
+  if (!(single || mxIsDouble(prhs[0])) || mxIsSingle(prhs[1]) != single)
+    mexErrMsgIdAndTxt("nr_sch_rx_backend:d","d and N0 must be both double or both single.");
+  d_re = mxGetData(prhs[0]);
+  d_im = mxGetImagData(prhs[0]);
+  N0_size = mxGetM(prhs[1]) * mxGetN(prhs[1]);
+  N0 = mxGetData(prhs[1]);
+  Q_m = (int) mxGetScalar(prhs[2]);
+  c_init = (uint32_t) mxGetScalar(prhs[3]) & 0x7FFFFFFF;
+  C = mxGetM(prhs[4]) * mxGetN(prhs[4]);
+  E = mxGetPr(prhs[4]);
+  N = (size_t) mxGetScalar(prhs[5]);
+  k_0 = (size_t) mxGetScalar(prhs[6]);
+  Fbst = (size_t) mxGetScalar(prhs[7]);
+  Fbsz = (size_t) mxGetScalar(prhs[8]);
+
+  if (Q_m != 1 && Q_m != 2 && Q_m != 4 && Q_m != 6 && Q_m != 8 && Q_m != 10)
+    mexErrMsgIdAndTxt("nr_sch_rx_backend:Q_m","Modulation order not supported.");
+
+  if (N0_size != 1 && N0_size != n_sym)
+    mexErrMsgIdAndTxt("nr_sch_rx_backend:N0","N0 must be a scalar or match the size of d.");
+
+  E_sum = 0;
+  for (r = 0; r < C; r++) {
+    if ((size_t)E[r] % Q_m != 0)
+      mexErrMsgIdAndTxt("nr_sch_rx_backend:E","Codeblock sizes E must be multiples of Q_m.");
+    E_sum += (size_t)E[r];
+  }
+
+  if (E_sum != n_sym * Q_m)
+    mexErrMsgIdAndTxt("nr_sch_rx_backend:E","Sum of codeblock sizes E does not match the number of symbols.");
+
+  if (Fbsz >= N || Fbst + Fbsz > N)
+    mexErrMsgIdAndTxt("nr_sch_rx_backend:N","Invalid circular buffer parameters.");
+
+  llr_format = LLR_DOUBLE;
+  class_id = mxDOUBLE_CLASS;
+  elem_size = sizeof(double);
+  scale = 1.0;
+  if (nrhs > 10) {
+    llr_class = mxArrayToString(prhs[10]);
+    if (llr_class != NULL && strcmp(llr_class, "int16") == 0) {
+      llr_format = LLR_INT16;
+      class_id = mxINT16_CLASS;
+      elem_size = sizeof(int16_t);
+    } else if (llr_class != NULL && strcmp(llr_class, "int8") == 0) {
+      llr_format = LLR_INT8;
+      class_id = mxINT8_CLASS;
+      elem_size = sizeof(int8_t);
+    } else if (llr_class == NULL || strcmp(llr_class, "double") != 0) {
+      llr_format = -1;
+    }
+    mxFree(llr_class);
+    if (llr_format < 0)
+      mexErrMsgIdAndTxt("nr_sch_rx_backend:llr_class","LLR class not supported (double, int16 or int8).");
+    scale = mxGetScalar(prhs[11]);
+  }
+
+  /* create the output matrix */
+  plhs[0] = mxCreateNumericMatrix((mwSize)C, (mwSize)N, class_id, mxREAL);
+
+  if (nrhs > 9 && !mxIsEmpty(prhs[9])) {
+    if (mxGetM(prhs[9]) != C || mxGetN(prhs[9]) != N || mxGetClassID(prhs[9]) != class_id || mxIsComplex(prhs[9]))
+      mexErrMsgIdAndTxt("nr_sch_rx_backend:D0","D0 must be a real C x N matrix of the LLR class.");
+    memcpy(mxGetData(plhs[0]), mxGetData(prhs[9]), C * N * elem_size);
+  }
+
+  /* call the computational routine */
+  if (!sch_rx_backend_typed(d_re, d_im, n_sym, N0, N0_size, single, Q_m, c_init, E, C, N, k_0, Fbst, Fbsz, mxGetData(plhs[0]), llr_format, scale))
+    mexErrMsgIdAndTxt("nr_sch_rx_backend:E","Codeblock sizes E exceed the number of symbols.");
+}
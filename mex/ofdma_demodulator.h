@@ -0,0 +1,55 @@
+/* OFDM demodulator core shared by nr_ofdma_demodulator_mex.c and native code.
+ *
+ * Symbols of a slot are read from column-major sample buffer y (N_y samples
+ * per antenna), cyclic prefixes are skipped, fftshift and guardband removal
+ * are folded into output indexing. Only subcarriers k_first ..
+ * k_first+k_num-1 of the N_sc x N_sym x N_ant grid x are written, symbols
+ * of zero samples only are skipped. s_re and s_im are N_fft element scratch
+ * buffers.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef OFDMA_DEMODULATOR_H
+#define OFDMA_DEMODULATOR_H
+
+#include <stddef.h>
+#include "fft_radix2.h"
+
+static void nr_ofdma_demodulator(const double* y_re, const double* y_im, size_t N_y, size_t N_ant, size_t N_fft, size_t N_sc,
+                                 size_t N_cp_first, size_t N_cp_other, size_t N_sym, size_t k_first, size_t k_num,
+                                 const fft_radix2_t* plan, double* s_re, double* s_im, double* x_re, double* x_im) {
+  size_t ant, l, i, k, sidx, N_guard = (N_fft - N_sc) / 2;
+  double scale = 1.0 / sqrt((double) N_fft);
+  int nonzero;
+
+  for (ant = 0; ant < N_ant; ant++) {
+    sidx = ant * N_y;
+    for (l = 0; l < N_sym; l++) {
+      sidx += (l == 0) ? N_cp_first : N_cp_other;
+
+      nonzero = 0;
+      for (i = 0; i < N_fft; i++) {
+        s_re[i] = y_re[sidx + i];
+        s_im[i] = (y_im != NULL) ? y_im[sidx + i] : 0.0;
+        nonzero |= (s_re[i] != 0.0) || (s_im[i] != 0.0);
+      }
+      sidx += N_fft;
+
+      /* silent symbols are left zero */
+      if (!nonzero)
+        continue;
+
+      fft_radix2(plan, s_re, s_im, 0);
+
+      /* subcarrier k of the grid is bin (N_guard + k + N_fft/2) mod N_fft */
+      for (k = k_first; k < k_first + k_num; k++) {
+        i = (N_guard + k + N_fft/2) & (N_fft - 1);
+        x_re[k + N_sc * (l + N_sym * ant)] = scale * s_re[i];
+        x_im[k + N_sc * (l + N_sym * ant)] = scale * s_im[i];
+      }
+    }
+  }
+}
+
+#endif
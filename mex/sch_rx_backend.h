@@ -0,0 +1,112 @@
+/* Fused receive back-end core of 5G NR SCH shared by nr_sch_rx_backend_mex.c
+ * and native code: soft demapping, descrambling, codeblock deconcatenation,
+ * bit deinterleaving and rate unmatching in one pass (see
+ * nr_sch_rx_backend_mex.c). LLRs are accumulated into the C x N column-major
+ * decoder input matrix D, which is double or saturated int16/int8 (see
+ * sch_rx_backend_typed).
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef SCH_RX_BACKEND_H
+#define SCH_RX_BACKEND_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "demapper_pam.h"
+#include "gold31.h"
+#include "llr_quant.h"
+
+#define SCH_RX_BLOCK_SYMBOLS 64
+#define SCH_RX_Q_M_MAX 10
+
+/* walks the circular buffer of codeblock r for the blk demapped symbols in
+ * llr, STORE combines the descrambled LLR v into position pos */
+#define SCH_RX_WALK(STORE) \
+  for (i = 0, n = 0; i < blk; i++) { \
+    if (c_num < Q_m) { \
+      c_bits |= (uint64_t)gold31_next(&gold) << c_num; \
+      c_num += 32; \
+    } \
+    for (q = 0; q < Q_m; q++, n++) { \
+      pos = (cur[q] < Fbst) ? cur[q] : cur[q] + Fbsz; \
+      v = (c_bits & 1) ? -llr[n] : llr[n]; \
+      STORE; \
+      c_bits >>= 1; \
+      cur[q] = (cur[q] + 1 == N_comp) ? 0 : cur[q] + 1; \
+    } \
+    c_num -= Q_m; \
+  }
+
+/* d_re, d_im and N0 are float arrays if single is set, double otherwise.
+ * D is a double, int16_t or int8_t matrix according to llr_format
+ * (LLR_DOUBLE, LLR_INT16, LLR_INT8), fixed-point LLRs are multiplied by
+ * scale and combined with saturation (see llr_quant.h). Returns zero
+ * without touching D if Q_m is not supported or the codeblocks of sizes E
+ * need more than the n_sym input symbols. */
+static int sch_rx_backend_typed(const void* d_re, const void* d_im, size_t n_sym, const void* N0, size_t N0_size, int single, int Q_m, uint32_t c_init,
+                                 const double* E, size_t C, size_t N, size_t k_0, size_t Fbst, size_t Fbsz, void* D, int llr_format, double scale) {
+  double llr[SCH_RX_BLOCK_SYMBOLS * SCH_RX_Q_M_MAX];
+  size_t cur[SCH_RX_Q_M_MAX];
+  size_t N_comp = N - Fbsz;
+  size_t c0, p, r, j, i, n, blk, EdQm, pos, sym = 0;
+  gold31_t gold;
+  uint64_t c_bits = 0;
+  int c_num = 0, q;
+  double v;
+
+  if (Q_m < 1 || Q_m > SCH_RX_Q_M_MAX || N_comp == 0)
+    return 0;
+  for (r = 0, n = 0; r < C; r++)
+    n += (size_t)E[r] / Q_m;
+  if (n > n_sym)
+    return 0;
+
+  /* compressed index of the first non-filler position at or after k_0 */
+  p = k_0 % N;
+  if (p >= Fbst && p < Fbst + Fbsz)
+    p = (Fbst + Fbsz) % N;
+  c0 = (p < Fbst) ? p : p - Fbsz;
+
+  gold31_start(&gold, c_init);
+
+  for (r = 0; r < C; r++) {
+    EdQm = (size_t)E[r] / Q_m;
+
+    for (q = 0; q < Q_m; q++)
+      cur[q] = (c0 + q * EdQm) % N_comp;
+
+    for (j = 0; j < EdQm; j += blk) {
+      blk = (EdQm - j < SCH_RX_BLOCK_SYMBOLS) ? EdQm - j : SCH_RX_BLOCK_SYMBOLS;
+
+      if (single)
+        demapprt_approx_llr_pam_f32((const float*)d_re + sym, (d_im != NULL) ? (const float*)d_im + sym : NULL, blk, Q_m,
+          (N0_size == 1) ? (const float*)N0 : (const float*)N0 + sym, (N0_size == 1) ? 1 : blk, llr);
+      else
+        demapprt_approx_llr_pam((double*)d_re + sym, (d_im != NULL) ? (double*)d_im + sym : NULL, blk, Q_m,
+          (N0_size == 1) ? (double*)N0 : (double*)N0 + sym, (N0_size == 1) ? 1 : blk, llr);
+
+      switch (llr_format) {
+      case LLR_INT16:
+        SCH_RX_WALK(((int16_t*)D)[r + pos*C] = llr_sadd_i16(((int16_t*)D)[r + pos*C], llr_quant_i16(v * scale)))
+        break;
+      case LLR_INT8:
+        SCH_RX_WALK(((int8_t*)D)[r + pos*C] = llr_sadd_i8(((int8_t*)D)[r + pos*C], llr_quant_i8(v * scale)))
+        break;
+      default:
+        SCH_RX_WALK(((double*)D)[r + pos*C] += v)
+      }
+
+      sym += blk;
+    }
+  }
+
+  return 1;
+}
+
+static int sch_rx_backend(double* d_re, double* d_im, size_t n_sym, double* N0, size_t N0_size, int Q_m, uint32_t c_init,
+                           double* E, size_t C, size_t N, size_t k_0, size_t Fbst, size_t Fbsz, double* D) {
+  return sch_rx_backend_typed(d_re, d_im, n_sym, N0, N0_size, 0, Q_m, c_init, E, C, N, k_0, Fbst, Fbsz, D, LLR_DOUBLE, 1.0);
+}
+
+#endif
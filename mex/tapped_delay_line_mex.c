@@ -0,0 +1,253 @@
+/* y = tapped_delay_line_mex(x, tap_delay, tap_gain, h, A, block_len=0)
+ *
+ * MIMO tapped delay line channel. Applies L taps of N_tx x N_rx links to
+ * the N x N_tx matrix of transmitted samples x and returns the N x N_rx
+ * matrix of received samples:
+ *
+ *   y(n,rx) = sum_tx sum_l tap_gain(l) * hc(n,l,m) * x(n-tap_delay(l),tx)
+ *
+ * where m = (rx-1)*N_tx + tx and hc(n,l,:) = A * h(n,l,:) are the spatially
+ * correlated tap processes obtained from the uncorrelated N x L x M matrix
+ * h with the M x M mixing matrix A (empty for no correlation). Correlated
+ * taps are formed block by block and never stored as a whole.
+ *
+ * For block_len > 0 the channel is assumed constant within blocks of
+ * block_len samples (taken at the center of a block) and the convolution
+ * is performed by FFT overlap-save, which pays off for long delay spreads.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#include <string.h>
+#include "mex.h"
+#include "fft_radix2.h"
+
+#define TDL_BLOCK 256
+
+typedef struct {
+  size_t N, L, N_tx, N_rx;
+  const double* x_re;
+  const double* x_im;
+  const double* delay;
+  const double* gain;
+  const double* h_re;
+  const double* h_im;
+  const double* A_re; /* NULL for no spatial correlation */
+  const double* A_im;
+  double* y_re;
+  double* y_im;
+} tdl_t;
+
+/* correlated coefficient of tap l on link m at sample n, scaled by tap gain */
+static void tdl_coeff(const tdl_t* p, size_t n, size_t l, size_t m, double* c_re, double* c_im) {
+  size_t M = p->N_tx * p->N_rx, k, idx;
+  double a_re, a_im;
+
+  if (p->A_re == NULL) {
+    idx = n + p->N * (l + p->L * m);
+    *c_re = p->gain[l] * p->h_re[idx];
+    *c_im = p->gain[l] * p->h_im[idx];
+    return;
+  }
+
+  *c_re = 0.0;
+  *c_im = 0.0;
+  for (k = 0; k < M; k++) {
+    a_re = p->A_re[m + M*k];
+    a_im = (p->A_im != NULL) ? p->A_im[m + M*k] : 0.0;
+    idx = n + p->N * (l + p->L * k);
+    *c_re += a_re * p->h_re[idx] - a_im * p->h_im[idx];
+    *c_im += a_re * p->h_im[idx] + a_im * p->h_re[idx];
+  }
+  *c_re *= p->gain[l];
+  *c_im *= p->gain[l];
+}
+
+/* exact time-varying convolution */
+static void tdl_time_domain(const tdl_t* p) {
+  double c_re[TDL_BLOCK], c_im[TDL_BLOCK];
+  size_t b0, blk, n, l, d, tx, rx, m, n0;
+  const double* xr;
+  const double* xi;
+  double* yr;
+  double* yi;
+
+  for (b0 = 0; b0 < p->N; b0 += blk) {
+    blk = (p->N - b0 < TDL_BLOCK) ? p->N - b0 : TDL_BLOCK;
+
+    for (rx = 0; rx < p->N_rx; rx++) {
+      yr = p->y_re + rx * p->N;
+      yi = p->y_im + rx * p->N;
+
+      for (tx = 0; tx < p->N_tx; tx++) {
+        m = rx * p->N_tx + tx;
+        xr = p->x_re + tx * p->N;
+        xi = p->x_im + tx * p->N;
+
+        for (l = 0; l < p->L; l++) {
+          d = (size_t) p->delay[l];
+          if (b0 + blk <= d)
+            continue;
+          n0 = (b0 >= d) ? b0 : d;
+
+          for (n = n0; n < b0 + blk; n++)
+            tdl_coeff(p, n, l, m, &c_re[n-b0], &c_im[n-b0]);
+
+          for (n = n0; n < b0 + blk; n++) {
+            yr[n] += c_re[n-b0] * xr[n-d] - c_im[n-b0] * xi[n-d];
+            yi[n] += c_re[n-b0] * xi[n-d] + c_im[n-b0] * xr[n-d];
+          }
+        }
+      }
+    }
+  }
+}
+
+/* block-wise static channel, FFT overlap-save convolution */
+static void tdl_block_fft(const tdl_t* p, size_t block_len) {
+  size_t d_max = 0, n_fft, b0, blk, n, k, l, tx, rx, m, s0, src, n_c;
+  double *buf, *x_re, *x_im, *y_re, *y_im, *h_re, *h_im;
+  double c_re, c_im, t_re, t_im, scale;
+  fft_radix2_t plan;
+
+  for (l = 0; l < p->L; l++)
+    if ((size_t) p->delay[l] > d_max)
+      d_max = (size_t) p->delay[l];
+
+  n_fft = fft_radix2_len(block_len + d_max);
+  scale = 1.0 / (double) n_fft;
+
+  buf = (double*) mxMalloc(n_fft * (1 + 2 * (p->N_tx + p->N_rx + 1)) * sizeof(double));
+  fft_radix2_init(&plan, n_fft, buf);
+  x_re = buf + n_fft;
+  x_im = x_re + n_fft * p->N_tx;
+  y_re = x_im + n_fft * p->N_tx;
+  y_im = y_re + n_fft * p->N_rx;
+  h_re = y_im + n_fft * p->N_rx;
+  h_im = h_re + n_fft;
+
+  for (b0 = 0; b0 < p->N; b0 += blk) {
+    blk = (p->N - b0 < block_len) ? p->N - b0 : block_len;
+    n_c = b0 + blk / 2;
+
+    /* input segment ending at the last sample of the block */
+    s0 = b0 + block_len;
+    for (tx = 0; tx < p->N_tx; tx++) {
+      for (k = 0; k < n_fft; k++) {
+        src = s0 + k;
+        if (src >= n_fft && src - n_fft < p->N) {
+          x_re[tx*n_fft + k] = p->x_re[tx*p->N + src - n_fft];
+          x_im[tx*n_fft + k] = p->x_im[tx*p->N + src - n_fft];
+        } else {
+          x_re[tx*n_fft + k] = 0.0;
+          x_im[tx*n_fft + k] = 0.0;
+        }
+      }
+      fft_radix2(&plan, x_re + tx*n_fft, x_im + tx*n_fft, 0);
+    }
+
+    memset(y_re, 0, n_fft * p->N_rx * sizeof(double));
+    memset(y_im, 0, n_fft * p->N_rx * sizeof(double));
+
+    for (rx = 0; rx < p->N_rx; rx++) {
+      for (tx = 0; tx < p->N_tx; tx++) {
+        m = rx * p->N_tx + tx;
+
+        /* frequency response of the link in this block */
+        memset(h_re, 0, n_fft * sizeof(double));
+        memset(h_im, 0, n_fft * sizeof(double));
+        for (l = 0; l < p->L; l++) {
+          tdl_coeff(p, n_c, l, m, &c_re, &c_im);
+          h_re[(size_t) p->delay[l]] += c_re;
+          h_im[(size_t) p->delay[l]] += c_im;
+        }
+        fft_radix2(&plan, h_re, h_im, 0);
+
+        for (k = 0; k < n_fft; k++) {
+          t_re = h_re[k] * x_re[tx*n_fft + k] - h_im[k] * x_im[tx*n_fft + k];
+          t_im = h_re[k] * x_im[tx*n_fft + k] + h_im[k] * x_re[tx*n_fft + k];
+          y_re[rx*n_fft + k] += t_re;
+          y_im[rx*n_fft + k] += t_im;
+        }
+      }
+
+      fft_radix2(&plan, y_re + rx*n_fft, y_im + rx*n_fft, 1);
+
+      /* the last block_len samples are free of circular wrap-around */
+      for (n = 0; n < blk; n++) {
+        p->y_re[rx*p->N + b0 + n] += scale * y_re[rx*n_fft + n_fft - block_len + n];
+        p->y_im[rx*p->N + b0 + n] += scale * y_im[rx*n_fft + n_fft - block_len + n];
+      }
+    }
+  }
+
+  mxFree(buf);
+}
+
+void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]) {
+  tdl_t p;
+  size_t M, l, n_zeros, block_len = 0;
+  double* zeros = NULL;
+
+  /* check for proper number of arguments */
+  if(nrhs != 5 && nrhs != 6) {
+    mexErrMsgIdAndTxt("tapped_delay_line:nrhs","Five or six inputs required.");
+  }
+
+  if(nlhs != 1) {
+    mexErrMsgIdAndTxt("tapped_delay_line:nlhs","One output required.");
+  }
+
+  /* get the input arguments */
+  p.N = mxGetM(prhs[0]);
+  p.N_tx = mxGetN(prhs[0]);
+  p.L = mxGetM(prhs[1]) * mxGetN(prhs[1]);
+
+  if (mxGetM(prhs[2]) * mxGetN(prhs[2]) != p.L)
+    mexErrMsgIdAndTxt("tapped_delay_line:L","Lengths of tap_gain and tap_delay must be equal.");
+
+  if (p.N == 0 || p.L == 0 || p.N_tx == 0 || mxGetNumberOfElements(prhs[3]) % (p.N * p.L * p.N_tx) != 0)
+    mexErrMsgIdAndTxt("tapped_delay_line:h","h must be of size [N, L, N_tx*N_rx].");
+
+  M = mxGetNumberOfElements(prhs[3]) / (p.N * p.L);
+  p.N_rx = M / p.N_tx;
+
+  if (!mxIsEmpty(prhs[4]) && (mxGetM(prhs[4]) != M || mxGetN(prhs[4]) != M))
+    mexErrMsgIdAndTxt("tapped_delay_line:A","A must be a square matrix of size N_tx*N_rx.");
+
+  if (nrhs > 5)
+    block_len = (size_t) mxGetScalar(prhs[5]);
+
+  p.delay = mxGetPr(prhs[1]);
+  p.gain = mxGetPr(prhs[2]);
+  for (l = 0; l < p.L; l++)
+    if (p.delay[l] < 0)
+      mexErrMsgIdAndTxt("tapped_delay_line:tap_delay","Tap delays must be non-negative.");
+
+  /* real-valued inputs have no imaginary part */
+  if (mxGetPi(prhs[0]) == NULL || mxGetPi(prhs[3]) == NULL) {
+    n_zeros = (p.N_tx > p.L * M) ? p.N * p.N_tx : p.N * p.L * M;
+    zeros = (double*) mxCalloc(n_zeros, sizeof(double));
+  }
+
+  p.x_re = mxGetPr(prhs[0]);
+  p.x_im = (mxGetPi(prhs[0]) != NULL) ? mxGetPi(prhs[0]) : zeros;
+  p.h_re = mxGetPr(prhs[3]);
+  p.h_im = (mxGetPi(prhs[3]) != NULL) ? mxGetPi(prhs[3]) : zeros;
+  p.A_re = mxIsEmpty(prhs[4]) ? NULL : mxGetPr(prhs[4]);
+  p.A_im = mxIsEmpty(prhs[4]) ? NULL : mxGetPi(prhs[4]);
+
+  /* create the output matrix */
+  plhs[0] = mxCreateDoubleMatrix((mwSize)p.N, (mwSize)p.N_rx, mxCOMPLEX);
+  p.y_re = mxGetPr(plhs[0]);
+  p.y_im = mxGetPi(plhs[0]);
+
+  /* call the computational routine */
+  if (block_len > 0)
+    tdl_block_fft(&p, block_len);
+  else
+    tdl_time_domain(&p);
+
+  if (zeros != NULL)
+    mxFree(zeros);
+}
@@ -0,0 +1,393 @@
+/* Minimal worker pool for mex kernels.
+ *
+ * thread_pool_run() starts a set of workers which pull task indices from a
+ * shared counter until all tasks are processed, and returns once every
+ * worker has finished. Worker functions must not call the mx* / mex* API,
+ * which is not thread-safe.
+ *
+ * thread_pool_create() starts workers that stay parked between calls of
+ * thread_pool_exec(), which runs tasks the same way as thread_pool_run()
+ * without starting and joining threads per call. Mex files keep such a
+ * pool in a static and destroy it from their mexAtExit function.
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <stdlib.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#define THREAD_POOL_MAX 64
+
+/* fn(ctx, task, worker) is called once per task index in [0, num_tasks) */
+typedef void (*thread_pool_fn)(void* ctx, int task, int worker);
+
+typedef struct {
+  thread_pool_fn fn;
+  void* ctx;
+  int num_tasks;
+  int next_task;
+#ifdef _WIN32
+  CRITICAL_SECTION lock;
+#else
+  pthread_mutex_t lock;
+#endif
+} thread_pool_t;
+
+typedef struct {
+  thread_pool_t* pool;
+  int worker;
+} thread_pool_worker_t;
+
+static int thread_pool_num_cpus(void) {
+#ifdef _WIN32
+  SYSTEM_INFO si;
+  GetSystemInfo(&si);
+  return (int) si.dwNumberOfProcessors;
+#else
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n > 0) ? (int) n : 1;
+#endif
+}
+
+static int thread_pool_next(thread_pool_t* pool) {
+  int task;
+#ifdef _WIN32
+  EnterCriticalSection(&pool->lock);
+  task = pool->next_task++;
+  LeaveCriticalSection(&pool->lock);
+#else
+  pthread_mutex_lock(&pool->lock);
+  task = pool->next_task++;
+  pthread_mutex_unlock(&pool->lock);
+#endif
+  return task;
+}
+
+#ifdef _WIN32
+static DWORD WINAPI thread_pool_worker(LPVOID arg) {
+#else
+static void* thread_pool_worker(void* arg) {
+#endif
+  thread_pool_worker_t* w = (thread_pool_worker_t*) arg;
+  int task;
+
+  while ((task = thread_pool_next(w->pool)) < w->pool->num_tasks)
+    w->pool->fn(w->pool->ctx, task, w->worker);
+
+  return 0;
+}
+
+/* Runs num_tasks tasks on num_threads workers (0 selects the number of
+ * online CPUs). The calling thread acts as worker 0. Returns the number of
+ * workers actually used, so that callers may size per-worker scratch. */
+static int thread_pool_run(int num_threads, int num_tasks, thread_pool_fn fn, void* ctx) {
+  thread_pool_t pool;
+  thread_pool_worker_t w[THREAD_POOL_MAX];
+#ifdef _WIN32
+  HANDLE th[THREAD_POOL_MAX];
+#else
+  pthread_t th[THREAD_POOL_MAX];
+#endif
+  int n, started;
+
+  if (num_threads <= 0)
+    num_threads = thread_pool_num_cpus();
+  if (num_threads > num_tasks)
+    num_threads = num_tasks;
+  if (num_threads > THREAD_POOL_MAX)
+    num_threads = THREAD_POOL_MAX;
+  if (num_threads < 1)
+    num_threads = 1;
+
+  pool.fn = fn;
+  pool.ctx = ctx;
+  pool.num_tasks = num_tasks;
+  pool.next_task = 0;
+#ifdef _WIN32
+  InitializeCriticalSection(&pool.lock);
+#else
+  pthread_mutex_init(&pool.lock, NULL);
+#endif
+
+  /* workers that fail to start are simply not used */
+  started = 1;
+  for (n = 1; n < num_threads; n++) {
+    w[started].pool = &pool;
+    w[started].worker = started;
+#ifdef _WIN32
+    th[started] = CreateThread(NULL, 0, thread_pool_worker, &w[started], 0, NULL);
+    if (th[started] != NULL)
+      started++;
+#else
+    if (pthread_create(&th[started], NULL, thread_pool_worker, &w[started]) == 0)
+      started++;
+#endif
+  }
+
+  w[0].pool = &pool;
+  w[0].worker = 0;
+  thread_pool_worker(&w[0]);
+
+  for (n = 1; n < started; n++) {
+#ifdef _WIN32
+    WaitForSingleObject(th[n], INFINITE);
+    CloseHandle(th[n]);
+#else
+    pthread_join(th[n], NULL);
+#endif
+  }
+
+#ifdef _WIN32
+  DeleteCriticalSection(&pool.lock);
+#else
+  pthread_mutex_destroy(&pool.lock);
+#endif
+
+  return started;
+}
+
+
+/* workers parked between jobs of thread_pool_exec() */
+typedef struct thread_pool_persistent_s thread_pool_persistent_t;
+
+typedef struct {
+  thread_pool_persistent_t* p;
+  int worker;
+} thread_pool_thread_t;
+
+struct thread_pool_persistent_s {
+  thread_pool_t job;
+  /* threads of the pool including the calling thread */
+  int num_threads;
+  /* workers taking part in the current job, and those still busy with it */
+  int num_active;
+  int running;
+  unsigned long generation;
+  int quit;
+  thread_pool_thread_t w[THREAD_POOL_MAX];
+#ifdef _WIN32
+  CRITICAL_SECTION lock;
+  CONDITION_VARIABLE wake;
+  CONDITION_VARIABLE done;
+  HANDLE th[THREAD_POOL_MAX];
+#else
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t done;
+  pthread_t th[THREAD_POOL_MAX];
+#endif
+};
+
+static void thread_pool_lock(thread_pool_persistent_t* p) {
+#ifdef _WIN32
+  EnterCriticalSection(&p->lock);
+#else
+  pthread_mutex_lock(&p->lock);
+#endif
+}
+
+static void thread_pool_unlock(thread_pool_persistent_t* p) {
+#ifdef _WIN32
+  LeaveCriticalSection(&p->lock);
+#else
+  pthread_mutex_unlock(&p->lock);
+#endif
+}
+
+#ifdef _WIN32
+static DWORD WINAPI thread_pool_parked(LPVOID arg) {
+#else
+static void* thread_pool_parked(void* arg) {
+#endif
+  thread_pool_thread_t* w = (thread_pool_thread_t*) arg;
+  thread_pool_persistent_t* p = w->p;
+  unsigned long seen = 0;
+  int task;
+
+  thread_pool_lock(p);
+  for (;;) {
+    while (!p->quit && p->generation == seen) {
+#ifdef _WIN32
+      SleepConditionVariableCS(&p->wake, &p->lock, INFINITE);
+#else
+      pthread_cond_wait(&p->wake, &p->lock);
+#endif
+    }
+    if (p->quit)
+      break;
+    seen = p->generation;
+    if (w->worker >= p->num_active)
+      continue;
+
+    thread_pool_unlock(p);
+    while ((task = thread_pool_next(&p->job)) < p->job.num_tasks)
+      p->job.fn(p->job.ctx, task, w->worker);
+    thread_pool_lock(p);
+
+    if (--p->running == 0) {
+#ifdef _WIN32
+      WakeConditionVariable(&p->done);
+#else
+      pthread_cond_signal(&p->done);
+#endif
+    }
+  }
+  thread_pool_unlock(p);
+
+  return 0;
+}
+
+/* stops and joins the workers of pool p */
+static void thread_pool_destroy(thread_pool_persistent_t* p) {
+  int n;
+
+  if (p == NULL)
+    return;
+
+  thread_pool_lock(p);
+  p->quit = 1;
+#ifdef _WIN32
+  WakeAllConditionVariable(&p->wake);
+#else
+  pthread_cond_broadcast(&p->wake);
+#endif
+  thread_pool_unlock(p);
+
+  for (n = 1; n < p->num_threads; n++) {
+#ifdef _WIN32
+    WaitForSingleObject(p->th[n], INFINITE);
+    CloseHandle(p->th[n]);
+#else
+    pthread_join(p->th[n], NULL);
+#endif
+  }
+
+#ifdef _WIN32
+  DeleteCriticalSection(&p->job.lock);
+  DeleteCriticalSection(&p->lock);
+#else
+  pthread_mutex_destroy(&p->job.lock);
+  pthread_mutex_destroy(&p->lock);
+  pthread_cond_destroy(&p->wake);
+  pthread_cond_destroy(&p->done);
+#endif
+  free(p);
+}
+
+/* Starts a pool of num_threads workers (0 selects the number of online
+ * CPUs), the calling thread of thread_pool_exec() acts as worker 0. Workers
+ * that fail to start are simply not used. Returns NULL if out of memory. */
+static thread_pool_persistent_t* thread_pool_create(int num_threads) {
+  thread_pool_persistent_t* p;
+  int n;
+
+  if (num_threads <= 0)
+    num_threads = thread_pool_num_cpus();
+  if (num_threads > THREAD_POOL_MAX)
+    num_threads = THREAD_POOL_MAX;
+
+  p = (thread_pool_persistent_t*) calloc(1, sizeof(thread_pool_persistent_t));
+  if (p == NULL)
+    return NULL;
+
+#ifdef _WIN32
+  InitializeCriticalSection(&p->job.lock);
+  InitializeCriticalSection(&p->lock);
+  InitializeConditionVariable(&p->wake);
+  InitializeConditionVariable(&p->done);
+#else
+  pthread_mutex_init(&p->job.lock, NULL);
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->wake, NULL);
+  pthread_cond_init(&p->done, NULL);
+#endif
+
+  p->num_threads = 1;
+  for (n = 1; n < num_threads; n++) {
+    p->w[p->num_threads].p = p;
+    p->w[p->num_threads].worker = p->num_threads;
+#ifdef _WIN32
+    p->th[p->num_threads] = CreateThread(NULL, 0, thread_pool_parked, &p->w[p->num_threads], 0, NULL);
+    if (p->th[p->num_threads] != NULL)
+      p->num_threads++;
+#else
+    if (pthread_create(&p->th[p->num_threads], NULL, thread_pool_parked, &p->w[p->num_threads]) == 0)
+      p->num_threads++;
+#endif
+  }
+
+  return p;
+}
+
+/* Returns pool p if it has at least num_threads workers (0 selects the
+ * number of online CPUs, capped at THREAD_POOL_MAX), otherwise destroys it
+ * and returns a new pool of num_threads workers, NULL if out of memory. */
+static thread_pool_persistent_t* thread_pool_reserve(thread_pool_persistent_t* p, int num_threads) {
+  if (num_threads <= 0)
+    num_threads = thread_pool_num_cpus();
+  if (num_threads > THREAD_POOL_MAX)
+    num_threads = THREAD_POOL_MAX;
+
+  if (p != NULL && p->num_threads >= num_threads)
+    return p;
+
+  thread_pool_destroy(p);
+  return thread_pool_create(num_threads);
+}
+
+/* Runs num_tasks tasks on at most num_threads workers of pool p (0 selects
+ * all of them) as thread_pool_run() does. Returns the number of workers
+ * used. */
+static int thread_pool_exec(thread_pool_persistent_t* p, int num_threads, int num_tasks, thread_pool_fn fn, void* ctx) {
+  int task;
+
+  if (num_threads <= 0 || num_threads > p->num_threads)
+    num_threads = p->num_threads;
+  if (num_threads > num_tasks)
+    num_threads = num_tasks;
+  if (num_threads < 1)
+    num_threads = 1;
+
+  thread_pool_lock(p);
+  p->job.fn = fn;
+  p->job.ctx = ctx;
+  p->job.num_tasks = num_tasks;
+  p->job.next_task = 0;
+  p->num_active = num_threads;
+  p->running = num_threads - 1;
+  if (num_threads > 1) {
+    p->generation++;
+#ifdef _WIN32
+    WakeAllConditionVariable(&p->wake);
+#else
+    pthread_cond_broadcast(&p->wake);
+#endif
+  }
+  thread_pool_unlock(p);
+
+  while ((task = thread_pool_next(&p->job)) < num_tasks)
+    fn(ctx, task, 0);
+
+  thread_pool_lock(p);
+  while (p->running > 0) {
+#ifdef _WIN32
+    SleepConditionVariableCS(&p->done, &p->lock, INFINITE);
+#else
+    pthread_cond_wait(&p->done, &p->lock);
+#endif
+  }
+  thread_pool_unlock(p);
+
+  return num_threads;
+}
+
+#endif
@@ -21,6 +21,11 @@
 %  method - soft-demodulation algorithm selection:
 %           'True LLR'   - true LLR using LOGMAP
 %           'Approx LLR' - Viterbi LLR appoximation [1]
+%           'Approx LLR PAM' - same as 'Approx LLR', computed in
+%                        closed form separately for I and Q PAM
+%                        components with O(ord) cost per symbol,
+%                        single precision iq is demapped without
+%                        conversion to double
 %           'Hard'       - hard demodulation
 %
 %  N0     - noise variance, may be provided as a single value, 
@@ -41,6 +46,18 @@ function [x] = modulation_demapper_soft(iq, ord, method, N0)
 
   x = zeros(numel(iq)*ord, 1);
 
+  if strcmpi(method, 'Approx LLR PAM')
+    try
+      x = modulation_demapper_soft_mex(iq, ord, 'Approx LLR PAM', cast(N0, class(iq)));
+    catch
+      x = demapper_approx_llr_pam(double(iq(:)), ord, double(N0(:)));
+    end
+    return;
+  end
+
+  iq = double(iq);
+  N0 = double(N0);
+
   [A, S0, S1] = modulation_alphabet(ord);
 
   try
@@ -87,6 +104,33 @@ function [x] = modulation_demapper_soft(iq, ord, method, N0)
   end
 end
 
+% Max-log LLR of Gray-coded QAM computed per I and Q axis. Bit b(2m) of
+% the I axis is the sign of the PAM coordinate folded m times, for which
+% the nearest points with either sign are found by rounding and clipping.
+function x = demapper_approx_llr_pam(iq, ord, N0)
+  if ord == 1
+    x = 2 * sqrt(2) * (real(iq) + imag(iq)) ./ N0;
+    return;
+  end
+
+  k = ord / 2;
+  s = sqrt(1.5 / (2^ord - 1));
+  g = repmat(s^2 ./ N0, 1, 2);
+  t = [real(iq), imag(iq)] / s;
+  L = zeros(numel(iq), ord);
+
+  for m = 0 : k-1
+    half = 2^(k-m-1);
+    r = min(max(2 * floor(t / 2) + 1, 1 - 2*half), 2*half - 1);
+    p = max(r, 1);
+    n = min(r, -1);
+    L(:,2*m+1:2*m+2) = g .* (p - n) .* (2 * t - p - n);
+    t = half - abs(t);
+  end
+
+  x = reshape(L.', [], 1);
+end
+
 % truncated logarithm - to avoid NaNs in the results
 function y = tlog(x)
   if isinf(x)
@@ -0,0 +1,84 @@
+/* ldpc_graph_store_gen [file]
+ *
+ * Writes the store of precomputed LDPC graphs (see ldpc_graph_store.h) of
+ * both base graphs and all 51 lifting sizes of 3GPP 38.212 Table 5.3.2-1 to
+ * file (ldpc_graphs.bin by default), and verifies that it maps back to the
+ * graphs built from the base graph tables.
+ *
+ * The decoders and the encoder of the mex kernels and the Matlab code
+ * (nr_ldpc_graph_store.m) use the store named by environment variable
+ * NR_LDPC_GRAPH_STORE or else the file ldpc_graphs.bin in directory mex,
+ * nr_pusch_replay only the one named by the variable. Since the store is native-endian, it is to be generated on the
+ * architecture it is used on.
+ *
+ * Build (POSIX):
+ *   gcc -O2 -I../mex ldpc_graph_store_gen.c -o ldpc_graph_store_gen
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ldpc_layered.h"
+#include "ldpc_base_graph_tbl.h"
+#include "ldpc_graph_store.h"
+
+/* returns non-zero if every graph of the store equals the one built from
+ * the base graph tables */
+static int verify(const ldpc_graph_store_t* gs) {
+  double i_tbl[LDPC_BG1_EDGES], j_tbl[LDPC_BG1_EDGES], V_tbl[LDPC_BG1_EDGES];
+  base_graph_t ref, view;
+  size_t edges;
+  int bg_num, Z, ok = 1;
+
+  for (bg_num = 1; bg_num <= 2; bg_num++) {
+    for (Z = 1; Z <= LDPC_GS_Z_MAX; Z++) {
+      edges = ldpc_base_graph_tbl(bg_num, Z, i_tbl, j_tbl, V_tbl);
+      if (edges == 0) {
+        ok &= !ldpc_graph_store_get(gs, bg_num, Z, &view);
+        continue;
+      }
+      if (!base_graph_init(&ref, Z, (bg_num == 1) ? 68 : 52, i_tbl, j_tbl, V_tbl, edges)) {
+        base_graph_free(&ref);
+        return 0;
+      }
+      ok &= ldpc_graph_store_get(gs, bg_num, Z, &view) && view.rows == ref.rows && view.cols == ref.cols &&
+            view.edges == ref.edges && view.deg_max == ref.deg_max &&
+            memcmp(view.row_ptr, ref.row_ptr, sizeof(int) * (ref.rows + 1)) == 0 &&
+            memcmp(view.col, ref.col, sizeof(int) * edges) == 0 &&
+            memcmp(view.shift, ref.shift, sizeof(int) * edges) == 0;
+      base_graph_free(&ref);
+    }
+  }
+
+  return ok;
+}
+
+int main(int argc, char* argv[]) {
+  const char* path = (argc > 1) ? argv[1] : LDPC_GS_FILE;
+  ldpc_graph_store_t gs;
+  FILE* fp;
+  int n_graphs;
+
+  fp = fopen(path, "wb");
+  if (fp == NULL) {
+    fprintf(stderr, "ldpc_graph_store_gen: cannot open %s\n", path);
+    return 1;
+  }
+  n_graphs = ldpc_graph_store_write(fp);
+  if (fclose(fp) != 0 || n_graphs == 0) {
+    fprintf(stderr, "ldpc_graph_store_gen: cannot write %s\n", path);
+    return 1;
+  }
+
+  if (!ldpc_graph_store_open(&gs, path) || !verify(&gs)) {
+    fprintf(stderr, "ldpc_graph_store_gen: verification of %s failed\n", path);
+    return 1;
+  }
+  printf("%s: %d graphs, %zu bytes\n", path, n_graphs, gs.size);
+  ldpc_graph_store_close(&gs);
+
+  return 0;
+}
@@ -0,0 +1,782 @@
+/* nr_kernel_bench [options]
+ *
+ * Micro-benchmark of the C cores of the mex kernels (no Matlab runtime).
+ *
+ * Every kernel is run over a sweep of base graphs and lifting sizes (LDPC
+ * codecs, CRC, circular buffer), modulation orders (demappers, circular
+ * buffer, scrambling sequence) and PRB counts (demappers, scrambling
+ * sequence, fading channel), and its median time per call over a number of
+ * repetitions is reported together with the throughput and the number of
+ * CPU cycles per bit. Kernels and units of the "bits" column:
+ *   ldpc_spa         - ldpc_spa.h (ldpc_decode_spa_mex), information bits of
+ *                      a code block, 22*Z (BG1) or 10*Z (BG2)
+ *   ldpc_layered     - ldpc_layered.h (ldpc_decode_layered_mex), as above
+ *   ldpc_layered_i16 - ldpc_layered_i16.h (ldpc_decode_layered_mex with
+ *                      int16 LLRs), as above
+ *   ldpc_encode      - ldpc_encoder.h (ldpc_encode_nr_mex), as above
+ *   demap_pam        - demapper_pam.h ('Approx LLR PAM'), LLRs of a slot of
+ *                      14 x 12*prb REs
+ *   demap_maxlog     - demapper_alphabet.h ('Approx LLR'), as above
+ *   crc              - nr_crc.h (crc_calc_mex), CRC24B over a code block
+ *   gold31           - gold31.h (gold31seq_mex), scrambling sequence of a
+ *                      slot, Q_m bits per RE
+ *   circbuff_il      - circbuff.h (nr_38_212_circbuff_interleave_mex), bit
+ *                      selection and interleaving of E = N bits
+ *   circbuff_deil    - circbuff.h (nr_38_212_circbuff_deinterleave_mex),
+ *                      as above
+ *   fading_zheng     - fading_zheng.h (fading_channel_zheng_mex), samples of
+ *                      a slot of one link at 30 kHz subcarrier spacing
+ * The LDPC decoders are fed with LLRs of the all-zero codeword at an SNR
+ * below the decoding threshold, so that every call runs the maximum number
+ * of iterations. Cycles are read from the time stamp counter on x86 (at its
+ * nominal frequency), elsewhere the column is left empty.
+ *
+ * Options (defaults in brackets):
+ *   -k list     kernels to run, comma separated [all]
+ *   -g list     base graphs [1,2]
+ *   -z list     lifting sizes [64,128,256,384]
+ *   -q list     modulation orders [2,4,6,8]
+ *   -p list     PRB counts [25,106,273]
+ *   -i n        LDPC decoder iterations [10]
+ *   -t sec      measurement time per case [0.2]
+ *   -r n        repetitions per case, the median is reported [5]
+ *   -f format   output format, csv or json [csv]
+ *   -o file     output file [stdout]
+ *   -b file     baseline, CSV output of an earlier run
+ *   -T tol      relative slowdown against the baseline reported as
+ *               a regression [0.05]
+ *
+ * With a baseline, the baseline time and speedup of every case found in it
+ * are added to the output, and the exit status is 1 if any case is slower
+ * than the baseline by more than tol. To keep a baseline:
+ *   ./nr_kernel_bench > baseline.csv
+ *   ... change and rebuild ...
+ *   ./nr_kernel_bench -b baseline.csv
+ *
+ * Build (POSIX):
+ *   gcc -O3 -march=native -I../mex nr_kernel_bench.c -o nr_kernel_bench -lm
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#else
+#define HAVE_TSC 0
+#endif
+
+#include "ldpc_spa.h"
+#include "ldpc_layered.h"
+#include "ldpc_layered_i16.h"
+#include "ldpc_base_graph_tbl.h"
+#include "ldpc_encoder.h"
+#include "demapper_pam.h"
+#include "demapper_alphabet.h"
+#include "nr_crc.h"
+#include "gold31.h"
+#include "circbuff.h"
+#include "llr_quant.h"
+#include "fading_zheng.h"
+
+#define MAX_LIST 16
+#define MAX_REPS 64
+#define MAX_BASELINE 4096
+#define N_SC_RB 12
+#define N_SLOT_SYMBOL 14
+#define N_PUNCT_COLS 2
+#define LDPC_SNR_DB -10.0
+#define LDPC_I16_SCALE 64.0
+
+enum {
+  K_LDPC_SPA, K_LDPC_LAYERED, K_LDPC_LAYERED_I16, K_LDPC_ENCODE, K_DEMAP_PAM, K_DEMAP_MAXLOG, K_CRC, K_GOLD31,
+  K_CIRCBUFF_IL, K_CIRCBUFF_DEIL, K_FADING_ZHENG, N_KERNEL
+};
+
+static const char* kernel_name[N_KERNEL] = {
+  "ldpc_spa", "ldpc_layered", "ldpc_layered_i16", "ldpc_encode", "demap_pam", "demap_maxlog", "crc", "gold31",
+  "circbuff_il", "circbuff_deil", "fading_zheng"
+};
+
+/* sweep dimensions used by each kernel */
+#define DIM_BG_Z 1
+#define DIM_QM 2
+#define DIM_PRB 4
+
+static const int kernel_dims[N_KERNEL] = {
+  DIM_BG_Z, DIM_BG_Z, DIM_BG_Z, DIM_BG_Z, DIM_QM | DIM_PRB, DIM_QM | DIM_PRB, DIM_BG_Z, DIM_QM | DIM_PRB,
+  DIM_BG_Z | DIM_QM, DIM_BG_Z | DIM_QM, DIM_PRB
+};
+
+typedef struct {
+  int kernel_en[N_KERNEL];
+  int bg[MAX_LIST], N_bg;
+  int Z[MAX_LIST], N_Z;
+  int Q_m[MAX_LIST], N_Q_m;
+  int prb[MAX_LIST], N_prb;
+  int ldpc_iters;
+  double min_time;
+  int reps;
+  int json;
+  const char* out;
+  const char* baseline;
+  double tol;
+} bench_cfg_t;
+
+/* one benchmark case with its input and output buffers */
+typedef struct {
+  int kernel, bg, Z, Q_m, prb;
+  size_t bits;
+  double iters;
+
+  /* LDPC */
+  int max_iters;
+  base_graph_t graph;
+  ldpc_layered_ws_t* ws;
+  ldpc_layered_i16_ws_t* ws16;
+  ldpc_enc_t enc;
+  int16_t* llr16;
+  unsigned char* hard;
+  size_t ncheck, nvar, cmax, vmax;
+  size_t *H_ir, *H_jc;
+  double *sumX1, *sumX2, *i_idx, *j_idx;
+  ldpc_spa_graph_t* spa_g;
+  ldpc_spa_ctx_t* spa;
+
+  /* demappers */
+  size_t n_sym;
+  double A_re[1024], A_im[1024];
+  double *S0, *S1, *N0;
+
+  /* CRC and scrambling */
+  nr_crc_t crc;
+  uint32_t crc_reg;
+  uint32_t* seq;
+  size_t words;
+
+  /* circular buffer */
+  size_t N, E;
+
+  /* fading channel */
+  fading_zheng_t fading;
+  double f_s;
+
+  double *x_re, *x_im, *y;
+} bench_t;
+
+typedef struct {
+  char kernel[32];
+  int bg, Z, Q_m, prb;
+  double ns_op;
+} baseline_t;
+
+static double now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint64_t cycles(void) {
+#if HAVE_TSC
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+/* uniform variate in (0,1) from the fading channel mixer, reproducible
+ * across runs */
+static double uniform(uint64_t* state) {
+  *state = fading_zheng_mix(*state);
+  return ((double)(*state >> 11) + 0.5) * (1.0 / 9007199254740992.0);
+}
+
+static double gaussian(uint64_t* state) {
+  double u1 = uniform(state), u2 = uniform(state);
+  return sqrt(-2.0 * log(u1)) * cos(2 * M_PI * u2);
+}
+
+/* Expands the base graph into the compressed column parity check matrix and
+ * message index tables expected by ldpc_decode_spa (see ldpc_decode_spa.m).
+ * Base graph rows are sorted by i and columns by j, so checks of every
+ * variable and variables of every check are visited in ascending order. */
+static int spa_graph_init(bench_t* b, const double* i_tbl, const double* j_tbl, const double* V_tbl, size_t edges) {
+  size_t e, k, c, v;
+  size_t *deg_v, *deg_c;
+  int Z = b->Z;
+
+  b->ncheck = (size_t) b->graph.rows * Z;
+  b->nvar = (size_t) b->graph.cols * Z;
+  deg_v = calloc(b->nvar, sizeof(size_t));
+  deg_c = calloc(b->ncheck, sizeof(size_t));
+  b->H_jc = calloc(b->nvar + 1, sizeof(size_t));
+  b->H_ir = malloc(sizeof(size_t) * edges * Z);
+  b->sumX1 = malloc(sizeof(double) * b->nvar);
+  b->sumX2 = malloc(sizeof(double) * b->ncheck);
+  if (deg_v == NULL || deg_c == NULL || b->H_jc == NULL || b->H_ir == NULL || b->sumX1 == NULL || b->sumX2 == NULL) {
+    free(deg_v);
+    free(deg_c);
+    return 0;
+  }
+
+  for (e = 0; e < edges; e++) {
+    for (k = 0; k < (size_t) Z; k++) {
+      deg_c[(size_t) i_tbl[e] * Z + k]++;
+      deg_v[(size_t) j_tbl[e] * Z + k]++;
+    }
+  }
+
+  b->cmax = 0;
+  for (v = 0; v < b->nvar; v++) {
+    b->H_jc[v+1] = b->H_jc[v] + deg_v[v];
+    b->sumX1[v] = (double) deg_v[v];
+    b->cmax = (deg_v[v] > b->cmax) ? deg_v[v] : b->cmax;
+    deg_v[v] = 0;
+  }
+  b->vmax = 0;
+  for (c = 0; c < b->ncheck; c++) {
+    b->sumX2[c] = (double) deg_c[c];
+    b->vmax = (deg_c[c] > b->vmax) ? deg_c[c] : b->vmax;
+    deg_c[c] = 0;
+  }
+
+  b->i_idx = malloc(sizeof(double) * b->nvar * b->cmax);
+  b->j_idx = malloc(sizeof(double) * b->ncheck * b->vmax);
+  if (b->i_idx == NULL || b->j_idx == NULL) {
+    free(deg_v);
+    free(deg_c);
+    return 0;
+  }
+
+  /* deg_v and deg_c now count the edges visited so far */
+  for (e = 0; e < edges; e++) {
+    for (k = 0; k < (size_t) Z; k++) {
+      c = (size_t) i_tbl[e] * Z + k;
+      v = (size_t) j_tbl[e] * Z + (k + (size_t) V_tbl[e]) % Z;
+      b->H_ir[b->H_jc[v] + deg_v[v]] = c;
+      b->i_idx[v + deg_v[v] * b->nvar] = (double)(c + deg_c[c] * b->ncheck);
+      b->j_idx[c + deg_c[c] * b->ncheck] = (double)(v + deg_v[v] * b->nvar);
+      deg_v[v]++;
+      deg_c[c]++;
+    }
+  }
+
+  free(deg_v);
+  free(deg_c);
+
+  b->spa_g = ldpc_spa_graph_create(b->ncheck, b->nvar, b->cmax, b->vmax, b->H_ir, b->H_jc, b->sumX1, b->sumX2, b->i_idx, b->j_idx);
+  b->spa = (b->spa_g != NULL) ? ldpc_spa_ctx_create(b->spa_g) : NULL;
+  return b->spa != NULL;
+}
+
+/* 38.211 5.1 Gray-mapped QAM alphabet and the S0, S1 index tables of
+ * modulation_alphabet.m (zero-based) */
+static int qam_alphabet(bench_t* b) {
+  int ord = b->Q_m, k = ord / 2, size = 1 << ord, n, m, q, a0, a1;
+  double s = sqrt(1.5 / (double)((1 << (2*k)) - 1)), tI, tQ;
+
+#define BIT_SGN(n, c) (1.0 - 2.0 * (((n) >> (ord - 1 - (c))) & 1))
+
+  for (n = 0; n < size; n++) {
+    tI = 1.0;
+    tQ = 1.0;
+    for (m = k - 1; m >= 1; m--) {
+      tI = (double)(1 << (k - m)) - BIT_SGN(n, 2*m) * tI;
+      tQ = (double)(1 << (k - m)) - BIT_SGN(n, 2*m+1) * tQ;
+    }
+    b->A_re[n] = s * BIT_SGN(n, 0) * tI;
+    b->A_im[n] = s * BIT_SGN(n, 1) * tQ;
+  }
+
+#undef BIT_SGN
+
+  b->S0 = malloc(sizeof(double) * size / 2 * ord);
+  b->S1 = malloc(sizeof(double) * size / 2 * ord);
+  if (b->S0 == NULL || b->S1 == NULL)
+    return 0;
+
+  for (q = 0; q < ord; q++) {
+    a0 = 0;
+    a1 = 0;
+    for (n = 0; n < size; n++) {
+      if (n & (1 << q))
+        b->S1[q + (a1++) * ord] = n;
+      else
+        b->S0[q + (a0++) * ord] = n;
+    }
+  }
+
+  return 1;
+}
+
+static size_t fft_size(int prb) {
+  size_t N_fft = 128;
+  while (N_fft * 85 < (size_t) prb * N_SC_RB * 100)
+    N_fft *= 2;
+  return N_fft;
+}
+
+static void bench_free(bench_t* b) {
+  if (b->graph.row_ptr != NULL)
+    base_graph_free(&b->graph);
+  ldpc_layered_ws_free(b->ws);
+  ldpc_layered_i16_ws_free(b->ws16);
+  ldpc_enc_free(&b->enc);
+  ldpc_spa_ctx_destroy(b->spa);
+  ldpc_spa_graph_destroy(b->spa_g);
+  free(b->llr16);
+  free(b->hard);
+  free(b->H_ir);
+  free(b->H_jc);
+  free(b->sumX1);
+  free(b->sumX2);
+  free(b->i_idx);
+  free(b->j_idx);
+  free(b->S0);
+  free(b->S1);
+  free(b->N0);
+  free(b->seq);
+  free(b->x_re);
+  free(b->x_im);
+  free(b->y);
+}
+
+/* prepares inputs of a case, returns 0 if the case is not valid or out of
+ * memory */
+static int bench_init(bench_t* b, int kernel, int bg, int Z, int Q_m, int prb, int ldpc_iters) {
+  static const double crc24b[25] = {1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,0,0,0,1,1};
+  double i_tbl[LDPC_BG1_EDGES], j_tbl[LDPC_BG1_EDGES], V_tbl[LDPC_BG1_EDGES];
+  double sigma, sigma2;
+  uint64_t rng = 0x5EED;
+  size_t edges = 0, n, N_llr, N_fft;
+  int cols = (bg == 1) ? 68 : 52, kb = (bg == 1) ? 22 : 10, i;
+
+  memset(b, 0, sizeof(bench_t));
+  b->kernel = kernel;
+  b->bg = (kernel_dims[kernel] & DIM_BG_Z) ? bg : 0;
+  b->Z = (kernel_dims[kernel] & DIM_BG_Z) ? Z : 0;
+  b->Q_m = (kernel_dims[kernel] & DIM_QM) ? Q_m : 0;
+  b->prb = (kernel_dims[kernel] & DIM_PRB) ? prb : 0;
+  b->max_iters = ldpc_iters;
+
+  if (kernel_dims[kernel] & DIM_BG_Z) {
+    edges = ldpc_base_graph_tbl(bg, Z, i_tbl, j_tbl, V_tbl);
+    if (edges == 0)
+      return 0;
+    b->N = (size_t)(cols - N_PUNCT_COLS) * Z;
+  }
+  b->n_sym = (size_t) prb * N_SC_RB * N_SLOT_SYMBOL;
+
+  switch (kernel) {
+    case K_LDPC_SPA:
+    case K_LDPC_LAYERED:
+    case K_LDPC_LAYERED_I16:
+      if (!base_graph_init(&b->graph, Z, cols, i_tbl, j_tbl, V_tbl, edges))
+        return 0;
+      b->bits = (size_t) kb * Z;
+
+      /* BPSK LLRs of the all-zero codeword, zeros at punctured positions
+       * for the SPA decoder which takes the whole codeword */
+      N_llr = (size_t) cols * Z;
+      sigma2 = pow(10.0, -LDPC_SNR_DB / 10.0);
+      sigma = sqrt(sigma2);
+      b->x_re = calloc(N_llr, sizeof(double));
+      b->y = malloc(sizeof(double) * N_llr);
+      if (b->x_re == NULL || b->y == NULL)
+        return 0;
+      for (n = (size_t) N_PUNCT_COLS * Z; n < N_llr; n++)
+        b->x_re[n] = 2.0 * (1.0 + sigma * gaussian(&rng)) / sigma2;
+
+      if (kernel == K_LDPC_SPA)
+        return spa_graph_init(b, i_tbl, j_tbl, V_tbl, edges);
+      if (kernel == K_LDPC_LAYERED_I16) {
+        b->llr16 = malloc(sizeof(int16_t) * N_llr);
+        b->hard = malloc(N_llr);
+        b->ws16 = ldpc_layered_i16_ws_alloc(&b->graph, Z);
+        if (b->llr16 == NULL || b->hard == NULL)
+          return 0;
+        for (n = 0; n < N_llr; n++)
+          b->llr16[n] = llr_quant_i16(b->x_re[n] * LDPC_I16_SCALE);
+        return b->ws16 != NULL;
+      }
+      b->ws = ldpc_layered_ws_alloc(&b->graph, Z);
+      return b->ws != NULL;
+
+    case K_LDPC_ENCODE:
+      if (!base_graph_init(&b->graph, Z, cols, i_tbl, j_tbl, V_tbl, edges) || !ldpc_enc_init(&b->enc, &b->graph, Z))
+        return 0;
+      b->bits = (size_t) kb * Z;
+      b->x_re = malloc(sizeof(double) * b->bits);
+      b->y = malloc(sizeof(double) * b->graph.rows * Z);
+      if (b->x_re == NULL || b->y == NULL)
+        return 0;
+      for (n = 0; n < b->bits; n++)
+        b->x_re[n] = (uniform(&rng) < 0.5) ? 1.0 : 0.0;
+      return 1;
+
+    case K_DEMAP_PAM:
+    case K_DEMAP_MAXLOG:
+      b->bits = b->n_sym * Q_m;
+      b->x_re = malloc(sizeof(double) * b->n_sym);
+      b->x_im = malloc(sizeof(double) * b->n_sym);
+      b->N0 = malloc(sizeof(double) * b->n_sym);
+      b->y = malloc(sizeof(double) * b->bits);
+      if (b->x_re == NULL || b->x_im == NULL || b->N0 == NULL || b->y == NULL || !qam_alphabet(b))
+        return 0;
+      /* random points at 20 dB SNR with per-RE noise variance, as at the
+       * equalizer output */
+      for (n = 0; n < b->n_sym; n++) {
+        i = (int)(uniform(&rng) * (1 << Q_m));
+        b->N0[n] = 0.01 * (0.5 + uniform(&rng));
+        b->x_re[n] = b->A_re[i] + sqrt(b->N0[n] / 2) * gaussian(&rng);
+        b->x_im[n] = b->A_im[i] + sqrt(b->N0[n] / 2) * gaussian(&rng);
+      }
+      return 1;
+
+    case K_CRC:
+      b->bits = (size_t) kb * Z;
+      b->y = malloc(sizeof(double) * b->bits);
+      if (b->y == NULL || !nr_crc_init(&b->crc, crc24b, 25))
+        return 0;
+      for (n = 0; n < b->bits; n++)
+        b->y[n] = (uniform(&rng) < 0.5) ? 1.0 : 0.0;
+      return 1;
+
+    case K_GOLD31:
+      b->bits = b->n_sym * Q_m;
+      b->words = (b->bits + 31) / 32;
+      b->seq = malloc(sizeof(uint32_t) * b->words);
+      return b->seq != NULL;
+
+    case K_CIRCBUFF_IL:
+    case K_CIRCBUFF_DEIL:
+      b->E = b->N - b->N % Q_m;
+      b->bits = b->E;
+      b->x_re = malloc(sizeof(double) * b->N);
+      b->y = malloc(sizeof(double) * b->N);
+      if (b->x_re == NULL || b->y == NULL)
+        return 0;
+      for (n = 0; n < b->N; n++)
+        b->x_re[n] = (kernel == K_CIRCBUFF_IL) ? ((uniform(&rng) < 0.5) ? 1.0 : 0.0) : gaussian(&rng);
+      return 1;
+
+    case K_FADING_ZHENG:
+      N_fft = fft_size(prb);
+      b->f_s = N_fft * 30e3;
+      b->bits = N_SLOT_SYMBOL * (N_fft + N_fft * 144 / 2048);
+      b->x_re = malloc(sizeof(double) * b->bits);
+      b->x_im = malloc(sizeof(double) * b->bits);
+      fading_zheng_init(&b->fading, 70.0, 8, 0x5EED, 0);
+      return b->x_re != NULL && b->x_im != NULL;
+  }
+
+  return 0;
+}
+
+static void bench_run(bench_t* b) {
+  double cw_valid;
+
+  switch (b->kernel) {
+    case K_LDPC_SPA:
+      ldpc_spa_decode(b->spa, b->x_re, 1, b->max_iters, NULL, b->y, 1, &cw_valid, &b->iters, NULL);
+      break;
+    case K_LDPC_LAYERED:
+      ldpc_layered_decode(&b->graph, b->ws, b->x_re + N_PUNCT_COLS * b->Z, 1, N_PUNCT_COLS, b->max_iters, LDPC_METHOD_NMS, 0.75, NULL,
+                          b->y, 1, &cw_valid, &b->iters, NULL);
+      break;
+    case K_LDPC_LAYERED_I16:
+      ldpc_layered_decode_i16(&b->graph, b->ws16, b->llr16 + N_PUNCT_COLS * b->Z, 0, 1, N_PUNCT_COLS, b->max_iters, LDPC_METHOD_NMS, 0.75, NULL,
+                              b->hard, 1, &cw_valid, &b->iters, NULL);
+      break;
+    case K_LDPC_ENCODE:
+      ldpc_encode_qc(&b->enc, b->x_re, 1, b->y, 1, 0);
+      break;
+    case K_DEMAP_PAM:
+      demapprt_approx_llr_pam(b->x_re, b->x_im, b->n_sym, b->Q_m, b->N0, b->n_sym, b->y);
+      break;
+    case K_DEMAP_MAXLOG:
+      demapprt_approx_llr(b->x_re, b->x_im, b->n_sym, b->Q_m, b->N0, b->A_re, b->A_im, b->S0, b->S1, b->y);
+      break;
+    case K_CRC:
+      b->crc_reg = nr_crc_final(&b->crc, nr_crc_update_bits(&b->crc, nr_crc_init_reg(&b->crc), b->y, b->bits, 1));
+      break;
+    case K_GOLD31:
+      gold31_packed(0x12345, b->words, b->seq);
+      break;
+    case K_CIRCBUFF_IL:
+      circbuff_interleave(b->x_re, b->N, b->y, b->E, b->Q_m, 0);
+      break;
+    case K_CIRCBUFF_DEIL:
+      memset(b->y, 0, sizeof(double) * b->N);
+      circbuff_deinterleave(b->x_re, b->E, b->y, b->N, b->Q_m, 0, 0, 0);
+      break;
+    case K_FADING_ZHENG:
+      fading_zheng_uniform_grid(&b->fading, 0.0, 1.0 / b->f_s, b->bits, b->x_re, b->x_im);
+      break;
+  }
+}
+
+static int cmp_double(const void* a, const void* b) {
+  double x = *(const double*)a, y = *(const double*)b;
+  return (x > y) - (x < y);
+}
+
+/* median time and cycles per call over reps repetitions of min_time/reps */
+static void bench_measure(bench_t* b, double min_time, int reps, double* ns_op, double* cyc_op) {
+  double ns[MAX_REPS], cy[MAX_REPS], t0, t1;
+  uint64_t c0, c1;
+  long calls, n;
+  int r;
+
+  t0 = now_ns();
+  bench_run(b);
+  t1 = now_ns();
+  calls = (long)(min_time * 1e9 / reps / ((t1 > t0) ? t1 - t0 : 1.0));
+  if (calls < 1)
+    calls = 1;
+
+  for (r = 0; r < reps; r++) {
+    t0 = now_ns();
+    c0 = cycles();
+    for (n = 0; n < calls; n++)
+      bench_run(b);
+    c1 = cycles();
+    t1 = now_ns();
+    ns[r] = (t1 - t0) / calls;
+    cy[r] = (double)(c1 - c0) / calls;
+  }
+
+  qsort(ns, reps, sizeof(double), cmp_double);
+  qsort(cy, reps, sizeof(double), cmp_double);
+  *ns_op = ns[reps / 2];
+  *cyc_op = HAVE_TSC ? cy[reps / 2] : NAN;
+}
+
+static int parse_list(const char* s, int* v, int max) {
+  int n = 0;
+  char* end;
+
+  while (*s != '\0' && n < max) {
+    v[n++] = (int) strtol(s, &end, 10);
+    if (end == s)
+      return 0;
+    s = (*end == ',') ? end + 1 : end;
+  }
+
+  return n;
+}
+
+static int parse_kernels(const char* s, int* en) {
+  char name[32];
+  size_t len;
+  int k, found;
+
+  memset(en, 0, sizeof(int) * N_KERNEL);
+  while (*s != '\0') {
+    len = strcspn(s, ",");
+    if (len >= sizeof(name))
+      return 0;
+    memcpy(name, s, len);
+    name[len] = '\0';
+    found = 0;
+    for (k = 0; k < N_KERNEL; k++)
+      if (strcmp(name, kernel_name[k]) == 0)
+        en[k] = found = 1;
+    if (!found) {
+      fprintf(stderr, "nr_kernel_bench: unknown kernel %s\n", name);
+      return 0;
+    }
+    s += len + (s[len] == ',');
+  }
+
+  return 1;
+}
+
+static int baseline_load(const char* path, baseline_t* base) {
+  char line[512];
+  FILE* fp = fopen(path, "r");
+  int n = 0;
+
+  if (fp == NULL)
+    return -1;
+
+  while (n < MAX_BASELINE && fgets(line, sizeof(line), fp) != NULL) {
+    if (sscanf(line, "%31[^,],%d,%d,%d,%d,%*[^,],%*[^,],%lf", base[n].kernel, &base[n].bg, &base[n].Z, &base[n].Q_m,
+               &base[n].prb, &base[n].ns_op) == 6)
+      n++;
+  }
+
+  fclose(fp);
+  return n;
+}
+
+static double baseline_find(const baseline_t* base, int N_base, const bench_t* b) {
+  int n;
+
+  for (n = 0; n < N_base; n++)
+    if (strcmp(base[n].kernel, kernel_name[b->kernel]) == 0 && base[n].bg == b->bg && base[n].Z == b->Z &&
+        base[n].Q_m == b->Q_m && base[n].prb == b->prb)
+      return base[n].ns_op;
+
+  return NAN;
+}
+
+static void print_number(FILE* fp, double x, const char* fmt, int json) {
+  if (isnan(x))
+    fputs(json ? "null" : "", fp);
+  else
+    fprintf(fp, fmt, x);
+}
+
+static void print_result(FILE* fp, const bench_cfg_t* cfg, const bench_t* b, double ns_op, double cyc_op, double base_ns, int first) {
+  double mbps = b->bits / ns_op * 1e3;
+  double cpb = cyc_op / b->bits;
+
+  if (cfg->json) {
+    fprintf(fp, "%s\n    {\"kernel\": \"%s\", \"bg\": %d, \"Z\": %d, \"Q_m\": %d, \"prb\": %d, \"bits\": %zu, \"iters\": %g, ",
+            first ? "" : ",", kernel_name[b->kernel], b->bg, b->Z, b->Q_m, b->prb, b->bits, b->iters);
+    fprintf(fp, "\"ns_op\": %.1f, \"mbps\": %.2f, \"cycles_bit\": ", ns_op, mbps);
+    print_number(fp, cpb, "%.3f", 1);
+    if (cfg->baseline != NULL) {
+      fputs(", \"base_ns_op\": ", fp);
+      print_number(fp, base_ns, "%.1f", 1);
+      fputs(", \"speedup\": ", fp);
+      print_number(fp, base_ns / ns_op, "%.3f", 1);
+    }
+    fputs("}", fp);
+  } else {
+    fprintf(fp, "%s,%d,%d,%d,%d,%zu,%g,%.1f,%.2f,", kernel_name[b->kernel], b->bg, b->Z, b->Q_m, b->prb, b->bits, b->iters, ns_op, mbps);
+    print_number(fp, cpb, "%.3f", 0);
+    if (cfg->baseline != NULL) {
+      fputs(",", fp);
+      print_number(fp, base_ns, "%.1f", 0);
+      fputs(",", fp);
+      print_number(fp, base_ns / ns_op, "%.3f", 0);
+    }
+    fputs("\n", fp);
+  }
+  fflush(fp);
+}
+
+static void usage(void) {
+  fprintf(stderr, "usage: nr_kernel_bench [-k kernels] [-g bg] [-z Z] [-q Q_m] [-p prb] [-i iters] [-t sec] [-r reps]\n"
+                  "                       [-f csv|json] [-o file] [-b baseline.csv] [-T tol]\n");
+}
+
+int main(int argc, char** argv) {
+  static const int def_bg[] = {1, 2}, def_Z[] = {64, 128, 256, 384}, def_Q_m[] = {2, 4, 6, 8}, def_prb[] = {25, 106, 273};
+  static baseline_t base[MAX_BASELINE];
+  bench_cfg_t cfg;
+  bench_t b;
+  FILE* fp = stdout;
+  double ns_op, cyc_op, base_ns;
+  int N_base = 0, first = 1, regressions = 0, k, ig, iz, iq, ip, N_g, N_z, N_q, N_p, opt;
+
+  memset(&cfg, 0, sizeof(cfg));
+  for (k = 0; k < N_KERNEL; k++)
+    cfg.kernel_en[k] = 1;
+  memcpy(cfg.bg, def_bg, sizeof(def_bg));
+  cfg.N_bg = 2;
+  memcpy(cfg.Z, def_Z, sizeof(def_Z));
+  cfg.N_Z = 4;
+  memcpy(cfg.Q_m, def_Q_m, sizeof(def_Q_m));
+  cfg.N_Q_m = 4;
+  memcpy(cfg.prb, def_prb, sizeof(def_prb));
+  cfg.N_prb = 3;
+  cfg.ldpc_iters = 10;
+  cfg.min_time = 0.2;
+  cfg.reps = 5;
+  cfg.tol = 0.05;
+
+  while ((opt = getopt(argc, argv, "k:g:z:q:p:i:t:r:f:o:b:T:h")) != -1) {
+    switch (opt) {
+      case 'k': if (!parse_kernels(optarg, cfg.kernel_en)) return 2; break;
+      case 'g': if (!(cfg.N_bg = parse_list(optarg, cfg.bg, MAX_LIST))) { usage(); return 2; } break;
+      case 'z': if (!(cfg.N_Z = parse_list(optarg, cfg.Z, MAX_LIST))) { usage(); return 2; } break;
+      case 'q': if (!(cfg.N_Q_m = parse_list(optarg, cfg.Q_m, MAX_LIST))) { usage(); return 2; } break;
+      case 'p': if (!(cfg.N_prb = parse_list(optarg, cfg.prb, MAX_LIST))) { usage(); return 2; } break;
+      case 'i': cfg.ldpc_iters = atoi(optarg); break;
+      case 't': cfg.min_time = atof(optarg); break;
+      case 'r': cfg.reps = atoi(optarg); break;
+      case 'f': cfg.json = (strcmp(optarg, "json") == 0); break;
+      case 'o': cfg.out = optarg; break;
+      case 'b': cfg.baseline = optarg; break;
+      case 'T': cfg.tol = atof(optarg); break;
+      default: usage(); return 2;
+    }
+  }
+
+  if (cfg.reps < 1 || cfg.reps > MAX_REPS || cfg.ldpc_iters < 1 || cfg.min_time <= 0.0) {
+    usage();
+    return 2;
+  }
+
+  if (cfg.baseline != NULL && (N_base = baseline_load(cfg.baseline, base)) < 0) {
+    fprintf(stderr, "nr_kernel_bench: cannot read baseline %s\n", cfg.baseline);
+    return 2;
+  }
+
+  if (cfg.out != NULL && (fp = fopen(cfg.out, "w")) == NULL) {
+    fprintf(stderr, "nr_kernel_bench: cannot open %s\n", cfg.out);
+    return 2;
+  }
+
+  if (cfg.json)
+    fputs("{\"results\": [", fp);
+  else
+    fprintf(fp, "kernel,bg,Z,Q_m,prb,bits,iters,ns_op,mbps,cycles_bit%s\n", (cfg.baseline != NULL) ? ",base_ns_op,speedup" : "");
+
+  for (k = 0; k < N_KERNEL; k++) {
+    if (!cfg.kernel_en[k])
+      continue;
+
+    /* unused dimensions of a kernel are swept over a single dummy value */
+    N_g = (kernel_dims[k] & DIM_BG_Z) ? cfg.N_bg : 1;
+    N_z = (kernel_dims[k] & DIM_BG_Z) ? cfg.N_Z : 1;
+    N_q = (kernel_dims[k] & DIM_QM) ? cfg.N_Q_m : 1;
+    N_p = (kernel_dims[k] & DIM_PRB) ? cfg.N_prb : 1;
+
+    for (ig = 0; ig < N_g; ig++)
+      for (iz = 0; iz < N_z; iz++)
+        for (iq = 0; iq < N_q; iq++)
+          for (ip = 0; ip < N_p; ip++) {
+            if (!bench_init(&b, k, cfg.bg[ig], cfg.Z[iz], cfg.Q_m[iq], cfg.prb[ip], cfg.ldpc_iters)) {
+              fprintf(stderr, "nr_kernel_bench: %s bg %d Z %d Q_m %d prb %d skipped\n", kernel_name[k], b.bg, b.Z, b.Q_m, b.prb);
+              bench_free(&b);
+              continue;
+            }
+
+            bench_measure(&b, cfg.min_time, cfg.reps, &ns_op, &cyc_op);
+            base_ns = baseline_find(base, N_base, &b);
+            if (!isnan(base_ns) && ns_op > base_ns * (1.0 + cfg.tol)) {
+              fprintf(stderr, "nr_kernel_bench: %s bg %d Z %d Q_m %d prb %d slower than baseline (%.1f ns, was %.1f ns)\n",
+                      kernel_name[k], b.bg, b.Z, b.Q_m, b.prb, ns_op, base_ns);
+              regressions++;
+            }
+
+            print_result(fp, &cfg, &b, ns_op, cyc_op, base_ns, first);
+            first = 0;
+            bench_free(&b);
+          }
+  }
+
+  if (cfg.json)
+    fputs("\n]}\n", fp);
+
+  if (fp != stdout)
+    fclose(fp);
+
+  if (regressions > 0)
+    fprintf(stderr, "nr_kernel_bench: %d case(s) slower than baseline by more than %g%%\n", regressions, cfg.tol * 100);
+
+  return (regressions > 0) ? 1 : 0;
+}
@@ -0,0 +1,1176 @@
+/* nr_pusch_replay config_file capture_file
+ *
+ * Standalone PUSCH receiver replaying a multi-antenna IQ capture through the
+ * C cores of the mex kernels (no Matlab runtime).
+ *
+ * The capture is memory mapped and walked slot by slot from its start
+ * (sample_offset samples skipped, the first slot has number slot_offset in
+ * the frame). Samples are interleaved I/Q pairs of all receive antennas per
+ * time instant, either int16 (scaled by int16_scale) or float32. Every slot
+ * is OFDM demodulated once over the band occupied by all configured UEs,
+ * then for each UE the chain of nr_pusch_receive and nr_sch_decode is run:
+ * DMRS based LS channel estimation with frequency averaging and linear
+ * interpolation, ZF/MMSE/MMSE-IRC equalization (mimo_equalizer.h), fused
+ * demapping, descrambling and rate unmatching (sch_rx_backend.h), layered
+ * LDPC decoding (ldpc_layered.h) and codeblock desegmentation with CRC
+ * checks (cb_desegmentation.h).
+ *
+ * Transport block results are written as text lines
+ *   slot ue rnti tbs tb_crc_ok cb_crc_ok_count C mean_iter early_stop_count
+ * to crc_out (stdout by default). If llr_out is set, decoder input LLRs of
+ * every transport block are appended to it as an int32 header
+ * {slot, ue, C, N} followed by C*N float32 values, codeblock by codeblock.
+ *
+ * Configuration is a text file of "key = value" lines, '#' starts a
+ * comment. Global keys come first, each "[ue]" line starts the keys of
+ * a new UE (defaults in brackets):
+ *   fr [1], scs [30e3], band [40] (MHz), n_rb [0 - full band],
+ *   n_rx [1], format [int16] (int16 or float32), int16_scale [1/32768],
+ *   sample_offset [0], slot_offset [0], max_slots [0 - whole capture],
+ *   equalizer [MMSE] (ZF, MMSE or MMSE-IRC), chan_est_avg [3] (pilots),
+ *   ldpc_method [NMS] (NMS or OMS), ldpc_param [0.75 NMS, 0.5 OMS],
+ *   ldpc_max_iter [25], ldpc_num_threads [0 - all CPUs],
+ *   ldpc_crc_term [0] (1 - CRC-aided early termination),
+ *   ldpc_patience [0] (stall detection, see ldpc_term.h),
+ *   crc_out [-], llr_out [none],
+ *   profile [0] (1 - execution time of the receiver stages and event
+ *   counters are written to stderr at the end, see nr_prof.h),
+ *   trace_out [none] (timeline of stages in Chrome trace event format,
+ *   enables profile)
+ *   [ue] rnti [0], mcs [0], mcs_table [1], ports [0] (comma separated,
+ *   one per layer), prb_start [0], prb_num [n_rb], symbol_start [0],
+ *   symbols [14], dmrs_config_type [1], dmrs_add_pos [0],
+ *   dmrs_typeA_pos [2], dmrs_scrambling_id [0], n_scid [0],
+ *   data_scrambling_id [0], rv [0]
+ *
+ * LDPC graphs are taken from the store named by environment variable
+ * NR_LDPC_GRAPH_STORE if it is set (see ldpc_graph_store.h).
+ *
+ * Every UE is assumed to transmit in every slot with the same redundancy
+ * version, there is no HARQ combining between slots. As in the Matlab
+ * receiver, only single-symbol DMRS without transform precoding is
+ * supported, and TBS is calculated without DMRS overhead in data symbols.
+ *
+ * Build (POSIX):
+ *   gcc -O3 -march=native -I../mex nr_pusch_replay.c -o nr_pusch_replay -lm -lpthread
+ *
+ * Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+ */
+
+#define _USE_MATH_DEFINES
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "fft_radix2.h"
+#include "ofdma_demodulator.h"
+#include "mimo_equalizer.h"
+#include "sch_rx_backend.h"
+#include "ldpc_layered.h"
+#include "ldpc_base_graph_tbl.h"
+#include "ldpc_graph_store.h"
+#include "cb_desegmentation.h"
+#include "thread_pool.h"
+#include "nr_prof.h"
+
+#define MAX_UE 16
+#define MAX_DMRS_SYM 4
+#define MAX_CB 64
+#define N_SLOT_SYMBOL 14
+#define N_SC_RB 12
+#define MAX_SC (275 * N_SC_RB)
+#define MAX_PILOT (275 * 6)
+#define N_PUNCT_COLS 2
+
+#define FORMAT_INT16 0
+#define FORMAT_FLOAT32 1
+
+#define EQ_MMSE_IRC 2
+
+/* profiled stages and counters */
+enum {
+  PROF_SLOT, PROF_CAPTURE, PROF_OFDMA_DEMOD, PROF_CHAN_EST, PROF_EQUALIZER, PROF_RX_BACKEND, PROF_LDPC,
+  PROF_DESEGMENTATION, PROF_STAGES
+};
+enum {
+  CNT_RE, CNT_CODE_BLOCKS, CNT_LDPC_ITER, CNT_LDPC_EARLY_STOP, CNT_BYTES_ALLOCATED, PROF_COUNTERS
+};
+
+static const char* const prof_stage_names[PROF_STAGES] = {
+  "slot", "capture", "ofdma_demodulator", "chan_est", "equalizer", "rx_backend", "ldpc_decode", "desegmentation"
+};
+static const char* const prof_counter_names[PROF_COUNTERS] = {
+  "re", "code_blocks", "ldpc_iterations", "ldpc_early_stop", "bytes_allocated"
+};
+
+typedef struct {
+  int rnti, mcs, mcs_table, N_layer, ports[EQ_MAX_LAYER];
+  int prb_start, prb_num, symbol_start, symbols;
+  int dmrs_config_type, dmrs_add_pos, dmrs_typeA_pos, dmrs_scrambling_id, n_scid;
+  int data_scrambling_id, rv;
+
+  /* derived parameters */
+  int Q_m, tbs, L_tb, bg, Z_c, cols, N_dmrs;
+  int l_dmrs[MAX_DMRS_SYM];
+  size_t C, N, K, Kp, k_0, Fbst, Fbsz, G;
+  double E[MAX_CB];
+  nr_crc_t tb_crc;
+  const base_graph_t* graph;
+} ue_cfg_t;
+
+typedef struct {
+  int fr, n_rb, n_rx, format, max_slots;
+  double scs, band, int16_scale;
+  size_t sample_offset;
+  int slot_offset;
+  int equalizer, chan_est_avg;
+  int ldpc_method, ldpc_max_iter, ldpc_num_threads;
+  int ldpc_crc_term, ldpc_patience;
+  double ldpc_param;
+  int profile;
+  char crc_out[1024];
+  char llr_out[1024];
+  char trace_out[1024];
+  int N_ue;
+  ue_cfg_t ue[MAX_UE];
+} replay_cfg_t;
+
+typedef struct {
+  int u, N_fft, N_sc, N_RB, N_subframe_slot, N_frame_slot;
+} frame_cfg_t;
+
+/* -------------------------------------------------------------------------
+ * framing (nr_framing_constants, nr_cyclic_prefix_len, nr_samples_in_slot)
+ */
+
+static int framing_constants(int FR, double scs, double band, int N_RB_sel, frame_cfg_t* f) {
+  static const double fr1_band[13] = {5, 10, 15, 20, 25, 30, 40, 50, 60, 70, 80, 90, 100};
+  static const int fr1_N_RB[3][13] = {
+    { 25,  52,  79, 106, 133, 160, 216, 270,  -1,  -1,  -1,  -1,  -1},
+    { 11,  24,  38,  51,  65,  78, 106, 133, 162, 189, 217, 245, 273},
+    { -1,  11,  18,  24,  31,  38,  51,  65,  79,  93, 107, 121, 135}};
+  static const double fr1_guard[3][13] = {
+    {242.5, 312.5, 382.5, 452.5, 522.5, 592.5, 552.5, 692.5,    -1,   -1,   -1,   -1,   -1},
+    {  505,   665,   645,   805,   785,   945,   905,  1045,   825,  965,  925,  885,  845},
+    {   -1,  1010,   990,  1330,  1310,  1290,  1610,  1570,  1530, 1490, 1450, 1410, 1370}};
+  static const double fr2_band[4] = {50, 100, 200, 400};
+  static const int fr2_N_RB[2][4] = {{66, 132, 264, -1}, {32, 66, 132, 264}};
+  static const double fr2_guard[2][4] = {{1210, 2450, 4930, -1}, {1900, 2420, 4900, 9860}};
+  int scs_idx, band_idx, n;
+  double min_guard;
+
+  f->u = (int) floor(log2(scs / 15e3) + 0.5);
+  if (f->u < 0 || f->u > 3 || scs != 15e3 * (1 << f->u))
+    return 0;
+
+  band_idx = -1;
+  if (FR == 1) {
+    scs_idx = f->u;
+    for (n = 0; n < 13; n++)
+      if (fr1_band[n] == band)
+        band_idx = n;
+    if (scs_idx > 2 || band_idx < 0)
+      return 0;
+    f->N_RB = fr1_N_RB[scs_idx][band_idx];
+    min_guard = fr1_guard[scs_idx][band_idx] * 1e3;
+  } else if (FR == 2) {
+    scs_idx = f->u - 2;
+    for (n = 0; n < 4; n++)
+      if (fr2_band[n] == band)
+        band_idx = n;
+    if (scs_idx < 0 || band_idx < 0)
+      return 0;
+    f->N_RB = fr2_N_RB[scs_idx][band_idx];
+    min_guard = fr2_guard[scs_idx][band_idx] * 1e3;
+  } else {
+    return 0;
+  }
+
+  if (f->N_RB < 0)
+    return 0;
+  if (N_RB_sel > 0) {
+    if (N_RB_sel > f->N_RB)
+      return 0;
+    f->N_RB = N_RB_sel;
+  }
+
+  f->N_sc = f->N_RB * N_SC_RB;
+  f->N_fft = 0;
+  for (n = 256; n <= 4096 && f->N_fft == 0; n *= 2)
+    if (f->N_sc * scs + 2 * min_guard < n * scs)
+      f->N_fft = n;
+
+  f->N_subframe_slot = 1 << f->u;
+  f->N_frame_slot = 10 << f->u;
+
+  return f->N_fft > 0;
+}
+
+static void cyclic_prefix_len(const frame_cfg_t* f, int slot_num, size_t* N_cp_first, size_t* N_cp_other) {
+  int slot_in_sf = slot_num & (f->N_subframe_slot - 1);
+
+  /* cp_scale = N_fft / (2048 / 2^u) is fractional for small N_fft */
+  *N_cp_other = (size_t) f->N_fft * 144 / 2048;
+  if (slot_in_sf == 0 || (f->u > 0 && slot_in_sf == (1 << (f->u - 1))))
+    *N_cp_first = (size_t) f->N_fft * (144 + (16 << f->u)) / 2048;
+  else
+    *N_cp_first = *N_cp_other;
+}
+
+static size_t samples_in_slot(const frame_cfg_t* f, int slot_num) {
+  size_t N_cp_first, N_cp_other;
+
+  cyclic_prefix_len(f, slot_num, &N_cp_first, &N_cp_other);
+  if (f->u == 0)
+    return 2 * N_cp_first + (N_SLOT_SYMBOL - 2) * N_cp_other + N_SLOT_SYMBOL * (size_t) f->N_fft;
+  return N_cp_first + (N_SLOT_SYMBOL - 1) * N_cp_other + N_SLOT_SYMBOL * (size_t) f->N_fft;
+}
+
+/* -------------------------------------------------------------------------
+ * transport block parameters (nr_resolve_mcs, nr_transport_block_size,
+ * nr_sch_decode, nr_38_212_rate_unmatching_params)
+ */
+
+static int resolve_mcs(int I_mcs, int tbl_no, int* Q_m, double* R) {
+  static const double tbl1[29][2] = {
+    {2, 120}, {2, 157}, {2, 193}, {2, 251}, {2, 308}, {2, 379}, {2, 449}, {2, 526}, {2, 602}, {2, 679},
+    {4, 340}, {4, 378}, {4, 434}, {4, 490}, {4, 553}, {4, 616}, {4, 658},
+    {6, 438}, {6, 466}, {6, 517}, {6, 567}, {6, 616}, {6, 666}, {6, 719}, {6, 772}, {6, 822}, {6, 873}, {6, 910}, {6, 948}};
+  static const double tbl2[28][2] = {
+    {2, 120}, {2, 193}, {2, 308}, {2, 449}, {2, 602},
+    {4, 378}, {4, 434}, {4, 490}, {4, 553}, {4, 616}, {4, 658},
+    {6, 466}, {6, 517}, {6, 567}, {6, 616}, {6, 666}, {6, 719}, {6, 772}, {6, 822}, {6, 873},
+    {8, 682.5}, {8, 711}, {8, 754}, {8, 797}, {8, 841}, {8, 885}, {8, 916.5}, {8, 948}};
+
+  if (tbl_no == 1 && I_mcs >= 0 && I_mcs < 29) {
+    *Q_m = (int) tbl1[I_mcs][0];
+    *R = tbl1[I_mcs][1] / 1024;
+  } else if (tbl_no == 2 && I_mcs >= 0 && I_mcs < 28) {
+    *Q_m = (int) tbl2[I_mcs][0];
+    *R = tbl2[I_mcs][1] / 1024;
+  } else {
+    return 0;
+  }
+  return 1;
+}
+
+static int transport_block_size(int N_sh_symb, int n_PRB, int N_layers, int Q_m, double R) {
+  static const int tbl_5_1_3_2_2[93] = {24, 32, 40, 48, 56, 64, 72, 80, 88, 96, 104, 112, 120, 128, 136, 144, 152, 160, 168, 176, 184, 192, 208, 224, 240, 256, 272, 288, 304, 320, 336, 352, 368, 384, 408, 432, 456, 480, 504, 528, 552, 576, 608, 640, 672, 704, 736, 768, 808, 848, 888, 928, 984, 1032, 1064, 1128, 1160, 1192, 1224, 1256, 1288, 1320, 1352, 1416, 1480, 1544, 1608, 1672, 1736, 1800, 1864, 1928, 2024, 2088, 2152, 2216, 2280, 2408, 2472, 2536, 2600, 2664, 2728, 2792, 2856, 2976, 3104, 3240, 3368, 3496, 3624, 3752, 3824};
+  int Np_RE = N_SC_RB * N_sh_symb, Ndp_RE, n, t, C;
+  double N_info, Np_info;
+
+  if (Np_RE <= 9) Ndp_RE = 6;
+  else if (Np_RE <= 15) Ndp_RE = 12;
+  else if (Np_RE <= 30) Ndp_RE = 18;
+  else if (Np_RE <= 57) Ndp_RE = 42;
+  else if (Np_RE <= 90) Ndp_RE = 72;
+  else if (Np_RE <= 126) Ndp_RE = 108;
+  else if (Np_RE <= 150) Ndp_RE = 144;
+  else Ndp_RE = 156;
+
+  N_info = Ndp_RE * n_PRB * R * Q_m * N_layers;
+
+  if (N_info <= 3824) {
+    n = (int) floor(log2(N_info)) - 6;
+    if (n < 3)
+      n = 3;
+    Np_info = ldexp(floor(ldexp(N_info, -n)), n);
+    if (Np_info < 24)
+      Np_info = 24;
+    for (t = 0; t < 93; t++)
+      if (tbl_5_1_3_2_2[t] >= Np_info)
+        return tbl_5_1_3_2_2[t];
+    return tbl_5_1_3_2_2[92];
+  }
+
+  n = (int) floor(log2(N_info - 24)) - 5;
+  Np_info = ldexp(floor(ldexp(N_info - 24, -n) + 0.5), n);
+
+  if (R <= 0.25)
+    C = (int) ceil((Np_info + 24) / 3816);
+  else if (Np_info > 8424)
+    C = (int) ceil((Np_info + 24) / 8424);
+  else
+    C = 1;
+
+  return 8 * C * (int) ceil((Np_info + 24) / (8 * C)) - 24;
+}
+
+static int dmrs_positions(const ue_cfg_t* ue, int* l) {
+  /* single-symbol DMRS, {count, positions}, -1 stands for typeA_pos */
+  static const signed char tbl[2][4][8][5] = {
+    {{{1,-1}, {1,-1}, {1,-1}, {1,-1}, {1,-1}, {1,-1}, {1,-1}, {1,-1}},
+     {{0}, {0}, {2,-1,7}, {2,-1,9}, {2,-1,9}, {2,-1,9}, {2,-1,11}, {2,-1,11}},
+     {{0}, {0}, {0}, {3,-1,6,9}, {3,-1,6,9}, {3,-1,6,9}, {3,-1,7,11}, {3,-1,7,11}},
+     {{0}, {0}, {0}, {0}, {0}, {4,-1,5,8,11}, {4,-1,5,8,11}, {4,-1,5,8,11}}},
+    {{{1,0}, {1,0}, {1,0}, {1,0}, {1,0}, {1,0}, {1,0}, {0}},
+     {{2,0,4}, {2,0,6}, {2,0,6}, {2,0,8}, {2,0,8}, {2,0,10}, {2,0,10}, {0}},
+     {{0}, {3,0,3,6}, {3,0,3,6}, {3,0,4,8}, {3,0,4,8}, {3,0,5,10}, {3,0,5,10}, {0}},
+     {{0}, {0}, {0}, {4,0,3,6,9}, {4,0,3,6,9}, {4,0,3,6,9}, {4,0,3,6,9}, {0}}}};
+  const signed char* p;
+  int dur_idx, n;
+
+  if (ue->dmrs_config_type < 1 || ue->dmrs_config_type > 2 || ue->dmrs_add_pos < 0 || ue->dmrs_add_pos > 3)
+    return 0;
+  if (ue->dmrs_config_type == 1 && ue->dmrs_add_pos == 3 && ue->dmrs_typeA_pos != 2)
+    return 0;
+
+  dur_idx = (ue->symbols <= 7) ? 0 : ue->symbols - 7;
+  p = tbl[ue->dmrs_config_type - 1][ue->dmrs_add_pos][dur_idx];
+
+  for (n = 0; n < p[0]; n++) {
+    l[n] = (p[1+n] < 0) ? ue->dmrs_typeA_pos : p[1+n];
+    /* type 1 positions are given relative to the slot start */
+    if (ue->dmrs_config_type == 1)
+      l[n] -= ue->symbol_start;
+    if (l[n] < 0 || l[n] >= ue->symbols)
+      return 0;
+  }
+
+  return p[0];
+}
+
+/* derives all per-UE parameters, returns an error message or NULL */
+static const char* ue_setup(const frame_cfg_t* f, const replay_cfg_t* cfg, ue_cfg_t* ue) {
+  static const double crc16[17] = {1,0,0,0,1,0,0,0,0,0,0,1,0,0,0,0,1};
+  static const double crc24a[25] = {1,1,0,0,0,0,1,1,0,0,1,0,0,1,1,0,0,1,1,1,1,1,0,1,1};
+  static const int k_0_tbl[2][4] = {{0, 17, 33, 56}, {0, 13, 25, 43}};
+  double R;
+  size_t B, Bp, K_cb, K_b, L, r, GdQ;
+  int n;
+
+  if (ue->prb_num <= 0)
+    ue->prb_num = f->N_RB - ue->prb_start;
+  if (ue->prb_start < 0 || ue->prb_start + ue->prb_num > f->N_RB)
+    return "PRB allocation exceeds the carrier";
+  if (ue->symbol_start < 0 || ue->symbols < 1 || ue->symbol_start + ue->symbols > N_SLOT_SYMBOL)
+    return "symbol allocation exceeds the slot";
+  if (ue->N_layer < 1 || ue->N_layer > EQ_MAX_LAYER || ue->N_layer > cfg->n_rx)
+    return "number of layers (ports) must be 1 to 4, not exceeding the number of receive antennas";
+  for (n = 0; n < ue->N_layer; n++)
+    if (ue->ports[n] < 0 || ue->ports[n] > ((ue->dmrs_config_type == 1) ? 7 : 11))
+      return "invalid antenna port";
+  if (ue->rv < 0 || ue->rv > 3)
+    return "rv must be 0 to 3";
+  if (!resolve_mcs(ue->mcs, ue->mcs_table, &ue->Q_m, &R))
+    return "invalid MCS index or table";
+
+  ue->N_dmrs = dmrs_positions(ue, ue->l_dmrs);
+  if (ue->N_dmrs == 0)
+    return "invalid DMRS configuration";
+
+  ue->tbs = transport_block_size(ue->symbols - (ue->dmrs_add_pos + 1), ue->prb_num, ue->N_layer, ue->Q_m, R);
+  ue->G = (size_t)(ue->symbols - ue->N_dmrs) * ue->prb_num * N_SC_RB * ue->N_layer * ue->Q_m;
+
+  /* transport block CRC and base graph selection */
+  if (ue->tbs > 3824) {
+    ue->L_tb = 24;
+    nr_crc_init(&ue->tb_crc, crc24a, 25);
+  } else {
+    ue->L_tb = 16;
+    nr_crc_init(&ue->tb_crc, crc16, 17);
+  }
+  ue->bg = (ue->tbs <= 292 || (ue->tbs <= 3824 && R <= 0.67) || R <= 0.25) ? 2 : 1;
+
+  /* codeblock segmentation and rate matching parameters */
+  B = (size_t)(ue->tbs + ue->L_tb);
+  if (ue->bg == 1) {
+    K_cb = 8448;
+    K_b = 22;
+  } else {
+    K_cb = 3840;
+    K_b = (B > 640) ? 10 : (B > 560) ? 9 : (B > 192) ? 8 : 6;
+  }
+
+  if (B < K_cb) {
+    ue->C = 1;
+    L = 0;
+    Bp = B;
+  } else {
+    L = 24;
+    ue->C = (B + K_cb - L - 1) / (K_cb - L);
+    Bp = B + ue->C * L;
+  }
+  if (ue->C > sizeof(ue->E) / sizeof(ue->E[0]))
+    return "too many codeblocks";
+
+  ue->Z_c = ldpc_lifting_size_min((int)((Bp + ue->C * K_b - 1) / (ue->C * K_b)));
+  if (ue->Z_c == 0)
+    return "no lifting size for the transport block";
+
+  ue->N = (ue->bg == 1) ? 66 * ue->Z_c : 50 * ue->Z_c;
+  ue->K = (ue->bg == 1) ? 22 * ue->Z_c : 10 * ue->Z_c;
+  ue->k_0 = (size_t) k_0_tbl[ue->bg - 1][ue->rv] * ue->Z_c;
+  ue->Kp = Bp / ue->C;
+  ue->Fbst = ue->Kp - 2 * ue->Z_c;
+  ue->Fbsz = ue->K - ue->Kp;
+
+  GdQ = ue->G / (ue->N_layer * ue->Q_m);
+  for (r = 0; r < ue->C; r++) {
+    if (r <= ue->C - GdQ % ue->C)
+      ue->E[r] = (double)(ue->N_layer * ue->Q_m * (GdQ / ue->C));
+    else
+      ue->E[r] = (double)(ue->N_layer * ue->Q_m * ((GdQ + ue->C - 1) / ue->C));
+  }
+
+  ue->cols = (ue->bg == 1) ? 68 : 52;
+  ue->graph = ldpc_graph_lookup(ue->bg, ue->Z_c);
+  if (ue->graph == NULL)
+    return "out of memory";
+
+  return NULL;
+}
+
+/* -------------------------------------------------------------------------
+ * configuration file
+ */
+
+static void cfg_defaults(replay_cfg_t* cfg) {
+  memset(cfg, 0, sizeof(*cfg));
+  cfg->fr = 1;
+  cfg->scs = 30e3;
+  cfg->band = 40;
+  cfg->n_rx = 1;
+  cfg->format = FORMAT_INT16;
+  cfg->int16_scale = 1.0 / 32768;
+  cfg->equalizer = EQ_MMSE;
+  cfg->chan_est_avg = 3;
+  cfg->ldpc_method = LDPC_METHOD_NMS;
+  cfg->ldpc_param = -1;
+  cfg->ldpc_max_iter = 25;
+  strcpy(cfg->crc_out, "-");
+}
+
+static void ue_defaults(ue_cfg_t* ue) {
+  memset(ue, 0, sizeof(*ue));
+  ue->mcs_table = 1;
+  ue->N_layer = 1;
+  ue->symbols = N_SLOT_SYMBOL;
+  ue->dmrs_config_type = 1;
+  ue->dmrs_typeA_pos = 2;
+}
+
+static int parse_ports(const char* v, ue_cfg_t* ue) {
+  char* end;
+
+  ue->N_layer = 0;
+  while (*v != '\0') {
+    if (ue->N_layer == EQ_MAX_LAYER)
+      return 0;
+    ue->ports[ue->N_layer++] = (int) strtol(v, &end, 10);
+    if (end == v)
+      return 0;
+    v = end;
+    while (*v == ',' || isspace((unsigned char) *v))
+      v++;
+  }
+  return ue->N_layer > 0;
+}
+
+static int cfg_set(replay_cfg_t* cfg, ue_cfg_t* ue, const char* k, const char* v) {
+  if (ue != NULL) {
+    if (!strcmp(k, "rnti")) ue->rnti = atoi(v);
+    else if (!strcmp(k, "mcs")) ue->mcs = atoi(v);
+    else if (!strcmp(k, "mcs_table")) ue->mcs_table = atoi(v);
+    else if (!strcmp(k, "ports")) return parse_ports(v, ue);
+    else if (!strcmp(k, "prb_start")) ue->prb_start = atoi(v);
+    else if (!strcmp(k, "prb_num")) ue->prb_num = atoi(v);
+    else if (!strcmp(k, "symbol_start")) ue->symbol_start = atoi(v);
+    else if (!strcmp(k, "symbols")) ue->symbols = atoi(v);
+    else if (!strcmp(k, "dmrs_config_type")) ue->dmrs_config_type = atoi(v);
+    else if (!strcmp(k, "dmrs_add_pos")) ue->dmrs_add_pos = atoi(v);
+    else if (!strcmp(k, "dmrs_typeA_pos")) ue->dmrs_typeA_pos = atoi(v);
+    else if (!strcmp(k, "dmrs_scrambling_id")) ue->dmrs_scrambling_id = atoi(v);
+    else if (!strcmp(k, "n_scid")) ue->n_scid = atoi(v);
+    else if (!strcmp(k, "data_scrambling_id")) ue->data_scrambling_id = atoi(v);
+    else if (!strcmp(k, "rv")) ue->rv = atoi(v);
+    else return 0;
+    return 1;
+  }
+
+  if (!strcmp(k, "fr")) cfg->fr = atoi(v);
+  else if (!strcmp(k, "scs")) cfg->scs = atof(v);
+  else if (!strcmp(k, "band")) cfg->band = atof(v);
+  else if (!strcmp(k, "n_rb")) cfg->n_rb = atoi(v);
+  else if (!strcmp(k, "n_rx")) cfg->n_rx = atoi(v);
+  else if (!strcmp(k, "int16_scale")) cfg->int16_scale = atof(v);
+  else if (!strcmp(k, "sample_offset")) cfg->sample_offset = (size_t) strtoull(v, NULL, 10);
+  else if (!strcmp(k, "slot_offset")) cfg->slot_offset = atoi(v);
+  else if (!strcmp(k, "max_slots")) cfg->max_slots = atoi(v);
+  else if (!strcmp(k, "chan_est_avg")) cfg->chan_est_avg = atoi(v);
+  else if (!strcmp(k, "ldpc_param")) cfg->ldpc_param = atof(v);
+  else if (!strcmp(k, "ldpc_max_iter")) cfg->ldpc_max_iter = atoi(v);
+  else if (!strcmp(k, "ldpc_num_threads")) cfg->ldpc_num_threads = atoi(v);
+  else if (!strcmp(k, "ldpc_crc_term")) cfg->ldpc_crc_term = atoi(v);
+  else if (!strcmp(k, "ldpc_patience")) cfg->ldpc_patience = atoi(v);
+  else if (!strcmp(k, "crc_out")) snprintf(cfg->crc_out, sizeof(cfg->crc_out), "%s", v);
+  else if (!strcmp(k, "llr_out")) snprintf(cfg->llr_out, sizeof(cfg->llr_out), "%s", v);
+  else if (!strcmp(k, "profile")) cfg->profile = atoi(v);
+  else if (!strcmp(k, "trace_out")) snprintf(cfg->trace_out, sizeof(cfg->trace_out), "%s", v);
+  else if (!strcmp(k, "format")) {
+    if (!strcmp(v, "int16")) cfg->format = FORMAT_INT16;
+    else if (!strcmp(v, "float32")) cfg->format = FORMAT_FLOAT32;
+    else return 0;
+  } else if (!strcmp(k, "equalizer")) {
+    if (!strcmp(v, "ZF")) cfg->equalizer = EQ_ZF;
+    else if (!strcmp(v, "MMSE")) cfg->equalizer = EQ_MMSE;
+    else if (!strcmp(v, "MMSE-IRC")) cfg->equalizer = EQ_MMSE_IRC;
+    else return 0;
+  } else if (!strcmp(k, "ldpc_method")) {
+    if (!strcmp(v, "NMS")) cfg->ldpc_method = LDPC_METHOD_NMS;
+    else if (!strcmp(v, "OMS")) cfg->ldpc_method = LDPC_METHOD_OMS;
+    else return 0;
+  } else {
+    return 0;
+  }
+  return 1;
+}
+
+static char* trim(char* s) {
+  char* e;
+
+  while (isspace((unsigned char) *s))
+    s++;
+  e = s + strlen(s);
+  while (e > s && isspace((unsigned char) e[-1]))
+    *--e = '\0';
+  return s;
+}
+
+static int cfg_load(const char* path, replay_cfg_t* cfg) {
+  char line[1024];
+  char *k, *v, *eq;
+  FILE* fp;
+  int n = 0, ok = 1;
+
+  fp = fopen(path, "r");
+  if (fp == NULL) {
+    fprintf(stderr, "nr_pusch_replay: cannot open %s\n", path);
+    return 0;
+  }
+
+  cfg_defaults(cfg);
+
+  while (ok && fgets(line, sizeof(line), fp) != NULL) {
+    n++;
+    if ((k = strchr(line, '#')) != NULL)
+      *k = '\0';
+    k = trim(line);
+    if (*k == '\0')
+      continue;
+
+    if (!strcmp(k, "[ue]")) {
+      if (cfg->N_ue == MAX_UE) {
+        fprintf(stderr, "nr_pusch_replay: %s:%d: at most %d UEs supported\n", path, n, MAX_UE);
+        ok = 0;
+      } else {
+        ue_defaults(&cfg->ue[cfg->N_ue++]);
+      }
+      continue;
+    }
+
+    eq = strchr(k, '=');
+    if (eq == NULL) {
+      fprintf(stderr, "nr_pusch_replay: %s:%d: key = value expected\n", path, n);
+      ok = 0;
+      continue;
+    }
+    *eq = '\0';
+    v = trim(eq + 1);
+    k = trim(k);
+
+    if (!cfg_set(cfg, (cfg->N_ue > 0) ? &cfg->ue[cfg->N_ue - 1] : NULL, k, v)) {
+      fprintf(stderr, "nr_pusch_replay: %s:%d: invalid key or value '%s'\n", path, n, k);
+      ok = 0;
+    }
+  }
+
+  fclose(fp);
+
+  if (ok && cfg->N_ue == 0) {
+    fprintf(stderr, "nr_pusch_replay: no [ue] configured\n");
+    ok = 0;
+  }
+  if (ok && (cfg->n_rx < 1 || cfg->n_rx > EQ_MAX_RX)) {
+    fprintf(stderr, "nr_pusch_replay: n_rx must be 1 to %d\n", EQ_MAX_RX);
+    ok = 0;
+  }
+  if (cfg->ldpc_param < 0)
+    cfg->ldpc_param = (cfg->ldpc_method == LDPC_METHOD_OMS) ? 0.5 : 0.75;
+  if (cfg->chan_est_avg < 1)
+    cfg->chan_est_avg = 1;
+
+  return ok;
+}
+
+/* -------------------------------------------------------------------------
+ * receiver
+ */
+
+typedef struct {
+  /* demodulated slot, N_sc x N_SLOT_SYMBOL x n_rx */
+  double* x_re;
+  double* x_im;
+  /* data REs, N x n_rx, and channel estimates, N x N_layer x n_rx */
+  double* y_re;
+  double* y_im;
+  double* H_re;
+  double* H_im;
+  /* equalized symbols and their noise variance, N x N_layer */
+  double* x_eq_re;
+  double* x_eq_im;
+  double* x_eq_N0;
+  /* layer demapped symbols */
+  double* d_re;
+  double* d_im;
+  double* d_N0;
+  /* decoder input, hard decisions and transport block */
+  double* D;
+  double* sh;
+  double* b;
+  float* llr;
+  double cw_valid[MAX_CB];
+  double iter[MAX_CB];
+  double cb_crc_ok[MAX_CB];
+  ldpc_term_stats_t stats[MAX_CB];
+  /* decoder workspaces per UE and worker */
+  ldpc_layered_ws_t* ws[MAX_UE][THREAD_POOL_MAX];
+} rx_ws_t;
+
+typedef struct {
+  const replay_cfg_t* cfg;
+  const ue_cfg_t* ue;
+  ldpc_layered_ws_t** ws;
+  const ldpc_term_t* term;
+  rx_ws_t* w;
+  int failed;
+} decode_batch_t;
+
+/* DMRS subcarrier (relative to the allocation start) of pilot m of a port
+ * (nr_38_211_sch_dmrs_re_mapping) */
+static int dmrs_subcarrier(int config_type, int port, int m) {
+  if (config_type == 1)
+    return 4 * (m / 2) + 2 * (m % 2) + ((port % 4 == 2 || port % 4 == 3) ? 1 : 0);
+  return 6 * (m / 2) + (m % 2) + 2 * ((port % 6) / 2);
+}
+
+/* M DMRS symbols of a port in PUSCH symbol l (nr_38_211_sch_dmrs_gen_symbol
+ * with identity precoding) */
+static void dmrs_symbols(const ue_cfg_t* ue, int slot_num, int l, int port, size_t M, double* r_re, double* r_im) {
+  size_t dmrs_per_rb = (ue->dmrs_config_type == 1) ? 6 : 4;
+  size_t n0 = ue->prb_start * dmrs_per_rb, m, n, words;
+  uint64_t N_ID = (uint64_t) ue->dmrs_scrambling_id;
+  uint32_t c_init, c = 0;
+  double w_f;
+  gold31_t g;
+
+  c_init = (uint32_t)(((1ULL << 17) * (uint64_t)(14 * slot_num + ue->symbol_start + l + 1) * (2 * N_ID + 1) + 2 * N_ID + (uint64_t) ue->n_scid) & 0x7FFFFFFF);
+  gold31_start(&g, c_init);
+
+  words = 0;
+  for (m = 0; m < M; m++) {
+    /* bits 2n and 2n+1 are in the same word */
+    n = 2 * (n0 + m);
+    while (words <= n / 32) {
+      c = gold31_next(&g);
+      words++;
+    }
+    w_f = ((port % 2) == 1 && (m % 2) == 1) ? -M_SQRT1_2 : M_SQRT1_2;
+    r_re[m] = ((c >> (n % 32)) & 1) ? -w_f : w_f;
+    r_im[m] = ((c >> ((n + 1) % 32)) & 1) ? -w_f : w_f;
+  }
+}
+
+/* LS estimates at M pilots averaged over avg neighbouring pilots, returns
+ * the noise variance estimated from the residuals */
+static double pilot_estimate(const double* y_re, const double* y_im, const double* r_re, const double* r_im, size_t M, int avg,
+                             double* h_re, double* h_im) {
+  double ls_re[MAX_PILOT], ls_im[MAX_PILOT];
+  double acc_re, acc_im, e = 0.0;
+  size_t m, i, lo, hi;
+
+  for (m = 0; m < M; m++) {
+    ls_re[m] = y_re[m] * r_re[m] + y_im[m] * r_im[m];
+    ls_im[m] = y_im[m] * r_re[m] - y_re[m] * r_im[m];
+  }
+
+  for (m = 0; m < M; m++) {
+    lo = (m >= (size_t)(avg / 2)) ? m - avg / 2 : 0;
+    hi = (m + (avg - 1) / 2 < M) ? m + (avg - 1) / 2 : M - 1;
+    acc_re = 0.0;
+    acc_im = 0.0;
+    for (i = lo; i <= hi; i++) {
+      acc_re += ls_re[i];
+      acc_im += ls_im[i];
+    }
+    h_re[m] = acc_re / (double)(hi - lo + 1);
+    h_im[m] = acc_im / (double)(hi - lo + 1);
+    e += (ls_re[m] - h_re[m]) * (ls_re[m] - h_re[m]) + (ls_im[m] - h_im[m]) * (ls_im[m] - h_im[m]);
+  }
+
+  /* the residual of an average of avg pilots holds (avg-1)/avg of the noise */
+  if (avg > 1)
+    e *= (double) avg / (avg - 1);
+  return e / (double) M;
+}
+
+/* channel estimate of one layer and antenna on N_k subcarriers of the
+ * allocation and all data symbols l_data from the pilot estimates hp (M
+ * per DMRS symbol), linear interpolation in frequency and time with
+ * constant extrapolation at the edges */
+static void interpolate(const ue_cfg_t* ue, int port, const double* hp_re, const double* hp_im, size_t M, size_t N_k,
+                        const int* l_data, int N_data, double* hf_re, double* hf_im, double* H_re, double* H_im) {
+  double a;
+  size_t k, m;
+  int s, j, k0, k1;
+
+  for (s = 0; s < ue->N_dmrs; s++) {
+    m = 0;
+    for (k = 0; k < N_k; k++) {
+      while (m + 1 < M && dmrs_subcarrier(ue->dmrs_config_type, port, (int) m + 1) <= (int) k)
+        m++;
+      k0 = dmrs_subcarrier(ue->dmrs_config_type, port, (int) m);
+      k1 = (m + 1 < M) ? dmrs_subcarrier(ue->dmrs_config_type, port, (int) m + 1) : k0;
+      a = ((int) k <= k0 || k1 == k0) ? 0.0 : (double)((int) k - k0) / (double)(k1 - k0);
+      hf_re[k + N_k*s] = (1 - a) * hp_re[m + M*s] + ((a > 0.0) ? a * hp_re[m + 1 + M*s] : 0.0);
+      hf_im[k + N_k*s] = (1 - a) * hp_im[m + M*s] + ((a > 0.0) ? a * hp_im[m + 1 + M*s] : 0.0);
+    }
+  }
+
+  for (j = 0; j < N_data; j++) {
+    for (s = 0; s + 1 < ue->N_dmrs && ue->l_dmrs[s + 1] < l_data[j]; s++)
+      ;
+    if (s + 1 == ue->N_dmrs || l_data[j] < ue->l_dmrs[s]) {
+      memcpy(H_re + N_k*j, hf_re + N_k*s, N_k * sizeof(double));
+      memcpy(H_im + N_k*j, hf_im + N_k*s, N_k * sizeof(double));
+    } else {
+      a = (double)(l_data[j] - ue->l_dmrs[s]) / (double)(ue->l_dmrs[s + 1] - ue->l_dmrs[s]);
+      for (k = 0; k < N_k; k++) {
+        H_re[k + N_k*j] = (1 - a) * hf_re[k + N_k*s] + a * hf_re[k + N_k*(s + 1)];
+        H_im[k + N_k*j] = (1 - a) * hf_im[k + N_k*s] + a * hf_im[k + N_k*(s + 1)];
+      }
+    }
+  }
+}
+
+/* malloc accounted in counter bytes_allocated */
+static void* rx_malloc(size_t n, nr_prof_t* prof) {
+  nr_prof_count(prof, CNT_BYTES_ALLOCATED, (double) n);
+  return malloc(n);
+}
+
+static void decode_task(void* ctx, int r, int worker) {
+  decode_batch_t* b = (decode_batch_t*) ctx;
+  const ue_cfg_t* ue = b->ue;
+
+  if (b->ws[worker] == NULL)
+    b->ws[worker] = ldpc_layered_ws_alloc(ue->graph, ue->Z_c);
+
+  if (b->ws[worker] == NULL) {
+    b->failed = 1;
+    return;
+  }
+
+  ldpc_layered_decode(ue->graph, b->ws[worker], b->w->D + r, ue->C, N_PUNCT_COLS, b->cfg->ldpc_max_iter, b->cfg->ldpc_method,
+    b->cfg->ldpc_param, b->term, b->w->sh + r, ue->C, b->w->cw_valid + r, b->w->iter + r, b->w->stats + r);
+}
+
+/* receives and decodes the transport block of UE u in the demodulated slot,
+ * returns zero if out of memory */
+static int ue_receive(const replay_cfg_t* cfg, const frame_cfg_t* f, int u, int slot_num, long slot_cnt, rx_ws_t* w, FILE* crc_fp, FILE* llr_fp,
+                      nr_prof_t* prof) {
+  static const double crc24b[25] = {1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,0,0,0,1,1};
+  const ue_cfg_t* ue = &cfg->ue[u];
+  double r_re[MAX_DMRS_SYM * MAX_PILOT], r_im[MAX_DMRS_SYM * MAX_PILOT];
+  double yp_re[MAX_DMRS_SYM * MAX_PILOT], yp_im[MAX_DMRS_SYM * MAX_PILOT];
+  double hp_re[MAX_DMRS_SYM * MAX_PILOT], hp_im[MAX_DMRS_SYM * MAX_PILOT];
+  double hf_re[MAX_DMRS_SYM * MAX_SC], hf_im[MAX_DMRS_SYM * MAX_SC];
+  double R_re[EQ_MAX_RX * EQ_MAX_RX], R_im[EQ_MAX_RX * EQ_MAX_RX], W_re[EQ_MAX_RX * EQ_MAX_RX], W_im[EQ_MAX_RX * EQ_MAX_RX];
+  double noise = 0.0, trace = 0.0, iter = 0.0, h_re, h_im, *e_re, *e_im, t_prof;
+  size_t N_k = (size_t) ue->prb_num * N_SC_RB, k_off = (size_t) ue->prb_start * N_SC_RB;
+  size_t M = ((ue->dmrs_config_type == 1) ? 6 : 4) * (size_t) ue->prb_num;
+  size_t N, n, m, k, i, r, n_sym, n_res = 0;
+  int l_data[N_SLOT_SYMBOL], N_data, N_rx = cfg->n_rx, L = ue->N_layer;
+  int l, s, j, lay, ant, a2, cb_ok, tb_ok, early;
+  nr_crc_t cb_crc;
+  ldpc_term_t term;
+  decode_batch_t batch;
+  int32_t hdr[4];
+  eq_t p;
+
+  N_data = 0;
+  for (l = 0, s = 0; l < ue->symbols; l++) {
+    if (s < ue->N_dmrs && ue->l_dmrs[s] == l)
+      s++;
+    else
+      l_data[N_data++] = l;
+  }
+  N = N_k * N_data;
+
+  /* DMRS residuals of all antennas are collected in the equalizer output
+   * buffer, which is not used before equalization */
+  e_re = w->x_eq_re;
+  e_im = w->x_eq_im;
+
+  /* channel estimation per layer and receive antenna */
+  t_prof = nr_prof_begin(prof);
+  for (lay = 0; lay < L; lay++) {
+    for (s = 0; s < ue->N_dmrs; s++)
+      dmrs_symbols(ue, slot_num, ue->l_dmrs[s], ue->ports[lay], M, r_re + M*s, r_im + M*s);
+
+    for (ant = 0; ant < N_rx; ant++) {
+      for (s = 0; s < ue->N_dmrs; s++) {
+        l = ue->symbol_start + ue->l_dmrs[s];
+        for (m = 0; m < M; m++) {
+          k = k_off + (size_t) dmrs_subcarrier(ue->dmrs_config_type, ue->ports[lay], (int) m);
+          yp_re[m + M*s] = w->x_re[k + f->N_sc * (l + N_SLOT_SYMBOL * ant)];
+          yp_im[m + M*s] = w->x_im[k + f->N_sc * (l + N_SLOT_SYMBOL * ant)];
+        }
+        noise += pilot_estimate(yp_re + M*s, yp_im + M*s, r_re + M*s, r_im + M*s, M, cfg->chan_est_avg, hp_re + M*s, hp_im + M*s);
+      }
+
+      interpolate(ue, ue->ports[lay], hp_re, hp_im, M, N_k, l_data, N_data, hf_re, hf_im,
+        w->H_re + N * (lay + L * ant), w->H_im + N * (lay + L * ant));
+
+      /* e = y - h x at pilots, each DMRS RE carries a single layer */
+      if (cfg->equalizer == EQ_MMSE_IRC) {
+        for (i = 0; i < M * ue->N_dmrs; i++) {
+          h_re = hp_re[i] * r_re[i] - hp_im[i] * r_im[i];
+          h_im = hp_re[i] * r_im[i] + hp_im[i] * r_re[i];
+          e_re[ant + N_rx * (n_res + i)] = yp_re[i] - h_re;
+          e_im[ant + N_rx * (n_res + i)] = yp_im[i] - h_im;
+        }
+      }
+    }
+    n_res += M * ue->N_dmrs;
+  }
+  noise /= (double)(L * N_rx * ue->N_dmrs);
+  nr_prof_end(prof, PROF_CHAN_EST, t_prof);
+
+  /* received data REs */
+  t_prof = nr_prof_begin(prof);
+  for (ant = 0; ant < N_rx; ant++)
+    for (j = 0; j < N_data; j++)
+      for (k = 0; k < N_k; k++) {
+        w->y_re[k + N_k * (j + N_data * ant)] = w->x_re[k_off + k + f->N_sc * (ue->symbol_start + l_data[j] + N_SLOT_SYMBOL * ant)];
+        w->y_im[k + N_k * (j + N_data * ant)] = w->x_im[k_off + k + f->N_sc * (ue->symbol_start + l_data[j] + N_SLOT_SYMBOL * ant)];
+      }
+
+  p.N = N;
+  p.single = 0;
+  p.N_layer = (size_t) L;
+  p.N_rx = (size_t) N_rx;
+  p.y_re = w->y_re;
+  p.y_im = w->y_im;
+  p.H_re = w->H_re;
+  p.H_im = w->H_im;
+  p.W_re = NULL;
+  p.W_im = NULL;
+  p.sigma2 = noise;
+  p.method = (cfg->equalizer == EQ_ZF) ? EQ_ZF : EQ_MMSE;
+
+  /* noise and interference covariance with diagonal loading, white noise
+   * is assumed if it is not positive definite */
+  if (cfg->equalizer == EQ_MMSE_IRC) {
+    memset(R_re, 0, sizeof(R_re));
+    memset(R_im, 0, sizeof(R_im));
+    for (n = 0; n < n_res; n++) {
+      for (ant = 0; ant < N_rx; ant++) {
+        for (a2 = 0; a2 < N_rx; a2++) {
+          /* R(ant,a2) += e(ant) conj(e(a2)) */
+          R_re[ant + N_rx*a2] += e_re[ant + N_rx*n] * e_re[a2 + N_rx*n] + e_im[ant + N_rx*n] * e_im[a2 + N_rx*n];
+          R_im[ant + N_rx*a2] += e_im[ant + N_rx*n] * e_re[a2 + N_rx*n] - e_re[ant + N_rx*n] * e_im[a2 + N_rx*n];
+        }
+      }
+    }
+    for (i = 0; i < (size_t)(N_rx * N_rx); i++) {
+      R_re[i] /= (double) n_res;
+      R_im[i] /= (double) n_res;
+    }
+    for (ant = 0; ant < N_rx; ant++)
+      trace += R_re[ant + N_rx*ant];
+    for (ant = 0; ant < N_rx; ant++)
+      R_re[ant + N_rx*ant] += 1e-2 * trace / N_rx;
+
+    if (trace > 0.0 && whitening_matrix(R_re, R_im, (size_t) N_rx, W_re, W_im)) {
+      p.W_re = W_re;
+      p.W_im = W_im;
+      p.sigma2 = 1.0;
+    }
+  }
+
+  p.x_re = w->x_eq_re;
+  p.x_im = w->x_eq_im;
+  p.n0 = w->x_eq_N0;
+  if (!mimo_equalizer(&p))
+    return 0;
+
+  /* layer demapping */
+  for (n = 0; n < N; n++) {
+    for (lay = 0; lay < L; lay++) {
+      w->d_re[lay + L*n] = w->x_eq_re[n + N*lay];
+      w->d_im[lay + L*n] = w->x_eq_im[n + N*lay];
+      w->d_N0[lay + L*n] = w->x_eq_N0[n + N*lay];
+    }
+  }
+  nr_prof_end(prof, PROF_EQUALIZER, t_prof);
+  nr_prof_count(prof, CNT_RE, (double)(N * L));
+
+  /* demapping, descrambling and rate unmatching */
+  t_prof = nr_prof_begin(prof);
+  n_sym = 0;
+  for (r = 0; r < ue->C; r++)
+    n_sym += (size_t) ue->E[r] / ue->Q_m;
+  memset(w->D, 0, ue->C * ue->N * sizeof(double));
+  sch_rx_backend(w->d_re, w->d_im, n_sym, w->d_N0, n_sym, ue->Q_m, ((uint32_t) ue->rnti << 15) + (uint32_t) ue->data_scrambling_id,
+    (double*) ue->E, ue->C, ue->N, ue->k_0, ue->Fbst, ue->Fbsz, w->D);
+  nr_prof_end(prof, PROF_RX_BACKEND, t_prof);
+
+  if (llr_fp != NULL) {
+    hdr[0] = (int32_t) slot_cnt;
+    hdr[1] = (int32_t) u;
+    hdr[2] = (int32_t) ue->C;
+    hdr[3] = (int32_t) ue->N;
+    fwrite(hdr, sizeof(int32_t), 4, llr_fp);
+    for (r = 0; r < ue->C; r++) {
+      for (n = 0; n < ue->N; n++)
+        w->llr[n] = (float) w->D[r + ue->C*n];
+      fwrite(w->llr, sizeof(float), ue->N, llr_fp);
+    }
+  }
+
+  /* LDPC decoding, codeblocks are distributed over worker threads, CRC-aided
+   * termination checks the codeblock CRC or the CRC of a single codeblock
+   * transport block */
+  if (ue->C > 1)
+    nr_crc_init(&cb_crc, crc24b, 25);
+  term.crc = cfg->ldpc_crc_term ? ((ue->C > 1) ? &cb_crc : &ue->tb_crc) : NULL;
+  term.crc_bits = ue->Kp;
+  term.patience = cfg->ldpc_patience;
+
+  batch.cfg = cfg;
+  batch.term = &term;
+  batch.ue = ue;
+  batch.ws = w->ws[u];
+  batch.w = w;
+  batch.failed = 0;
+  t_prof = nr_prof_begin(prof);
+  thread_pool_run(cfg->ldpc_num_threads, (int) ue->C, decode_task, &batch);
+  nr_prof_end(prof, PROF_LDPC, t_prof);
+  if (batch.failed)
+    return 0;
+
+  /* desegmentation and CRC checks */
+  t_prof = nr_prof_begin(prof);
+  tb_ok = code_block_desegmentation(w->sh, ue->C, ue->Kp, (size_t)(ue->tbs + ue->L_tb), (ue->C > 1) ? &cb_crc : NULL, &ue->tb_crc,
+    w->b, w->cb_crc_ok);
+  nr_prof_end(prof, PROF_DESEGMENTATION, t_prof);
+
+  cb_ok = 0;
+  early = 0;
+  for (r = 0; r < ue->C; r++) {
+    cb_ok += (w->cb_crc_ok[r] != 0.0);
+    iter += w->iter[r];
+    early += (w->stats[r].reason == LDPC_TERM_CRC || w->stats[r].reason == LDPC_TERM_STALL);
+  }
+  fprintf(crc_fp, "%ld %d %d %d %d %d %d %.2f %d\n", slot_cnt, u, ue->rnti, ue->tbs, tb_ok, cb_ok, (int) ue->C, iter / (double) ue->C, early);
+  nr_prof_count(prof, CNT_CODE_BLOCKS, (double) ue->C);
+  nr_prof_count(prof, CNT_LDPC_ITER, iter);
+  nr_prof_count(prof, CNT_LDPC_EARLY_STOP, (double) early);
+
+  return 1;
+}
+
+int main(int argc, char** argv) {
+  static replay_cfg_t cfg;
+  frame_cfg_t f;
+  rx_ws_t w;
+  nr_prof_t prof;
+  fft_radix2_t plan;
+  double *tw, *s, *y_re, *y_im, t_slot, t_prof;
+  const unsigned char* cap;
+  const int16_t* cap16;
+  const float* cap32;
+  struct stat st;
+  size_t cap_samples, pos, N_slot, N_cp_first, N_cp_other, max_N, max_C_N, t, i;
+  size_t sc_first, sc_last;
+  FILE *crc_fp, *llr_fp = NULL;
+  const char* err;
+  long slot_cnt;
+  int fd, u, ant, slot_num, ok = 1;
+
+  if (argc != 3) {
+    fprintf(stderr, "usage: nr_pusch_replay config_file capture_file\n");
+    return 2;
+  }
+
+  if (!cfg_load(argv[1], &cfg))
+    return 2;
+
+  if (!framing_constants(cfg.fr, cfg.scs, cfg.band, cfg.n_rb, &f)) {
+    fprintf(stderr, "nr_pusch_replay: unsupported carrier configuration\n");
+    return 2;
+  }
+
+  /* UE parameters and the band occupied by all UEs */
+  sc_first = (size_t) f.N_sc;
+  sc_last = 0;
+  max_N = 0;
+  max_C_N = 0;
+  for (u = 0; u < cfg.N_ue; u++) {
+    if ((err = ue_setup(&f, &cfg, &cfg.ue[u])) != NULL) {
+      fprintf(stderr, "nr_pusch_replay: UE %d: %s\n", u, err);
+      return 2;
+    }
+    if ((size_t) cfg.ue[u].prb_start * N_SC_RB < sc_first)
+      sc_first = (size_t) cfg.ue[u].prb_start * N_SC_RB;
+    if ((size_t)(cfg.ue[u].prb_start + cfg.ue[u].prb_num) * N_SC_RB > sc_last)
+      sc_last = (size_t)(cfg.ue[u].prb_start + cfg.ue[u].prb_num) * N_SC_RB;
+    t = (size_t) cfg.ue[u].prb_num * N_SC_RB * N_SLOT_SYMBOL;
+    if (t > max_N)
+      max_N = t;
+    t = cfg.ue[u].C * (size_t)((cfg.ue[u].cols * cfg.ue[u].Z_c > (int) cfg.ue[u].N) ? cfg.ue[u].cols * cfg.ue[u].Z_c : (int) cfg.ue[u].N);
+    if (t > max_C_N)
+      max_C_N = t;
+  }
+
+  /* memory mapped capture */
+  fd = open(argv[2], O_RDONLY);
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    fprintf(stderr, "nr_pusch_replay: cannot open %s\n", argv[2]);
+    return 2;
+  }
+  cap_samples = (size_t) st.st_size / (2 * cfg.n_rx * ((cfg.format == FORMAT_INT16) ? sizeof(int16_t) : sizeof(float)));
+  if (cap_samples == 0) {
+    fprintf(stderr, "nr_pusch_replay: capture %s is empty\n", argv[2]);
+    return 2;
+  }
+  cap = (const unsigned char*) mmap(NULL, (size_t) st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (cap == MAP_FAILED) {
+    fprintf(stderr, "nr_pusch_replay: cannot map %s\n", argv[2]);
+    return 2;
+  }
+  madvise((void*) cap, (size_t) st.st_size, MADV_SEQUENTIAL);
+  cap16 = (const int16_t*) cap;
+  cap32 = (const float*) cap;
+
+  crc_fp = (strcmp(cfg.crc_out, "-") == 0) ? stdout : fopen(cfg.crc_out, "w");
+  if (cfg.llr_out[0] != '\0')
+    llr_fp = fopen(cfg.llr_out, "wb");
+  if (crc_fp == NULL || (cfg.llr_out[0] != '\0' && llr_fp == NULL)) {
+    fprintf(stderr, "nr_pusch_replay: cannot open output files\n");
+    return 2;
+  }
+  fprintf(crc_fp, "# slot ue rnti tbs tb_crc_ok cb_crc_ok C mean_iter early_stop\n");
+
+  nr_prof_init(&prof, cfg.profile || cfg.trace_out[0] != '\0', cfg.trace_out[0] != '\0', prof_stage_names, PROF_STAGES,
+    prof_counter_names, PROF_COUNTERS);
+
+  /* buffers */
+  N_slot = samples_in_slot(&f, 0);
+  if (samples_in_slot(&f, 1) > N_slot)
+    N_slot = samples_in_slot(&f, 1);
+  memset(&w, 0, sizeof(w));
+  tw = rx_malloc(f.N_fft * sizeof(double), &prof);
+  s = rx_malloc(2 * f.N_fft * sizeof(double), &prof);
+  y_re = rx_malloc(N_slot * cfg.n_rx * sizeof(double), &prof);
+  y_im = rx_malloc(N_slot * cfg.n_rx * sizeof(double), &prof);
+  w.x_re = rx_malloc((size_t) f.N_sc * N_SLOT_SYMBOL * cfg.n_rx * sizeof(double), &prof);
+  w.x_im = rx_malloc((size_t) f.N_sc * N_SLOT_SYMBOL * cfg.n_rx * sizeof(double), &prof);
+  w.y_re = rx_malloc(max_N * cfg.n_rx * sizeof(double), &prof);
+  w.y_im = rx_malloc(max_N * cfg.n_rx * sizeof(double), &prof);
+  w.H_re = rx_malloc(max_N * EQ_MAX_LAYER * cfg.n_rx * sizeof(double), &prof);
+  w.H_im = rx_malloc(max_N * EQ_MAX_LAYER * cfg.n_rx * sizeof(double), &prof);
+  /* equalizer outputs also hold DMRS residuals of all antennas */
+  w.x_eq_re = rx_malloc(max_N * EQ_MAX_LAYER * cfg.n_rx * sizeof(double), &prof);
+  w.x_eq_im = rx_malloc(max_N * EQ_MAX_LAYER * cfg.n_rx * sizeof(double), &prof);
+  w.x_eq_N0 = rx_malloc(max_N * EQ_MAX_LAYER * sizeof(double), &prof);
+  w.d_re = rx_malloc(max_N * EQ_MAX_LAYER * sizeof(double), &prof);
+  w.d_im = rx_malloc(max_N * EQ_MAX_LAYER * sizeof(double), &prof);
+  w.d_N0 = rx_malloc(max_N * EQ_MAX_LAYER * sizeof(double), &prof);
+  w.D = rx_malloc(max_C_N * sizeof(double), &prof);
+  w.sh = rx_malloc(max_C_N * sizeof(double), &prof);
+  w.b = rx_malloc(max_C_N * sizeof(double), &prof);
+  w.llr = rx_malloc(max_C_N * sizeof(float), &prof);
+  if (tw == NULL || s == NULL || y_re == NULL || y_im == NULL || w.x_re == NULL || w.x_im == NULL || w.y_re == NULL || w.y_im == NULL ||
+      w.H_re == NULL || w.H_im == NULL || w.x_eq_re == NULL || w.x_eq_im == NULL || w.x_eq_N0 == NULL || w.d_re == NULL ||
+      w.d_im == NULL || w.d_N0 == NULL || w.D == NULL || w.sh == NULL || w.b == NULL || w.llr == NULL) {
+    fprintf(stderr, "nr_pusch_replay: out of memory\n");
+    return 2;
+  }
+  fft_radix2_init(&plan, (size_t) f.N_fft, tw);
+
+  /* slot loop */
+  pos = cfg.sample_offset;
+  for (slot_cnt = 0; ok && (cfg.max_slots <= 0 || slot_cnt < cfg.max_slots); slot_cnt++) {
+    slot_num = (int)((cfg.slot_offset + slot_cnt) % f.N_frame_slot);
+    N_slot = samples_in_slot(&f, slot_num);
+    if (pos + N_slot > cap_samples)
+      break;
+
+    nr_prof_slot(&prof, slot_cnt);
+    t_slot = nr_prof_begin(&prof);
+    t_prof = nr_prof_begin(&prof);
+    for (t = 0; t < N_slot; t++) {
+      for (ant = 0; ant < cfg.n_rx; ant++) {
+        i = 2 * ((pos + t) * cfg.n_rx + ant);
+        if (cfg.format == FORMAT_INT16) {
+          y_re[t + N_slot * ant] = cfg.int16_scale * cap16[i];
+          y_im[t + N_slot * ant] = cfg.int16_scale * cap16[i + 1];
+        } else {
+          y_re[t + N_slot * ant] = cap32[i];
+          y_im[t + N_slot * ant] = cap32[i + 1];
+        }
+      }
+    }
+    pos += N_slot;
+    nr_prof_end(&prof, PROF_CAPTURE, t_prof);
+
+    t_prof = nr_prof_begin(&prof);
+    cyclic_prefix_len(&f, slot_num, &N_cp_first, &N_cp_other);
+    memset(w.x_re, 0, (size_t) f.N_sc * N_SLOT_SYMBOL * cfg.n_rx * sizeof(double));
+    memset(w.x_im, 0, (size_t) f.N_sc * N_SLOT_SYMBOL * cfg.n_rx * sizeof(double));
+    nr_ofdma_demodulator(y_re, y_im, N_slot, (size_t) cfg.n_rx, (size_t) f.N_fft, (size_t) f.N_sc, N_cp_first, N_cp_other,
+      N_SLOT_SYMBOL, sc_first, sc_last - sc_first, &plan, s, s + f.N_fft, w.x_re, w.x_im);
+    nr_prof_end(&prof, PROF_OFDMA_DEMOD, t_prof);
+
+    for (u = 0; ok && u < cfg.N_ue; u++)
+      ok = ue_receive(&cfg, &f, u, slot_num, slot_cnt, &w, crc_fp, llr_fp, &prof);
+    nr_prof_end(&prof, PROF_SLOT, t_slot);
+  }
+
+  if (!ok)
+    fprintf(stderr, "nr_pusch_replay: out of memory\n");
+
+  nr_prof_report(&prof, stderr);
+  if (cfg.trace_out[0] != '\0' && !nr_prof_export(&prof, cfg.trace_out)) {
+    fprintf(stderr, "nr_pusch_replay: cannot write %s\n", cfg.trace_out);
+    ok = 0;
+  }
+  nr_prof_free(&prof);
+
+  for (u = 0; u < cfg.N_ue; u++) {
+    for (i = 0; i < THREAD_POOL_MAX; i++)
+      ldpc_layered_ws_free(w.ws[u][i]);
+  }
+  ldpc_graph_release();
+  free(tw); free(s); free(y_re); free(y_im);
+  free(w.x_re); free(w.x_im); free(w.y_re); free(w.y_im); free(w.H_re); free(w.H_im);
+  free(w.x_eq_re); free(w.x_eq_im); free(w.x_eq_N0); free(w.d_re); free(w.d_im); free(w.d_N0);
+  free(w.D); free(w.sh); free(w.b); free(w.llr);
+  munmap((void*) cap, (size_t) st.st_size);
+  if (crc_fp != stdout)
+    fclose(crc_fp);
+  if (llr_fp != NULL)
+    fclose(llr_fp);
+
+  return ok ? 0 : 1;
+}
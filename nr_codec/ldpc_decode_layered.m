@@ -0,0 +1,189 @@
+%[sh, cw_valid, iter, stop, weight] = ldpc_decode_layered(LLRin, base_graph, Z_c, max_iter=25, method='NMS', param, num_threads=1, term)
+%
+% Soft-decoder of 5G NR LDPC codes using layered min-sum algorithm.
+% Operates directly on the base graph and lifting size rather than
+% on the expanded parity check matrix. Base graph rows are processed
+% one at a time, with all Z_c check nodes of the row updated at once.
+% A matrix of codewords may be decoded in a single call, in which case
+% the codewords are distributed over a pool of worker threads.
+%
+% Arguments:
+%  LLRin      - vector of LLR, or matrix with each row as a codeword.
+%               Rows may either include the 2*Z_c punctured systematic
+%               bits or omit them, in which case they are decoded as
+%               erasures. int16 or int8 LLRs (see nr_llr_quantize) are
+%               decoded with 16-bit fixed-point arithmetic.
+%  base_graph - LDPC base graph (1 or 2)
+%  Z_c        - lifting size
+%  max_iter   - maximum nuber of iterations
+%  method     - check node update variant:
+%               'NMS' - normalized min-sum (param is scaling factor,
+%                       default 0.75)
+%               'OMS' - offset min-sum (param is offset, default 0.5,
+%                       in units of quantized LLRs for int16/int8 LLRin)
+%  param      - scaling factor or offset of the min-sum variant
+%  num_threads - number of worker threads (0 - use all CPU cores)
+%  term       - optional early termination structure with members crc,
+%               crc_bits and patience (see ldpc_early_term), empty to
+%               stop on valid codewords and max_iter only
+%
+% Returns:
+%  sh         - binary codeword vector after decoding (including
+%               punctured bits), or matrix with each row as a codeword
+%               (uint8 for int16/int8 LLRin)
+%  cw_valid   - a non-zero value indicates that sh is a valid
+%               codeword (one value per codeword)
+%  iter       - number of iterations made (one value per codeword)
+%  stop       - reason of termination (one value per codeword):
+%               0 - max_iter reached, 1 - valid codeword, 2 - CRC passed,
+%               3 - decoding stalled
+%  weight     - final syndrome weight (one value per codeword)
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function [sh, cw_valid, iter, stop, weight] = ldpc_decode_layered(LLRin, base_graph, Z_c, max_iter, method, param, num_threads, term)
+  if nargin < 4; max_iter = 25; end
+  if nargin < 5; method = 'NMS'; end
+  if nargin < 6 || isempty(param)
+    if strcmpi(method, 'OMS')
+      param = 0.5;
+    else
+      param = 0.75;
+    end
+  end
+  if nargin < 7; num_threads = 1; end
+  if nargin < 8 || isempty(term)
+    term = struct('crc', [], 'crc_bits', 0, 'patience', 0);
+  end
+
+  is_vec = isvector(LLRin);
+  if is_vec
+    LLRin = reshape(LLRin, 1, []);
+  end
+
+  try
+    crc_poly = [];
+    if ~isempty(term.crc)
+      crc_poly = nr_38_212_crc_poly(term.crc);
+    end
+    [sh, cw_valid, iter, stop, weight] = ldpc_decode_layered_mex(LLRin, base_graph, Z_c, max_iter, upper(method), param, num_threads, crc_poly, term.crc_bits, term.patience);
+    if is_vec
+      sh = sh(:);
+    end
+    return;
+  catch
+    persistent flag
+    if isempty(flag)
+      disp('ldpc_decode_layered: compile mex file to reduce execution time');
+      flag = 0;
+    end
+  end
+
+  [i, j, V_i_j] = nr_ldpc_graph_store(base_graph, Z_c);
+
+  is_int = isinteger(LLRin);
+  LLRin = double(LLRin);
+
+  if strcmpi(method, 'OMS')
+    alpha = 1.0;
+    beta = param;
+  elseif strcmpi(method, 'NMS')
+    alpha = param;
+    beta = 0.0;
+  else
+    error('min-sum variant not supported: %s', method);
+  end
+
+  z = (0 : Z_c-1)';
+
+  % variable node index of each lane for every base graph edge
+  idx = zeros(Z_c, numel(i));
+  for e = 1 : numel(i)
+    idx(:,e) = j(e) * Z_c + mod(z + V_i_j(e), Z_c) + 1;
+  end
+
+  N = (max(j) + 1) * Z_c;
+  if size(LLRin,2) < N
+    LLRin = [zeros(size(LLRin,1), N - size(LLRin,2)), LLRin];
+  end
+
+  sh = zeros(size(LLRin));
+  cw_valid = zeros(size(LLRin,1), 1);
+  iter = zeros(size(LLRin,1), 1);
+  stop = zeros(size(LLRin,1), 1);
+  weight = zeros(size(LLRin,1), 1);
+
+  for n = 1 : size(LLRin,1)
+    [sh(n,:), cw_valid(n), iter(n), stop(n), weight(n)] = decode_codeword(LLRin(n,:), i, idx, max_iter, alpha, beta, term);
+  end
+
+  if is_int
+    sh = uint8(sh);
+  end
+  if is_vec
+    sh = sh(:);
+  end
+end
+
+function [sh, cw_valid, iter, stop, weight] = decode_codeword(LLRin, i, idx, max_iter, alpha, beta, term)
+  Z_c = size(idx,1);
+  L = reshape(LLRin, Z_c, []);
+  R = zeros(Z_c, size(idx,2));
+
+  weight = syndrome_weight(L, i, idx);
+  cw_valid = (weight == 0);
+  iter = 0;
+  stop = 0;
+  state = [];
+
+  active = ~isempty(term.crc) || term.patience > 0;
+  if ~cw_valid && active
+    [~, state] = ldpc_early_term(term, [], llr2hardbit(L(:)), weight);
+  end
+
+  while ~cw_valid && iter < max_iter
+    for r = 0 : max(i)
+      e = find(i == r);
+      Q = L(idx(:,e)) - R(:,e);
+
+      [min1, pos] = min(abs(Q), [], 2);
+      absQ = abs(Q);
+      absQ(sub2ind(size(Q), (1:Z_c)', pos)) = inf;
+      min2 = min(absQ, [], 2);
+
+      mag = repmat(min1, 1, numel(e));
+      mag(sub2ind(size(Q), (1:Z_c)', pos)) = min2;
+      mag = max(alpha * mag - beta, 0);
+
+      sgn = prod(sign(Q) + (Q == 0), 2);
+      R(:,e) = mag .* (sgn .* (sign(Q) + (Q == 0)));
+      L(idx(:,e)) = Q + R(:,e);
+    end
+
+    iter = iter + 1;
+    weight = syndrome_weight(L, i, idx);
+    cw_valid = (weight == 0);
+
+    if ~cw_valid && active
+      [stop, state] = ldpc_early_term(term, state, llr2hardbit(L(:)), weight);
+      if stop
+        break;
+      end
+    end
+  end
+
+  if cw_valid
+    stop = 1;
+  end
+
+  sh = llr2hardbit(L(:)).';
+end
+
+% return the number of unsatisfied parity checks
+function weight = syndrome_weight(L, i, idx)
+  hb = llr2hardbit(L);
+  weight = 0;
+  for r = 0 : max(i)
+    weight = weight + sum(mod(sum(hb(idx(:,i == r)), 2), 2));
+  end
+end
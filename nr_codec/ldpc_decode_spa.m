@@ -1,78 +1,94 @@
-%[sh, cw_valid, iter] = ldpc_decode(LLRin, H, max_iter=30)
+%[sh, cw_valid, iter, stop, weight] = ldpc_decode_spa(LLRin, H, max_iter=50, H_key, num_threads=1, term)
 %
 % Soft-decoder of LDPC codes using Sum-Product Algorithm.
+% Message index tables of every parity check matrix are built once and
+% kept per matrix, so that alternating matrices (e.g. UEs with different
+% lifting sizes) do not rebuild them. With the mex file, a decoder handle
+% holding the tables and the message memory of its contexts is created
+% once per matrix as well (see ldpc_decode_spa_mex).
 %
 % Arguments:
-%  LLRin     - vector of LLR
+%  LLRin     - vector of LLR, or matrix with a codeword in every row
 %  H         - parity check matrix
 %  max_iter  - maximum nuber of iterations.
+%  H_key     - optional name identifying H (valid field name, e.g. of
+%              base graph and lifting size). Without it, tables are looked up by size and number
+%              of nonzeros of H and compared with H.
+%  num_threads - number of worker threads decoding the rows of LLRin
+%              concurrently (0 - all CPU cores)
+%  term      - optional early termination structure with members crc,
+%              crc_bits and patience (see ldpc_early_term), empty to stop
+%              on valid codewords and max_iter only
 %
 % Returns:
-%  sh        - binary codeword vector after decoding
+%  sh        - binary codeword vector after decoding, matrix of
+%              codewords in rows if LLRin is a matrix
 %  cw_valid  - a non-zero value indicates that sh is a valid 
-%              codeword
-%  iter      - number of iterations made
+%              codeword (per row)
+%  iter      - number of iterations made (per row)
+%  stop      - reason of termination (per row): 0 - max_iter reached,
+%              1 - valid codeword, 2 - CRC passed, 3 - decoding stalled
+%  weight    - final syndrome weight (per row)
 
 % Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function [sh, cw_valid, iter] = ldpc_decode_spa(LLRin, H, max_iter)
+function [sh, cw_valid, iter, stop, weight] = ldpc_decode_spa(LLRin, H, max_iter, H_key, num_threads, term)
   if nargin < 3; max_iter = 50; end
+  if nargin < 5; num_threads = 1; end
+  if nargin < 6 || isempty(term)
+    term = struct('crc', [], 'crc_bits', 0, 'patience', 0);
+  end
 
-  persistent H_int sumX1 sumX2 i_idx j_idx
-
-  [ncheck, nvar] = size(H);
+  persistent tables
 
-  if isempty(H_int) || ~isequal(H, H_int)
-    H_int = H;
-    
-    sumX1 = full(sum(H,1)');
-    sumX2 = full(sum(H,2));
+  if isempty(tables)
+    tables = struct();
+  end
 
-    cmax = max(sumX1);
-    vmax = max(sumX2);
+  [ncheck, nvar] = size(H);
 
-    C = zeros(cmax,nvar);
-    V = zeros(ncheck,vmax);
-    i_idx = zeros(nvar,cmax);
-    j_idx = zeros(ncheck,vmax);
+  if nargin < 4 || isempty(H_key)
+    H_key = sprintf('H%dx%d_%d', ncheck, nvar, nnz(H));
+    compare = true;
+  else
+    compare = false;
+  end
 
-    for i = 1 : nvar
-      c = find(H(:,i) == 1);
-      C(1:numel(c),i) = c;
+  if ~isfield(tables, H_key) || (compare && ~isequal(tables.(H_key).H, H))
+    if isfield(tables, H_key)
+      release_handle(tables.(H_key).handle);
     end
+    tables.(H_key) = spa_tables(H);
+  end
 
-    for j = 1 : ncheck
-      v = find(H(j,:) == 1);
-      V(j,1:numel(v)) = v;
+  t = tables.(H_key);
+  
+  try
+    crc_poly = [];
+    if ~isempty(term.crc)
+      crc_poly = nr_38_212_crc_poly(term.crc);
     end
-
-    for j = 1 : ncheck
-      for ip = 1 : sumX2(j)
-        vip = V(j,ip);
-        k = 0;
-        while C(k+1,vip) ~= j
-          k = k + 1;
-        end
-        j_idx(j,ip) = vip + k * nvar;
+    for attempt = 1 : 2
+      if isempty(t.handle)
+        t.handle = ldpc_decode_spa_mex('create', H, t.sumX1, t.sumX2, t.i_idx-1, t.j_idx-1);
+        tables.(H_key).handle = t.handle;
       end
-    end
-
-    for i = 1 : nvar
-      for jp = 1 : sumX1(i)
-        cjp = C(jp,i);
-        k = 0;
-        while V(cjp,k+1) ~= i
-          k = k + 1;
+      try
+        [sh, cw_valid, iter, stop, weight] = ldpc_decode_spa_mex('decode', t.handle, H, LLRin, max_iter, num_threads, crc_poly, term.crc_bits, term.patience);
+        return;
+      catch err
+        % handles do not survive clearing of the mex file, the mex file
+        % rejects them, so the decoder is created again
+        if attempt > 1 || ~strcmp(err.identifier, 'ldpc_decode_spa:handle')
+          rethrow(err);
         end
-        i_idx(i,jp) = cjp + k * ncheck;
+        t.handle = [];
+        tables.(H_key).handle = [];
       end
     end
-  end
-  
-  try
-    [sh, cw_valid, iter] = ldpc_decode_spa_mex(H, LLRin, sumX1, sumX2, i_idx-1, j_idx-1, max_iter);
-    return;
   catch
+    release_handle(t.handle);
+    tables.(H_key).handle = [];
     persistent flag
     if isempty(flag)
       disp('ldpc_decode_spa: compile mex file to reduce execution time');
@@ -80,14 +96,53 @@ function [sh, cw_valid, iter] = ldpc_decode_spa(LLRin, H, max_iter)
     end
   end
 
-  if check_syndrome(H, LLRin)
+  if isvector(LLRin)
+    [sh, cw_valid, iter, stop, weight] = spa_decode(LLRin, H, t, max_iter, term);
+    return;
+  end
+
+  C = size(LLRin,1);
+  sh = zeros(C, nvar);
+  cw_valid = zeros(C,1);
+  iter = zeros(C,1);
+  stop = zeros(C,1);
+  weight = zeros(C,1);
+  for r = 1:C
+    [sh(r,:), cw_valid(r), iter(r), stop(r), weight(r)] = spa_decode(LLRin(r,:), H, t, max_iter, term);
+  end
+end
+
+function release_handle(handle)
+  if ~isempty(handle)
+    try
+      ldpc_decode_spa_mex('destroy', handle);
+    end
+  end
+end
+
+function [sh, cw_valid, iter, stop, weight] = spa_decode(LLRin, H, t, max_iter, term)
+  [ncheck, nvar] = size(H);
+  sumX1 = t.sumX1;
+  sumX2 = t.sumX2;
+  i_idx = t.i_idx;
+  j_idx = t.j_idx;
+
+  weight = syndrome_weight(H, LLRin);
+  if weight == 0
     iter = 0;
     cw_valid = true;
+    stop = 1;
     sh = llr2hardbit(LLRin);
     return;
   end
 
   cw_valid = false;
+  stop = 0;
+  state = [];
+  active = ~isempty(term.crc) || term.patience > 0;
+  if active
+    [~, state] = ldpc_early_term(term, [], llr2hardbit(LLRin), weight);
+  end
 
   LLRout = zeros(size(LLRin));
 
@@ -108,19 +163,28 @@ function [sh, cw_valid, iter] = ldpc_decode_spa(LLRin, H, max_iter)
       mvc(i,j) = LLRout(i) - mcv(i_idx(i,j));
     end
 
-    if check_syndrome(H, LLRout)
+    weight = syndrome_weight(H, LLRout);
+    if weight == 0
       cw_valid = true;
+      stop = 1;
       break;
     end
+
+    if active
+      [stop, state] = ldpc_early_term(term, state, llr2hardbit(LLRout), weight);
+      if stop
+        break;
+      end
+    end
   end
 
   sh = llr2hardbit(LLRout);
 end
 
-% return a non-zero value if no errors detected
-function cw_valid = check_syndrome(H, r)
+% return the number of unsatisfied parity checks
+function weight = syndrome_weight(H, r)
   s = H * llr2hardbit(r(:));
-  cw_valid = all(mod(s,2) == 0);
+  weight = full(sum(mod(s,2)));
 end
 
 function mcv = boxplus_sums(mvc)
@@ -142,4 +206,32 @@ function mcv = boxplus_sums(mvc)
   mcv(1) = mr(n-1);
   mcv(n) = ml(n-1);
   mcv(2:n-1) = boxplus_approx( ml(1:n-2), mr(n-2:-1:1) );
-end
\ No newline at end of file
+end
+
+% message index tables: edge k of variable i is edge i_idx(i,k) of the
+% check node update, edge k of check j is edge j_idx(j,k) of the variable
+% node update
+function t = spa_tables(H)
+  [ncheck, nvar] = size(H);
+
+  t = struct();
+  t.H = H;
+  t.sumX1 = full(sum(H,1)');
+  t.sumX2 = full(sum(H,2));
+
+  % edges sorted by columns, position of every edge within its column and row
+  [r, c] = find(H);
+  n = numel(r);
+  col_start = [0; cumsum(t.sumX1(1:end-1))];
+  pos_col = (1:n)' - 1 - col_start(c);
+  [~, ord] = sortrows([r, c]);
+  row_start = [0; cumsum(t.sumX2(1:end-1))];
+  pos_row = zeros(n,1);
+  pos_row(ord) = (1:n)' - 1 - row_start(r(ord));
+
+  t.i_idx = zeros(nvar, max(t.sumX1));
+  t.j_idx = zeros(ncheck, max(t.sumX2));
+  t.i_idx(c + pos_col * nvar) = r + pos_row * ncheck;
+  t.j_idx(r + pos_row * ncheck) = c + pos_col * nvar;
+  t.handle = [];
+end
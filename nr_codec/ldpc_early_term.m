@@ -0,0 +1,66 @@
+%[stop, state] = ldpc_early_term(term, state, hb, weight)
+%
+% Early termination policies of LDPC decoders (see mex/ldpc_term.h),
+% evaluated after every decoding iteration which left unsatisfied parity
+% checks:
+%  - CRC-aided termination stops if the CRC of the first term.crc_bits
+%    hard decisions (data followed by CRC parity bits) passes,
+%  - stall detection stops if the syndrome weight did not reach a new
+%    minimum and the number of flipped hard decisions did not decrease
+%    for term.patience iterations in a row.
+% Called with empty state before the first iteration to initialize it.
+%
+% Arguments:
+%  term       - termination structure with members:
+%               crc      - CRC polynomial selection (see
+%                          nr_38_212_crc_calc), empty if disabled
+%               crc_bits - number of bits covered by the CRC, including
+%                          the CRC parity bits
+%               patience - iterations without progress before the
+%                          codeword is given up, 0 if disabled
+%  state      - progress of the codeword
+%  hb         - hard decisions of the codeword
+%  weight     - syndrome weight (number of unsatisfied parity checks)
+%
+% Returns:
+%  stop       - 0 to continue, 2 if the CRC passed, 3 if decoding stalled
+%  state      - updated progress of the codeword
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function [stop, state] = ldpc_early_term(term, state, hb, weight)
+  stop = 0;
+  hb = hb(:);
+
+  if isempty(state)
+    state = struct('best_weight', weight, 'prev_flips', sum(hb), 'idle', 0, 'hb', hb);
+    return;
+  end
+
+  flips = sum(hb ~= state.hb);
+  state.hb = hb;
+
+  if ~isempty(term.crc)
+    L = numel(nr_38_212_crc_poly(term.crc)) - 1;
+    if term.crc_bits > L
+      p = nr_38_212_crc_calc(hb(1:term.crc_bits-L), term.crc);
+      if all(p(:) == hb(term.crc_bits-L+1:term.crc_bits))
+        stop = 2;
+        return;
+      end
+    end
+  end
+
+  if term.patience > 0
+    if weight < state.best_weight
+      state.best_weight = weight;
+      state.idle = 0;
+    elseif flips >= state.prev_flips
+      state.idle = state.idle + 1;
+    end
+    state.prev_flips = flips;
+    if state.idle >= term.patience
+      stop = 3;
+    end
+  end
+end
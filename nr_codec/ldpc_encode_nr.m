@@ -1,4 +1,4 @@
-%[p] = ldpc_encode_nr(s, H, Z_c)
+%[p] = ldpc_encode_nr(s, H, Z_c, check=false)
 %
 % Implementation of simplified Richardson's efficient LDPC encoder (see [1]).
 % Assumes E = 0 and T = I, which is true for 5G NR LDPC 
@@ -12,13 +12,16 @@
 %  s         - vector of information bits
 %  H         - parity check matrix
 %  Z_c       - lifting size of matrix H
+%  check     - if true, parity checks of the codeword are verified
 %
 % Returns:
 %  p         - vector of generated parity bits
 
 % Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function p = ldpc_encode_nr(s, H, Z_c)
+function p = ldpc_encode_nr(s, H, Z_c, check)
+  if nargin < 4; check = false; end
+
   persistent C_int D_int Dinv_C 
 
   s = s(:);
@@ -51,5 +54,7 @@ function p = ldpc_encode_nr(s, H, Z_c)
 
   p = [p1; p2];
   
-  assert(any(mod(H * [s;p], 2)) == 0, 'LDPC encoder error: parity check failed');
+  if check
+    assert(~any(mod(H * [s;p], 2)), 'LDPC encoder error: parity check failed');
+  end
 end
\ No newline at end of file
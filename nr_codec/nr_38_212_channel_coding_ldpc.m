@@ -1,24 +1,37 @@
-%[d] = nr_38_212_channel_coding_ldpc(c, base_graph)
+%[d] = nr_38_212_channel_coding_ldpc(c, base_graph, check=false)
 %
 % Performs encoding of 5G NR SCH according to 3GPP 38.212 sec. 5.3.2.
+% All codeblocks are encoded in a single call of the MEX encoder, which
+% computes parity as cyclic shifts and XORs of bit-packed Z_c-bit columns
+% directly from the base graph.
 %
 % Arguments:
 %  c          - codeblocks to be encoded (each row is a separate codeblock)
 %  base_graph - LDPC base graph (1 or 2) 
+%  check      - if true, parity checks of the encoded codeblocks are
+%               verified
 %
 % Returns:
 %  d          - encoded codeblocks
 
 % Copyright 2018 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function d = nr_38_212_channel_coding_ldpc(c, base_graph)
-  persistent H base_graph_int Z_c_int
-  
-  if isempty(base_graph_int) 
-    base_graph_int = 0;
+function d = nr_38_212_channel_coding_ldpc(c, base_graph, check)
+  if nargin < 3; check = false; end
+
+  ok = [];
+  try
+    [d, ok] = ldpc_encode_nr_mex(c, base_graph, check);
+  catch
+    persistent flag
+    if isempty(flag)
+      disp('nr_38_212_channel_coding_ldpc: compile mex file to reduce execution time');
+      flag = 0;
+    end
   end
-  if isempty(Z_c_int)
-    Z_c_int = 0;
+  if ~isempty(ok)
+    assert(ok ~= 0, 'LDPC encoder error: parity check failed');
+    return;
   end
 
   C = size(c,1);
@@ -34,11 +47,7 @@ function d = nr_38_212_channel_coding_ldpc(c, base_graph)
     error('base_graph permitted values are 1 or 2');
   end
 
-  if (Z_c ~= Z_c_int) || (base_graph ~= base_graph_int)
-    Z_c_int = Z_c;
-    base_graph_int = base_graph;
-    H = nr_ldpc_parity_check_matrix(base_graph, Z_c);
-  end
+  H = nr_ldpc_parity_check_matrix(base_graph, Z_c);
 
   % insert information bits
   d = ones(C,N) * -1;
@@ -49,7 +58,7 @@ function d = nr_38_212_channel_coding_ldpc(c, base_graph)
 
   % generate and insert parity bits
   for r = 1:C
-    p = ldpc_encode_nr(c(r,:)', H, Z_c);
+    p = ldpc_encode_nr(c(r,:)', H, Z_c, check);
     d(r,1+K-2*Z_c:N) = p;
   end
 end
\ No newline at end of file
@@ -1,26 +1,49 @@
-%[c] = nr_38_212_channel_decoding_ldpc(d, base_graph)
+%[c, stats] = nr_38_212_channel_decoding_ldpc(d, base_graph, decoder='SPA', num_threads=1, llr_scale=1, term, max_iter)
 %
 % Performs decoding of 5G NR SCH according to 3GPP 38.212 sec. 5.3.2.
-% When avaliable, uses LDPC decoder from Matlab communications package.
 %
 % Arguments:
-%  d          - received LLR values (each row as a codeblock)
+%  d          - received LLR values (each row as a codeblock), double or
+%               fixed-point int16/int8 (see nr_llr_quantize)
 %  base_graph - LDPC base graph (1 or 2) 
+%  decoder    - LDPC decoding algorithm:
+%               'SPA'         - flooding sum-product (see ldpc_decode_spa)
+%               'Layered NMS' - layered normalized min-sum
+%               'Layered OMS' - layered offset min-sum
+%               (see ldpc_decode_layered)
+%  num_threads - number of worker threads used to decode codeblocks
+%               concurrently (0 - all CPU cores)
+%  llr_scale  - quantization scale of fixed-point d, the layered decoders
+%               operate on quantized LLRs, SPA on dequantized ones
+%  term       - optional early termination structure (see
+%               ldpc_early_term), CRC bits are counted from the first
+%               bit of the codeblock
+%  max_iter   - maximum number of decoding iterations, empty for the
+%               default of the decoder (25 layered, 50 SPA)
 %
 % Returns:
-%  c          - decoded codeblocks (each row is a separate codeblock)
+%  c          - decoded codeblocks (each row is a separate codeblock),
+%               uint8 if decoded by the fixed-point layered decoder
+%  stats      - decoder statistics, column vectors with a value per
+%               codeblock: cw_valid, iter (number of iterations), stop
+%               (reason of termination) and weight (final syndrome weight),
+%               see ldpc_decode_spa
 
 % Copyright 2018 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function c = nr_38_212_channel_decoding_ldpc(d, base_graph)
-  persistent H hLDPCDec base_graph_int Z_c_int
+function [c, stats] = nr_38_212_channel_decoding_ldpc(d, base_graph, decoder, num_threads, llr_scale, term, max_iter)
+  if nargin < 3; decoder = 'SPA'; end
+  if nargin < 4; num_threads = 1; end
+  if nargin < 5; llr_scale = 1; end
+  if nargin < 6; term = []; end
+  if nargin < 7; max_iter = []; end
 
-  if isempty(base_graph_int) 
-    base_graph_int = 0;
-  end
-  if isempty(Z_c_int)
-    Z_c_int = 0;
-  end
+  % default iteration budgets, layered decoders converge in about half
+  % the iterations of flooding SPA
+  max_iter_layered = 25;
+  max_iter_spa = 50;
+
+  stats = struct();
 
   C = size(d,1);
   N = size(d,2);
@@ -35,29 +58,38 @@ function c = nr_38_212_channel_decoding_ldpc(d, base_graph)
     error('base_graph permitted values are 1 or 2');
   end
 
-  if (Z_c ~= Z_c_int) || (base_graph ~= base_graph_int)
-    Z_c_int = Z_c;
-    base_graph_int = base_graph;
+  if strncmpi(decoder, 'Layered', 7)
+    % all codeblocks are decoded in a single call, punctured bits are
+    % inserted by the decoder
+    param = [];
+    if isinteger(d) && strcmpi(decoder(9:end), 'OMS')
+      param = 0.5 * llr_scale;
+    end
+    if isempty(max_iter)
+      max_iter = max_iter_layered;
+    end
+    [wd, stats.cw_valid, stats.iter, stats.stop, stats.weight] = ldpc_decode_layered(d, base_graph, Z_c, max_iter, decoder(9:end), param, num_threads, term);
+    wd = reshape(wd, C, []);
+    c = wd(:,1:K);
+    return;
+  elseif ~strcmpi(decoder, 'SPA')
+    error('LDPC decoder not supported: %s', decoder);
+  end
 
-    H = nr_ldpc_parity_check_matrix(base_graph, Z_c);
+  H = nr_ldpc_parity_check_matrix(base_graph, Z_c);
+  H_key = sprintf('bg%d_z%d', base_graph, Z_c);
 
-    % Matlab communications toolbox LDPC decoder
-    % try
-    %   if ~isempty(hLDPCDec); release(hLDPCDec); end
-    %   hLDPCDec = comm.LDPCDecoder('ParityCheckMatrix', H);
-    %   hLDPCDec.DecisionMethod = 'Hard decision';
-    % end
+  if isempty(max_iter)
+    max_iter = max_iter_spa;
   end
-  
-  c = zeros(C,K);
-
-  for r = 1:C
-    w = [zeros(1, 2*Z_c), d(r,:)];
-    %try
-    %  c(r,:) = step(hLDPCDec, w');
-    %catch
-      wd = ldpc_decode_spa(w, H);
-      c(r,:) = wd(1:K);
-    %end
+  if isinteger(d)
+    d = double(d) / llr_scale;
   end
+
+  % all codeblocks are decoded in a single call, each row by a decoder
+  % context of the handle kept for H_key
+  w = [zeros(C, 2*Z_c), d];
+  [wd, stats.cw_valid, stats.iter, stats.stop, stats.weight] = ldpc_decode_spa(w, H, max_iter, H_key, num_threads, term);
+  wd = reshape(wd, C, []);
+  c = wd(:,1:K);
 end
\ No newline at end of file
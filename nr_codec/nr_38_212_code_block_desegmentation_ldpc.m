@@ -1,22 +1,28 @@
-%[b, cb_crc_ok] = nr_38_212_code_block_desegmentation_ldpc(c, base_graph, tbs)
+%[b, cb_crc_ok, tb_crc_ok] = nr_38_212_code_block_desegmentation_ldpc(c, base_graph, tbs, tb_crc_gen)
 %
 % Performs code block de-segmentation of 5G NR SCH according to 3GPP 38.212 
-% sec. 5.2.2.
+% sec. 5.2.2. When tb_crc_gen is provided, the transport block CRC attached
+% to the last bits of b is checked in the same pass over the data as the
+% codeblock CRCs.
 %
 % Arguments:
 %  c          - segmented codeblocks (each row as a codeblock)
-%               the size is [num_codeblocks,num_bits_per_codeblock]
+%               the size is [num_codeblocks,num_bits_per_codeblock],
+%               double or uint8
 %  base_graph - LDPC base graph (1 or 2)
-%  tbs        - transport block size
+%  tbs        - transport block size (including transport block CRC)
+%  tb_crc_gen - transport block CRC polynomial (see nr_38_212_crc_calc)
 %
 % Returns:
 %  b          - binary vector of information bits
 %  cb_crc_ok  - binary vector. Zero on any position indicates CRC check
 %               failure for corresponding codeblock.
+%  tb_crc_ok  - non-zero if transport block CRC check passed (requires
+%               tb_crc_gen)
 
 % Copyright 2018 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function [b, cb_crc_ok] = nr_38_212_code_block_desegmentation_ldpc(c, base_graph, tbs)
+function [b, cb_crc_ok, tb_crc_ok] = nr_38_212_code_block_desegmentation_ldpc(c, base_graph, tbs, tb_crc_gen)
   if base_graph == 1
     K_cb = 8448;
   elseif base_graph == 2
@@ -69,6 +75,26 @@ function [b, cb_crc_ok] = nr_38_212_code_block_desegmentation_ldpc(c, base_graph
 
   Kp = Bp / C;
 
+  if nargin > 3
+    if C > 1
+      cb_crc_poly = nr_38_212_crc_poly('24B');
+    else
+      cb_crc_poly = [];
+    end
+
+    try
+      [b, cb_crc_ok, tb_crc_ok] = nr_38_212_code_block_desegmentation_ldpc_mex(c, Kp, B, cb_crc_poly, nr_38_212_crc_poly(tb_crc_gen));
+      return;
+    catch
+      persistent flag
+      if isempty(flag)
+        disp('nr_38_212_code_block_desegmentation_ldpc: compile mex file to reduce execution time');
+        flag = 0;
+      end
+    end
+  end
+
+  c = double(c);
   b = zeros(1, B);
 
   cb_crc_ok = zeros(1,C);
@@ -92,4 +118,12 @@ function [b, cb_crc_ok] = nr_38_212_code_block_desegmentation_ldpc(c, base_graph
       cb_crc_ok = 1;
     end
   end
+
+  if nargin > 3
+    L_tb = numel(nr_38_212_crc_poly(tb_crc_gen)) - 1;
+    tb_crc_ok = all(nr_38_212_crc_calc(b(1:end-L_tb), tb_crc_gen) == b(end-L_tb+1:end));
+    if C == 1
+      cb_crc_ok = tb_crc_ok;
+    end
+  end
 end
\ No newline at end of file
@@ -13,21 +13,7 @@
 % Copyright 2018 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
 function p = nr_38_212_crc_calc(b, crc_gen) 
-  if crc_gen == 6
-    crc_poly = [1,1,0,0,0,0,1];
-  elseif crc_gen == 11
-    crc_poly = [1,1,1,0,0,0,1,0,0,0,0,1];
-  elseif crc_gen == 16
-    crc_poly = [1,0,0,0,1,0,0,0,0,0,0,1,0,0,0,0,1];
-  elseif strcmpi(crc_gen, '24a')
-    crc_poly = [1,1,0,0,0,0,1,1,0,0,1,0,0,1,1,0,0,1,1,1,1,1,0,1,1];
-  elseif strcmpi(crc_gen, '24b')
-    crc_poly = [1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,0,0,0,1,1];
-  elseif strcmpi(crc_gen, '24c')
-    crc_poly = [1,1,0,1,1,0,0,1,0,1,0,1,1,0,0,0,1,0,0,0,1,0,1,1,1];
-  else
-    error('Invalid crc_gen (%s)', crc_gen);
-  end
+  crc_poly = nr_38_212_crc_poly(crc_gen);
 
   try
     p = crc_calc_mex(b, crc_poly);
@@ -0,0 +1,31 @@
+%crc_poly = nr_38_212_crc_poly(crc_gen)
+%
+% Returns CRC generator polynomial defined in 3GPP 38.212 sec. 5.1.
+%
+% Arguments:
+%  crc_gen    - polynomial selection: 
+%               6, 11, 16, '24a', '24b' or '24c'
+%
+% Returns:
+%  crc_poly   - binary vector of polynomial coefficients, starting
+%               from the highest power
+
+% Copyright 2018 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function crc_poly = nr_38_212_crc_poly(crc_gen)
+  if crc_gen == 6
+    crc_poly = [1,1,0,0,0,0,1];
+  elseif crc_gen == 11
+    crc_poly = [1,1,1,0,0,0,1,0,0,0,0,1];
+  elseif crc_gen == 16
+    crc_poly = [1,0,0,0,1,0,0,0,0,0,0,1,0,0,0,0,1];
+  elseif strcmpi(crc_gen, '24a')
+    crc_poly = [1,1,0,0,0,0,1,1,0,0,1,0,0,1,1,0,0,1,1,1,1,1,0,1,1];
+  elseif strcmpi(crc_gen, '24b')
+    crc_poly = [1,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,0,0,0,1,1];
+  elseif strcmpi(crc_gen, '24c')
+    crc_poly = [1,1,0,1,1,0,0,1,0,1,0,1,1,0,0,0,1,0,0,0,1,0,1,1,1];
+  else
+    error('Invalid crc_gen (%s)', crc_gen);
+  end
+end
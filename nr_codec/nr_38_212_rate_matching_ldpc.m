@@ -32,6 +32,13 @@ function g = nr_38_212_rate_matching_ldpc(d, base_graph, N_layers, Q_m, rv_id, c
 
   % FIXME: simplified N_cb calculation assuming I_LBRM = 0
   N_cb = N;
+
+  % lifting size of the encoded codeblocks
+  if base_graph == 1
+    Z_c = N / 66;
+  else
+    Z_c = N / 50;
+  end
   G = ctbs;
 
   for r = 0 : C-1
@@ -1,10 +1,12 @@
-%d = nr_38_212_rate_unmatching_ldpc(g, base_graph, N_layers, Q_m, rv_id, tbs)
+%d = nr_38_212_rate_unmatching_ldpc(g, base_graph, N_layers, Q_m, rv_id, tbs, d0)
 %
 % Performs rate un-matching and code block de-concatenaion of 5G NR SCH according 
 % to 3GPP 38.212 sec. 5.2.4 and 5.5.
 %
 % Arguments:
-%  g          - vector of concatenated LLR
+%  g          - vector of concatenated LLR, double or fixed-point int16
+%               or int8 (see nr_llr_quantize), in which case d is of the
+%               same class and LLR combining saturates
 %  base_graph - LDPC base graph (1 or 2) 
 %  N_layers   - number of layers
 %  Q_m        - modulation order
@@ -15,6 +17,9 @@
 %               8 - 256QAM
 % rv_id       - redundancy version index (0, 1, 2 or 3)
 % tbs        - transport block size (uncoded)
+% d0         - optional matrix of soft bits combined in previous
+%              transmissions of the transport block (HARQ buffer),
+%              LLRs are accumulated on top of it
 %
 % Returns:
 %  d          - matrix of codeblock LLR (each row as a codeblock)
@@ -22,95 +27,18 @@
 
 % Copyright 2018 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function d = nr_38_212_rate_unmatching_ldpc(g, base_graph, N_layers, Q_m, rv_id, tbs)
+function d = nr_38_212_rate_unmatching_ldpc(g, base_graph, N_layers, Q_m, rv_id, tbs, d0)
   bits = struct([]);
 
-  % recalculate parameters B, C, E, G, k_0
-  B = tbs;
   G = length(g);
- 
-  if base_graph == 1
-    K_cb = 8448;
-    K_b = 22;
-    switch rv_id
-      case 0
-        k_0 = 0;
-      case 1
-        k_0 = floor(17 * N_cb / (66 * Z_c)) * Z_c;
-      case 2
-        k_0 = floor(33 * N_cb / (66 * Z_c)) * Z_c;
-      case 3
-        k_0 = floor(56 * N_cb / (66 * Z_c)) * Z_c;
-      otherwise
-        error('rv_id permitted values are in integer range 0:3');
-    end
-  elseif base_graph == 2
-    K_cb = 3840;
-    if B > 640
-      K_b = 10;
-    elseif B > 560
-      K_b = 9;
-    elseif B > 192
-      K_b = 8;
-    else
-      K_b = 6;
-    end
-    switch rv_id
-      case 0
-        k_0 = 0;
-      case 1
-        k_0 = floor(13 * N_cb / (50 * Z_c)) * Z_c;
-      case 2
-        k_0 = floor(25 * N_cb / (50 * Z_c)) * Z_c;
-      case 3
-        k_0 = floor(43 * N_cb / (50 * Z_c)) * Z_c;
-      otherwise
-        error('rv_id permitted values are in integer range 0:3');
-    end
-  else
-    error('base_graph permitted values are 1 or 2');
-  end
-
-  if B < K_cb
-    C = 1;
-    L = 0;
-    Bp = B;
-  else
-    L = 24;
-    C = ceil(B / (K_cb - L));
-    Bp = B + C * L;
-  end
-
-  Z_c = 1000;
-  for i_LS = 0 : 7
-    Z = nr_ldpc_lifting_size_tbl_5_3_2_1(i_LS);
-    for z = Z
-      if z < Z_c && C * K_b * z >= B + C * L
-        Z_c = z;
-      end
-    end
-  end
-
-  if base_graph == 1
-    N = 66 * Z_c;
-    K = 22 * Z_c;
-  elseif base_graph == 2
-    N = 50 * Z_c;
-    K = 10 * Z_c;
-  end
-
-  % FIXME: simplified N_cb calculation
-  N_cb = N;
-  Cp = C;
-  Kp = Bp / C;
-  Fp = K - Kp;
+  prm = nr_38_212_rate_unmatching_params(G, base_graph, N_layers, Q_m, rv_id, tbs);
 
+  C = prm.C;
+  N = prm.N;
+  N_cb = prm.N_cb;
+  k_0 = prm.k_0;
   for r = 0 : C-1
-    if r <= Cp - mod(G / (N_layers * Q_m), Cp)
-      bits(r+1).E = N_layers * Q_m * floor(G / (N_layers * Q_m * Cp));
-    else
-      bits(r+1).E = N_layers * Q_m * ceil(G / (N_layers * Q_m * Cp));
-    end
+    bits(r+1).E = prm.E(r+1);
   end
 
   % codeblock deconcatenation
@@ -120,14 +48,25 @@ function d = nr_38_212_rate_unmatching_ldpc(g, base_graph, N_layers, Q_m, rv_id,
     k = k + bits(r+1).E;
   end
 
-  d = zeros(C,N);
+  if nargin < 7 || isempty(d0)
+    d0 = [];
+    d = zeros(C,N,class(g));
+  elseif size(d0,1) == C && size(d0,2) == N
+    d = d0;
+  else
+    error('d0 must be a matrix of size [num_codeblocks,num_enc_bits_per_codeblock]');
+  end
 
-  Fbst = Kp - 2*Z_c;
-  Fbsz = K - Kp;
+  Fbst = prm.Fbst;
+  Fbsz = prm.Fbsz;
 
   try
     for r = 0 : C-1
-      d(r+1,:) = nr_38_212_circbuff_deinterleave_mex(bits(r+1).f, N, Q_m, k_0, Fbst, Fbsz);
+      if isempty(d0)
+        d(r+1,:) = nr_38_212_circbuff_deinterleave_mex(bits(r+1).f, N, Q_m, k_0, Fbst, Fbsz);
+      else
+        d(r+1,:) = nr_38_212_circbuff_deinterleave_mex(bits(r+1).f, N, Q_m, k_0, Fbst, Fbsz, d0(r+1,:));
+      end
     end
   catch
     persistent flag
@@ -136,8 +75,14 @@ function d = nr_38_212_rate_unmatching_ldpc(g, base_graph, N_layers, Q_m, rv_id,
       flag = 0;
     end
 
+    if isempty(d0)
+      d = zeros(C,N,class(g));
+    else
+      d = d0;
+    end
+
     for r = 0 : C-1
-      bits(r+1).e = zeros(1, bits(r+1).E);
+      bits(r+1).e = zeros(1, bits(r+1).E, class(g));
       % deinterleaving
       for j = 0 : bits(r+1).E / Q_m - 1
         for i = 0 : Q_m - 1
@@ -147,11 +92,13 @@ function d = nr_38_212_rate_unmatching_ldpc(g, base_graph, N_layers, Q_m, rv_id,
 
       % do LLR combining on circular buffer
       j = 0;
-      for k = 0 : bits(r+1).E - 1
+      k = 0;
+      while j < bits(r+1).E
         if mod(k_0 + k, N_cb) < Fbst || mod(k_0 + k, N_cb) >= Fbst + Fbsz
-          d(r+1,1+mod(k_0 + k, N_cb)) = d(r+1,1+mod(k_0 + k, N_cb)) + bits(r+1).e(1+mod(j,bits(r+1).E));
+          d(r+1,1+mod(k_0 + k, N_cb)) = d(r+1,1+mod(k_0 + k, N_cb)) + bits(r+1).e(1+j);
           j = j + 1;
         end
+        k = k + 1;
       end
     end
   end
@@ -0,0 +1,116 @@
+%prm = nr_38_212_rate_unmatching_params(G, base_graph, N_layers, Q_m, rv_id, tbs)
+%
+% Calculates codeblock and circular buffer parameters of 5G NR SCH rate
+% (un)matching according to 3GPP 38.212 sec. 5.2.2, 5.4.2 and 5.5.
+%
+% Arguments:
+%  G          - total number of coded bits available for transmission
+%  base_graph - LDPC base graph (1 or 2) 
+%  N_layers   - number of layers
+%  Q_m        - modulation order
+%  rv_id      - redundancy version index (0, 1, 2 or 3)
+%  tbs        - transport block size (including transport block CRC)
+%
+% Returns:
+%  prm        - structure with the following members:
+%               C    - number of codeblocks
+%               E    - vector of rate matching output sizes per codeblock
+%               Z_c  - lifting size
+%               K    - codeblock size (including filler bits)
+%               Kp   - number of non-filler bits in a codeblock
+%               N    - length of encoded codeblock
+%               N_cb - length of circular buffer
+%               k_0  - starting position of redundancy version rv_id
+%               Fbst - position of the first filler bit in circular buffer
+%               Fbsz - number of filler bits
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function prm = nr_38_212_rate_unmatching_params(G, base_graph, N_layers, Q_m, rv_id, tbs)
+  B = tbs;
+
+  if base_graph == 1
+    K_cb = 8448;
+    K_b = 22;
+  elseif base_graph == 2
+    K_cb = 3840;
+    if B > 640
+      K_b = 10;
+    elseif B > 560
+      K_b = 9;
+    elseif B > 192
+      K_b = 8;
+    else
+      K_b = 6;
+    end
+  else
+    error('base_graph permitted values are 1 or 2');
+  end
+
+  if B < K_cb
+    C = 1;
+    L = 0;
+    Bp = B;
+  else
+    L = 24;
+    C = ceil(B / (K_cb - L));
+    Bp = B + C * L;
+  end
+
+  Z_c = 1000;
+  for i_LS = 0 : 7
+    Z = nr_ldpc_lifting_size_tbl_5_3_2_1(i_LS);
+    for z = Z
+      if z < Z_c && C * K_b * z >= Bp
+        Z_c = z;
+      end
+    end
+  end
+
+  if base_graph == 1
+    N = 66 * Z_c;
+    K = 22 * Z_c;
+  else
+    N = 50 * Z_c;
+    K = 10 * Z_c;
+  end
+
+  % FIXME: simplified N_cb calculation assuming I_LBRM = 0
+  N_cb = N;
+
+  if base_graph == 1
+    k_0_tbl = [0, 17, 33, 56];
+    k_0_div = 66;
+  else
+    k_0_tbl = [0, 13, 25, 43];
+    k_0_div = 50;
+  end
+  if ~ismember(rv_id, 0:3)
+    error('rv_id permitted values are in integer range 0:3');
+  end
+  k_0 = floor(k_0_tbl(rv_id+1) * N_cb / (k_0_div * Z_c)) * Z_c;
+
+  Cp = C;
+  E = zeros(1, C);
+  for r = 0 : C-1
+    if r <= Cp - mod(G / (N_layers * Q_m), Cp)
+      E(r+1) = N_layers * Q_m * floor(G / (N_layers * Q_m * Cp));
+    else
+      E(r+1) = N_layers * Q_m * ceil(G / (N_layers * Q_m * Cp));
+    end
+  end
+
+  Kp = Bp / C;
+
+  prm = struct();
+  prm.C = C;
+  prm.E = E;
+  prm.Z_c = Z_c;
+  prm.K = K;
+  prm.Kp = Kp;
+  prm.N = N;
+  prm.N_cb = N_cb;
+  prm.k_0 = k_0;
+  prm.Fbst = Kp - 2*Z_c;
+  prm.Fbsz = K - Kp;
+end
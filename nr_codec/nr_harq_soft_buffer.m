@@ -0,0 +1,88 @@
+%varargout = nr_harq_soft_buffer(action, varargin)
+%
+% Manages a pool of HARQ soft buffers holding combined codeblock LLRs of
+% 5G NR SCH between (re)transmissions of a transport block. The buffer of a
+% process takes over the LLR matrix of the first transmission without a
+% copy and keeps its class (see nr_llr_format), LLRs of retransmissions are
+% accumulated into it in place (with saturation for fixed-point LLR
+% classes), and the combined buffer is returned to the decoder as a shared,
+% read-only value.
+%
+% Usage:
+%  nr_harq_soft_buffer('init', N_proc)
+%               - creates N_proc empty soft buffers
+%  d = nr_harq_soft_buffer('accumulate', pid, d)
+%               - combines codeblock LLRs d of a transmission (see output d
+%                 of nr_sch_decode) with the buffer of process pid, which
+%                 must be of the same size and class, returns the combined
+%                 LLRs
+%  d0 = nr_harq_soft_buffer('get', pid)
+%               - returns soft buffer of HARQ process pid or an empty
+%                 matrix if the process holds no data
+%  nr_harq_soft_buffer('store', pid, d)
+%               - replaces the buffer of process pid by combined LLRs d
+%  nr_harq_soft_buffer('release', pid)
+%               - releases the buffer of process pid (e.g. after successful
+%                 transport block CRC check or the last retransmission)
+%  nr_harq_soft_buffer('free')
+%               - deallocates the pool
+%
+% Arguments:
+%  pid        - HARQ process index (1 to N_proc)
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function varargout = nr_harq_soft_buffer(action, varargin)
+  persistent pool
+
+  switch action
+    case 'accumulate'
+      pid = check_pid(varargin{1}, pool);
+      d = varargin{2};
+      if isempty(pool{pid})
+        pool{pid} = d;
+      else
+        % detach the buffer, so that it is not shared and the sum is
+        % computed in place
+        b = pool{pid};
+        pool{pid} = [];
+        if ~isequal(size(b), size(d)) || ~strcmp(class(b), class(d))
+          pool{pid} = b;
+          error('nr_harq_soft_buffer: LLRs do not match the soft buffer of process %d', pid);
+        end
+        b = b + d;
+        pool{pid} = b;
+      end
+      varargout{1} = pool{pid};
+
+    case 'get'
+      pid = check_pid(varargin{1}, pool);
+      varargout{1} = pool{pid};
+
+    case 'store'
+      pid = check_pid(varargin{1}, pool);
+      pool{pid} = varargin{2};
+
+    case 'release'
+      pid = check_pid(varargin{1}, pool);
+      pool{pid} = [];
+
+    case 'init'
+      pool = cell(varargin{1}, 1);
+
+    case 'free'
+      pool = [];
+
+    otherwise
+      error('nr_harq_soft_buffer: unknown action %s', action);
+  end
+end
+
+function pid = check_pid(pid, pool)
+  if ~iscell(pool)
+    error('nr_harq_soft_buffer: soft buffer pool is not initialized');
+  end
+  if pid < 1 || pid > numel(pool)
+    error('nr_harq_soft_buffer: invalid HARQ process index');
+  end
+end
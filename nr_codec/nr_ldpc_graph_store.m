@@ -0,0 +1,95 @@
+%[i, j, V_i_j] = nr_ldpc_graph_store(base_graph, Z_c)
+%
+% Returns the base graph of 5G NR LDPC code lifted by Z_c from the store
+% of precomputed graphs of all lifting sizes (see mex/ldpc_graph_store.h).
+% The store file is written by native/ldpc_graph_store_gen and read once,
+% from the path in environment variable NR_LDPC_GRAPH_STORE or, if it is
+% not set, from mex/ldpc_graphs.bin (the lookup order of the mex kernels).
+% Without the store file, graphs are built from
+% 3GPP 38.212 Tables 5.3.2-2 and 5.3.2-3 on first use. Every following
+% call is a lookup by (base_graph, Z_c).
+%
+% Arguments:
+%  base_graph - LDPC base graph (1 or 2)
+%  Z_c        - lifting size
+%
+% Returns:
+%  i          - base graph row index
+%  j          - base graph column index
+%  V_i_j      - cyclic shift per row i and column j, modulo Z_c
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function [i, j, V_i_j] = nr_ldpc_graph_store(base_graph, Z_c)
+  persistent graphs
+
+  Z_max = 384;
+
+  if isempty(graphs)
+    graphs = read_store(Z_max);
+  end
+
+  assert(any(base_graph == [1 2]) && Z_c >= 1 && Z_c <= Z_max && Z_c == round(Z_c), 'invalid base graph or lifting size');
+
+  if isempty(graphs{base_graph, Z_c})
+    i_LS = [];
+    for i_LS_i = 0 : 7
+      if any(nr_ldpc_lifting_size_tbl_5_3_2_1(i_LS_i) == Z_c)
+        i_LS = i_LS_i;
+        break;
+      end
+    end
+    assert(~isempty(i_LS), 'lifting size not in Table 5.3.2-1: %d', Z_c);
+
+    [i, j, V_i_j] = nr_ldpc_base_graph_tbl_5_3_2(base_graph, i_LS);
+    graphs{base_graph, Z_c} = [i(:), j(:), mod(V_i_j(:), Z_c)];
+  end
+
+  g = graphs{base_graph, Z_c};
+  i = g(:,1);
+  j = g(:,2);
+  V_i_j = g(:,3);
+end
+
+% graphs of the store file, empty cells if there is none
+function graphs = read_store(Z_max)
+  graphs = cell(2, Z_max);
+
+  file = getenv('NR_LDPC_GRAPH_STORE');
+  if isempty(file)
+    file = fullfile(fileparts(mfilename('fullpath')), '..', 'mex', 'ldpc_graphs.bin');
+  end
+
+  fid = fopen(file, 'r');
+  if fid < 0
+    return;
+  end
+  w = fread(fid, Inf, 'int32=>double');
+  fclose(fid);
+
+  % header: magic, version, number of graphs, maximum lifting size
+  hdr_words = 5;
+  magic = double(typecast(uint8('NRLDPCGS'), 'int32'));
+  if numel(w) < hdr_words + 2*(Z_max+1) || any(w(1:2) ~= magic(:)) || w(3) ~= 1 || w(5) ~= Z_max
+    return;
+  end
+
+  gs_dir = reshape(w(hdr_words+1 : hdr_words+2*(Z_max+1)), Z_max+1, 2);
+  for bg = 1 : 2
+    for Z = 1 : Z_max
+      off = gs_dir(Z+1, bg);
+      if off == 0
+        continue;
+      end
+      % record: bg, Z_c, i_LS, rows, cols, edges, deg_max, row_ptr, col, shift
+      rec = off / 4 + 1;
+      rows = w(rec+3);
+      edges = w(rec+5);
+      row_ptr = w(rec+7 : rec+7+rows);
+      col = w(rec+8+rows : rec+7+rows+edges);
+      shift = w(rec+8+rows+edges : rec+7+rows+2*edges);
+      row = repelem((0 : rows-1)', diff(row_ptr));
+      graphs{bg, Z} = [row, col, shift];
+    end
+  end
+end
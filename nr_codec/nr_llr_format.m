@@ -0,0 +1,46 @@
+%[llr_class, llr_scale] = nr_llr_format(algorithms, I_mcs)
+%
+% Resolves the LLR format of the SCH receive back-end configured in the
+% algorithm structure (see nr_algorithms_struct). Fixed-point LLRs are
+% stored as round(llr * llr_scale) saturated to the range of the class.
+%
+% Arguments:
+%  algorithms - algorithm configuration structure, members llr_format and
+%               llr_scale are used (double LLRs if not present)
+%  I_mcs      - MCS index, selects the element of a per-MCS llr_scale
+%               vector
+%
+% Returns:
+%  llr_class  - 'double', 'int16' or 'int8'
+%  llr_scale  - quantization scale (1 for double LLRs)
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function [llr_class, llr_scale] = nr_llr_format(algorithms, I_mcs)
+  llr_class = 'double';
+  llr_scale = 1;
+
+  if ~isstruct(algorithms) || ~isfield(algorithms, 'llr_format')
+    return;
+  end
+
+  llr_class = lower(algorithms.llr_format);
+  switch llr_class
+    case 'double'
+      return;
+    case 'int16'
+      llr_scale = 64;
+    case 'int8'
+      llr_scale = 8;
+    otherwise
+      error('LLR format not supported: %s', algorithms.llr_format);
+  end
+
+  if isfield(algorithms, 'llr_scale') && ~isempty(algorithms.llr_scale)
+    if isscalar(algorithms.llr_scale)
+      llr_scale = algorithms.llr_scale;
+    else
+      llr_scale = algorithms.llr_scale(I_mcs+1);
+    end
+  end
+end
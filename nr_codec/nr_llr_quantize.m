@@ -0,0 +1,25 @@
+%q = nr_llr_quantize(llr, llr_class, llr_scale)
+%
+% Quantizes LLR values to the fixed-point format of the SCH receive
+% back-end: round(llr * llr_scale) saturated to the symmetric range
+% [-intmax, intmax] of the class, so that negation does not overflow.
+%
+% Arguments:
+%  llr        - LLR values
+%  llr_class  - 'double' (llr is returned unchanged), 'int16' or 'int8'
+%  llr_scale  - quantization scale (see nr_llr_format)
+%
+% Returns:
+%  q          - quantized LLR values of class llr_class
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function q = nr_llr_quantize(llr, llr_class, llr_scale)
+  if strcmpi(llr_class, 'double')
+    q = double(llr);
+    return;
+  end
+
+  lim = double(intmax(llr_class));
+  q = cast(min(max(round(double(llr) * llr_scale), -lim), lim), llr_class);
+end
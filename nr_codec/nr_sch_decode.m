@@ -1,36 +1,71 @@
-%[a, tb_crc_ok, cb_crc_ok] = nr_sch_decode(g, I_mcs, N_layers, rv_id, tbs, mcs_tbl)
+%[a, tb_crc_ok, cb_crc_ok, d, ldpc_stats] = nr_sch_decode(g, I_mcs, N_layers, rv_id, tbs, mcs_tbl, algorithms, d0)
 %
 % Decodes 5G NR PUSCH/PDSCH channels using LDPC codes according to
 % 3GPP 38.212 sec. 6.2 and 7.2.
 %
 % Arguments:
-%  g          - encoded transport block vector (LLR values)
+%  g          - encoded transport block vector (LLR values), or a
+%               structure of equalized symbols to be processed by the
+%               fused receive back-end (see nr_pusch_receive) with members:
+%               d      - vector of equalized modulation symbols
+%               N0     - noise variance (scalar or one per symbol)
+%               c_init - initial value of scrambling sequence
 %  I_mcs      - MCS index
 %  N_layers   - number of layers
 %  rv_id      - redundancy version index (0, 1, 2 or 3)
 %  tbs        - transport block size (uncoded)
 %  mcs_tbl    - index of MCS table (1 - 64-QAM, 2 - 256-QAM)
+%  algorithms - algorithm configuration structure (see nr_algorithms_struct),
+%               members ldpc_decoder, ldpc_max_iter, ldpc_num_threads,
+%               ldpc_crc_term, ldpc_patience, llr_format and llr_scale are
+%               used, all but ldpc_decoder are optional. May also be a
+%               string with the name of LDPC decoder.
+%  d0         - optional HARQ soft buffer: matrix of codeblock LLRs combined
+%               in previous transmissions of the same transport block
+%               (output d of the previous call), empty for a new
+%               transmission, or the index of a HARQ process of
+%               nr_harq_soft_buffer, whose buffer LLRs of this transmission
+%               are accumulated into in place
 %
 % Returns:
 %  a          - binary transport block vector
 %  tb_crc_ok  - set to 0 indicates transpor block CRC check failure
 %  cb_crc_ok  - binary vector. Zero on any position indicates CRC check
 %               failure for corresponding codeblock.
+%  d          - matrix of codeblock LLRs after combining with d0, to be kept
+%               for a retransmission if the transport block failed (of the
+%               class given by algorithms.llr_format, see nr_llr_format).
+%               If d0 is a HARQ process index, the combined LLRs are already
+%               kept in its buffer
+%  ldpc_stats - LDPC decoder statistics per codeblock (see
+%               nr_38_212_channel_decoding_ldpc)
 
 % Copyright 2018 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function [a, tb_crc_ok, cb_crc_ok] = nr_sch_decode(g, I_mcs, N_layers, rv_id, tbs, mcs_tbl)
+function [a, tb_crc_ok, cb_crc_ok, d, ldpc_stats] = nr_sch_decode(g, I_mcs, N_layers, rv_id, tbs, mcs_tbl, algorithms, d0)
   if nargin < 6
     mcs_tbl = 1;
   end
+  if nargin < 7 || isempty(algorithms)
+    algorithms = nr_algorithms_struct();
+  elseif ischar(algorithms)
+    decoder = algorithms;
+    algorithms = nr_algorithms_struct();
+    algorithms.ldpc_decoder = decoder;
+  end
+  if nargin < 8
+    d0 = [];
+  end
 
   A = tbs;
 
   % Transport Block crc size
   if A > 3824
     L = 24; 
+    tb_crc_gen = '24A';
   else
     L = 16;
+    tb_crc_gen = 16;
   end
 
   % resolve MCS and select LDPC graph
@@ -41,26 +76,97 @@ function [a, tb_crc_ok, cb_crc_ok] = nr_sch_decode(g, I_mcs, N_layers, rv_id, tb
     base_graph = 1;
   end
 
-  d = nr_38_212_rate_unmatching_ldpc(g, base_graph, N_layers, Q_m, rv_id, A+L);
-  c = nr_38_212_channel_decoding_ldpc(d, base_graph);
-  [b, cb_crc_ok] = nr_38_212_code_block_desegmentation_ldpc(c, base_graph, A+L);
-
-  % Transport Block crc extraction and check
-  p_ext = b(end-L+1:end);
-  a = b(1:end-L);
-  a = a(:);
+  % LLRs are quantized before rate unmatching, combining saturates
+  [llr_class, llr_scale] = nr_llr_format(algorithms, I_mcs);
+  harq_pid = [];
+  if isscalar(d0)
+    harq_pid = d0;
+    d0 = [];
+  elseif ~isempty(d0)
+    d0 = cast(d0, llr_class);
+  end
 
-  if A > 3824
-    p_calc = nr_38_212_crc_calc(a, '24A');
+  t_prof = nr_profiler('begin', 'rate_unmatching');
+  if isstruct(g)
+    d = sch_rx_backend(g, base_graph, N_layers, Q_m, rv_id, A+L, d0, llr_class, llr_scale);
   else
-    p_calc = nr_38_212_crc_calc(a, 16);
+    d = nr_38_212_rate_unmatching_ldpc(nr_llr_quantize(g, llr_class, llr_scale), base_graph, N_layers, Q_m, rv_id, A+L, d0);
+  end
+  if ~isempty(harq_pid)
+    d = nr_harq_soft_buffer('accumulate', harq_pid, d);
   end
+  nr_profiler('end', t_prof);
+  nr_profiler('alloc', d);
 
-  tb_crc_ok = all(p_calc == p_ext);
-  if numel(cb_crc_ok) == 1
-    cb_crc_ok = tb_crc_ok;
+  % early termination of LDPC decoding on the codeblock CRC, or on the
+  % transport block CRC of a single codeblock (sizes as in
+  % nr_38_212_code_block_desegmentation_ldpc)
+  % algorithm structures built before these members existed keep the
+  % former behaviour
+  patience = 0;
+  if isfield(algorithms, 'ldpc_patience')
+    patience = algorithms.ldpc_patience;
+  end
+  crc_term = false;
+  if isfield(algorithms, 'ldpc_crc_term')
+    crc_term = algorithms.ldpc_crc_term;
   end
+  num_threads = 1;
+  if isfield(algorithms, 'ldpc_num_threads')
+    num_threads = algorithms.ldpc_num_threads;
+  end
+
+  term = struct('crc', [], 'crc_bits', 0, 'patience', patience);
+  if crc_term
+    K_cb = [8448, 3840];
+    K_cb = K_cb(base_graph);
+    if A+L < K_cb
+      term.crc = tb_crc_gen;
+      term.crc_bits = A+L;
+    else
+      C = ceil((A+L) / (K_cb - 24));
+      term.crc = '24B';
+      term.crc_bits = (A+L) / C + 24;
+    end
+  end
+
+  t_prof = nr_profiler('begin', 'ldpc_decode');
+  max_iter = [];
+  if isfield(algorithms, 'ldpc_max_iter')
+    max_iter = algorithms.ldpc_max_iter;
+  end
+  [c, ldpc_stats] = nr_38_212_channel_decoding_ldpc(d, base_graph, algorithms.ldpc_decoder, num_threads, llr_scale, term, max_iter);
+  nr_profiler('end', t_prof);
+  nr_profiler('count', 'code_blocks', numel(ldpc_stats.iter));
+  nr_profiler('count', 'ldpc_iterations', sum(ldpc_stats.iter));
+
+  % code block and transport block crc check
+  t_prof = nr_profiler('begin', 'desegmentation');
+  [b, cb_crc_ok, tb_crc_ok] = nr_38_212_code_block_desegmentation_ldpc(c, base_graph, A+L, tb_crc_gen);
+  nr_profiler('end', t_prof);
+  a = b(1:end-L);
+  a = a(:);
+
   % if ~tb_crc_ok
   %   display('TB CRC eror!');
   % end
-end
\ No newline at end of file
+end
+
+% demapping, descrambling and rate unmatching of equalized symbols
+function d = sch_rx_backend(s, base_graph, N_layers, Q_m, rv_id, tbs, d0, llr_class, llr_scale)
+  try
+    prm = nr_38_212_rate_unmatching_params(numel(s.d) * Q_m, base_graph, N_layers, Q_m, rv_id, tbs);
+    d = nr_sch_rx_backend_mex(s.d, cast(s.N0, class(s.d)), Q_m, s.c_init, prm.E, prm.N, prm.k_0, prm.Fbst, prm.Fbsz, d0, llr_class, llr_scale);
+    return;
+  catch
+    persistent flag
+    if isempty(flag)
+      disp('nr_sch_decode: compile mex file to reduce execution time');
+      flag = 0;
+    end
+  end
+
+  llr = modulation_demapper_soft(s.d, Q_m, 'Approx LLR PAM', s.N0);
+  llr = llr .* gold31seq(s.c_init, numel(llr), 'bipolar').';
+  d = nr_38_212_rate_unmatching_ldpc(nr_llr_quantize(llr, llr_class, llr_scale), base_graph, N_layers, Q_m, rv_id, tbs, d0);
+end
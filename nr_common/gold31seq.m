@@ -1,4 +1,4 @@
-%[c] = gold31seq(c_init, len)
+%[c] = gold31seq(c_init, len, format='binary')
 %
 % Calculates pseudo-random sequence as defined in 
 % 3GPP 38.211 sec. 5.2.1.
@@ -6,15 +6,22 @@
 % Arguments:
 %  c_init     - initial value of x2 sequence
 %  len        - length of the sequence
+%  format     - output format:
+%               'binary'  - row vector of 0 and 1
+%               'bipolar' - row vector of 1-2*c (+1 and -1)
+%               'packed'  - uint32 row vector, bit n of the sequence
+%                           stored at bit mod(n,32) of word floor(n/32)+1
 %
 % Returns:
-%  c          - generated binary sequence
+%  c          - generated sequence
 
 % Copyright 2018-2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function [c] = gold31seq(c_init, len)
+function [c] = gold31seq(c_init, len, format)
+  if nargin < 3; format = 'binary'; end
+
   try
-    c = gold31seq_mex(c_init, len);
+    c = gold31seq_mex(c_init, len, format);
     return;
   catch
     persistent flag
@@ -39,5 +46,15 @@ function [c] = gold31seq(c_init, len)
     x2(n+31) = mod(x2(n+3) + x2(n+2) + x2(n+1) + x2(n),2);
   end
 
+  c = zeros(1,len);
   c(1:len)= mod(x1((1:len)+N_c) + x2((1:len)+N_c),2);
+
+  if strcmpi(format, 'bipolar')
+    c = 1 - 2*c;
+  elseif strcmpi(format, 'packed')
+    c = reshape([c, zeros(1, mod(-len,32))], 32, []);
+    c = uint32(2.^(0:31) * c);
+  elseif ~strcmpi(format, 'binary')
+    error('format not supported: %s', format);
+  end
 end
\ No newline at end of file
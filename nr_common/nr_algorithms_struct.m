@@ -13,6 +13,8 @@
 %           of estimated channel response. The first element
 %           sets half-window length for frequency domain
 %           averaging, when the second is for time averaging.\
+%        chan_est_rank - number of eigenmodes of the pilot covariance
+%           kept in the MMSE channel estimation filter, 0 for full rank
 %        sto_est - sample time offset estimation algorithm
 %           'none' - bypass STO estimation and correction
 %           'dft'  - DFT method
@@ -23,10 +25,43 @@
 %        equalizer -  equalizer algorithm for MIMO channel
 %           'ZF' - Zero-Forcing equalizer
 %           'MMSE' - Minimum Mean Squared Error equalizer
+%           'MMSE-IRC' - MMSE with Interference Rejection Combining
+%              (noise covariance estimated from DMRS)
 %        demodulation_method - calculation of LLR values
 %           'Approx LLR' - approximated LLR
+%           'Approx LLR PAM' - approximated LLR computed per I/Q axis
 %           'True LLR' - LLR based on LOGMAP
 %           'Hard' - hard demodulation 
+%        fused_backend - if set, soft demapping, descrambling and rate
+%           unmatching are performed in a single step of nr_sch_decode,
+%           without intermediate LLR vectors (max-log demodulation only,
+%           uncoded BER is not reported by the link level simulation)
+%        ldpc_decoder - LDPC decoding algorithm
+%           'SPA' - flooding sum-product algorithm
+%           'Layered NMS' - layered normalized min-sum
+%           'Layered OMS' - layered offset min-sum
+%        ldpc_max_iter - maximum number of LDPC decoding iterations,
+%           empty for the default of the decoder
+%        ldpc_num_threads - number of worker threads decoding codeblocks
+%           of a transport block concurrently, 0 selects all CPU cores
+%        ldpc_crc_term - if set, LDPC decoding of a codeblock stops as soon
+%           as the CRC of its tentative hard decision passes (codeblock
+%           CRC, or transport block CRC of a single codeblock)
+%        ldpc_patience - number of decoding iterations without progress
+%           after which a codeblock is given up (see ldpc_early_term),
+%           0 disables stall detection
+%        precision - arithmetic of the receiver front-end (channel
+%           estimation, equalization, demapping)
+%           'double' - double precision
+%           'single' - single precision RE grids and symbols
+%        llr_format - format of LLRs from rate unmatching on, including
+%           HARQ soft buffers (see nr_llr_quantize)
+%           'double' - double precision
+%           'int16'  - 16-bit fixed-point, saturated
+%           'int8'   - 8-bit fixed-point, saturated
+%        llr_scale - quantization scale of fixed-point LLRs: a scalar, a
+%           vector indexed by I_mcs+1, or empty for the default (64 for
+%           int16, 8 for int8)
 
 % Copyright 2018 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
@@ -35,8 +70,18 @@ function alg = nr_algorithms_struct()
 
   alg.chan_est = 'LS'; % 'MMSE', 'LS'
   alg.chan_est_avg = [3,0];
+  alg.chan_est_rank = 0;
   alg.sto_est = 'dft'; % 'prony', 'none'
   alg.cfo_est = 'none'; % 'prony'
-  alg.equalizer = 'MMSE'; % 'ZF'
-  alg.demodulation_method = 'Approx LLR'; % 'True LLR', 'Hard'
+  alg.equalizer = 'MMSE'; % 'ZF', 'MMSE-IRC'
+  alg.demodulation_method = 'Approx LLR'; % 'Approx LLR PAM', 'True LLR', 'Hard'
+  alg.fused_backend = false;
+  alg.ldpc_decoder = 'SPA'; % 'Layered NMS', 'Layered OMS'
+  alg.ldpc_max_iter = [];
+  alg.ldpc_num_threads = 1;
+  alg.ldpc_crc_term = false;
+  alg.ldpc_patience = 0;
+  alg.precision = 'double'; % 'single'
+  alg.llr_format = 'double'; % 'int16', 'int8'
+  alg.llr_scale = [];
 end
\ No newline at end of file
@@ -0,0 +1,83 @@
+%rep = nr_precision_report(frame_cfg, UE, N_ant_eNB_RX, channel, MCS, BLER_target, precision_cfg, search_cfg)
+%
+% Measures SNR loss of reduced-precision receive paths with respect to the
+% double precision reference. SNR thresholds of all MCS and BLER targets
+% are found by nr_sch_snr_search for the reference and for every
+% configuration, with the same random number seed, so that the thresholds
+% are compared on the same channel and noise realizations. The loss table
+% is printed unless an output argument is requested.
+%
+% Arguments:
+%  frame_cfg     - OFDM framing constants structure
+%  UE            - vector of UE structures (see nr_sch_link_level_sim)
+%  N_ant_eNB_RX  - number of antennas in the receiver
+%  channel       - vector of channel structures (see nr_sch_link_level_sim)
+%  MCS           - vector of MCS indices
+%  BLER_target   - vector of target transport block error ratios
+%  precision_cfg - vector of structures with members precision, llr_format
+%                  and llr_scale (see nr_algorithms_struct), overriding
+%                  the algorithm structure of all UEs
+%  search_cfg    - optional SNR search configuration (see nr_sch_snr_search)
+%
+% Returns:
+%  rep           - structure with the members:
+%                  SNR_ref  - SNR thresholds of the double precision
+%                             receiver, size [numel(MCS),numel(BLER_target),numel(channel)]
+%                  SNR_loss - SNR loss in dB of every configuration, size
+%                             [numel(MCS),numel(BLER_target),numel(channel),numel(precision_cfg)]
+%                  name     - cell array of configuration names
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function rep = nr_precision_report(frame_cfg, UE, N_ant_eNB_RX, channel, MCS, BLER_target, precision_cfg, search_cfg)
+  if nargin < 8
+    search_cfg = struct();
+  end
+
+  ref = struct('precision', 'double', 'llr_format', 'double', 'llr_scale', []);
+  res = nr_sch_snr_search(frame_cfg, set_precision(UE, ref), N_ant_eNB_RX, channel, MCS, BLER_target, search_cfg);
+
+  rep = struct();
+  rep.SNR_ref = res.SNR_threshold;
+  rep.SNR_loss = zeros([size(rep.SNR_ref), numel(precision_cfg)]);
+  rep.name = cell(1, numel(precision_cfg));
+
+  for p = 1 : numel(precision_cfg)
+    res = nr_sch_snr_search(frame_cfg, set_precision(UE, precision_cfg(p)), N_ant_eNB_RX, channel, MCS, BLER_target, search_cfg);
+    rep.SNR_loss(:,:,:,p) = reshape(res.SNR_threshold - rep.SNR_ref, size(rep.SNR_ref));
+    rep.name{p} = sprintf('%s/%s', precision_cfg(p).precision, precision_cfg(p).llr_format);
+    if isfield(precision_cfg(p), 'llr_scale') && isscalar(precision_cfg(p).llr_scale)
+      rep.name{p} = sprintf('%s x%g', rep.name{p}, precision_cfg(p).llr_scale);
+    end
+  end
+
+  if nargout > 0
+    return;
+  end
+
+  for i_ch = 1 : numel(channel)
+    for i_target = 1 : numel(BLER_target)
+      fprintf('channel %d, BLER %g: SNR loss [dB] w.r.t. double precision\n', i_ch, BLER_target(i_target));
+      fprintf('%5s %9s', 'MCS', 'SNR_ref');
+      fprintf(' %18s', rep.name{:});
+      fprintf('\n');
+      for i_mcs = 1 : numel(MCS)
+        fprintf('%5d %9.2f', MCS(i_mcs), rep.SNR_ref(i_mcs, i_target, i_ch));
+        fprintf(' %18.2f', squeeze(rep.SNR_loss(i_mcs, i_target, i_ch, :)));
+        fprintf('\n');
+      end
+    end
+  end
+end
+
+function UE = set_precision(UE, cfg)
+  for i = 1 : length(UE)
+    UE(i).algorithms.precision = cfg.precision;
+    UE(i).algorithms.llr_format = cfg.llr_format;
+    if isfield(cfg, 'llr_scale')
+      UE(i).algorithms.llr_scale = cfg.llr_scale;
+    else
+      UE(i).algorithms.llr_scale = [];
+    end
+  end
+end
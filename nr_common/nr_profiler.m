@@ -0,0 +1,169 @@
+%varargout = nr_profiler(action, varargin)
+%
+% Instrumentation of the simulation chain: scoped stage timers and event
+% counters aggregated over a run, optionally recorded as a timeline that
+% is exported in Chrome trace event format (JSON, opened by
+% chrome://tracing or ui.perfetto.dev). While the profiler is disabled,
+% every action except 'init' returns immediately, so that instrumented
+% functions run at full speed.
+%
+% Usage:
+%  nr_profiler('init', enable, trace)
+%               - clears all stages and counters, enables the profiler if
+%                 enable is set and recording of the timeline if trace is
+%                 set
+%  nr_profiler('slot', n_slot)
+%               - sets the slot number attached to the following events
+%  t = nr_profiler('begin', name)
+%               - starts the timer of stage name (a valid field name),
+%                 stages may be nested
+%  nr_profiler('end', t)
+%               - stops the timer t started by 'begin'
+%  nr_profiler('count', name, n)
+%               - adds n to counter name (a valid field name)
+%  nr_profiler('alloc', x)
+%               - adds the size of array x in bytes to counter
+%                 bytes_allocated
+%  p = nr_profiler('report')
+%               - returns a structure with members:
+%                 stages   - structure with a member per stage, each with
+%                            members calls, time (total seconds) and mean
+%                 counters - structure with a member per counter
+%  nr_profiler('export', file)
+%               - writes the recorded timeline to file
+%  on = nr_profiler('enabled')
+%               - returns non-zero if the profiler is enabled
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function varargout = nr_profiler(action, varargin)
+  persistent on
+  persistent trace
+  persistent base
+  persistent slot
+  persistent ids
+  persistent names
+  persistent calls
+  persistent time
+  persistent counters
+  persistent ev
+  persistent n_ev
+
+  if isempty(on)
+    on = false;
+  end
+
+  if ~on && ~strcmp(action, 'init')
+    if strcmp(action, 'begin')
+      varargout{1} = [];
+    elseif strcmp(action, 'enabled')
+      varargout{1} = false;
+    elseif strcmp(action, 'report')
+      varargout{1} = struct('stages', struct(), 'counters', struct());
+    end
+    return;
+  end
+
+  switch action
+    case 'begin'
+      name = varargin{1};
+      if ~isfield(ids, name)
+        names{end+1} = name;
+        ids.(name) = numel(names);
+        calls(end+1) = 0;
+        time(end+1) = 0;
+      end
+      varargout{1} = [ids.(name), toc(base)];
+
+    case 'end'
+      t = varargin{1};
+      if isempty(t)
+        return;
+      end
+      dur = toc(base) - t(2);
+      calls(t(1)) = calls(t(1)) + 1;
+      time(t(1)) = time(t(1)) + dur;
+      if trace
+        [ev, n_ev] = record(ev, n_ev, [t(1), slot, t(2), dur]);
+      end
+
+    case 'count'
+      name = varargin{1};
+      if ~isfield(counters, name)
+        counters.(name) = 0;
+      end
+      counters.(name) = counters.(name) + varargin{2};
+
+    case 'alloc'
+      x = varargin{1};
+      if isnumeric(x) || islogical(x) || ischar(x)
+        w = whos('x');
+        if ~isfield(counters, 'bytes_allocated')
+          counters.bytes_allocated = 0;
+        end
+        counters.bytes_allocated = counters.bytes_allocated + w.bytes;
+      end
+
+    case 'slot'
+      slot = varargin{1};
+
+    case 'report'
+      p = struct('stages', struct(), 'counters', counters);
+      for n = 1 : numel(names)
+        p.stages.(names{n}) = struct('calls', calls(n), 'time', time(n), 'mean', time(n) / max(calls(n), 1));
+      end
+      varargout{1} = p;
+
+    case 'export'
+      export_trace(varargin{1}, names, ev(1:n_ev,:));
+
+    case 'enabled'
+      varargout{1} = true;
+
+    case 'init'
+      on = varargin{1} ~= 0;
+      trace = numel(varargin) > 1 && varargin{2} ~= 0;
+      base = tic;
+      slot = 0;
+      ids = struct();
+      names = {};
+      calls = [];
+      time = [];
+      counters = struct();
+      ev = zeros(1024, 4);
+      n_ev = 0;
+
+    otherwise
+      error('nr_profiler: unknown action %s', action);
+  end
+end
+
+% appends event e (stage index, slot, start, duration), the buffer grows
+% by doubling
+function [ev, n_ev] = record(ev, n_ev, e)
+  if n_ev == size(ev,1)
+    ev(2*n_ev, 1) = 0;
+  end
+  n_ev = n_ev + 1;
+  ev(n_ev,:) = e;
+end
+
+% writes events as complete ('X') events of the Chrome trace event format,
+% times in microseconds
+function export_trace(file, names, ev)
+  fid = fopen(file, 'w');
+  if fid < 0
+    error('nr_profiler: cannot open %s', file);
+  end
+
+  fprintf(fid, '{"displayTimeUnit":"ms","traceEvents":[\n');
+  for n = 1 : size(ev,1)
+    if n > 1
+      fprintf(fid, ',\n');
+    end
+    fprintf(fid, '{"name":"%s","cat":"stage","ph":"X","pid":1,"tid":1,"ts":%.3f,"dur":%.3f,"args":{"slot":%d}}', ...
+      names{ev(n,1)}, 1e6 * ev(n,3), 1e6 * ev(n,4), ev(n,2));
+  end
+  fprintf(fid, '\n]}\n');
+  fclose(fid);
+end
@@ -1,8 +1,22 @@
-%res = nr_sch_link_level_sim(frame_cfg, sim_dur_slots, UE, N_ant_eNB_RX, channel, SNR)
+%res = nr_sch_link_level_sim(frame_cfg, sim_dur_slots, UE, N_ant_eNB_RX, channel, SNR, sim_cfg)
 %
 % Runs link level simulation of 5G NR PUSCH/PDSCH channel transceiver on physical
 % layer level using fixed allocations of UE.
 %
+% Every slot is processed by a front-end (transmitters of all UEs, the
+% channel and OFDM demodulation of the band occupied by all UEs, once per
+% slot) followed by independent back-ends of UEs (channel estimation,
+% equalization, demodulation and decoding of their PRBs). With
+% sim_cfg.parallel set, back-ends of all UEs and transmitters of all UEs
+% run as tasks of the current parallel pool (parfor, serial execution if
+% Parallel Computing Toolbox is not available or no pool is open). If no
+% UE retransmits transport blocks (harq_max_tx of 1), the front-end of
+% the next slot is an additional task running concurrently with the
+% back-ends of the current slot. Random numbers of every UE and of the
+% noise are then drawn from substreams (see rng_substream) selected by the
+% slot and UE index and a seed drawn from the global stream, so results
+% do not depend on the number of workers.
+%
 % Arguments:
 %  frame_cfg     - OFDM framing constants structure
 %  sim_dur_slots - simulation duration in slots
@@ -21,6 +35,10 @@
 %                  tx_filter             - vector of real-valued FIR filter coefficients
 %                  higher_layer_parameters - higher layer parameter structure
 %                  algorithms              - algorithms structure
+%                  harq_max_tx             - maximum number of transmissions of a
+%                                            transport block (optional, default 1).
+%                                            Retransmissions use redundancy versions
+%                                            0, 2, 3, 1 and soft combining of LLRs.
 %  N_ant_eNB_RX  - number of antennas in the receiver
 %  channel       - structure with the following members:
 %                  rayleigh_en - if set to non-zero, emulates Rayleigh fading channel
@@ -34,18 +52,50 @@
 %                  pdp_reduce_N - parameter of some PDP reduction method
 %                  normalize_response - if set to true, power of the channel's response is
 %                                       normalized to 1  
+%                  tdl_block_len - optional block length of FFT based channel convolution
+%                                  (see manual of apply_fading_td function), default 0
 %  SNR           - signal to noise ratio in dB
+%  sim_cfg       - optional structure with the members (defaults in brackets):
+%                  parallel   - run front-ends and back-ends of UEs as
+%                               parallel tasks [false]
+%                  profile    - if set to non-zero, execution time of the
+%                               processing stages and event counters are
+%                               collected by nr_profiler [false]. Stages
+%                               run by workers of a parallel pool are not
+%                               profiled
+%                  trace_file - name of the file the timeline of stages is
+%                               exported to in Chrome trace event format,
+%                               one event per stage call tagged with the
+%                               slot number [''], no export if empty
 %
 % Returns:
 %  res           - vector of structures with simulation results (per UE)
 %                  BER_c    - coded Bit Error Ratio
-%                  BER_u    - uncoded Bit Error Ratio
-%                  BLER     - Block Error Ratio
+%                  BER_u    - uncoded Bit Error Ratio (NaN with fused
+%                             receive back-end)
+%                  BLER     - Block Error Ratio (codeblocks, per transmission)
+%                  residual_BLER - ratio of transport blocks not decoded after
+%                                  harq_max_tx transmissions
+%                  throughput    - successfully decoded transport block bits per second
 %                  EVM_DMRS - Error Vector Magnitude calculated based on equalized DMRS signal
+%                  counts   - structure of event counters the ratios are calculated
+%                             from (members coded_err, coded_tx, uncoded_err, uncoded_tx,
+%                             block_err, block_tx, tb_err, tb_tx, tb_bits_ok, slots),
+%                             used to aggregate results of several simulation runs
+%                  profile  - report of nr_profiler (stages and counters of
+%                             all UEs), only if profiling is enabled
 
 % Copyright 2018 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function res = nr_sch_link_level_sim(frame_cfg, sim_dur_slots, UE, N_ant_eNB_RX, channel, SNR)
+function res = nr_sch_link_level_sim(frame_cfg, sim_dur_slots, UE, N_ant_eNB_RX, channel, SNR, sim_cfg)
+  cfg = struct('parallel', false, 'profile', false, 'trace_file', '');
+  if nargin > 6
+    for f = fieldnames(sim_cfg)'
+      cfg.(f{1}) = sim_cfg.(f{1});
+    end
+  end
+  nr_profiler('init', cfg.profile, ~isempty(cfg.trace_file));
+
   for i = 1:length(UE)
     UE(i).PUSCH_symbols_sched_wo_DMRS = UE(i).PUSCH_symbols_sched - (UE(i).higher_layer_parameters.UL_DMRS_add_pos+1);
     UE(i).Q_m = nr_resolve_mcs(UE(i).I_mcs, UE(i).higher_layer_parameters.MCS_Table_PUSCH);
@@ -57,67 +107,138 @@ function res = nr_sch_link_level_sim(frame_cfg, sim_dur_slots, UE, N_ant_eNB_RX,
     UE(i).uncoded_err = 0;
     UE(i).block_tx = 0;
     UE(i).block_err = 0;
+    UE(i).tb_tx = 0;
+    UE(i).tb_err = 0;
+    UE(i).tb_bits_ok = 0;
+    UE(i).harq_tx = 0;
+    UE(i).a = [];
+    UE(i).g = [];
+    UE(i).rv_id = 0;
+    if ~isfield(UE(i), 'harq_max_tx') || isempty(UE(i).harq_max_tx)
+      UE(i).harq_max_tx = 1;
+    end
     UE(i).EVM_meas = zeros(sim_dur_slots,1);
 
     [d,g] = power_delay_profile(UE(i).mpprofile, 1 / frame_cfg.F_s, channel.pdp_resample_meth, channel.pdp_reduce_N);
     UE(i).pdp = [d;g];
   end
 
+  if isfield(channel, 'tdl_block_len')
+    tdl_block_len = channel.tdl_block_len;
+  else
+    tdl_block_len = 0;
+  end
+
+  % PRB range covering allocations of all UEs
+  prb_first = min([UE.PUSCH_sched_RB_offset]);
+  prb_range = [prb_first, max([UE.PUSCH_sched_RB_offset] + [UE.PUSCH_sched_RB_num]) - prb_first];
+
+  % one HARQ process per UE
+  rv_seq = [0, 2, 3, 1];
+  % soft buffers hold LLRs in the format of the decoder input of each UE
+  nr_harq_soft_buffer('init', length(UE));
+
+  % parallel tasks: seed of the random substreams, number of workers and
+  % pipelining of front-ends, which needs no HARQ feedback from the
+  % back-ends of the previous slot
+  N_ue = length(UE);
+  seed = [];
+  N_workers = 0;
+  pipeline = false;
+  if cfg.parallel
+    seed = randi(2^31 - 1);
+    try
+      pool = gcp('nocreate');
+      if ~isempty(pool)
+        N_workers = pool.NumWorkers;
+      end
+    catch
+    end
+    % workers decode with a single thread each
+    if N_workers > 1
+      for i = 1 : N_ue
+        UE(i).algorithms.ldpc_num_threads = 1;
+      end
+    end
+    pipeline = all([UE.harq_max_tx] == 1);
+  end
+
   for n_slot = 0 : sim_dur_slots-1
-    n_frame = floor(n_slot / frame_cfg.N_frame_slot);
     n_slot_frame = mod(n_slot, frame_cfg.N_frame_slot);
+    nr_profiler('slot', n_slot);
+    t_slot = nr_profiler('begin', 'slot');
 
-    % Transmitter
-    for i = 1:length(UE)
-      UE(i).a = randi([0 1], [UE(i).tbs 1]);
-      UE(i).g = nr_sch_encode(UE(i).a, UE(i).I_mcs, UE(i).N_layer, 0, UE(i).ctbs, UE(i).higher_layer_parameters.MCS_Table_PUSCH);
-      x_tx = nr_pusch_transmit(UE(i).g, UE(i).Q_m, UE(i).N_layer, frame_cfg, n_slot_frame, UE(i).PUSCH_symbol_start, UE(i).PUSCH_sched_RB_offset, UE(i).PUSCH_sched_RB_num, UE(i).antenna_ports, UE(i).higher_layer_parameters, 0, 0);
-      UE(i).y_tx = nr_ofdma_modulator(x_tx, frame_cfg, n_slot_frame);
-      for n_tx = 1 : size(UE(i).y_tx,2)
-        UE(i).y_tx(:,n_tx) = conv(UE(i).y_tx(:,n_tx), UE(i).tx_filter', 'same');
-      end
+    for i = 1 : N_ue
+      UE(i).rv_id = rv_seq(mod(UE(i).harq_tx, length(rv_seq)) + 1);
     end
 
-    % Wireless Channel 
-    y_tx = zeros(size(UE(1).y_tx));
-    for i = 1:length(UE)
-      if channel.rayleigh_en
-        y_tx_ue = apply_fading_td(UE(i).y_tx, UE(i).f_doppler, frame_cfg.F_s, UE(i).pdp, channel.method, [UE(i).N_ant_TX, N_ant_eNB_RX, channel.MIMO_corr(1), channel.MIMO_corr(2)]);
-      else
-        y_tx_ue = UE(i).y_tx;
-      end
+    % Front-end: transmitters, wireless channel and OFDM demodulation,
+    % computed by the previous slot if pipelined
+    if ~pipeline || n_slot == 0
+      [x_rx, a, g] = slot_frontend(frame_cfg, UE, N_ant_eNB_RX, channel, SNR, n_slot, prb_range, tdl_block_len, seed, N_workers);
+    else
+      x_rx = frontend_next{1};
+      a = frontend_next{2};
+      g = frontend_next{3};
+    end
+    for i = 1 : N_ue
+      UE(i).a = a{i};
+      UE(i).g = g{i};
+    end
 
-      if channel.normalize_response
-        for n_tx = 1 : size(y_tx_ue,2)
-          y_tx_ue(:,n_tx) = y_tx_ue(:,n_tx) / rms(y_tx_ue(:,n_tx)) * rms(UE(i).y_tx(:,n_tx));
+    % Back-ends of UEs, and the front-end of the next slot if pipelined.
+    % Serial back-ends combine LLRs in the soft buffers of the UEs in
+    % place, parallel ones get the buffers and return the combined LLRs
+    N_task = N_ue + (pipeline && n_slot + 1 < sim_dur_slots);
+    out = cell(N_task, 1);
+    if isempty(seed)
+      for i = 1 : N_ue
+        out{i} = ue_backend(frame_cfg, UE(i), x_rx, n_slot_frame, i);
+      end
+    else
+      d0 = cell(N_ue, 1);
+      for i = 1 : N_ue
+        d0{i} = nr_harq_soft_buffer('get', i);
+      end
+      parfor (t = 1 : N_task, N_workers)
+        if t <= N_ue
+          out{t} = ue_backend(frame_cfg, UE(t), x_rx, n_slot_frame, d0{t});
+        else
+          [x_next, a_next, g_next] = slot_frontend(frame_cfg, UE, N_ant_eNB_RX, channel, SNR, n_slot + 1, prb_range, tdl_block_len, seed, 0);
+          out{t} = {x_next, a_next, g_next};
         end
       end
-
-      y_tx = y_tx + cfo_add(y_tx_ue, channel.F_cfo, frame_cfg.F_s);
-      y_tx = y_tx + y_tx_ue;
+      if N_task > N_ue
+        frontend_next = out{end};
+      end
     end
 
-    noise = 10.0 ^ (-SNR / 20.0) / sqrt(2) * (randn(size(y_tx)) + 1i * randn(size(y_tx)));
-    y_rx = y_tx + noise;
-
-    % Receiver
-    for i = 1:length(UE)
-      x_rx = nr_ofdma_demodulator(y_rx, frame_cfg, n_slot_frame);
-      [llrs, EVM_DMRS] = nr_pusch_receive(x_rx, UE(i).Q_m, UE(i).N_layer, frame_cfg, n_slot_frame, UE(i).PUSCH_symbol_start, UE(i).PUSCH_symbols_sched, UE(i).PUSCH_sched_RB_offset, UE(i).PUSCH_sched_RB_num, UE(i).antenna_ports, UE(i).higher_layer_parameters, UE(i).algorithms, 0);      
-      [a_rx, ~, cb_crc_ok] = nr_sch_decode(llrs, UE(i).I_mcs, UE(i).N_layer, 0, UE(i).tbs, UE(i).higher_layer_parameters.MCS_Table_PUSCH);
+    for i = 1 : N_ue
+      r = out{i};
 
       % update statistics
-      UE(i).coded_tx = UE(i).coded_tx + numel(a_rx);
-      UE(i).coded_err = UE(i).coded_err + sum(a_rx ~= UE(i).a);
-
-      UE(i).uncoded_tx = UE(i).uncoded_tx + numel(llrs);
-      UE(i).uncoded_err = UE(i).uncoded_err + sum(llr2hardbit(llrs) ~= UE(i).g(:));
+      UE(i).coded_tx = UE(i).coded_tx + r.coded_tx;
+      UE(i).coded_err = UE(i).coded_err + r.coded_err;
+      UE(i).uncoded_tx = UE(i).uncoded_tx + r.uncoded_tx;
+      UE(i).uncoded_err = UE(i).uncoded_err + r.uncoded_err;
+      UE(i).block_tx = UE(i).block_tx + r.block_tx;
+      UE(i).block_err = UE(i).block_err + r.block_err;
 
-      UE(i).block_tx = UE(i).block_tx + numel(cb_crc_ok);
-      UE(i).block_err = UE(i).block_err + numel(cb_crc_ok) - sum(cb_crc_ok);
+      UE(i).EVM_meas(n_slot+1) = r.EVM_DMRS;
 
-      UE(i).EVM_meas(n_slot+1) = rms(EVM_DMRS(:));
+      % HARQ: keep combined LLRs for retransmission or complete the transport block
+      UE(i).harq_tx = UE(i).harq_tx + 1;
+      if r.tb_crc_ok || UE(i).harq_tx >= UE(i).harq_max_tx
+        UE(i).tb_tx = UE(i).tb_tx + 1;
+        UE(i).tb_err = UE(i).tb_err + ~r.tb_crc_ok;
+        UE(i).tb_bits_ok = UE(i).tb_bits_ok + r.tb_crc_ok * UE(i).tbs;
+        UE(i).harq_tx = 0;
+        nr_harq_soft_buffer('release', i);
+      elseif ~isempty(seed)
+        nr_harq_soft_buffer('store', i, r.d);
+      end
     end
+    nr_profiler('end', t_slot);
   end
 
   res = struct();
@@ -126,11 +247,145 @@ function res = nr_sch_link_level_sim(frame_cfg, sim_dur_slots, UE, N_ant_eNB_RX,
   res.BER_u     = zeros(length(UE), 1);
   res.BLER      = zeros(length(UE), 1);
   res.EVM_DMRS  = zeros(length(UE), 1);
+  res.residual_BLER = zeros(length(UE), 1);
+  res.throughput    = zeros(length(UE), 1);
+  res.counts = struct();
+  for f = {'coded_err', 'coded_tx', 'uncoded_err', 'uncoded_tx', 'block_err', 'block_tx', 'tb_err', 'tb_tx', 'tb_bits_ok'}
+    res.counts.(f{1}) = reshape([UE.(f{1})], [], 1);
+  end
+  res.counts.slots = sim_dur_slots;
+
+  T_slot = 1e-3 / frame_cfg.N_subframe_slot;
 
   for i = 1:length(UE)
     res.BER_c   (i) = UE(i).coded_err / UE(i).coded_tx;
     res.BER_u   (i) = UE(i).uncoded_err / UE(i).uncoded_tx;
     res.BLER    (i) = UE(i).block_err / UE(i).block_tx;
     res.EVM_DMRS(i) = rms(UE(i).EVM_meas);
+    res.residual_BLER(i) = UE(i).tb_err / UE(i).tb_tx;
+    res.throughput   (i) = UE(i).tb_bits_ok / (sim_dur_slots * T_slot);
+  end
+
+  if cfg.profile
+    res.profile = nr_profiler('report');
+    if ~isempty(cfg.trace_file)
+      nr_profiler('export', cfg.trace_file);
+    end
+  end
+  nr_profiler('init', false);
+
+  nr_harq_soft_buffer('free');
+end
+% Transmitters of all UEs, the wireless channel and OFDM demodulation of
+% the band occupied by all UEs in slot n_slot. If seed is not empty, UEs are
+% processed by up to N_workers workers, each UE and the noise drawing
+% random numbers from its own substream of the slot.
+function [x_rx, a, g] = slot_frontend(frame_cfg, UE, N_ant_eNB_RX, channel, SNR, n_slot, prb_range, tdl_block_len, seed, N_workers)
+  N_ue = length(UE);
+  n_slot_frame = mod(n_slot, frame_cfg.N_frame_slot);
+  a = cell(N_ue, 1);
+  g = cell(N_ue, 1);
+  y_tx_ue = cell(N_ue, 1);
+
+  if isempty(seed)
+    y = cell(N_ue, 1);
+    for i = 1 : N_ue
+      [a{i}, g{i}, y{i}] = ue_transmit(frame_cfg, UE(i), n_slot_frame);
+    end
+    t_prof = nr_profiler('begin', 'channel');
+    for i = 1 : N_ue
+      y_tx_ue{i} = ue_channel(frame_cfg, UE(i), y{i}, N_ant_eNB_RX, channel, tdl_block_len);
+    end
+  else
+    parfor (i = 1 : N_ue, N_workers)
+      rng_substream(seed, n_slot * (N_ue + 1) + i);
+      [a_i, g_i, y_i] = ue_transmit(frame_cfg, UE(i), n_slot_frame);
+      a{i} = a_i;
+      g{i} = g_i;
+      y_tx_ue{i} = ue_channel(frame_cfg, UE(i), y_i, N_ant_eNB_RX, channel, tdl_block_len);
+    end
+    rng_substream(seed, n_slot * (N_ue + 1) + N_ue + 1);
+    t_prof = nr_profiler('begin', 'channel');
+  end
+
+  y_tx = zeros(size(y_tx_ue{1}));
+  for i = 1 : N_ue
+    y_tx = y_tx + cfo_add(y_tx_ue{i}, channel.F_cfo, frame_cfg.F_s);
+    y_tx = y_tx + y_tx_ue{i};
+  end
+
+  noise = 10.0 ^ (-SNR / 20.0) / sqrt(2) * (randn(size(y_tx)) + 1i * randn(size(y_tx)));
+  y_rx = y_tx + noise;
+  nr_profiler('end', t_prof);
+
+  % OFDM demodulation of the band occupied by all UEs, once per slot
+  t_prof = nr_profiler('begin', 'ofdma_demodulator');
+  x_rx = nr_ofdma_demodulator(y_rx, frame_cfg, n_slot_frame, prb_range);
+  nr_profiler('end', t_prof);
+end
+
+% transport block (a new one on the first transmission), its codeword and
+% the time domain signal of UE
+function [a, g, y_tx] = ue_transmit(frame_cfg, UE, n_slot_frame)
+  if UE.harq_tx == 0
+    a = randi([0 1], [UE.tbs 1]);
+  else
+    a = UE.a;
+  end
+  t_prof = nr_profiler('begin', 'sch_encode');
+  g = nr_sch_encode(a, UE.I_mcs, UE.N_layer, UE.rv_id, UE.ctbs, UE.higher_layer_parameters.MCS_Table_PUSCH);
+  nr_profiler('end', t_prof);
+  t_prof = nr_profiler('begin', 'pusch_transmit');
+  x_tx = nr_pusch_transmit(g, UE.Q_m, UE.N_layer, frame_cfg, n_slot_frame, UE.PUSCH_symbol_start, UE.PUSCH_sched_RB_offset, UE.PUSCH_sched_RB_num, UE.antenna_ports, UE.higher_layer_parameters, 0, 0);
+  nr_profiler('end', t_prof);
+  t_prof = nr_profiler('begin', 'ofdma_modulator');
+  y_tx = nr_ofdma_modulator(x_tx, frame_cfg, n_slot_frame, UE.tx_filter);
+  nr_profiler('end', t_prof);
+end
+
+% signal y_tx of UE at the receive antennas
+function y_tx_ue = ue_channel(frame_cfg, UE, y_tx, N_ant_eNB_RX, channel, tdl_block_len)
+  if channel.rayleigh_en
+    y_tx_ue = apply_fading_td(y_tx, UE.f_doppler, frame_cfg.F_s, UE.pdp, channel.method, [UE.N_ant_TX, N_ant_eNB_RX, channel.MIMO_corr(1), channel.MIMO_corr(2)], tdl_block_len);
+  else
+    y_tx_ue = y_tx;
+  end
+
+  if channel.normalize_response
+    for n_tx = 1 : size(y_tx_ue,2)
+      y_tx_ue(:,n_tx) = y_tx_ue(:,n_tx) / rms(y_tx_ue(:,n_tx)) * rms(y_tx(:,n_tx));
+    end
+  end
+end
+
+% receiver and decoder of UE in the demodulated slot x_rx with HARQ soft
+% buffer d0 (LLRs, or index of the soft buffer combined in place), returns
+% the statistics of the slot
+function r = ue_backend(frame_cfg, UE, x_rx, n_slot_frame, d0)
+  t_prof = nr_profiler('begin', 'pusch_receive');
+  [llrs, EVM_DMRS] = nr_pusch_receive(x_rx, UE.Q_m, UE.N_layer, frame_cfg, n_slot_frame, UE.PUSCH_symbol_start, UE.PUSCH_symbols_sched, UE.PUSCH_sched_RB_offset, UE.PUSCH_sched_RB_num, UE.antenna_ports, UE.higher_layer_parameters, UE.algorithms, 0);
+  nr_profiler('end', t_prof);
+  t_prof = nr_profiler('begin', 'sch_decode');
+  [a_rx, tb_crc_ok, cb_crc_ok, d] = nr_sch_decode(llrs, UE.I_mcs, UE.N_layer, UE.rv_id, UE.tbs, UE.higher_layer_parameters.MCS_Table_PUSCH, UE.algorithms, d0);
+  nr_profiler('end', t_prof);
+
+  r = struct();
+  r.coded_tx = numel(a_rx);
+  r.coded_err = sum(a_rx ~= UE.a);
+  if isstruct(llrs)
+    % LLRs are not exposed by the fused receive back-end
+    r.uncoded_tx = numel(UE.g);
+    r.uncoded_err = NaN;
+  else
+    r.uncoded_tx = numel(llrs);
+    r.uncoded_err = sum(llr2hardbit(llrs) ~= UE.g(:));
+  end
+  r.block_tx = numel(cb_crc_ok);
+  r.block_err = numel(cb_crc_ok) - sum(cb_crc_ok);
+  r.EVM_DMRS = rms(EVM_DMRS(:));
+  r.tb_crc_ok = tb_crc_ok;
+  r.d = [];
+  if ~isscalar(d0)
+    r.d = d;
   end
-end
\ No newline at end of file
+end
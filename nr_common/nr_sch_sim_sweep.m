@@ -0,0 +1,190 @@
+%res = nr_sch_sim_sweep(frame_cfg, UE, N_ant_eNB_RX, channel, SNR, MCS, sweep_cfg)
+%
+% Runs link level simulations (see nr_sch_link_level_sim) over a grid of
+% SNR values, MCS indices and channel configurations.
+%
+% Every point of the grid is simulated in batches of slots. Batches of
+% all unfinished points are distributed over the workers of the current
+% parallel pool (parfor, serial execution if Parallel Computing Toolbox is
+% not available). Each batch uses its own substream of a random number
+% generator, selected by the point and batch index, so results do not
+% depend on the number of workers or on resuming an interrupted sweep.
+%
+% A point is finished when the number of transport block errors reaches
+% the target, when the relative half-width of the 95% confidence interval
+% of the transport block error ratio falls below the target, or after the
+% maximum number of slots. Batches of a round are aggregated in batch
+% order and a point stops at the first batch meeting a criterion, its later
+% batches of the round are discarded, so that a point ends after the same
+% batches as in serial execution. After every round of batches the state
+% of the sweep is written to the checkpoint file, and a sweep started with
+% an existing checkpoint file of the same grid continues from the saved
+% state.
+%
+% Arguments:
+%  frame_cfg     - OFDM framing constants structure
+%  UE            - vector of UE structures (see nr_sch_link_level_sim),
+%                  MCS of all UEs is set from the MCS argument
+%  N_ant_eNB_RX  - number of antennas in the receiver
+%  channel       - vector of channel structures (see nr_sch_link_level_sim)
+%  SNR           - vector of signal to noise ratios in dB
+%  MCS           - vector of MCS indices
+%  sweep_cfg     - optional structure with the members (defaults in brackets):
+%                  batch_slots   - number of slots in a batch [20]
+%                  max_slots     - maximum number of slots of a point [2000]
+%                  min_tb_err    - target number of transport block errors [100]
+%                  ci_rel        - target relative half-width of 95% confidence
+%                                  interval of transport block error ratio,
+%                                  0 disables the criterion [0]
+%                  seed          - seed of random number generator [0]
+%                  checkpoint    - checkpoint file name, empty to disable ['']
+%                  verbose       - print progress after every round [true]
+%
+% Returns:
+%  res           - structure array of size [numel(SNR),numel(MCS),numel(channel)]
+%                  with the result members of nr_sch_link_level_sim aggregated
+%                  over all batches of a point
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function res = nr_sch_sim_sweep(frame_cfg, UE, N_ant_eNB_RX, channel, SNR, MCS, sweep_cfg)
+  if nargin < 7
+    sweep_cfg = struct();
+  end
+  cfg = struct('batch_slots', 20, 'max_slots', 2000, 'min_tb_err', 100, 'ci_rel', 0, 'seed', 0, 'checkpoint', '', 'verbose', true);
+  for f = fieldnames(sweep_cfg)'
+    cfg.(f{1}) = sweep_cfg.(f{1});
+  end
+
+  grid_size = [numel(SNR), numel(MCS), numel(channel)];
+  N_point = prod(grid_size);
+  max_batches = ceil(cfg.max_slots / cfg.batch_slots);
+
+  N_workers = 1;
+  try
+    pool = gcp('nocreate');
+    if ~isempty(pool)
+      N_workers = pool.NumWorkers;
+    end
+  catch
+  end
+
+  % workers decode with a single thread each
+  if N_workers > 1
+    for i = 1 : length(UE)
+      UE(i).algorithms.ldpc_num_threads = 1;
+    end
+  end
+
+  state = struct();
+  state.SNR = SNR(:);
+  state.MCS = MCS(:);
+  state.N_channel = numel(channel);
+  state.seed = cfg.seed;
+  state.batch_slots = cfg.batch_slots;
+  state.batches = zeros(N_point, 1);
+  state.done = false(N_point, 1);
+  state.counts = cell(N_point, 1);
+  state.evm_sq = cell(N_point, 1);
+
+  if ~isempty(cfg.checkpoint) && exist(cfg.checkpoint, 'file')
+    cp = load(cfg.checkpoint);
+    if isequal(cp.state.SNR, state.SNR) && isequal(cp.state.MCS, state.MCS) && cp.state.N_channel == state.N_channel && ...
+       cp.state.seed == state.seed && cp.state.batch_slots == state.batch_slots
+      state = cp.state;
+      if cfg.verbose
+        fprintf('nr_sch_sim_sweep: resumed from %s, %d of %d points done\n', cfg.checkpoint, sum(state.done), N_point);
+      end
+    else
+      warning('checkpoint file %s does not match the sweep configuration, starting from scratch', cfg.checkpoint);
+    end
+  end
+
+  while ~all(state.done)
+    % schedule batches of unfinished points, enough to keep all workers busy
+    pending = find(~state.done);
+    per_point = max(1, ceil(N_workers / length(pending)));
+    task_point = zeros(0,1);
+    task_batch = zeros(0,1);
+    for p = reshape(pending, 1, [])
+      b = state.batches(p) + (1 : min(per_point, max_batches - state.batches(p)));
+      task_point = [task_point; repmat(p, length(b), 1)];
+      task_batch = [task_batch; b(:)];
+    end
+
+    N_task = length(task_point);
+    task_res = cell(N_task, 1);
+    parfor t = 1 : N_task
+      task_res{t} = run_batch(frame_cfg, UE, N_ant_eNB_RX, channel, SNR, MCS, grid_size, cfg, max_batches, task_point(t), task_batch(t));
+    end
+
+    % aggregate in batch order (tasks of a point are in batch order), up to
+    % the batch that finishes the point
+    for t = 1 : N_task
+      p = task_point(t);
+      if state.done(p)
+        continue;
+      end
+      r = task_res{t};
+      if isempty(state.counts{p})
+        state.counts{p} = r.counts;
+        state.evm_sq{p} = r.EVM_DMRS.^2 * r.counts.slots;
+      else
+        for f = fieldnames(r.counts)'
+          state.counts{p}.(f{1}) = state.counts{p}.(f{1}) + r.counts.(f{1});
+        end
+        state.evm_sq{p} = state.evm_sq{p} + r.EVM_DMRS.^2 * r.counts.slots;
+      end
+      state.batches(p) = state.batches(p) + 1;
+      state.done(p) = point_finished(state.counts{p}, cfg, state.batches(p) >= max_batches);
+    end
+
+    if ~isempty(cfg.checkpoint)
+      save(cfg.checkpoint, 'state');
+    end
+
+    if cfg.verbose
+      fprintf('nr_sch_sim_sweep: %d of %d points done, %d batches simulated\n', sum(state.done), N_point, sum(state.batches));
+    end
+  end
+
+  T_slot = 1e-3 / frame_cfg.N_subframe_slot;
+  res = struct();
+  for p = 1 : N_point
+    c = state.counts{p};
+    res(p).BER_c = c.coded_err ./ c.coded_tx;
+    res(p).BER_u = c.uncoded_err ./ c.uncoded_tx;
+    res(p).BLER = c.block_err ./ c.block_tx;
+    res(p).EVM_DMRS = sqrt(state.evm_sq{p} / c.slots);
+    res(p).residual_BLER = c.tb_err ./ c.tb_tx;
+    res(p).throughput = c.tb_bits_ok / (c.slots * T_slot);
+    res(p).counts = c;
+  end
+  res = reshape(res, grid_size);
+end
+
+function r = run_batch(frame_cfg, UE, N_ant_eNB_RX, channel, SNR, MCS, grid_size, cfg, max_batches, p, b)
+  [i_snr, i_mcs, i_ch] = ind2sub(grid_size, p);
+
+  % random number substream unique to the point and batch
+  rng_substream(cfg.seed, (p - 1) * max_batches + b);
+
+  for i = 1 : length(UE)
+    UE(i).I_mcs = MCS(i_mcs);
+  end
+
+  slots = min(cfg.batch_slots, cfg.max_slots - (b - 1) * cfg.batch_slots);
+  r = nr_sch_link_level_sim(frame_cfg, slots, UE, N_ant_eNB_RX, channel(i_ch), SNR(i_snr));
+end
+
+function done = point_finished(c, cfg, out_of_slots)
+  tb_err = sum(c.tb_err);
+  tb_tx = sum(c.tb_tx);
+
+  done = out_of_slots || tb_err >= cfg.min_tb_err;
+
+  if ~done && cfg.ci_rel > 0 && tb_err > 0
+    p = tb_err / tb_tx;
+    done = 1.96 * sqrt(p * (1 - p) / tb_tx) <= cfg.ci_rel * p;
+  end
+end
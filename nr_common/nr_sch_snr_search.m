@@ -0,0 +1,156 @@
+%res = nr_sch_snr_search(frame_cfg, UE, N_ant_eNB_RX, channel, MCS, BLER_target, search_cfg)
+%
+% Finds SNR at which the transport block error ratio of link level
+% simulation (see nr_sch_link_level_sim) equals the target, for every MCS,
+% channel configuration and BLER target. Only the waterfall region of BLER
+% curves is simulated.
+%
+% Every search is a bisection of the SNR interval. At every SNR, batches
+% of slots are simulated until a sequential test decides on which side of
+% the target the BLER is: the estimate lies outside the 95% confidence
+% interval of the target, the number of transport block errors reaches
+% min_tb_err, or max_slots are simulated. The threshold is interpolated
+% in log(BLER) between the final bracket points. BLER is assumed to
+% decrease with SNR, and to be above the target at the lower and below at
+% the upper end of the interval.
+%
+% Searches run in parallel over the workers of the current parallel pool
+% (parfor), each batch with its own random number substream (see
+% rng_substream). Caches of decoder and estimator persist in the workers
+% between batches.
+%
+% Arguments:
+%  frame_cfg     - OFDM framing constants structure
+%  UE            - vector of UE structures (see nr_sch_link_level_sim),
+%                  MCS of all UEs is set from the MCS argument
+%  N_ant_eNB_RX  - number of antennas in the receiver
+%  channel       - vector of channel structures (see nr_sch_link_level_sim)
+%  MCS           - vector of MCS indices
+%  BLER_target   - vector of target transport block error ratios
+%  search_cfg    - optional structure with the members (defaults in brackets):
+%                  SNR_range     - searched SNR interval in dB [-10, 30]
+%                  SNR_tol       - width of the final SNR interval in dB [0.25]
+%                  batch_slots   - number of slots in a batch [20]
+%                  max_slots     - maximum number of slots at one SNR [2000]
+%                  min_tb_err    - number of transport block errors that
+%                                  ends simulation at one SNR [100]
+%                  seed          - seed of random number generator [0]
+%
+% Returns:
+%  res           - structure with the members:
+%                  SNR_threshold - SNR in dB at BLER target, array of size
+%                                  [numel(MCS),numel(BLER_target),numel(channel)]
+%                  slots         - number of simulated slots per search (same size)
+%                  mcs_table     - cell array of size [numel(BLER_target),numel(channel)]
+%                                  of MCS switching tables for link adaptation.
+%                                  Each table is a matrix of rows [MCS, SNR], MCS
+%                                  is selected if SNR is not lower than given.
+%                                  MCS values not better than a lower MCS at any
+%                                  SNR are omitted.
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function res = nr_sch_snr_search(frame_cfg, UE, N_ant_eNB_RX, channel, MCS, BLER_target, search_cfg)
+  if nargin < 7
+    search_cfg = struct();
+  end
+  cfg = struct('SNR_range', [-10, 30], 'SNR_tol', 0.25, 'batch_slots', 20, 'max_slots', 2000, 'min_tb_err', 100, 'seed', 0);
+  for f = fieldnames(search_cfg)'
+    cfg.(f{1}) = search_cfg.(f{1});
+  end
+
+  grid_size = [numel(MCS), numel(BLER_target), numel(channel)];
+  N_search = prod(grid_size);
+
+  try
+    pool = gcp('nocreate');
+    if ~isempty(pool) && pool.NumWorkers > 1
+      for i = 1 : length(UE)
+        UE(i).algorithms.ldpc_num_threads = 1;
+      end
+    end
+  catch
+  end
+
+  SNR_threshold = zeros(N_search, 1);
+  slots = zeros(N_search, 1);
+  parfor s = 1 : N_search
+    [thr, n_slots] = snr_search(frame_cfg, UE, N_ant_eNB_RX, channel, MCS, BLER_target, grid_size, cfg, s);
+    SNR_threshold(s) = thr;
+    slots(s) = n_slots;
+  end
+
+  res = struct();
+  res.SNR_threshold = reshape(SNR_threshold, grid_size);
+  res.slots = reshape(slots, grid_size);
+
+  % MCS switching: a higher MCS is useful only above thresholds of all lower ones
+  res.mcs_table = cell(grid_size(2), grid_size(3));
+  [MCS_sorted, order] = sort(MCS(:));
+  for i_target = 1 : grid_size(2)
+    for i_ch = 1 : grid_size(3)
+      thr = res.SNR_threshold(order, i_target, i_ch);
+      keep = [true; thr(2:end) > cummax(thr(1:end-1))];
+      res.mcs_table{i_target, i_ch} = [MCS_sorted(keep), thr(keep)];
+    end
+  end
+end
+
+function [SNR_thr, slots] = snr_search(frame_cfg, UE, N_ant_eNB_RX, channel, MCS, BLER_target, grid_size, cfg, s)
+  [i_mcs, i_target, i_ch] = ind2sub(grid_size, s);
+  target = BLER_target(i_target);
+
+  for i = 1 : length(UE)
+    UE(i).I_mcs = MCS(i_mcs);
+  end
+
+  max_batches = ceil(cfg.max_slots / cfg.batch_slots);
+  max_evals = ceil(log2((cfg.SNR_range(2) - cfg.SNR_range(1)) / cfg.SNR_tol)) + 1;
+
+  lo = cfg.SNR_range(1);
+  hi = cfg.SNR_range(2);
+  bler_lo = NaN;
+  bler_hi = NaN;
+  slots = 0;
+  n_eval = 0;
+
+  while hi - lo > cfg.SNR_tol
+    SNR = (lo + hi) / 2;
+    tb_err = 0;
+    tb_tx = 0;
+
+    for b = 1 : max_batches
+      % random number substream unique to the search, SNR step and batch
+      rng_substream(cfg.seed, ((s - 1) * max_evals + n_eval) * max_batches + b);
+
+      batch_slots = min(cfg.batch_slots, cfg.max_slots - (b - 1) * cfg.batch_slots);
+      r = nr_sch_link_level_sim(frame_cfg, batch_slots, UE, N_ant_eNB_RX, channel(i_ch), SNR);
+      tb_err = tb_err + sum(r.counts.tb_err);
+      tb_tx = tb_tx + sum(r.counts.tb_tx);
+      slots = slots + batch_slots;
+
+      % sequential test against the target
+      if tb_err >= cfg.min_tb_err || ...
+         (tb_tx > 0 && abs(tb_err / tb_tx - target) > 1.96 * sqrt(target * (1 - target) / tb_tx))
+        break;
+      end
+    end
+    n_eval = n_eval + 1;
+
+    bler = tb_err / max(tb_tx, 1);
+    if bler > target
+      lo = SNR;
+      bler_lo = bler;
+    else
+      hi = SNR;
+      bler_hi = bler;
+    end
+  end
+
+  % interpolation in log domain between bracket points
+  if bler_lo > 0 && bler_hi > 0 && bler_lo > bler_hi
+    SNR_thr = lo + (hi - lo) * log(bler_lo / target) / log(bler_lo / bler_hi);
+  else
+    SNR_thr = (lo + hi) / 2;
+  end
+end
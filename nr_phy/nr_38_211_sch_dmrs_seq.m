@@ -19,7 +19,7 @@ function r = nr_38_211_sch_dmrs_seq(n, slot_num, symbol_num, N_ID, n_SCID)
   if nargin < 5; n_SCID = 0; end
 
   c_init = mod(2^17*(14*slot_num+symbol_num+1)*(2*N_ID+1)+2*N_ID+n_SCID, 2^31);
-  c = gold31seq(c_init, 2 * (max(n) + 1));
+  cs = gold31seq(c_init, 2 * (max(n) + 1), 'bipolar');
 
-  r = ((1 - 2*c(1+2*n)) + 1i * (1 - 2*c(2+2*n))) / sqrt(2);
+  r = (cs(1+2*n) + 1i * cs(2+2*n)) / sqrt(2);
 end
\ No newline at end of file
@@ -24,16 +24,14 @@ function bs = nr_38_211_sch_scrambling(b, n_rnti, n_ID, q)
   end
 
   c_init = n_rnti * 2^15 + q * 2^14 + n_ID;
-  c = reshape(gold31seq(c_init, length(b)), size(b));
 
   if all(ismember(b, [0 1]))
     % binary input
+    c = reshape(gold31seq(c_init, numel(b)), size(b));
     bs = mod(b + c, 2);
   else
     % soft-decision input
-    cs = zeros(size(b));
-    cs(c == 1) = -1;
-    cs(c == 0) = 1;
+    cs = reshape(gold31seq(c_init, numel(b), 'bipolar'), size(b));
     bs = b .* cs;
   end
 end
\ No newline at end of file
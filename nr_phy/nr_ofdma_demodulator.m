@@ -1,4 +1,4 @@
-%x = nr_ofdma_demodulator(y, frame_cfg, slot_num)
+%x = nr_ofdma_demodulator(y, frame_cfg, slot_num, prb_range)
 %
 % Applies OFDM demodulation to a slot time domain signal as specified 
 % in 3GPP 38.211 sec. 5.3.1. Removes cyclic prefix and guardbands.
@@ -13,16 +13,38 @@
 %              N_subframe_slot - number of slots in a subframe
 %              u - OFDM numerology (as per 3GPP 38.211 sec. 4.3.2)
 %  slot_num  - number of slot in frame
+%  prb_range - optional two element vector [n_PRB_start, n_PRB_num]. If
+%              given, only subcarriers of these PRBs are demodulated and
+%              the remaining part of the RE grid is set to zero.
 %
 % Returns:
 %  x         - RE grid (3-D array of size [N_sc,N_slot_symbol,N_ant])
 
-% Copyright 2017-2018 Grzegorz Cisek (grzegorzcisek@gmail.com)
+% Copyright 2017-2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function x = nr_ofdma_demodulator(y, frame_cfg, slot_num)
+function x = nr_ofdma_demodulator(y, frame_cfg, slot_num, prb_range)
   [N_cp_first, N_cp_other] = nr_cyclic_prefix_len(frame_cfg, slot_num);
   N_guard = (frame_cfg.N_fft - frame_cfg.N_sc) / 2;
 
+  if nargin < 4 || isempty(prb_range)
+    sc_range = [0, frame_cfg.N_sc];
+  else
+    sc_range = prb_range * frame_cfg.N_sc_RB;
+  end
+
+  try
+    x = nr_ofdma_demodulator_mex(y, frame_cfg.N_fft, frame_cfg.N_sc, N_cp_first, N_cp_other, frame_cfg.N_slot_symbol, sc_range);
+    return;
+  catch
+    persistent flag
+    if isempty(flag)
+      disp('nr_ofdma_demodulator: compile mex file to reduce execution time');
+      flag = 0;
+    end
+  end
+
+  k = sc_range(1) + (1 : sc_range(2));
+
   N_ant = size(y,2);
   x = zeros(frame_cfg.N_sc, frame_cfg.N_slot_symbol, N_ant);
 
@@ -45,7 +67,7 @@ function x = nr_ofdma_demodulator(y, frame_cfg, slot_num)
     for l = 1 : frame_cfg.N_slot_symbol
       if any(y_framed(:,l))
         x_gb = fftshift(fft(y_framed(:,l))) / sqrt(frame_cfg.N_fft);
-        x(:,l,ant) = x_gb(1+N_guard:N_guard+frame_cfg.N_sc);
+        x(k,l,ant) = x_gb(N_guard+k);
       else
         x(:,l,ant) = zeros(frame_cfg.N_sc,1);
       end
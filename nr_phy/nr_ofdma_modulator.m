@@ -1,4 +1,4 @@
-%y = nr_ofdma_modulator(x, frame_cfg, slot_num)
+%[y, filter_state] = nr_ofdma_modulator(x, frame_cfg, slot_num, tx_filter, filter_state)
 %
 % Applies OFDM modulation to a slot time domain signal as specified 
 % in 3GPP 38.211 sec. 5.3.1. Adds cyclic prefix and guardbands.
@@ -14,20 +14,44 @@
 %              N_subframe_slot - number of slots in a subframe
 %              u - OFDM numerology (as per 3GPP 38.211 sec. 4.3.2)
 %  slot_num  - number of slot in frame
+%  tx_filter - optional vector of real-valued FIR filter coefficients applied
+%              to each antenna signal, by default as conv(y, tx_filter, 'same')
+%  filter_state - if given, the filter runs in streaming mode: filter_state
+%              holds the last numel(tx_filter)-1 unfiltered samples of the
+%              previous slot (empty for the first slot) and the output is
+%              the causal filter response, continuous across slots
 %
 % Returns:
 %  y         - time domain OFDM signal (matrix of size [N_sample_slot,N_ant])
+%  filter_state - filter state to be passed with the next slot
 
-% Copyright 2017-2018 Grzegorz Cisek (grzegorzcisek@gmail.com)
+% Copyright 2017-2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
 
-function y = nr_ofdma_modulator(x, frame_cfg, slot_num)
+function [y, filter_state] = nr_ofdma_modulator(x, frame_cfg, slot_num, tx_filter, filter_state)
   assert(size(x,1) == frame_cfg.N_sc && size(x,2) == frame_cfg.N_slot_symbol, 'input mst be be of size [N_sc,N_slot_symbol,N_ant]');
+  if nargin < 4; tx_filter = []; end
+  streaming = (nargin >= 5);
 
   N_ant = size(x,3);
   N_guard = (frame_cfg.N_fft - frame_cfg.N_sc) / 2;
 
   [N_cp_first, N_cp_other] = nr_cyclic_prefix_len(frame_cfg, slot_num);
 
+  try
+    if streaming
+      [y, filter_state] = nr_ofdma_modulator_mex(x, frame_cfg.N_fft, N_cp_first, N_cp_other, tx_filter, filter_state);
+    else
+      y = nr_ofdma_modulator_mex(x, frame_cfg.N_fft, N_cp_first, N_cp_other, tx_filter);
+    end
+    return;
+  catch
+    persistent flag
+    if isempty(flag)
+      disp('nr_ofdma_modulator: compile mex file to reduce execution time');
+      flag = 0;
+    end
+  end
+
   samples_in_slot = nr_samples_in_slot(frame_cfg, slot_num);
   y = zeros(samples_in_slot, N_ant);
 
@@ -37,7 +61,7 @@ function y = nr_ofdma_modulator(x, frame_cfg, slot_num)
     y_framed = zeros(frame_cfg.N_fft, frame_cfg.N_slot_symbol);
 
     for l = 1 : frame_cfg.N_slot_symbol
-      if any(x(:,l))
+      if any(x(:,l,ant))
         y_framed(:,l) = ifft(ifftshift(x_gb(:,l))) * sqrt(frame_cfg.N_fft);
       else
         y_framed(:,l) = zeros(frame_cfg.N_fft,1);
@@ -59,4 +83,27 @@ function y = nr_ofdma_modulator(x, frame_cfg, slot_num)
       sidx = sidx + frame_cfg.N_fft;
     end
   end
+
+  if isempty(tx_filter)
+    if streaming
+      filter_state = zeros(0, N_ant);
+    end
+    return;
+  end
+
+  N_h = numel(tx_filter);
+  if streaming && isempty(filter_state)
+    filter_state = zeros(N_h-1, N_ant);
+  end
+
+  for ant = 1 : N_ant
+    if streaming
+      v = [filter_state(:,ant); y(:,ant)];
+      y_f = conv(v, tx_filter(:));
+      filter_state(:,ant) = v(end-N_h+2:end);
+      y(:,ant) = y_f(N_h : N_h+size(y,1)-1);
+    else
+      y(:,ant) = conv(y(:,ant), tx_filter(:), 'same');
+    end
+  end
 end
\ No newline at end of file
@@ -27,7 +27,13 @@
 %  tpmi      - TPMI index from 3GPP 38.211 sec. 6.3.1.5.
 %
 % Returns:
-%  b         - vector of LLR values
+%  b         - vector of LLR values. If algorithms.fused_backend is set
+%              and max-log demodulation is selected, b is a structure of
+%              equalized symbols (members d, N0 and c_init), which is
+%              demapped, descrambled and rate unmatched by nr_sch_decode
+%              in a single step. If algorithms.precision is 'single',
+%              the receiver operates on single precision RE grids and
+%              symbols (LLRs are double)
 %  evm_dmrs  - EVM of DMRS signal per TX layer and RX antenna
 %              matrix size is [N_layer,N_rx_ant]
 
@@ -50,12 +56,16 @@ function [b, evm_dmrs] = nr_pusch_receive(a, Q_m, N_layer, frame_cfg, slot_num,
   dmrs_per_rb = nr_38_211_sch_dmrs_per_prb(higher_layer_params.UL_DMRS_config_type);
 
   a_partial = a(k,symbol_start+1:symbol_start+symbols_sched,:);
+  if isfield(algorithms, 'precision') && strcmpi(algorithms.precision, 'single')
+    a_partial = single(a_partial);
+  end
   
   k_dmrs = zeros(nr_38_211_sch_dmrs_per_prb(higher_layer_params.UL_DMRS_config_type)*n_PRB_sched, N_layer);
   tx_pilot = zeros(dmrs_per_rb*n_PRB_sched, symbols_dmrs, N_layer);
-  rx_pilot = zeros(dmrs_per_rb*n_PRB_sched, symbols_dmrs, N_layer, N_rx_ant);
+  rx_pilot = zeros(dmrs_per_rb*n_PRB_sched, symbols_dmrs, N_layer, N_rx_ant, class(a_partial));
 
   % Pilot generation and extraction
+  t_prof = nr_profiler('begin', 'pilots');
   ll = 1;
   for l = 0 : symbols_sched - 1 
     if ismember(l, l_dmrs) 
@@ -71,26 +81,24 @@ function [b, evm_dmrs] = nr_pusch_receive(a, Q_m, N_layer, frame_cfg, slot_num,
     end
   end
   
+  nr_profiler('end', t_prof);
+
   % Carrier Frequency Offset estimation and compensation
+  t_prof = nr_profiler('begin', 'cfo_sto');
   if ~strcmpi(algorithms.cfo_est, 'none')
     f_cfo_est = estimate_cfo_from_pilots(tx_pilot, rx_pilot, k_dmrs+1, l_dmrs+1, frame_cfg, algorithms.cfo_est);
-    cfomtx = cfo_fd_mtx(frame_cfg.N_fft, rms(f_cfo_est(:)), frame_cfg.scs);
-    cfomtx = cfomtx(k,k);
+    a_partial = cfo_correct_fd(a_partial, mean(f_cfo_est(:)), frame_cfg.scs, frame_cfg.N_fft);
     for n_sym = 1 : size(a_partial,2)
       offset = nr_symbol_start_offset(frame_cfg, slot_num, symbol_start + n_sym - 1);
-      for n_ant = 1 : size(a_partial,3)
-        a_partial(:,n_sym,n_ant) = cfomtx * a_partial(:,n_sym,n_ant) * exp(2i*pi*offset/frame_cfg.N_fft);
-      end
+      a_partial(:,n_sym,:) = a_partial(:,n_sym,:) * exp(2i*pi*offset/frame_cfg.N_fft);
     end
   end
   
   % Sample Time Offset estimation and compensation
   if ~strcmpi(algorithms.sto_est, 'none')
     t_sto_est = estimate_sto_from_pilots(tx_pilot, rx_pilot, k_dmrs+1, l_dmrs+1, frame_cfg, algorithms.sto_est);
-    for n_sym = 1 : size(a_partial, 2)
-      for n_ant = 1 : size(a_partial, 3)
-        a_partial(:,n_sym,n_ant) = a_partial(:,n_sym,n_ant) .* exp(2i * pi * (rms(t_sto_est(:,n_ant))) * (k-1)' / frame_cfg.N_fft);
-      end
+    for n_ant = 1 : size(a_partial, 3)
+      a_partial(:,:,n_ant) = a_partial(:,:,n_ant) .* exp(2i * pi * mean(t_sto_est(:,n_ant)) * (k-1)' / frame_cfg.N_fft);
     end
   end
 
@@ -103,60 +111,80 @@ function [b, evm_dmrs] = nr_pusch_receive(a, Q_m, N_layer, frame_cfg, slot_num,
     end
   end
   
-  if N_layer == 1 && N_rx_ant == 1
-    % Channel estimator
-    [H_est, noise_est, signal_est] = channel_estimate(tx_pilot, rx_pilot, k_dmrs+1, l_dmrs+1, [frame_cfg.N_sc_RB*n_PRB_sched,symbols_sched], algorithms.chan_est_avg, algorithms.chan_est, frame_cfg.N_fft);
-    % Equalizer
-    a_partial_eq = a_partial ./ H_est;
-  elseif N_layer == 2 && N_rx_ant == 2
-    a_partial_eq = zeros(size(a_partial));
-    H_est = zeros(frame_cfg.N_sc_RB*n_PRB_sched,symbols_sched,N_layer,N_rx_ant);
-    noise_est = zeros(N_layer,1);
-    signal_est = zeros(N_layer,1);
-    % Channel estimator
+  nr_profiler('end', t_prof);
+
+  assert(N_layer <= N_rx_ant, 'number of layers must not exceed number of receive antennas');
+
+  % Channel estimator
+  t_prof = nr_profiler('begin', 'chan_est');
+  chan_est_rank = 0;
+  if isfield(algorithms, 'chan_est_rank')
+    chan_est_rank = algorithms.chan_est_rank;
+  end
+  H_est = zeros(frame_cfg.N_sc_RB*n_PRB_sched,symbols_sched,N_layer,N_rx_ant,class(a_partial));
+  nr_profiler('alloc', H_est);
+  noise_est = zeros(N_layer,1);
+  for n_layer = 1 : N_layer
+    [H_est(:,:,n_layer,:), noise_est(n_layer)] = channel_estimate_SIMO(tx_pilot(:,:,n_layer), reshape(rx_pilot(:,:,n_layer,:), [dmrs_per_rb*n_PRB_sched,symbols_dmrs,N_rx_ant]), k_dmrs(:,n_layer)+1, l_dmrs+1, [frame_cfg.N_sc_RB*n_PRB_sched,symbols_sched], algorithms.chan_est_avg, algorithms.chan_est, frame_cfg.N_fft, chan_est_rank);
+  end
+
+  nr_profiler('end', t_prof);
+
+  % Equalizer
+  t_prof = nr_profiler('begin', 'equalizer');
+  if strcmpi(algorithms.equalizer, 'MMSE-IRC')
+    % noise and interference covariance from DMRS residuals, each DMRS RE
+    % carries a single layer (ports are in different CDM groups)
+    e = zeros(N_rx_ant, 0);
     for n_layer = 1 : N_layer
-      [H_est(:,:,n_layer,:), noise_est(n_layer), signal_est(n_layer)] = channel_estimate_SIMO(tx_pilot(:,:,n_layer), reshape(rx_pilot(:,:,n_layer,:), [dmrs_per_rb*n_PRB_sched,symbols_dmrs,N_rx_ant]), k_dmrs(:,n_layer)+1, l_dmrs+1, [frame_cfg.N_sc_RB*n_PRB_sched,symbols_sched], algorithms.chan_est_avg, algorithms.chan_est, frame_cfg.N_fft);
+      H_p = reshape(H_est(k_dmrs(:,n_layer)-n_PRB_start*dmrs_per_rb+1,l_dmrs+1,n_layer,:), [], N_rx_ant);
+      y_p = reshape(rx_pilot(:,:,n_layer,:), [], N_rx_ant);
+      e = [e, (y_p - H_p .* reshape(tx_pilot(:,:,n_layer), [], 1)).'];
     end
-    % Equalizer
-    NSR = rms(noise_est) / rms(signal_est);
-    for n_sym = 1:size(a_partial,2)
-      for n_re = 1:size(a_partial,1)
-        Hd = reshape(H_est(n_re,n_sym,:,:), [N_layer,N_rx_ant]).';
-        x_re = reshape(a_partial(n_re,n_sym,:),[],1);
-        if strcmpi(algorithms.equalizer, 'MMSE')
-          % MMSE receiver - 3GPP TR 36.829 V11.1.0 sec. 4.1
-          a_partial_eq(n_re,n_sym,:) = Hd' * inv(Hd * Hd' + NSR * eye(size(Hd))) * x_re;
-        elseif strcmpi(algorithms.equalizer, 'ZF')
-          % ZF receiver
-          a_partial_eq(n_re,n_sym,:) = inv(Hd) * x_re;
-        else
-          error('Equalizer algorithm not supported: %s', algorithms.equalizer);
-        end
-      end
+    N0 = e * e' / size(e,2);
+    N0 = N0 + 1e-2 * real(trace(N0)) / N_rx_ant * eye(N_rx_ant);
+    if ~all(isfinite(N0(:))) || real(trace(N0)) <= 0
+      N0 = rms(noise_est) * eye(N_rx_ant);
     end
   else
-    error('this MIMO configuration is not supported by the equalizer');
+    N0 = rms(noise_est);
   end
+  [a_partial_eq, N0_eq] = mimo_equalizer(a_partial, H_est, N0, algorithms.equalizer);
+  nr_profiler('end', t_prof);
 
   % Resource Element Demapping
+  t_prof = nr_profiler('begin', 'demapping');
   x_idx = 1;
-  x = zeros(symbols_data*n_PRB_sched*frame_cfg.N_sc_RB, N_layer);
-  x_sig_est = zeros(symbols_data*n_PRB_sched*frame_cfg.N_sc_RB, N_layer);
+  x = zeros(symbols_data*n_PRB_sched*frame_cfg.N_sc_RB, N_layer, class(a_partial));
+  x_N0 = zeros(symbols_data*n_PRB_sched*frame_cfg.N_sc_RB, N_layer, class(a_partial));
+  nr_profiler('alloc', x);
+  nr_profiler('alloc', x_N0);
+  nr_profiler('count', 're', numel(x));
   for l = 0 : symbols_sched - 1
     if ~ismember(l, l_dmrs)
-      for n_layer = 1 : N_rx_ant
+      for n_layer = 1 : N_layer
         x(x_idx:x_idx+n_PRB_sched*frame_cfg.N_sc_RB-1,n_layer) = a_partial_eq(:,l+1,n_layer);
-        x_sig_est(x_idx:x_idx+n_PRB_sched*frame_cfg.N_sc_RB-1,n_layer) = rms(H_est(:,l+1,n_layer,:), 4);
+        x_N0(x_idx:x_idx+n_PRB_sched*frame_cfg.N_sc_RB-1,n_layer) = N0_eq(:,l+1,n_layer);
       end
       x_idx = x_idx + n_PRB_sched*frame_cfg.N_sc_RB;
     end
   end
 
   d = nr_38_211_layer_demapping(x, N_layer);
-  d_sig_est = nr_38_211_layer_demapping(x_sig_est, N_layer);
+  d_N0 = nr_38_211_layer_demapping(x_N0, N_layer);
 
-  bs = modulation_demapper_soft(d, Q_m, algorithms.demodulation_method, rms(noise_est) ./ d_sig_est);
-  b = nr_38_211_sch_scrambling(bs, n_rnti, higher_layer_params.Data_scrambling_Identity);
+  if isfield(algorithms, 'fused_backend') && algorithms.fused_backend && ...
+     any(strcmpi(algorithms.demodulation_method, {'Approx LLR', 'Approx LLR PAM'}))
+    % demapping and descrambling deferred to nr_sch_decode
+    b = struct();
+    b.d = d;
+    b.N0 = d_N0;
+    b.c_init = n_rnti * 2^15 + higher_layer_params.Data_scrambling_Identity;
+  else
+    bs = modulation_demapper_soft(d, Q_m, algorithms.demodulation_method, d_N0);
+    b = nr_38_211_sch_scrambling(bs, n_rnti, higher_layer_params.Data_scrambling_Identity);
+  end
+  nr_profiler('end', t_prof);
   
   if nargout > 1
     evm_dmrs = zeros(N_layer,1);
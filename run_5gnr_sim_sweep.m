@@ -19,9 +19,15 @@ alg = nr_algorithms_struct();
 alg.chan_est = 'MMSE'; % 'LS'
 alg.sto_est = 'dft'; % 'prony'
 alg.cfo_est = 'none'; % 'prony'
-alg.equalizer = 'MMSE'; % 'ZF'
+alg.equalizer = 'MMSE'; % 'ZF', 'MMSE-IRC'
 alg.chan_est_avg = [3,0];
-alg.demodulation_method = 'Approx LLR';
+alg.demodulation_method = 'Approx LLR'; % 'Approx LLR PAM'
+alg.fused_backend = false; % true - demap, descramble and rate unmatch in one step
+alg.ldpc_decoder = 'SPA'; % 'Layered NMS', 'Layered OMS'
+alg.ldpc_num_threads = 1; % 0 - all CPU cores
+alg.precision = 'double'; % 'single'
+alg.llr_format = 'double'; % 'int16', 'int8'
+alg.llr_scale = []; % default scale of the LLR format
 
 channel = struct();
 channel.MIMO_corr = [0, 0];
@@ -31,6 +37,7 @@ channel.method = 'zheng';
 channel.pdp_resample_meth = 'simple';
 channel.pdp_reduce_N = 10;
 channel.normalize_response = true;
+channel.tdl_block_len = 0; % > 0 - FFT convolution, channel constant within blocks
 
 frame_cfg = nr_framing_constants(FR, scs, band);
 
@@ -53,22 +60,53 @@ UE(1).PUSCH_symbols_sched = 13;
 UE(1).tx_filter = radio_filter(153, frame_cfg);
 UE(1).higher_layer_parameters = hlp;
 UE(1).algorithms = alg;
+UE(1).harq_max_tx = 1; % > 1 - HARQ retransmissions with soft combining
 
 rng(0);
 
-if 1
+mode = 'single'; % 'sweep', 'search', 'precision'
+
+if strcmpi(mode, 'single')
   nr_sch_link_level_sim(frame_cfg, sim_dur_slots, UE, N_ant_eNB_RX, channel, SNR)
+elseif strcmpi(mode, 'search')
+  % SNR thresholds of BLER targets and MCS switching tables
+  MCS = 0 : 2 : 26;
+  BLER_target = [0.1, 0.01];
+
+  search_cfg = struct();
+  search_cfg.SNR_range = [-10, 30];
+  search_cfg.SNR_tol = 0.25;
+
+  res = nr_sch_snr_search(frame_cfg, UE(1), N_ant_eNB_RX, channel, MCS, BLER_target, search_cfg);
+
+  figure; hold on;
+  for j = 1 : length(BLER_target)
+    plot(res.SNR_threshold(:,j), MCS, 'o-', 'DisplayName', sprintf('BLER %g', BLER_target(j)));
+  end
+  hold off; grid on; xlabel('SNR'); ylabel('MCS'); legend show;
+elseif strcmpi(mode, 'precision')
+  % SNR loss of reduced-precision receivers at BLER targets
+  MCS = 0 : 4 : 24;
+  BLER_target = [0.1, 0.01];
+
+  precision_cfg = struct('precision', {'single', 'single', 'single'}, ...
+                         'llr_format', {'double', 'int16', 'int8'}, ...
+                         'llr_scale', {[], [], []});
+
+  nr_precision_report(frame_cfg, UE(1), N_ant_eNB_RX, channel, MCS, BLER_target, precision_cfg);
 else
   SNR = -10 : 1 : 25;
   MCS = [0, 5, 10, 15, 20];
-  
-  for j = 1 : length(MCS)
-    for i = 1 : length(SNR)
-      UEl = UE(1);
-      UEl.I_mcs = MCS(j);
-      res(i,j) = nr_sch_link_level_sim(frame_cfg, sim_dur_slots, UEl, N_ant_eNB_RX, channel, SNR(i));
-    end
-  end
+
+  % start a parallel pool (parpool) to spread the sweep over all cores
+  sweep_cfg = struct();
+  sweep_cfg.batch_slots = 20;
+  sweep_cfg.max_slots = 2000;
+  sweep_cfg.min_tb_err = 100;
+  sweep_cfg.ci_rel = 0.1;
+  sweep_cfg.checkpoint = 'sim_sweep_checkpoint.mat';
+
+  res = nr_sch_sim_sweep(frame_cfg, UE(1), N_ant_eNB_RX, channel, SNR, MCS, sweep_cfg);
   
   figure; hold on;
   for j = 1 : length(MCS)
@@ -81,4 +119,10 @@ else
     plot(SNR, [res(:,j).BLER], 'DisplayName', sprintf('MCS %d', MCS(j)));
   end
   hold off; grid on; xlabel('SNR'); ylabel('BLER'); legend show;
+
+  figure; hold on;
+  for j = 1 : length(MCS)
+    plot(SNR, [res(:,j).throughput] / 1e6, 'DisplayName', sprintf('MCS %d', MCS(j)));
+  end
+  hold off; grid on; xlabel('SNR'); ylabel('Throughput [Mbit/s]'); legend show;
 end
\ No newline at end of file
@@ -0,0 +1,24 @@
+%rng_substream(seed, substream)
+%
+% Selects a substream of the mrg32k3a random number generator as the
+% global random stream. Substreams of the same seed are statistically
+% independent, so that parallel simulation tasks given distinct substream
+% numbers are reproducible regardless of the order of their execution.
+%
+% Arguments:
+%  seed      - seed of the generator
+%  substream - substream number (positive integer)
+
+% Copyright 2019 Grzegorz Cisek (grzegorzcisek@gmail.com)
+
+function rng_substream(seed, substream)
+  try
+    s = RandStream('mrg32k3a', 'Seed', seed);
+    s.Substream = substream;
+    RandStream.setGlobalStream(s);
+  catch
+    % no RandStream class (Octave)
+    rand('state', [seed; substream]);
+    randn('state', [seed; substream]);
+  end
+end